@@ -0,0 +1,162 @@
+#include <benchmark/benchmark.h>
+
+#include <linux/can.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cubemars_hardware/codec.hpp"
+#include "cubemars_hardware/statistics.hpp"
+#include "cubemars_hardware/tx_scheduler.hpp"
+
+using cubemars_hardware::JointCodec;
+using cubemars_hardware::ServoFeedback;
+using cubemars_hardware::TxScheduler;
+
+namespace
+{
+// one status message per joint, as received in one control cycle
+std::vector<struct can_frame> make_frames(std::size_t n)
+{
+  std::vector<struct can_frame> frames(n);
+  for (std::size_t i = 0; i < n; i++)
+  {
+    frames[i].can_id = i + 1;
+    frames[i].len = 8;
+    std::uint8_t data[8] = {0x01, 0x2C, 0x00, 0x64, 0xFF, 0x9C, 30, 0};
+    std::copy(data, data + 8, frames[i].data);
+  }
+  return frames;
+}
+
+// read() and write() with the conversions looked up from the URDF parameters every cycle
+void BM_ParameterLookup(benchmark::State & state)
+{
+  const std::size_t n = state.range(0);
+  std::vector<struct can_frame> frames = make_frames(n);
+  std::vector<std::uint32_t> can_ids;
+  std::vector<std::unordered_map<std::string, std::string>> parameters(n);
+  std::vector<double> erpm_conversions;
+  std::vector<double> torque_constants;
+  for (std::size_t i = 0; i < n; i++)
+  {
+    can_ids.push_back(i + 1);
+    parameters[i]["gear_ratio"] = "10";
+    erpm_conversions.push_back(21 * 10 * 60 / (2 * M_PI));
+    torque_constants.push_back(0.123);
+  }
+  std::vector<double> positions(n), velocities(n), efforts(n);
+  std::uint8_t data[4];
+
+  for (auto _ : state)
+  {
+    for (const struct can_frame & frame : frames)
+    {
+      auto it = std::find(can_ids.begin(), can_ids.end(), frame.can_id);
+      std::size_t i = std::distance(can_ids.begin(), it);
+      positions[i] = std::int16_t(frame.data[0] << 8 | frame.data[1]) * 0.1 * M_PI / 180;
+      velocities[i] = std::int16_t(frame.data[2] << 8 | frame.data[3]) * 10 / erpm_conversions[i];
+      efforts[i] = std::int16_t(frame.data[4] << 8 | frame.data[5]) * 0.01 * torque_constants[i] *
+        std::stoi(parameters[i].at("gear_ratio"));
+    }
+    for (std::size_t i = 0; i < n; i++)
+    {
+      std::int32_t current = efforts[i] * 1000 / torque_constants[i];
+      JointCodec::encode(current, data);
+      benchmark::DoNotOptimize(data);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// read() and write() with the precomputed joint codec
+void BM_JointCodec(benchmark::State & state)
+{
+  const std::size_t n = state.range(0);
+  std::vector<struct can_frame> frames = make_frames(n);
+  JointCodec codec;
+  for (std::size_t i = 0; i < n; i++)
+  {
+    codec.add_joint(0, i + 1, 21, 10, 0.123, 0, 0);
+  }
+  std::vector<double> positions(n), velocities(n), efforts(n);
+  ServoFeedback feedback;
+  std::uint8_t data[4];
+
+  for (auto _ : state)
+  {
+    for (const struct can_frame & frame : frames)
+    {
+      std::uint8_t i = codec.index(0, frame.can_id);
+      JointCodec::decode(frame.data, feedback);
+      positions[i] = codec.position(i, feedback);
+      velocities[i] = codec.velocity(i, feedback);
+      efforts[i] = codec.effort(i, feedback);
+    }
+    for (std::size_t i = 0; i < n; i++)
+    {
+      JointCodec::encode(codec.current_command(i, efforts[i]), data);
+      benchmark::DoNotOptimize(data);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// command selection at 1 kHz on one bus, where half of the joints hold their position
+void BM_TxScheduler(benchmark::State & state)
+{
+  const std::size_t n = state.range(0);
+  JointCodec codec;
+  TxScheduler scheduler;
+  scheduler.configure(0.1, 0.8, 1e6);
+  for (std::size_t i = 0; i < n; i++)
+  {
+    codec.add_joint(0, i + 1, 21, 10, 0.123, 0, 0);
+    scheduler.add_joint(0);
+  }
+  std::uint8_t joints[JointCodec::MAX_JOINTS];
+  std::uint8_t data[4];
+  std::uint64_t bits = 1;
+  std::int64_t now = 1000000000;
+  std::size_t frames = 0;
+
+  for (auto _ : state)
+  {
+    for (std::size_t i = 0; i < n; i++)
+    {
+      const double position = i % 2 == 0 ? std::sin(now * 1e-9) : 1.0;
+      JointCodec::encode(codec.position_command(i, position), data);
+      scheduler.submit(i, (i + 1) | 4 << 8, data, 4, false);
+    }
+    const std::size_t sent = scheduler.schedule(now, 0.001, &bits, joints);
+    for (std::size_t k = 0; k < sent; k++)
+    {
+      scheduler.sent(joints[k], now);
+    }
+    benchmark::DoNotOptimize(joints);
+    // selected commands and the status messages sent in reply
+    bits += sent * (cubemars_hardware::can_frame_bits(4) + cubemars_hardware::can_frame_bits(8));
+    frames += sent;
+    now += 1000000;
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  state.counters["frames/cycle"] = double(frames) / state.iterations();
+  std::uint64_t deferred = 0;
+  for (std::size_t i = 0; i < n; i++)
+  {
+    deferred += scheduler.deferred(i);
+  }
+  state.counters["deferred"] = deferred;
+}
+}  // namespace
+
+BENCHMARK(BM_ParameterLookup)->RangeMultiplier(2)->Range(1, JointCodec::MAX_JOINTS);
+BENCHMARK(BM_JointCodec)->RangeMultiplier(2)->Range(1, JointCodec::MAX_JOINTS);
+BENCHMARK(BM_TxScheduler)->RangeMultiplier(2)->Range(1, JointCodec::MAX_JOINTS);
+
+BENCHMARK_MAIN();
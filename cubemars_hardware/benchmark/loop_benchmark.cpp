@@ -0,0 +1,112 @@
+// Round trip of one control cycle against the servo emulator.
+// Requires a vcan interface (CUBEMARS_VCAN, default vcan0):
+//   sudo modprobe vcan
+//   sudo ip link add dev vcan0 type vcan
+//   sudo ip link set vcan0 mtu 72
+//   sudo ip link set vcan0 up
+// The CAN FD cases are skipped if the MTU of the interface is not 72.
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cubemars_hardware/can.hpp"
+#include "cubemars_hardware/codec.hpp"
+#include "cubemars_hardware/emulator.hpp"
+
+using cubemars_hardware::CanSocket;
+using cubemars_hardware::JointCodec;
+using cubemars_hardware::ServoEmulator;
+
+namespace
+{
+// send one current command per joint and wait for the status message of every joint
+void BM_CommandFeedbackLoop(benchmark::State & state)
+{
+  const std::size_t n = state.range(0);
+  const bool fd = state.range(1) != 0;
+  const char * env = std::getenv("CUBEMARS_VCAN");
+  const std::string can_itf = env != nullptr ? env : "vcan0";
+
+  ServoEmulator::Config config;
+  config.feedback_rate = 0;
+  config.reply_to_commands = true;
+  config.fd = fd;
+  std::vector<canid_t> can_ids;
+  JointCodec codec;
+  for (std::size_t i = 0; i < n; i++)
+  {
+    config.can_ids.push_back(i + 1);
+    can_ids.push_back(i + 1);
+    codec.add_joint(0, i + 1, 21, 10, 0.123, 0, 0);
+  }
+
+  ServoEmulator emulator(config);
+  if (!emulator.open(can_itf))
+  {
+    state.SkipWithError(
+      fd ? "vcan interface without CAN FD support" : "vcan interface not available");
+    return;
+  }
+  std::atomic<bool> running{true};
+  std::thread emulator_thread([&]() {emulator.run(running);});
+
+  CanSocket can;
+  if (!can.connect(can_itf, can_ids, 0xFFU, fd))
+  {
+    running = false;
+    emulator_thread.join();
+    state.SkipWithError("could not connect to vcan interface");
+    return;
+  }
+
+  struct canfd_frame frames[CanSocket::MAX_BATCH];
+  std::uint8_t data[4];
+  bool received[JointCodec::MAX_JOINTS];
+  for (auto _ : state)
+  {
+    for (std::size_t i = 0; i < n; i++)
+    {
+      JointCodec::encode(codec.current_command(i, 0.1), data);
+      can.queue_message(can_ids[i] | 1 << 8, data, 4);
+      received[i] = false;
+    }
+    can.flush();
+
+    std::size_t missing = n;
+    while (missing > 0)
+    {
+      std::size_t k = can.read_batch(frames, CanSocket::MAX_BATCH, 100);
+      if (k == 0)
+      {
+        state.SkipWithError("timeout waiting for status messages");
+        break;
+      }
+      for (std::size_t j = 0; j < k; j++)
+      {
+        std::uint8_t i = codec.index(0, frames[j].can_id);
+        if (i != JointCodec::NO_JOINT && !received[i])
+        {
+          received[i] = true;
+          missing--;
+        }
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+
+  running = false;
+  emulator_thread.join();
+  can.disconnect();
+}
+}  // namespace
+
+BENCHMARK(BM_CommandFeedbackLoop)
+->ArgsProduct({benchmark::CreateRange(1, JointCodec::MAX_JOINTS, 2), {0, 1}})
+->ArgNames({"joints", "fd"})
+->UseRealTime();
+
+BENCHMARK_MAIN();
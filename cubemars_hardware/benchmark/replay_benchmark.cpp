@@ -0,0 +1,160 @@
+// Recording overhead and replay throughput of recorded CAN traffic.
+// Replays the log in CUBEMARS_LOG if set, otherwise a synthetic recording
+// of 32 joints with one status message per joint and cycle. The joints of
+// a given log must have the CAN IDs 1 to 32 on the first interface.
+#include <benchmark/benchmark.h>
+
+#include <linux/can.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <string>
+
+#include "cubemars_hardware/codec.hpp"
+#include "cubemars_hardware/recorder.hpp"
+#include "cubemars_hardware/system.hpp"
+
+using cubemars_hardware::CanLog;
+using cubemars_hardware::CanRecorder;
+using cubemars_hardware::CubeMarsSystemHardware;
+using cubemars_hardware::JointCodec;
+
+namespace
+{
+std::string temp_log(const char * name)
+{
+  const char * tmp = std::getenv("TMPDIR");
+  return std::string(tmp != nullptr ? tmp : "/tmp") + "/" + name + "_" +
+         std::to_string(getpid()) + ".log";
+}
+
+// append frames to a preallocated log
+void BM_Record(benchmark::State & state)
+{
+  const std::string path = temp_log("cubemars_record");
+  CanRecorder recorder;
+  const std::size_t max_frames = 1 << 20;
+  if (!recorder.open(path, max_frames))
+  {
+    state.SkipWithError("could not create log file");
+    return;
+  }
+  std::uint8_t data[8] = {0x01, 0x2C, 0x00, 0x64, 0xFF, 0x9C, 30, 0};
+  std::size_t frames = 0;
+
+  for (auto _ : state)
+  {
+    if (frames++ == max_frames)
+    {
+      // start over instead of measuring dropped frames
+      state.PauseTiming();
+      recorder.open(path, max_frames);
+      frames = 1;
+      state.ResumeTiming();
+    }
+    recorder.record(cubemars_hardware::monotonic_ns(), 0, 0x2901, data, 8, 0);
+  }
+  state.SetItemsProcessed(state.iterations());
+  recorder.close();
+  unlink(path.c_str());
+}
+
+// read() of the hardware interface replaying a log, one update period of 1 ms per read()
+void BM_ReplayRead(benchmark::State & state)
+{
+  const char * env = std::getenv("CUBEMARS_LOG");
+  std::string path = env != nullptr ? env : "";
+  if (path.empty())
+  {
+    path = temp_log("cubemars_replay");
+    CanRecorder recorder;
+    if (!recorder.open(path, 100000 * JointCodec::MAX_JOINTS))
+    {
+      state.SkipWithError("could not create log file");
+      return;
+    }
+    std::int64_t stamp = 0;
+    for (std::size_t cycle = 0; cycle < 100000; cycle++, stamp += 1000000)
+    {
+      for (std::size_t i = 0; i < JointCodec::MAX_JOINTS; i++)
+      {
+        std::uint8_t data[8] = {std::uint8_t(cycle >> 8), std::uint8_t(cycle), 0x00, 0x64, 0xFF,
+          0x9C, 30, std::uint8_t(cycle % 1000 == 0 ? 7 : 0)};
+        recorder.record(stamp + i * 1000, 0, 0x2900 | (i + 1), data, 8, 0);
+      }
+    }
+    recorder.close();
+  }
+
+  // number of updates needed to replay the whole log
+  CanLog log;
+  if (!log.open(path) || log.size() == 0)
+  {
+    state.SkipWithError("could not open log file");
+    return;
+  }
+  const std::int64_t period = 1000000;
+  const std::size_t frames = log.size();
+  const std::size_t updates = (log[frames - 1].stamp - log[0].stamp) / period + 1;
+  log.close();
+
+  // joints with the CAN IDs 1 to MAX_JOINTS on one interface, as in the synthetic log
+  hardware_interface::HardwareInfo info;
+  info.name = "replay_benchmark";
+  info.hardware_parameters["can_interface"] = "can0";
+  info.hardware_parameters["replay_file"] = path;
+  info.hardware_parameters["statistics_rate"] = "0";
+  for (std::size_t i = 0; i < JointCodec::MAX_JOINTS; i++)
+  {
+    hardware_interface::ComponentInfo joint;
+    joint.name = "joint" + std::to_string(i + 1);
+    joint.parameters["can_id"] = std::to_string(i + 1);
+    joint.parameters["pole_pairs"] = "21";
+    joint.parameters["gear_ratio"] = "10";
+    joint.parameters["kt"] = "0.123";
+    info.joints.push_back(joint);
+  }
+
+  CubeMarsSystemHardware hardware;
+  const rclcpp_lifecycle::State lifecycle_state;
+  if (hardware.on_init(info) != hardware_interface::CallbackReturn::SUCCESS ||
+    hardware.on_configure(lifecycle_state) != hardware_interface::CallbackReturn::SUCCESS)
+  {
+    state.SkipWithError("could not configure the hardware interface");
+    return;
+  }
+  hardware.on_activate(lifecycle_state);
+
+  const rclcpp::Time time;
+  const rclcpp::Duration duration = rclcpp::Duration::from_nanoseconds(period);
+  for (auto _ : state)
+  {
+    for (std::size_t k = 0; k < updates; k++)
+    {
+      hardware.read(time, duration);
+    }
+
+    // start the log over
+    state.PauseTiming();
+    hardware.on_cleanup(lifecycle_state);
+    hardware.on_configure(lifecycle_state);
+    hardware.on_activate(lifecycle_state);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * frames);
+  state.counters["frames"] = frames;
+  state.counters["updates"] = updates;
+
+  hardware.on_deactivate(lifecycle_state);
+  hardware.on_cleanup(lifecycle_state);
+  if (env == nullptr)
+  {
+    unlink(path.c_str());
+  }
+}
+}  // namespace
+
+BENCHMARK(BM_Record);
+BENCHMARK(BM_ReplayRead)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
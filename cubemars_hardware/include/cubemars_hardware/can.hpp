@@ -1,16 +1,20 @@
 #ifndef CUBEMARS_HARDWARE__CAN_HPP_
 #define CUBEMARS_HARDWARE__CAN_HPP_
 
+#include <atomic>
 #include <string>
 #include <vector>
  #include <cstdint>
 #include <linux/can.h>
+#include <sys/socket.h>
+
+#include "cubemars_hardware/recorder.hpp"
 
 namespace cubemars_hardware
 {
 
 /**
- * @brief SocketCAN interface for extended frame format
+ * @brief SocketCAN interface for extended frame format, optionally with CAN FD frames
  */
 class CanSocket
 {
@@ -20,12 +24,21 @@ public:
    * @param can_itf CAN interface name
    * @param can_ids CAN IDs of interest
    * @param can_mask CAN IDs mask
+   * @param fd Send CAN FD frames with bit rate switch, if the interface supports it
+   * @param data_ratio Nominal bitrate divided by the data bitrate, used for bits()
    * @return true on success
    */
-  bool connect(std::string can_itf, const std::vector<canid_t> & can_ids, canid_t can_mask);
+  bool connect(
+    std::string can_itf, const std::vector<canid_t> & can_ids, canid_t can_mask, bool fd = false,
+    double data_ratio = 1);
+
+  /**
+   * @brief Whether CAN FD frames are sent
+   */
+  bool is_fd() const {return fd_;}
 
   /**
-   * @brief Disconnect from CAN bus
+   * @brief Disconnect from CAN bus, does nothing if not connected
    * @return true on success
    */
   bool disconnect();
@@ -40,24 +53,102 @@ public:
   bool write_message(std::uint32_t id, const std::uint8_t data[], std::uint8_t len);
 
   /**
-   * @brief Read message from CAN bus without blocking
+   * @brief Maximum number of messages in one batch
+   */
+  static constexpr std::size_t MAX_BATCH = 64;
+
+  /**
+   * @brief Queue message to be written to CAN bus with the next flush()
    * @param id CAN extended identifier
-   * @param data Data to be received
-   * @param len Received number of bytes of data (0-8)
-   * @return true on success
+   * @param data Data to be transmitted
+   * @param len Number of bytes of data (0-8)
+   * @return true on success, false if the queue is full
+   */
+  bool queue_message(std::uint32_t id, const std::uint8_t data[], std::uint8_t len);
+
+  /**
+   * @brief Write all queued messages to CAN bus with a single system call
+   * @return Number of messages written, the first ones in the order they were queued
+   */
+  std::size_t flush();
+
+  /**
+   * @brief Read up to max_frames messages from CAN bus with a single system call
+   * @param frames Received classic or CAN FD frames, the identifiers are already masked
+   * @param max_frames Size of frames (at most MAX_BATCH)
+   * @param timeout_ms Maximum time to wait for the first message, 0 to not block
+   * @param stamps Optional kernel receive time of every frame in ns (CLOCK_REALTIME)
+   * @return Number of received messages, 0 if there were none
+   */
+  std::size_t read_batch(
+    struct canfd_frame frames[], std::size_t max_frames, int timeout_ms,
+    std::int64_t stamps[] = nullptr);
+
+  /**
+   * @brief Number of nominal bit times written and read so far, without stuff bits (any thread)
+   */
+  std::uint64_t bits() const {return bits_.load(std::memory_order_relaxed);}
+
+  /**
+   * @brief File descriptor of the socket, to wait on multiple interfaces at once
+   * @return Socket file descriptor, negative if not connected
    */
-  bool read_nonblocking(std::uint32_t & id, std::uint8_t data[], std::uint8_t & len);
+  int fd() const {return socket_;}
+
+  /**
+   * @brief Record all transmitted and received frames
+   * @param recorder Open recorder, shared by all interfaces, or nullptr to stop recording
+   * @param bus Index of this interface in the log
+   */
+  void set_recorder(CanRecorder * recorder, std::uint8_t bus);
 
 private:
   /**
-   * @brief SocketCAN socket number
+   * @brief SocketCAN socket number, -1 if not connected
    */
-  int socket_;
+  int socket_ = -1;
 
   /**
    * @brief CAN IDs mask
    */
   std::uint32_t can_mask_;
+
+  /**
+   * @brief CAN FD frames and their data phase speed up
+   */
+  bool fd_ = false;
+  double data_ratio_ = 1;
+
+  /**
+   * @brief Count one frame in the bus traffic
+   */
+  void count_frame(std::uint8_t len, bool fd);
+
+  /**
+   * @brief Bus traffic counter
+   */
+  std::atomic<std::uint64_t> bits_{0};
+
+  /**
+   * @brief Optional traffic recorder
+   */
+  CanRecorder * recorder_ = nullptr;
+  std::uint8_t recorder_bus_ = 0;
+
+  /**
+   * @brief Transmit queue and message headers for sendmmsg()
+   */
+  struct canfd_frame tx_frames_[MAX_BATCH];
+  struct iovec tx_iovecs_[MAX_BATCH];
+  struct mmsghdr tx_msgs_[MAX_BATCH];
+  std::size_t tx_count_ = 0;
+
+  /**
+   * @brief Message headers for recvmmsg()
+   */
+  struct iovec rx_iovecs_[MAX_BATCH];
+  struct mmsghdr rx_msgs_[MAX_BATCH];
+  char rx_control_[MAX_BATCH][CMSG_SPACE(sizeof(struct timespec))];
 };
 }
 
@@ -0,0 +1,311 @@
+#ifndef CUBEMARS_HARDWARE__CODEC_HPP_
+#define CUBEMARS_HARDWARE__CODEC_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace cubemars_hardware
+{
+
+/**
+ * @brief Servo mode feedback of one actuator in motor units
+ */
+struct ServoFeedback
+{
+  std::int16_t position;
+  std::int16_t speed;
+  std::int16_t current;
+  std::int8_t temperature;
+  std::uint8_t error;
+};
+
+/**
+ * @brief Unit conversions between joint space and the servo mode CAN protocol
+ *
+ * All factors are computed once from the URDF parameters and stored as flat
+ * arrays, so encoding and decoding does not allocate or parse strings.
+ */
+class JointCodec
+{
+public:
+  /**
+   * @brief Maximum number of joints
+   */
+  static constexpr std::size_t MAX_JOINTS = 32;
+
+  /**
+   * @brief Maximum number of CAN buses
+   */
+  static constexpr std::size_t MAX_BUSES = 4;
+
+  /**
+   * @brief Index returned for CAN IDs which do not belong to a joint
+   */
+  static constexpr std::uint8_t NO_JOINT = 0xFF;
+
+  /**
+   * @brief Ranges of the impedance gains, the same for all actuator models
+   */
+  static constexpr double KP_MAX = 500;
+  static constexpr double KD_MAX = 5;
+
+  JointCodec();
+
+  /**
+   * @brief Add joint and precompute its conversion factors
+   * @param bus Index of the CAN bus the actuator is connected to
+   * @param can_id CAN ID of the actuator (0-255)
+   * @param pole_pairs Pole pairs of the motor
+   * @param gear_ratio Gear ratio of the actuator
+   * @param kt Torque constant
+   * @param enc_off Encoder offset in rad
+   * @param trq_limit Torque limit, 0 to disable
+   * @return true on success, false if the codec is full or the CAN ID is invalid or used twice on the bus
+   */
+  bool add_joint(
+    std::size_t bus, std::uint32_t can_id, int pole_pairs, int gear_ratio, double kt, double enc_off,
+    double trq_limit);
+
+  /**
+   * @brief Set the velocity and acceleration limits for Position-Speed Loop Mode
+   * @param i Joint index
+   * @param vel_limit Velocity limit in protocol units (10 ERPM)
+   * @param acc_limit Acceleration limit in protocol units (10 ERPM/s)
+   */
+  void set_limits(std::size_t i, std::int16_t vel_limit, std::int16_t acc_limit)
+  {
+    vel_limits_[i] = vel_limit;
+    acc_limits_[i] = acc_limit;
+  }
+
+  /**
+   * @brief Set the ranges of the impedance command, which depend on the actuator model
+   * @param i Joint index
+   * @param p_max Position range in rad (-p_max to p_max)
+   * @param v_max Velocity range in rad/s (-v_max to v_max)
+   * @param t_max Torque range in Nm (-t_max to t_max)
+   */
+  void set_impedance_ranges(std::size_t i, double p_max, double v_max, double t_max)
+  {
+    p_maxs_[i] = p_max;
+    v_maxs_[i] = v_max;
+    t_maxs_[i] = t_max;
+  }
+
+  /**
+   * @brief Number of joints
+   */
+  std::size_t size() const {return size_;}
+
+  /**
+   * @brief Joint index of a CAN ID
+   * @param bus Index of the CAN bus
+   * @param can_id CAN ID
+   * @return Joint index or NO_JOINT
+   */
+  std::uint8_t index(std::size_t bus, std::uint32_t can_id) const
+  {
+    return can_id < 256 ? index_[bus][can_id] : NO_JOINT;
+  }
+
+  /**
+   * @brief Decode servo mode status message
+   * @param data Received data (8 bytes)
+   * @param feedback Decoded feedback
+   */
+  static void decode(const std::uint8_t data[], ServoFeedback & feedback)
+  {
+    feedback.position = data[0] << 8 | data[1];
+    feedback.speed = data[2] << 8 | data[3];
+    feedback.current = data[4] << 8 | data[5];
+    feedback.temperature = data[6];
+    feedback.error = data[7];
+  }
+
+  /**
+   * @brief Encode servo mode status message
+   * @param feedback Feedback to be transmitted
+   * @param data Data to be transmitted (8 bytes)
+   */
+  static void encode(const ServoFeedback & feedback, std::uint8_t data[])
+  {
+    data[0] = feedback.position >> 8;
+    data[1] = feedback.position;
+    data[2] = feedback.speed >> 8;
+    data[3] = feedback.speed;
+    data[4] = feedback.current >> 8;
+    data[5] = feedback.current;
+    data[6] = feedback.temperature;
+    data[7] = feedback.error;
+  }
+
+  /**
+   * @brief Encode impedance command as position (16 bit), velocity, stiffness, damping and
+   * torque (12 bit each), all linearly mapped from their range
+   * @param p_max Position range in rad
+   * @param v_max Velocity range in rad/s
+   * @param t_max Torque range in Nm
+   * @param values Position, velocity, stiffness, damping and torque, clamped to their range
+   * @param data Data to be transmitted (8 bytes)
+   */
+  static void encode_impedance(
+    double p_max, double v_max, double t_max, const double values[5], std::uint8_t data[])
+  {
+    const std::uint32_t p = to_uint(values[0], -p_max, p_max, 16);
+    const std::uint32_t v = to_uint(values[1], -v_max, v_max, 12);
+    const std::uint32_t kp = to_uint(values[2], 0, KP_MAX, 12);
+    const std::uint32_t kd = to_uint(values[3], 0, KD_MAX, 12);
+    const std::uint32_t t = to_uint(values[4], -t_max, t_max, 12);
+    data[0] = p >> 8;
+    data[1] = p;
+    data[2] = v >> 4;
+    data[3] = (v & 0xF) << 4 | kp >> 8;
+    data[4] = kp;
+    data[5] = kd >> 4;
+    data[6] = (kd & 0xF) << 4 | t >> 8;
+    data[7] = t;
+  }
+
+  /**
+   * @brief Decode impedance command
+   * @param p_max Position range in rad
+   * @param v_max Velocity range in rad/s
+   * @param t_max Torque range in Nm
+   * @param data Received data (8 bytes)
+   * @param values Position, velocity, stiffness, damping and torque
+   */
+  static void decode_impedance(
+    double p_max, double v_max, double t_max, const std::uint8_t data[], double values[5])
+  {
+    values[0] = to_double(data[0] << 8 | data[1], -p_max, p_max, 16);
+    values[1] = to_double(data[2] << 4 | data[3] >> 4, -v_max, v_max, 12);
+    values[2] = to_double((data[3] & 0xF) << 8 | data[4], 0, KP_MAX, 12);
+    values[3] = to_double(data[5] << 4 | data[6] >> 4, 0, KD_MAX, 12);
+    values[4] = to_double((data[6] & 0xF) << 8 | data[7], -t_max, t_max, 12);
+  }
+
+  /**
+   * @brief Encode 32 bit command value in big endian byte order
+   * @param value Command value
+   * @param data Data to be transmitted (4 bytes)
+   */
+  static void encode(std::int32_t value, std::uint8_t data[])
+  {
+    data[0] = value >> 24;
+    data[1] = value >> 16;
+    data[2] = value >> 8;
+    data[3] = value;
+  }
+
+  double position(std::size_t i, const ServoFeedback & feedback) const
+  {
+    return feedback.position * POSITION_SCALE - enc_offs_[i];
+  }
+
+  double velocity(std::size_t i, const ServoFeedback & feedback) const
+  {
+    return feedback.speed * velocity_scales_[i];
+  }
+
+  double effort(std::size_t i, const ServoFeedback & feedback) const
+  {
+    return feedback.current * effort_scales_[i];
+  }
+
+  std::int32_t current_command(std::size_t i, double effort) const
+  {
+    return effort * current_scales_[i];
+  }
+
+  std::int32_t speed_command(std::size_t i, double velocity) const
+  {
+    return velocity * erpm_conversions_[i];
+  }
+
+  std::int32_t position_command(std::size_t i, double position) const
+  {
+    return (position + enc_offs_[i]) * POSITION_COMMAND_SCALE;
+  }
+
+  /**
+   * @brief Encode impedance command of a joint, see encode_impedance()
+   * @param i Joint index
+   * @param values Position in rad, velocity in rad/s, stiffness in Nm/rad, damping in Nms/rad
+   * and feed-forward torque in Nm
+   * @param data Data to be transmitted (8 bytes)
+   * @return -1 on success, otherwise the index of the first value out of range
+   */
+  int impedance_command(std::size_t i, const double values[5], std::uint8_t data[]) const
+  {
+    const double command[5] = {values[0] + enc_offs_[i], values[1], values[2], values[3], values[4]};
+    const double mins[5] = {-p_maxs_[i], -v_maxs_[i], 0, 0, -t_maxs_[i]};
+    const double maxs[5] = {p_maxs_[i], v_maxs_[i], KP_MAX, KD_MAX, t_maxs_[i]};
+    for (int k = 0; k < 5; k++)
+    {
+      if (command[k] < mins[k] || command[k] > maxs[k])
+      {
+        return k;
+      }
+    }
+    encode_impedance(p_maxs_[i], v_maxs_[i], t_maxs_[i], command, data);
+    return -1;
+  }
+
+  bool over_torque_limit(std::size_t i, double effort) const
+  {
+    return trq_limits_[i] != 0 && effort > trq_limits_[i];
+  }
+
+  bool has_limits(std::size_t i) const
+  {
+    return vel_limits_[i] != 0 && acc_limits_[i] != 0;
+  }
+
+  /**
+   * @brief Whether the ranges of the impedance command are set, impedance mode requires them
+   */
+  bool has_impedance_ranges(std::size_t i) const
+  {
+    return p_maxs_[i] > 0 && v_maxs_[i] > 0 && t_maxs_[i] > 0;
+  }
+
+  std::int16_t vel_limit(std::size_t i) const {return vel_limits_[i];}
+
+  std::int16_t acc_limit(std::size_t i) const {return acc_limits_[i];}
+
+  double erpm_conversion(std::size_t i) const {return erpm_conversions_[i];}
+
+private:
+  static constexpr double POSITION_SCALE = 0.1 * M_PI / 180;
+  static constexpr double POSITION_COMMAND_SCALE = 10000 * 180 / M_PI;
+
+  static std::uint32_t to_uint(double value, double min, double max, int bits)
+  {
+    const double scaled = (value - min) / (max - min) * ((1 << bits) - 1);
+    return scaled <= 0 ? 0 : scaled >= (1 << bits) - 1 ? (1 << bits) - 1 : std::lround(scaled);
+  }
+
+  static double to_double(std::uint32_t value, double min, double max, int bits)
+  {
+    return min + value * (max - min) / ((1 << bits) - 1);
+  }
+
+  alignas(64) double enc_offs_[MAX_JOINTS];
+  alignas(64) double velocity_scales_[MAX_JOINTS];
+  alignas(64) double effort_scales_[MAX_JOINTS];
+  alignas(64) double current_scales_[MAX_JOINTS];
+  alignas(64) double erpm_conversions_[MAX_JOINTS];
+  alignas(64) double trq_limits_[MAX_JOINTS];
+  alignas(64) std::int16_t vel_limits_[MAX_JOINTS];
+  alignas(64) std::int16_t acc_limits_[MAX_JOINTS];
+  alignas(64) double p_maxs_[MAX_JOINTS];
+  alignas(64) double v_maxs_[MAX_JOINTS];
+  alignas(64) double t_maxs_[MAX_JOINTS];
+  alignas(64) std::uint8_t index_[MAX_BUSES][256];
+  std::size_t size_;
+};
+
+}  // namespace cubemars_hardware
+
+#endif  // CUBEMARS_HARDWARE__CODEC_HPP_
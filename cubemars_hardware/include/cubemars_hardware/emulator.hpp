@@ -0,0 +1,148 @@
+#ifndef CUBEMARS_HARDWARE__EMULATOR_HPP_
+#define CUBEMARS_HARDWARE__EMULATOR_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <linux/can.h>
+
+namespace cubemars_hardware
+{
+
+/**
+ * @brief Emulation of CubeMars AK series actuators in servo mode on a SocketCAN interface
+ *
+ * Answers the commands sent by CubeMarsSystemHardware with status messages of a
+ * simple first order motor model. Intended to be used with a vcan interface.
+ */
+class ServoEmulator
+{
+public:
+  struct Config
+  {
+    // CAN IDs of the emulated actuators
+    std::vector<std::uint8_t> can_ids;
+    // rate of the periodic status messages in Hz, 0 to disable
+    double feedback_rate = 500;
+    // send a status message right after every command
+    bool reply_to_commands = false;
+    // pole pairs and gear ratio, used to integrate the position
+    int pole_pairs = 21;
+    int gear_ratio = 10;
+    // time constant of the speed loop in s
+    double time_constant = 0.01;
+    // speed in ERPM per A in current loop
+    double speed_per_current = 1000;
+    // proportional gain of the position loop in ERPM per degree
+    double position_gain = 100;
+    // maximal speed in ERPM
+    double max_speed = 100000;
+    // additional delay of every status message in us
+    std::uint32_t latency_us = 0;
+    // probability that a status message is dropped (0-1)
+    double drop_rate = 0;
+    // accept CAN FD commands and send the status messages as CAN FD frames
+    bool fd = false;
+    // position (rad), velocity (rad/s) and torque ranges of impedance commands
+    double p_max = 12.5;
+    double v_max = 50;
+    double t_max = 25;
+  };
+
+  explicit ServoEmulator(const Config & config);
+  ~ServoEmulator();
+
+  /**
+   * @brief Open CAN interface
+   * @param can_itf CAN interface name
+   * @return true on success, false if the interface is not available or does not support CAN FD
+   */
+  bool open(const std::string & can_itf);
+
+  /**
+   * @brief Close CAN interface
+   */
+  void close();
+
+  /**
+   * @brief Process commands and send status messages until running is false
+   * @param running Keeps the emulator running while true
+   */
+  void run(const std::atomic<bool> & running);
+
+  /**
+   * @brief Report a fault in the status messages of one actuator
+   * @param can_id CAN ID of the actuator
+   * @param error Error code (0 clears the fault)
+   */
+  void inject_fault(std::uint8_t can_id, std::uint8_t error);
+
+  /**
+   * @brief Number of received commands
+   */
+  std::uint64_t commands_received() const {return commands_received_;}
+
+  /**
+   * @brief Number of sent status messages
+   */
+  std::uint64_t feedback_sent() const {return feedback_sent_;}
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  enum control_mode_t : std::uint8_t
+  {
+    CURRENT_LOOP = 1,
+    SPEED_LOOP = 3,
+    POSITION_LOOP = 4,
+    POSITION_SPEED_LOOP = 6,
+    IMPEDANCE = 8,
+    UNDEFINED
+  };
+
+  struct Motor
+  {
+    std::uint8_t can_id;
+    control_mode_t mode = UNDEFINED;
+    double command = 0;
+    double vel_limit = 0;
+    double acc_limit = 0;
+    // position, velocity, stiffness, damping and torque of an impedance command
+    double impedance[5] = {0, 0, 0, 0, 0};
+    // position in degree, speed in ERPM, current in A
+    double position = 0;
+    double speed = 0;
+    double current = 0;
+    std::int8_t temperature = 30;
+    std::atomic<std::uint8_t> error{0};
+  };
+
+  struct PendingFrame
+  {
+    Clock::time_point due;
+    struct canfd_frame frame;
+  };
+
+  void handle_command(const struct canfd_frame & frame);
+  void step(double dt);
+  void queue_feedback(const Motor & motor, Clock::time_point now);
+  void send_due(Clock::time_point now);
+
+  Config config_;
+  std::vector<Motor> motors_;
+  std::deque<PendingFrame> pending_;
+  std::mt19937 rng_;
+  std::uniform_real_distribution<double> uniform_;
+  int socket_;
+  std::atomic<std::uint64_t> commands_received_{0};
+  std::atomic<std::uint64_t> feedback_sent_{0};
+};
+
+}  // namespace cubemars_hardware
+
+#endif  // CUBEMARS_HARDWARE__EMULATOR_HPP_
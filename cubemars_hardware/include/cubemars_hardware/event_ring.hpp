@@ -0,0 +1,74 @@
+#ifndef CUBEMARS_HARDWARE__EVENT_RING_HPP_
+#define CUBEMARS_HARDWARE__EVENT_RING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace cubemars_hardware
+{
+
+/**
+ * @brief Fixed size single producer, single consumer ring buffer
+ *
+ * push() never blocks or allocates. If the consumer falls behind, new
+ * entries are dropped and counted instead.
+ */
+template<typename T, std::size_t N>
+class EventRing
+{
+  static_assert((N & (N - 1)) == 0, "EventRing size must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value, "EventRing requires a trivially copyable type");
+
+public:
+  /**
+   * @brief Add entry (producer thread only)
+   * @param value Entry to be added
+   * @return true on success, false if the ring is full
+   */
+  bool push(const T & value)
+  {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= N)
+    {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    buffer_[head & (N - 1)] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Remove oldest entry (consumer thread only)
+   * @param value Removed entry
+   * @return true on success, false if the ring is empty
+   */
+  bool pop(T & value)
+  {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    value = buffer_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Number of entries dropped because the ring was full
+   */
+  std::uint64_t dropped() const {return dropped_.load(std::memory_order_relaxed);}
+
+private:
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  alignas(64) std::atomic<std::uint64_t> dropped_{0};
+  T buffer_[N];
+};
+
+}  // namespace cubemars_hardware
+
+#endif  // CUBEMARS_HARDWARE__EVENT_RING_HPP_
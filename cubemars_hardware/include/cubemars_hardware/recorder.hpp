@@ -0,0 +1,155 @@
+#ifndef CUBEMARS_HARDWARE__RECORDER_HPP_
+#define CUBEMARS_HARDWARE__RECORDER_HPP_
+
+#include <time.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cubemars_hardware
+{
+
+/**
+ * @brief One CAN frame of a binary log, 24 bytes in host byte order
+ */
+struct RecordedFrame
+{
+  // CLOCK_MONOTONIC time in ns
+  std::int64_t stamp;
+  // extended identifier as on the bus, without flags
+  std::uint32_t can_id;
+  // length of the frame, only the first 8 bytes of data are recorded
+  std::uint8_t len;
+  std::uint8_t flags;
+  // index of the CAN interface in the order of the URDF
+  std::uint8_t bus;
+  std::uint8_t reserved;
+  std::uint8_t data[8];
+
+  static constexpr std::uint8_t TX = 1;
+  static constexpr std::uint8_t FD = 2;
+};
+
+/**
+ * @brief Header at the start of a binary log
+ */
+struct LogHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t frame_size;
+  // number of frames, 0 if the recording was not closed properly
+  std::uint64_t frames;
+};
+
+/**
+ * @brief Monotonic time used for the recorded frames and the feedback deadline of read()
+ * @return Time in ns
+ */
+inline std::int64_t monotonic_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return std::int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Appends CAN frames to a preallocated, memory-mapped binary log
+ *
+ * record() only copies the frame into the mapping and may be called from
+ * multiple threads. Frames which don't fit anymore are dropped and counted.
+ */
+class CanRecorder
+{
+public:
+  ~CanRecorder();
+
+  /**
+   * @brief Create log file and map it into memory
+   * @param path Path of the log file, overwritten if it exists
+   * @param max_frames Maximum number of frames in the log
+   * @return true on success
+   */
+  bool open(const std::string & path, std::size_t max_frames);
+
+  /**
+   * @brief Write number of frames to the header, truncate and close log file
+   */
+  void close();
+
+  /**
+   * @brief Whether a log file is open
+   */
+  bool is_open() const {return frames_ != nullptr;}
+
+  /**
+   * @brief Append one frame (any thread)
+   * @param stamp CLOCK_MONOTONIC time in ns
+   * @param bus Index of the CAN interface
+   * @param id CAN extended identifier
+   * @param data Data of the frame
+   * @param len Number of bytes of data (0-64, only the first 8 are recorded)
+   * @param flags RecordedFrame::TX for transmitted frames, RecordedFrame::FD for CAN FD frames
+   */
+  void record(
+    std::int64_t stamp, std::uint8_t bus, std::uint32_t id, const std::uint8_t data[],
+    std::uint8_t len, std::uint8_t flags);
+
+  /**
+   * @brief Number of frames dropped because the log was full
+   */
+  std::uint64_t dropped() const {return dropped_.load(std::memory_order_relaxed);}
+
+private:
+  int fd_ = -1;
+  void * map_ = nullptr;
+  std::size_t map_size_ = 0;
+  RecordedFrame * frames_ = nullptr;
+  std::size_t capacity_ = 0;
+  std::atomic<std::size_t> next_{0};
+  std::atomic<std::uint64_t> dropped_{0};
+};
+
+/**
+ * @brief Read-only, memory-mapped view of a binary log
+ */
+class CanLog
+{
+public:
+  ~CanLog();
+
+  /**
+   * @brief Open log file and map it into memory
+   * @param path Path of the log file
+   * @return true on success
+   */
+  bool open(const std::string & path);
+
+  /**
+   * @brief Unmap and close log file
+   */
+  void close();
+
+  /**
+   * @brief Number of frames in the log
+   */
+  std::size_t size() const {return size_;}
+
+  /**
+   * @brief Frame of the log, in the order they were recorded
+   * @param i Index of the frame (0 to size() - 1)
+   */
+  const RecordedFrame & operator[](std::size_t i) const {return frames_[i];}
+
+private:
+  void * map_ = nullptr;
+  std::size_t map_size_ = 0;
+  const RecordedFrame * frames_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+}  // namespace cubemars_hardware
+
+#endif  // CUBEMARS_HARDWARE__RECORDER_HPP_
@@ -0,0 +1,63 @@
+#ifndef CUBEMARS_HARDWARE__SEQLOCK_HPP_
+#define CUBEMARS_HARDWARE__SEQLOCK_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace cubemars_hardware
+{
+
+/**
+ * @brief Single writer, multiple reader sequence lock
+ *
+ * The writer never blocks and readers never take a lock. A reader retries only
+ * if it raced with a store, which for a small payload is a few nanoseconds.
+ */
+template<typename T>
+class alignas(64) SeqLock
+{
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires a trivially copyable type");
+
+public:
+  /**
+   * @brief Publish a new value (writer thread only)
+   * @param value Value to be published
+   */
+  void store(const T & value)
+  {
+    const std::uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&data_, &value, sizeof(T));
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Read a consistent copy of the latest value
+   * @param value Copy of the latest value
+   * @return Sequence number of the value, 0 if nothing was published yet
+   */
+  std::uint32_t load(T & value) const
+  {
+    std::uint32_t seq0;
+    std::uint32_t seq1;
+    do
+    {
+      seq0 = seq_.load(std::memory_order_acquire);
+      std::memcpy(&value, &data_, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      seq1 = seq_.load(std::memory_order_relaxed);
+    } while (seq0 != seq1 || (seq0 & 1) != 0);
+    return seq0 / 2;
+  }
+
+private:
+  std::atomic<std::uint32_t> seq_{0};
+  T data_{};
+};
+
+}  // namespace cubemars_hardware
+
+#endif  // CUBEMARS_HARDWARE__SEQLOCK_HPP_
@@ -0,0 +1,142 @@
+#ifndef CUBEMARS_HARDWARE__STATISTICS_HPP_
+#define CUBEMARS_HARDWARE__STATISTICS_HPP_
+
+#include <time.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace cubemars_hardware
+{
+
+/**
+ * @brief Current time of the clock used for the kernel CAN timestamps
+ * @return Time in ns
+ */
+inline std::int64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return std::int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Number of bits of an extended CAN frame on the bus, without stuff bits
+ * @param len Number of bytes of data (0-8)
+ */
+constexpr std::uint32_t can_frame_bits(std::uint8_t len)
+{
+  // SOF, 29 bit ID, SRR, IDE, RTR, r0/r1, DLC, CRC, ACK, EOF and intermission
+  return 67 + 8 * len;
+}
+
+/**
+ * @brief Number of nominal bit times of an extended CAN FD frame, without stuff bits
+ * @param len Number of bytes of data (0-64)
+ * @param data_ratio Nominal bitrate divided by the data bitrate, 1 without bit rate switch
+ */
+constexpr double canfd_frame_bits(std::uint8_t len, double data_ratio)
+{
+  // SOF, 29 bit ID, SRR, IDE, FDF, res, BRS, ACK, EOF and intermission at the nominal bitrate,
+  // ESI, DLC, data, stuff count and CRC at the data bitrate
+  return 47 + (9 + 8 * len + (len > 16 ? 22 : 18)) * data_ratio;
+}
+
+/**
+ * @brief Lock-free histogram of durations with power of two buckets
+ *
+ * Bucket k counts durations in [2^k, 2^(k+1)) us, the first bucket also
+ * everything below 1 us and the last one everything above.
+ */
+class LatencyHistogram
+{
+public:
+  static constexpr std::size_t BUCKETS = 24;
+
+  /**
+   * @brief Count one duration (any thread)
+   * @param ns Duration in ns
+   */
+  void record(std::int64_t ns)
+  {
+    std::uint64_t us = ns > 0 ? ns / 1000 : 0;
+    std::size_t k = 0;
+    while (us > 1 && k < BUCKETS - 1)
+    {
+      us >>= 1;
+      k++;
+    }
+    buckets_[k].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Copy all bucket counts
+   * @param counts Bucket counts
+   */
+  void snapshot(std::uint64_t counts[BUCKETS]) const
+  {
+    for (std::size_t k = 0; k < BUCKETS; k++)
+    {
+      counts[k] = buckets_[k].load(std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Quantile of a histogram snapshot
+   * @param counts Bucket counts
+   * @param q Quantile (0-1)
+   * @return Upper bound of the bucket containing the quantile in s, 0 if there are no counts
+   */
+  static double quantile(const std::uint64_t counts[BUCKETS], double q)
+  {
+    std::uint64_t total = 0;
+    for (std::size_t k = 0; k < BUCKETS; k++)
+    {
+      total += counts[k];
+    }
+    if (total == 0)
+    {
+      return 0;
+    }
+    std::uint64_t sum = 0;
+    std::size_t k = 0;
+    for (; k < BUCKETS - 1; k++)
+    {
+      sum += counts[k];
+      if (sum >= q * total)
+      {
+        break;
+      }
+    }
+    return (std::uint64_t(1) << (k + 1)) * 1e-6;
+  }
+
+private:
+  std::atomic<std::uint64_t> buckets_[BUCKETS] = {};
+};
+
+/**
+ * @brief Timing statistics of one actuator
+ */
+struct alignas(64) JointStatistics
+{
+  // time of the last command, written by write()
+  std::atomic<std::int64_t> tx_stamp{0};
+  // command which the last round trip was measured for, only used by the receiving thread
+  std::int64_t matched_tx_stamp = 0;
+  // time from a command to the next status message
+  LatencyHistogram round_trip;
+  std::atomic<std::int64_t> last_round_trip{0};
+  // age of the status message used by read()
+  LatencyHistogram feedback_age;
+  // read() cycles without a new status message
+  std::atomic<std::uint64_t> missed_feedback{0};
+  // read() cycles in which no reply to the last command arrived before the deadline
+  std::atomic<std::uint64_t> missed_deadline{0};
+  std::atomic<std::uint64_t> feedback_count{0};
+};
+
+}  // namespace cubemars_hardware
+
+#endif  // CUBEMARS_HARDWARE__STATISTICS_HPP_
@@ -2,8 +2,13 @@
 #ifndef CUBEMARS_HARDWARE__SYSTEM_HPP_
 #define CUBEMARS_HARDWARE__SYSTEM_HPP_
 
+#include <poll.h>
+
+#include <atomic>
+#include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 #include <cstdint>
 
@@ -11,11 +16,19 @@
 #include "hardware_interface/hardware_info.hpp"
 #include "hardware_interface/system_interface.hpp"
 #include "hardware_interface/types/hardware_interface_return_values.hpp"
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
 #include "rclcpp/macros.hpp"
+#include "rclcpp/rclcpp.hpp"
 #include "rclcpp_lifecycle/node_interfaces/lifecycle_node_interface.hpp"
 #include "rclcpp_lifecycle/state.hpp"
 #include "cubemars_hardware/visibility_control.h"
 #include "cubemars_hardware/can.hpp"
+#include "cubemars_hardware/codec.hpp"
+#include "cubemars_hardware/event_ring.hpp"
+#include "cubemars_hardware/recorder.hpp"
+#include "cubemars_hardware/tx_scheduler.hpp"
+#include "cubemars_hardware/seqlock.hpp"
+#include "cubemars_hardware/statistics.hpp"
 
 namespace cubemars_hardware
 {
@@ -75,28 +88,56 @@ private:
   std::vector<double> hw_commands_velocities_;
   std::vector<double> hw_commands_accelerations_;
   std::vector<double> hw_commands_efforts_;
+  std::vector<double> hw_commands_stiffnesses_;
+  std::vector<double> hw_commands_dampings_;
   std::vector<double> hw_states_positions_;
   std::vector<double> hw_states_velocities_;
   std::vector<double> hw_states_efforts_;
   std::vector<double> hw_states_temperatures_;
+  std::vector<double> hw_states_round_trips_;
+  std::vector<double> hw_states_feedback_ages_;
+  std::vector<double> hw_states_missed_feedback_;
+  std::vector<double> hw_states_missed_deadlines_;
+  std::vector<double> hw_states_bus_loads_;
 
-  std::vector<double> erpm_conversions_;
-  std::vector<double> torque_constants_;
-  std::vector<double> enc_offs_;
-  std::vector<double> trq_limits_;
-  std::vector<std::pair<std::int16_t, std::int16_t>> limits_;
+  JointCodec codec_;
   std::vector<bool> read_only_;
 
-  CanSocket can_;
-  std::string can_itf_;
+  // one CAN interface with its socket and receive thread
+  struct CanBus
+  {
+    std::string itf;
+    CanSocket can;
+    std::vector<std::uint32_t> can_ids;
+    int rx_thread_cpu = -1;
+    std::thread rx_thread;
+    // share of the bitrate used, updated by the statistics thread
+    std::atomic<double> load{std::numeric_limits<double>::quiet_NaN()};
+    std::uint64_t last_bits = 0;
+  };
+
+  std::vector<std::unique_ptr<CanBus>> buses_;
+  std::vector<std::size_t> joint_bus_;
   std::vector<std::uint32_t> can_ids_;
 
+  void queue_command(std::size_t i, std::uint8_t mode, const std::uint8_t data[], std::uint8_t len);
+  void flush_buses(double period);
+  // close the sockets of the first count buses, false if any could not be closed
+  bool disconnect_buses(std::size_t count);
+
+  // optional change-driven, load limited selection of the commands sent per cycle
+  bool tx_scheduler_enabled_ = false;
+  double tx_keep_alive_ = 0.1;
+  double tx_load_budget_ = 0.8;
+  TxScheduler scheduler_;
+
   enum control_mode_t : std::uint8_t
   {
     CURRENT_LOOP = 1,
     SPEED_LOOP = 3,
     POSITION_LOOP = 4,
     POSITION_SPEED_LOOP = 6,
+    IMPEDANCE = 8,
     UNDEFINED
   };
 
@@ -106,6 +147,104 @@ private:
 
   // active control mode for each actuator
   std::vector<control_mode_t> control_mode_;
+
+  // latest feedback of each actuator, its receive time and whether it arrived since the last read
+  std::vector<ServoFeedback> feedback_;
+  std::vector<std::int64_t> feedback_stamps_;
+  std::vector<bool> feedback_received_;
+  // missing feedback and motor fault of each actuator, NO_FEEDBACK and MOTOR_FAULT are only
+  // logged when these change
+  std::vector<bool> feedback_missing_;
+  std::vector<std::uint8_t> motor_faults_;
+
+  struct StampedFeedback
+  {
+    ServoFeedback feedback;
+    std::int64_t stamp;
+  };
+
+  // optional receive threads (one per CAN bus) which block on the CAN socket
+  // and hand the decoded feedback to read() through one seqlock per actuator
+  bool rx_thread_enabled_ = false;
+  int rx_thread_priority_ = 80;
+  std::atomic<bool> rx_thread_running_{false};
+  std::vector<SeqLock<StampedFeedback>> rx_feedback_;
+  std::vector<std::uint32_t> rx_feedback_seq_;
+
+  void start_rx_threads();
+  void stop_rx_threads();
+  void rx_thread_loop(std::size_t bus);
+
+  // latency and bus load statistics, published as diagnostics by a separate thread
+  std::vector<JointStatistics> joint_stats_;
+  double statistics_rate_ = 1;
+  double bitrate_ = 1000000;
+  // CAN FD frames with bit rate switch
+  bool can_fd_ = false;
+  double data_bitrate_ = 5000000;
+  rclcpp::Node::SharedPtr statistics_node_;
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr statistics_pub_;
+  std::thread statistics_thread_;
+  std::atomic<bool> statistics_running_{false};
+
+  void record_feedback(std::size_t i, std::int64_t stamp);
+  void start_statistics_thread();
+  void stop_statistics_thread();
+  void statistics_loop();
+
+  // synchronous mode: read() waits until every joint replied to its last command
+  std::int64_t feedback_timeout_ = 0;
+  std::vector<struct pollfd> poll_fds_;
+  std::vector<bool> feedback_fresh_;
+  std::size_t feedback_pending_ = 0;
+
+  void receive_feedback();
+
+  // recording of the CAN traffic and replay of a recording instead of the CAN interfaces
+  CanRecorder recorder_;
+  std::string record_file_;
+  std::size_t record_frames_ = 1 << 20;
+  CanLog replay_;
+  std::string replay_file_;
+  std::size_t replay_index_ = 0;
+  std::int64_t replay_time_ = 0;
+
+  void replay_feedback(const rclcpp::Duration & period);
+
+  // events of the realtime loop, logged with rate limiting by a separate thread
+  enum event_t : std::uint8_t
+  {
+    NO_FEEDBACK,
+    MOTOR_FAULT,
+    TORQUE_LIMIT,
+    CURRENT_LIMIT,
+    SPEED_LIMIT,
+    POSITION_LIMIT,
+    READ_ONLY_POSITION,
+    DEADLINE_MISSED,
+    IMPEDANCE_LIMIT,
+    EVENT_TYPES
+  };
+
+  struct Event
+  {
+    std::int64_t stamp;
+    double value;
+    std::uint8_t joint;
+    event_t type;
+    std::uint8_t code;
+  };
+
+  EventRing<Event, 1024> events_;
+  double log_period_ = 1;
+  std::thread event_thread_;
+  std::atomic<bool> event_running_{false};
+
+  void log_event(event_t type, std::size_t joint, std::uint8_t code, double value);
+  void print_event(const Event & event, std::uint64_t suppressed);
+  void start_event_thread();
+  void stop_event_thread();
+  void event_loop();
 };
 
 }  // namespace cubemars_hardware
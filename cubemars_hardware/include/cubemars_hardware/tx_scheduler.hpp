@@ -0,0 +1,142 @@
+#ifndef CUBEMARS_HARDWARE__TX_SCHEDULER_HPP_
+#define CUBEMARS_HARDWARE__TX_SCHEDULER_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "cubemars_hardware/codec.hpp"
+
+namespace cubemars_hardware
+{
+
+/**
+ * @brief Selects the commands to be sent in one control cycle
+ *
+ * A command is only due if it differs from the last one sent to the
+ * actuator or if the keep-alive period has passed. If the due commands of a
+ * bus would exceed the load budget, they are sent round-robin over several
+ * cycles, commands of high priority joints first. Uses fixed size arrays
+ * only, so it can be used in the realtime loop.
+ */
+class TxScheduler
+{
+public:
+  TxScheduler();
+
+  /**
+   * @brief Set scheduling parameters
+   * @param keep_alive Maximum time in s between two commands to the same actuator
+   * @param load_budget Maximum share of the bitrate used by each bus (0-1)
+   * @param bitrate Nominal bitrate of the CAN buses
+   * @param fd Commands are sent as CAN FD frames
+   * @param data_ratio Nominal bitrate divided by the data bitrate of CAN FD frames
+   */
+  void configure(
+    double keep_alive, double load_budget, double bitrate, bool fd = false, double data_ratio = 1);
+
+  /**
+   * @brief Add joint
+   * @param bus Index of the CAN bus the actuator is connected to
+   * @return true on success, false if the scheduler is full
+   */
+  bool add_joint(std::size_t bus);
+
+  /**
+   * @brief Offer the command of one joint for this cycle
+   * @param i Index of the joint
+   * @param id CAN extended identifier
+   * @param data Data of the command
+   * @param len Number of bytes of data (0-8)
+   * @param priority Send before the commands of joints without priority
+   */
+  void submit(
+    std::size_t i, std::uint32_t id, const std::uint8_t data[], std::uint8_t len, bool priority);
+
+  /**
+   * @brief Select the commands to be sent in this cycle
+   * @param now Current time in ns
+   * @param period Duration of the control cycle in s
+   * @param bus_bits Bits transmitted and received so far on every bus (CanSocket::bits())
+   * @param joints Indices of the selected joints
+   * @return Number of selected joints
+   */
+  std::size_t schedule(
+    std::int64_t now, double period, const std::uint64_t bus_bits[],
+    std::uint8_t joints[JointCodec::MAX_JOINTS]);
+
+  /**
+   * @brief Remember the command of a joint selected by schedule() as sent
+   * @details Only call for commands which were actually written, so that a command lost by a
+   * failed write is due again in the next cycle
+   * @param i Index of the joint
+   * @param now Time in ns passed to schedule()
+   */
+  void sent(std::size_t i, std::int64_t now);
+
+  /**
+   * @brief Command of a joint selected by schedule()
+   */
+  std::uint32_t id(std::size_t i) const {return ids_[i];}
+  const std::uint8_t * data(std::size_t i) const {return data_[i];}
+  std::uint8_t len(std::size_t i) const {return lens_[i];}
+
+  /**
+   * @brief Estimated share of the bitrate used on a bus (any thread)
+   */
+  double utilization(std::size_t bus) const
+  {
+    return utilization_[bus].load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Number of due commands of a joint which were postponed because of the load budget
+   * (any thread)
+   */
+  std::uint64_t deferred(std::size_t i) const
+  {
+    return deferred_[i].load(std::memory_order_relaxed);
+  }
+
+private:
+  bool due(std::size_t i, std::int64_t now) const;
+  double frame_bits(std::uint8_t len) const;
+  std::size_t take(
+    std::size_t bus, bool priority, std::int64_t now, double & budget, std::uint8_t joints[],
+    std::size_t count, std::size_t start);
+
+  std::int64_t keep_alive_;
+  double load_budget_;
+  double bitrate_;
+  bool fd_;
+  double data_ratio_;
+
+  // command offered in this cycle
+  std::uint32_t ids_[JointCodec::MAX_JOINTS];
+  alignas(64) std::uint8_t data_[JointCodec::MAX_JOINTS][8];
+  std::uint8_t lens_[JointCodec::MAX_JOINTS];
+  bool submitted_[JointCodec::MAX_JOINTS];
+  bool priorities_[JointCodec::MAX_JOINTS];
+
+  // command last sent
+  std::uint32_t sent_ids_[JointCodec::MAX_JOINTS];
+  alignas(64) std::uint8_t sent_data_[JointCodec::MAX_JOINTS][8];
+  std::uint8_t sent_lens_[JointCodec::MAX_JOINTS];
+  std::int64_t sent_stamps_[JointCodec::MAX_JOINTS];
+
+  // joints of every bus in the order they were added
+  std::uint8_t bus_joints_[JointCodec::MAX_BUSES][JointCodec::MAX_JOINTS];
+  std::size_t bus_sizes_[JointCodec::MAX_BUSES];
+  // round-robin position of the priority and normal joints of every bus
+  std::size_t cursors_[JointCodec::MAX_BUSES][2];
+  std::uint64_t last_bits_[JointCodec::MAX_BUSES];
+  double tx_bits_[JointCodec::MAX_BUSES];
+  double rx_bits_[JointCodec::MAX_BUSES];
+  std::atomic<double> utilization_[JointCodec::MAX_BUSES];
+  std::atomic<std::uint64_t> deferred_[JointCodec::MAX_JOINTS];
+  std::size_t size_;
+};
+
+}  // namespace cubemars_hardware
+
+#endif  // CUBEMARS_HARDWARE__TX_SCHEDULER_HPP_
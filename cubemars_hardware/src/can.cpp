@@ -1,17 +1,24 @@
 #include "cubemars_hardware/can.hpp"
+#include "cubemars_hardware/statistics.hpp"
 
 #include <linux/can.h>
 #include <linux/can/raw.h>
 #include <net/if.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <cmath>
+
 #include "rclcpp/rclcpp.hpp"
 
 namespace cubemars_hardware
 {
-bool CanSocket::connect(std::string can_itf, const std::vector<canid_t> & can_ids, canid_t can_mask)
+bool CanSocket::connect(
+  std::string can_itf, const std::vector<canid_t> & can_ids, canid_t can_mask, bool fd,
+  double data_ratio)
 {
   // open socket
   socket_ = socket(PF_CAN, SOCK_RAW, CAN_RAW);
@@ -37,6 +44,7 @@ bool CanSocket::connect(std::string can_itf, const std::vector<canid_t> & can_id
     RCLCPP_ERROR(
       rclcpp::get_logger("CubeMarsSystemHardware"),
       "Could not bind CAN interface");
+    disconnect();
     return false;
   }
 
@@ -50,12 +58,61 @@ bool CanSocket::connect(std::string can_itf, const std::vector<canid_t> & can_id
   }
   setsockopt(socket_, SOL_CAN_RAW, CAN_RAW_FILTER, &rfilter, sizeof(rfilter));
 
+  // CAN FD frames, only if the interface can transport them
+  fd_ = false;
+  data_ratio_ = data_ratio;
+  if (fd)
+  {
+    int enable = 1;
+    if (ioctl(socket_, SIOCGIFMTU, &ifr) < 0 || ifr.ifr_mtu != CANFD_MTU)
+    {
+      RCLCPP_WARN(
+        rclcpp::get_logger("CubeMarsSystemHardware"),
+        "CAN interface %s does not support CAN FD, using classic CAN", can_itf.c_str());
+    }
+    else if (setsockopt(socket_, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)) < 0)
+    {
+      RCLCPP_WARN(
+        rclcpp::get_logger("CubeMarsSystemHardware"),
+        "Could not enable CAN FD frames on %s, using classic CAN", can_itf.c_str());
+    }
+    else
+    {
+      fd_ = true;
+    }
+  }
+
+  // kernel receive timestamps
+  int enable = 1;
+  if (setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0)
+  {
+    RCLCPP_WARN(
+      rclcpp::get_logger("CubeMarsSystemHardware"),
+      "Could not enable CAN timestamps, using time of reception instead");
+  }
+
+  // prepare message headers for batched transmission
+  tx_count_ = 0;
+  memset(tx_msgs_, 0, sizeof(tx_msgs_));
+  memset(rx_msgs_, 0, sizeof(rx_msgs_));
+  for (std::size_t i = 0; i < MAX_BATCH; i++)
+  {
+    tx_iovecs_[i].iov_base = &tx_frames_[i];
+    tx_iovecs_[i].iov_len = fd_ ? CANFD_MTU : CAN_MTU;
+    tx_msgs_[i].msg_hdr.msg_iov = &tx_iovecs_[i];
+    tx_msgs_[i].msg_hdr.msg_iovlen = 1;
+    rx_iovecs_[i].iov_len = sizeof(struct canfd_frame);
+    rx_msgs_[i].msg_hdr.msg_iov = &rx_iovecs_[i];
+    rx_msgs_[i].msg_hdr.msg_iovlen = 1;
+  }
+
   // write test message
   if (!write_message(0, NULL, 0))
   {
     RCLCPP_ERROR(
       rclcpp::get_logger("CubeMarsSystemHardware"),
       "Test message failed");
+    disconnect();
     return false;
   }
 
@@ -64,7 +121,14 @@ bool CanSocket::connect(std::string can_itf, const std::vector<canid_t> & can_id
 
 bool CanSocket::disconnect()
 {
-  if (close(socket_) < 0)
+  // not connected or already closed, e.g. by a failed on_configure before on_cleanup
+  if (socket_ < 0)
+  {
+    return true;
+  }
+  const int result = close(socket_);
+  socket_ = -1;
+  if (result < 0)
   {
     RCLCPP_ERROR(
       rclcpp::get_logger("CubeMarsSystemHardware"),
@@ -74,44 +138,159 @@ bool CanSocket::disconnect()
   return true;
 }
 
-bool CanSocket::read_nonblocking(std::uint32_t & id, std::uint8_t data[], std::uint8_t & len)
+bool CanSocket::write_message(std::uint32_t id, const std::uint8_t data[], std::uint8_t len)
 {
-  struct can_frame frame;
-  if (recv(socket_, &frame, sizeof(struct can_frame), MSG_DONTWAIT) < 0)
+  struct canfd_frame frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.can_id = id | CAN_EFF_FLAG;
+  frame.len = len;
+  frame.flags = fd_ ? CANFD_BRS : 0;
+  memcpy(frame.data, data, len);
+  const ssize_t mtu = fd_ ? CANFD_MTU : CAN_MTU;
+  if (write(socket_, &frame, mtu) != mtu)
   {
-    if (errno == EAGAIN)
-    {
-      // no message in buffer
-    }
-    else
+    RCLCPP_ERROR(
+      rclcpp::get_logger("CubeMarsSystemHardware"),
+      "Could not write message to CAN socket");
+    return false;
+  }
+  count_frame(len, fd_);
+  if (recorder_ != nullptr)
+  {
+    recorder_->record(
+      monotonic_ns(), recorder_bus_, id, data, len, RecordedFrame::TX | (fd_ ? RecordedFrame::FD : 0));
+  }
+  return true;
+}
+
+bool CanSocket::queue_message(std::uint32_t id, const std::uint8_t data[], std::uint8_t len)
+{
+  if (tx_count_ >= MAX_BATCH)
+  {
+    return false;
+  }
+  struct canfd_frame & frame = tx_frames_[tx_count_++];
+  memset(&frame, 0, sizeof(frame));
+  frame.can_id = id | CAN_EFF_FLAG;
+  frame.len = len;
+  frame.flags = fd_ ? CANFD_BRS : 0;
+  memcpy(frame.data, data, len);
+  return true;
+}
+
+std::size_t CanSocket::flush()
+{
+  std::size_t sent = 0;
+  while (sent < tx_count_)
+  {
+    int ret = sendmmsg(socket_, &tx_msgs_[sent], tx_count_ - sent, 0);
+    if (ret <= 0)
     {
       RCLCPP_ERROR(
         rclcpp::get_logger("CubeMarsSystemHardware"),
-        "Could not read CAN socket");
+        "Could not write %lu messages to CAN socket", tx_count_ - sent);
+      tx_count_ = 0;
+      return sent;
     }
-    return false;
+    const std::int64_t stamp = recorder_ != nullptr ? monotonic_ns() : 0;
+    for (std::size_t i = sent; i < sent + ret; i++)
+    {
+      count_frame(tx_frames_[i].len, fd_);
+      if (recorder_ != nullptr)
+      {
+        recorder_->record(
+          stamp, recorder_bus_, tx_frames_[i].can_id & CAN_EFF_MASK, tx_frames_[i].data,
+          tx_frames_[i].len, RecordedFrame::TX | (fd_ ? RecordedFrame::FD : 0));
+      }
+    }
+    sent += ret;
   }
+  tx_count_ = 0;
+  return sent;
+}
 
-  memcpy(data, frame.data, frame.len);
-  id = frame.can_id & can_mask_;
-  len = frame.len;
+void CanSocket::count_frame(std::uint8_t len, bool fd)
+{
+  const std::uint64_t bits = fd
+    ? std::lround(canfd_frame_bits(len, data_ratio_))
+    : can_frame_bits(len);
+  bits_.fetch_add(bits, std::memory_order_relaxed);
+}
 
-  return true;
+void CanSocket::set_recorder(CanRecorder * recorder, std::uint8_t bus)
+{
+  recorder_ = recorder;
+  recorder_bus_ = bus;
 }
 
-bool CanSocket::write_message(std::uint32_t id, const std::uint8_t data[], std::uint8_t len)
+std::size_t CanSocket::read_batch(
+  struct canfd_frame frames[], std::size_t max_frames, int timeout_ms, std::int64_t stamps[])
 {
-  struct can_frame frame;
-  frame.can_id = id | CAN_EFF_FLAG;
-  frame.len = len;
-  memcpy(frame.data, data, len);
-  if (write(socket_, &frame, sizeof(struct can_frame)) != sizeof(struct can_frame))
+  if (timeout_ms > 0)
   {
-    RCLCPP_ERROR(
-      rclcpp::get_logger("CubeMarsSystemHardware"),
-      "Could not write message to CAN socket");
-    return false;
+    struct pollfd pfd;
+    pfd.fd = socket_;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, timeout_ms) <= 0)
+    {
+      return 0;
+    }
   }
-  return true;
+
+  if (max_frames > MAX_BATCH)
+  {
+    max_frames = MAX_BATCH;
+  }
+  for (std::size_t i = 0; i < max_frames; i++)
+  {
+    rx_iovecs_[i].iov_base = &frames[i];
+    rx_msgs_[i].msg_hdr.msg_control = stamps != nullptr ? rx_control_[i] : NULL;
+    rx_msgs_[i].msg_hdr.msg_controllen = stamps != nullptr ? sizeof(rx_control_[i]) : 0;
+  }
+  int ret = recvmmsg(socket_, rx_msgs_, max_frames, MSG_DONTWAIT, NULL);
+  if (ret < 0)
+  {
+    if (errno != EAGAIN)
+    {
+      RCLCPP_ERROR(
+        rclcpp::get_logger("CubeMarsSystemHardware"),
+        "Could not read CAN socket");
+    }
+    return 0;
+  }
+
+  const std::int64_t stamp = recorder_ != nullptr ? monotonic_ns() : 0;
+  for (int i = 0; i < ret; i++)
+  {
+    const bool fd = rx_msgs_[i].msg_len == CANFD_MTU;
+    if (recorder_ != nullptr)
+    {
+      recorder_->record(
+        stamp, recorder_bus_, frames[i].can_id & CAN_EFF_MASK, frames[i].data, frames[i].len,
+        fd ? RecordedFrame::FD : 0);
+    }
+    frames[i].can_id &= can_mask_;
+    count_frame(frames[i].len, fd);
+  }
+
+  if (stamps != nullptr)
+  {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    for (int i = 0; i < ret; i++)
+    {
+      const struct timespec * ts = &now;
+      for (struct cmsghdr * cmsg = CMSG_FIRSTHDR(&rx_msgs_[i].msg_hdr); cmsg != NULL;
+        cmsg = CMSG_NXTHDR(&rx_msgs_[i].msg_hdr, cmsg))
+      {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+          ts = reinterpret_cast<const struct timespec *>(CMSG_DATA(cmsg));
+        }
+      }
+      stamps[i] = std::int64_t(ts->tv_sec) * 1000000000 + ts->tv_nsec;
+    }
+  }
+  return ret;
+}
 }
-}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "cubemars_hardware/codec.hpp"
+
+#include <cstring>
+
+namespace cubemars_hardware
+{
+JointCodec::JointCodec()
+: size_(0)
+{
+  std::memset(enc_offs_, 0, sizeof(enc_offs_));
+  std::memset(velocity_scales_, 0, sizeof(velocity_scales_));
+  std::memset(effort_scales_, 0, sizeof(effort_scales_));
+  std::memset(current_scales_, 0, sizeof(current_scales_));
+  std::memset(erpm_conversions_, 0, sizeof(erpm_conversions_));
+  std::memset(trq_limits_, 0, sizeof(trq_limits_));
+  std::memset(vel_limits_, 0, sizeof(vel_limits_));
+  std::memset(acc_limits_, 0, sizeof(acc_limits_));
+  std::memset(p_maxs_, 0, sizeof(p_maxs_));
+  std::memset(v_maxs_, 0, sizeof(v_maxs_));
+  std::memset(t_maxs_, 0, sizeof(t_maxs_));
+  std::memset(index_, NO_JOINT, sizeof(index_));
+}
+
+bool JointCodec::add_joint(
+  std::size_t bus, std::uint32_t can_id, int pole_pairs, int gear_ratio, double kt, double enc_off,
+  double trq_limit)
+{
+  if (size_ >= MAX_JOINTS || bus >= MAX_BUSES || can_id >= 256 || index_[bus][can_id] != NO_JOINT)
+  {
+    return false;
+  }
+
+  const std::size_t i = size_++;
+  index_[bus][can_id] = i;
+  erpm_conversions_[i] = pole_pairs * gear_ratio * 60 / (2 * M_PI);
+  enc_offs_[i] = enc_off;
+  velocity_scales_[i] = 10 / erpm_conversions_[i];
+  effort_scales_[i] = 0.01 * kt * gear_ratio;
+  current_scales_[i] = 1000 / kt;
+  trq_limits_[i] = trq_limit > 0 ? trq_limit : 0;
+  vel_limits_[i] = 0;
+  acc_limits_[i] = 0;
+  // the ranges of the impedance command depend on the model, see set_impedance_ranges()
+  p_maxs_[i] = 0;
+  v_maxs_[i] = 0;
+  t_maxs_[i] = 0;
+  return true;
+}
+}
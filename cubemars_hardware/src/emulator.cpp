@@ -0,0 +1,335 @@
+#include "cubemars_hardware/emulator.hpp"
+
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "cubemars_hardware/codec.hpp"
+
+namespace cubemars_hardware
+{
+ServoEmulator::ServoEmulator(const Config & config)
+: config_(config),
+  motors_(config.can_ids.size()),
+  rng_(std::random_device{}()),
+  uniform_(0.0, 1.0),
+  socket_(-1)
+{
+  for (std::size_t i = 0; i < motors_.size(); i++)
+  {
+    motors_[i].can_id = config_.can_ids[i];
+  }
+}
+
+ServoEmulator::~ServoEmulator()
+{
+  close();
+}
+
+bool ServoEmulator::open(const std::string & can_itf)
+{
+  socket_ = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (socket_ < 0)
+  {
+    std::perror("Could not create socket");
+    return false;
+  }
+
+  struct ifreq ifr;
+  std::memset(&ifr, 0, sizeof(ifr));
+  std::strncpy(ifr.ifr_name, can_itf.c_str(), IFNAMSIZ - 1);
+  if (ioctl(socket_, SIOCGIFINDEX, &ifr) < 0)
+  {
+    std::fprintf(stderr, "Unknown CAN interface %s\n", can_itf.c_str());
+    close();
+    return false;
+  }
+
+  struct sockaddr_can addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.can_family = AF_CAN;
+  addr.can_ifindex = ifr.ifr_ifindex;
+  if (bind(socket_, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+  {
+    std::perror("Could not bind CAN interface");
+    close();
+    return false;
+  }
+
+  if (config_.fd)
+  {
+    int enable = 1;
+    if (ioctl(socket_, SIOCGIFMTU, &ifr) < 0 || ifr.ifr_mtu != CANFD_MTU ||
+      setsockopt(socket_, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)) < 0)
+    {
+      std::fprintf(stderr, "CAN interface %s does not support CAN FD\n", can_itf.c_str());
+      close();
+      return false;
+    }
+  }
+
+  // only extended frames carry servo mode commands
+  struct can_filter rfilter;
+  rfilter.can_id = CAN_EFF_FLAG;
+  rfilter.can_mask = CAN_EFF_FLAG | CAN_RTR_FLAG;
+  setsockopt(socket_, SOL_CAN_RAW, CAN_RAW_FILTER, &rfilter, sizeof(rfilter));
+
+  return true;
+}
+
+void ServoEmulator::close()
+{
+  if (socket_ >= 0)
+  {
+    ::close(socket_);
+    socket_ = -1;
+  }
+}
+
+void ServoEmulator::inject_fault(std::uint8_t can_id, std::uint8_t error)
+{
+  for (Motor & motor : motors_)
+  {
+    if (motor.can_id == can_id)
+    {
+      motor.error = error;
+    }
+  }
+}
+
+void ServoEmulator::run(const std::atomic<bool> & running)
+{
+  const auto period = config_.feedback_rate > 0
+    ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1 / config_.feedback_rate))
+    : Clock::duration::max();
+  Clock::time_point last_step = Clock::now();
+  Clock::time_point next_feedback = config_.feedback_rate > 0
+    ? last_step + period
+    : Clock::time_point::max();
+
+  while (running)
+  {
+    // sleep until the next status message is due or a command arrives
+    Clock::time_point wakeup = std::min(next_feedback, last_step + std::chrono::milliseconds(10));
+    if (!pending_.empty())
+    {
+      wakeup = std::min(wakeup, pending_.front().due);
+    }
+    auto timeout = std::max(wakeup - Clock::now(), Clock::duration::zero());
+    struct timespec ts;
+    ts.tv_sec = std::chrono::duration_cast<std::chrono::seconds>(timeout).count();
+    ts.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count() % 1000000000;
+    struct pollfd pfd;
+    pfd.fd = socket_;
+    pfd.events = POLLIN;
+
+    if (ppoll(&pfd, 1, &ts, NULL) > 0)
+    {
+      struct canfd_frame frame;
+      ssize_t nbytes;
+      while ((nbytes = recv(socket_, &frame, sizeof(frame), MSG_DONTWAIT)) > 0)
+      {
+        if (nbytes == CAN_MTU || nbytes == CANFD_MTU)
+        {
+          handle_command(frame);
+        }
+      }
+    }
+
+    Clock::time_point now = Clock::now();
+    step(std::chrono::duration<double>(now - last_step).count());
+    last_step = now;
+
+    if (now >= next_feedback)
+    {
+      for (const Motor & motor : motors_)
+      {
+        queue_feedback(motor, now);
+      }
+      next_feedback += period;
+      if (next_feedback < now)
+      {
+        // fell behind, don't send a burst to catch up
+        next_feedback = now + period;
+      }
+    }
+
+    send_due(now);
+  }
+}
+
+void ServoEmulator::handle_command(const struct canfd_frame & frame)
+{
+  const std::uint32_t id = frame.can_id & CAN_EFF_MASK;
+  const std::uint8_t mode = id >> 8;
+  auto motor = std::find_if(
+    motors_.begin(), motors_.end(), [id](const Motor & m) {return m.can_id == (id & 0xFF);});
+  if (motor == motors_.end() || frame.len < 4)
+  {
+    return;
+  }
+
+  const std::int32_t value = frame.data[0] << 24 | frame.data[1] << 16 | frame.data[2] << 8 |
+    frame.data[3];
+  switch (mode)
+  {
+    case CURRENT_LOOP:
+      motor->command = value / 1000.0;
+      break;
+    case SPEED_LOOP:
+      motor->command = value;
+      break;
+    case POSITION_LOOP:
+      motor->command = value / 10000.0;
+      motor->vel_limit = 0;
+      motor->acc_limit = 0;
+      break;
+    case POSITION_SPEED_LOOP:
+      if (frame.len < 8)
+      {
+        return;
+      }
+      motor->command = value / 10000.0;
+      motor->vel_limit = std::int16_t(frame.data[4] << 8 | frame.data[5]) * 10.0;
+      motor->acc_limit = std::int16_t(frame.data[6] << 8 | frame.data[7]) * 10.0;
+      break;
+    case IMPEDANCE:
+      if (frame.len < 8)
+      {
+        return;
+      }
+      JointCodec::decode_impedance(
+        config_.p_max, config_.v_max, config_.t_max, frame.data, motor->impedance);
+      break;
+    default:
+      return;
+  }
+  motor->mode = static_cast<control_mode_t>(mode);
+  commands_received_++;
+
+  if (config_.reply_to_commands)
+  {
+    queue_feedback(*motor, Clock::now());
+  }
+}
+
+void ServoEmulator::step(double dt)
+{
+  if (dt <= 0)
+  {
+    return;
+  }
+  const double alpha = std::min(dt / config_.time_constant, 1.0);
+  // output shaft degree per electrical revolution
+  const double deg_per_erev = 360.0 / (config_.pole_pairs * config_.gear_ratio);
+  const double erpm_per_rad_s = config_.pole_pairs * config_.gear_ratio * 60 / (2 * M_PI);
+
+  for (Motor & motor : motors_)
+  {
+    double target;
+    switch (motor.mode)
+    {
+      case CURRENT_LOOP:
+        target = motor.command * config_.speed_per_current;
+        break;
+      case SPEED_LOOP:
+        target = motor.command;
+        break;
+      case POSITION_LOOP:
+      case POSITION_SPEED_LOOP:
+        target = config_.position_gain * (motor.command - motor.position);
+        if (motor.vel_limit > 0)
+        {
+          target = std::clamp(target, -motor.vel_limit, motor.vel_limit);
+        }
+        break;
+      case IMPEDANCE:
+      {
+        // torque of the spring-damper, treated like a current with 1 Nm/A
+        const double position = motor.position * M_PI / 180;
+        const double velocity = motor.speed / erpm_per_rad_s;
+        const double torque = motor.impedance[2] * (motor.impedance[0] - position) +
+          motor.impedance[3] * (motor.impedance[1] - velocity) + motor.impedance[4];
+        target = torque * config_.speed_per_current;
+        break;
+      }
+      default:
+        target = 0;
+        break;
+    }
+    target = std::clamp(target, -config_.max_speed, config_.max_speed);
+
+    double delta = (target - motor.speed) * alpha;
+    if (motor.acc_limit > 0)
+    {
+      delta = std::clamp(delta, -motor.acc_limit * dt, motor.acc_limit * dt);
+    }
+    motor.speed += delta;
+    motor.position += motor.speed / 60 * deg_per_erev * dt;
+    if (motor.mode == CURRENT_LOOP)
+    {
+      motor.current = motor.command;
+    }
+    else if (motor.mode == IMPEDANCE)
+    {
+      motor.current = target / config_.speed_per_current;
+    }
+    else
+    {
+      motor.current = (target - motor.speed) / config_.speed_per_current;
+    }
+  }
+}
+
+void ServoEmulator::queue_feedback(const Motor & motor, Clock::time_point now)
+{
+  if (config_.drop_rate > 0 && uniform_(rng_) < config_.drop_rate)
+  {
+    return;
+  }
+
+  ServoFeedback feedback;
+  feedback.position = std::clamp(std::lround(motor.position * 10), -32768L, 32767L);
+  feedback.speed = std::clamp(std::lround(motor.speed / 10), -32768L, 32767L);
+  feedback.current = std::clamp(std::lround(motor.current * 100), -32768L, 32767L);
+  feedback.temperature = motor.temperature;
+  feedback.error = motor.error;
+
+  PendingFrame pending;
+  pending.due = now + std::chrono::microseconds(config_.latency_us);
+  std::memset(&pending.frame, 0, sizeof(pending.frame));
+  pending.frame.can_id = (0x29 << 8 | motor.can_id) | CAN_EFF_FLAG;
+  pending.frame.len = 8;
+  pending.frame.flags = config_.fd ? CANFD_BRS : 0;
+  JointCodec::encode(feedback, pending.frame.data);
+  pending_.push_back(pending);
+
+  if (config_.latency_us == 0)
+  {
+    send_due(now);
+  }
+}
+
+void ServoEmulator::send_due(Clock::time_point now)
+{
+  while (!pending_.empty() && pending_.front().due <= now)
+  {
+    const ssize_t mtu = config_.fd ? CANFD_MTU : CAN_MTU;
+    if (write(socket_, &pending_.front().frame, mtu) == mtu)
+    {
+      feedback_sent_++;
+    }
+    pending_.pop_front();
+  }
+}
+}
@@ -0,0 +1,132 @@
+#include <getopt.h>
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#include "cubemars_hardware/emulator.hpp"
+
+namespace
+{
+std::atomic<bool> running{true};
+
+void signal_handler(int /*signal*/)
+{
+  running = false;
+}
+
+void print_usage(const char * name)
+{
+  std::printf(
+    "Usage: %s [options]\n"
+    "  -i, --interface ITF   CAN interface (default vcan0)\n"
+    "  -n, --ids ID,...      CAN IDs of the emulated actuators (default 1)\n"
+    "  -r, --rate HZ         rate of the status messages, 0 to disable (default 500)\n"
+    "  -a, --reply           send a status message after every command\n"
+    "  -l, --latency US      delay of every status message in us (default 0)\n"
+    "  -d, --drop P          probability of dropping a status message (default 0)\n"
+    "  -f, --fault ID:CODE   report error CODE for actuator ID\n"
+    "  -F, --fd              send status messages as CAN FD frames\n"
+    "  -h, --help            show this help\n",
+    name);
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  cubemars_hardware::ServoEmulator::Config config;
+  std::string can_itf = "vcan0";
+  std::vector<std::pair<int, int>> faults;
+
+  const struct option options[] = {
+    {"interface", required_argument, NULL, 'i'},
+    {"ids", required_argument, NULL, 'n'},
+    {"rate", required_argument, NULL, 'r'},
+    {"reply", no_argument, NULL, 'a'},
+    {"latency", required_argument, NULL, 'l'},
+    {"drop", required_argument, NULL, 'd'},
+    {"fault", required_argument, NULL, 'f'},
+    {"fd", no_argument, NULL, 'F'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0}
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "i:n:r:al:d:f:Fh", options, NULL)) != -1)
+  {
+    switch (opt)
+    {
+      case 'i':
+        can_itf = optarg;
+        break;
+      case 'n':
+      {
+        std::stringstream ss(optarg);
+        std::string id;
+        while (std::getline(ss, id, ','))
+        {
+          config.can_ids.push_back(std::stoi(id));
+        }
+        break;
+      }
+      case 'r':
+        config.feedback_rate = std::stod(optarg);
+        break;
+      case 'a':
+        config.reply_to_commands = true;
+        break;
+      case 'l':
+        config.latency_us = std::stoul(optarg);
+        break;
+      case 'd':
+        config.drop_rate = std::stod(optarg);
+        break;
+      case 'f':
+      {
+        int id, code;
+        if (std::sscanf(optarg, "%d:%d", &id, &code) != 2)
+        {
+          print_usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        faults.emplace_back(id, code);
+        break;
+      }
+      case 'F':
+        config.fd = true;
+        break;
+      case 'h':
+        print_usage(argv[0]);
+        return EXIT_SUCCESS;
+      default:
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if (config.can_ids.empty())
+  {
+    config.can_ids.push_back(1);
+  }
+
+  cubemars_hardware::ServoEmulator emulator(config);
+  if (!emulator.open(can_itf))
+  {
+    return EXIT_FAILURE;
+  }
+  for (const auto & fault : faults)
+  {
+    emulator.inject_fault(fault.first, fault.second);
+  }
+
+  std::signal(SIGINT, signal_handler);
+  std::signal(SIGTERM, signal_handler);
+  std::printf("Emulating %lu actuators on %s\n", config.can_ids.size(), can_itf.c_str());
+  emulator.run(running);
+
+  std::printf(
+    "Received %lu commands, sent %lu status messages\n",
+    emulator.commands_received(), emulator.feedback_sent());
+  return EXIT_SUCCESS;
+}
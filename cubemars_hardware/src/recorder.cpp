@@ -0,0 +1,197 @@
+#include "cubemars_hardware/recorder.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "rclcpp/rclcpp.hpp"
+
+namespace cubemars_hardware
+{
+namespace
+{
+constexpr char LOG_MAGIC[8] = {'C', 'M', 'C', 'A', 'N', 'L', 'O', 'G'};
+constexpr std::uint32_t LOG_VERSION = 1;
+}
+
+CanRecorder::~CanRecorder()
+{
+  close();
+}
+
+bool CanRecorder::open(const std::string & path, std::size_t max_frames)
+{
+  close();
+
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0)
+  {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("CubeMarsSystemHardware"),
+      "Could not create log file %s", path.c_str());
+    return false;
+  }
+
+  // allocate the whole file up front, so recording never has to extend it
+  map_size_ = sizeof(LogHeader) + max_frames * sizeof(RecordedFrame);
+  if (posix_fallocate(fd_, 0, map_size_) != 0)
+  {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("CubeMarsSystemHardware"),
+      "Could not allocate %lu bytes for log file %s", map_size_, path.c_str());
+    close();
+    return false;
+  }
+  map_ = mmap(NULL, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, 0);
+  if (map_ == MAP_FAILED)
+  {
+    map_ = nullptr;
+    RCLCPP_ERROR(
+      rclcpp::get_logger("CubeMarsSystemHardware"),
+      "Could not map log file %s", path.c_str());
+    close();
+    return false;
+  }
+
+  LogHeader * header = static_cast<LogHeader *>(map_);
+  memcpy(header->magic, LOG_MAGIC, sizeof(LOG_MAGIC));
+  header->version = LOG_VERSION;
+  header->frame_size = sizeof(RecordedFrame);
+  header->frames = 0;
+  frames_ = reinterpret_cast<RecordedFrame *>(header + 1);
+  capacity_ = max_frames;
+  next_ = 0;
+  dropped_ = 0;
+  return true;
+}
+
+void CanRecorder::close()
+{
+  std::size_t frames = std::min(next_.load(), capacity_);
+  if (map_ != nullptr)
+  {
+    static_cast<LogHeader *>(map_)->frames = frames;
+    munmap(map_, map_size_);
+    map_ = nullptr;
+    frames_ = nullptr;
+  }
+  if (fd_ >= 0)
+  {
+    if (ftruncate(fd_, sizeof(LogHeader) + frames * sizeof(RecordedFrame)) < 0)
+    {
+      RCLCPP_WARN(
+        rclcpp::get_logger("CubeMarsSystemHardware"),
+        "Could not truncate log file");
+    }
+    ::close(fd_);
+    fd_ = -1;
+  }
+  if (dropped_ > 0)
+  {
+    RCLCPP_WARN(
+      rclcpp::get_logger("CubeMarsSystemHardware"),
+      "Log file was full, %lu frames were not recorded", dropped_.load());
+  }
+}
+
+void CanRecorder::record(
+  std::int64_t stamp, std::uint8_t bus, std::uint32_t id, const std::uint8_t data[],
+  std::uint8_t len, std::uint8_t flags)
+{
+  std::size_t i = next_.fetch_add(1, std::memory_order_relaxed);
+  if (i >= capacity_)
+  {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  RecordedFrame & frame = frames_[i];
+  frame.stamp = stamp;
+  frame.can_id = id;
+  frame.len = len;
+  frame.flags = flags;
+  frame.bus = bus;
+  frame.reserved = 0;
+  memset(frame.data, 0, sizeof(frame.data));
+  memcpy(frame.data, data, std::min<std::size_t>(len, sizeof(frame.data)));
+}
+
+CanLog::~CanLog()
+{
+  close();
+}
+
+bool CanLog::open(const std::string & path)
+{
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("CubeMarsSystemHardware"),
+      "Could not open log file %s", path.c_str());
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || std::size_t(st.st_size) < sizeof(LogHeader))
+  {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("CubeMarsSystemHardware"),
+      "Log file %s is too short", path.c_str());
+    ::close(fd);
+    return false;
+  }
+  map_size_ = st.st_size;
+  map_ = mmap(NULL, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map_ == MAP_FAILED)
+  {
+    map_ = nullptr;
+    RCLCPP_ERROR(
+      rclcpp::get_logger("CubeMarsSystemHardware"),
+      "Could not map log file %s", path.c_str());
+    return false;
+  }
+
+  const LogHeader * header = static_cast<const LogHeader *>(map_);
+  if (memcmp(header->magic, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0 ||
+    header->version != LOG_VERSION || header->frame_size != sizeof(RecordedFrame))
+  {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("CubeMarsSystemHardware"),
+      "%s is not a CAN log of a supported version", path.c_str());
+    close();
+    return false;
+  }
+  frames_ = reinterpret_cast<const RecordedFrame *>(header + 1);
+  size_ = (map_size_ - sizeof(LogHeader)) / sizeof(RecordedFrame);
+  if (header->frames != 0)
+  {
+    size_ = std::min<std::size_t>(size_, header->frames);
+  }
+  else
+  {
+    // recording was interrupted, the unused part of the file is still zero
+    while (size_ > 0 && frames_[size_ - 1].stamp == 0)
+    {
+      size_--;
+    }
+  }
+  return true;
+}
+
+void CanLog::close()
+{
+  if (map_ != nullptr)
+  {
+    munmap(map_, map_size_);
+    map_ = nullptr;
+  }
+  frames_ = nullptr;
+  size_ = 0;
+}
+}
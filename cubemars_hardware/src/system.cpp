@@ -1,6 +1,15 @@
 #include "cubemars_hardware/system.hpp"
 
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
 #include <cmath>
+#include <sstream>
+#include <string>
 #include <vector>
 
 #include "hardware_interface/types/hardware_interface_type_values.hpp"
@@ -24,44 +33,192 @@ hardware_interface::CallbackReturn CubeMarsSystemHardware::on_init(
     return hardware_interface::CallbackReturn::ERROR;
   }
 
+  // default CAN interface for joints without their own can_interface
+  std::string default_itf;
   if (info_.hardware_parameters.count("can_interface") != 0) {
-    can_itf_ = info_.hardware_parameters.at("can_interface");
-  } else {
-    RCLCPP_FATAL(
-      rclcpp::get_logger("CubeMarsSystemHardware"),
-      "No can_interface specified in URDF");
-    return hardware_interface::CallbackReturn::ERROR;
+    default_itf = info_.hardware_parameters.at("can_interface");
+  }
+
+  if (info_.hardware_parameters.count("rx_thread") != 0 &&
+    std::stoi(info_.hardware_parameters.at("rx_thread")) == 1)
+  {
+    rx_thread_enabled_ = true;
+    if (info_.hardware_parameters.count("rx_thread_priority") != 0)
+    {
+      rx_thread_priority_ = std::stoi(info_.hardware_parameters.at("rx_thread_priority"));
+    }
+  }
+
+  if (info_.hardware_parameters.count("statistics_rate") != 0)
+  {
+    statistics_rate_ = std::stod(info_.hardware_parameters.at("statistics_rate"));
+  }
+  if (info_.hardware_parameters.count("bitrate") != 0)
+  {
+    bitrate_ = std::stod(info_.hardware_parameters.at("bitrate"));
+  }
+  if (info_.hardware_parameters.count("feedback_timeout_us") != 0)
+  {
+    feedback_timeout_ = std::stoll(info_.hardware_parameters.at("feedback_timeout_us")) * 1000;
+    if (feedback_timeout_ > 0 && rx_thread_enabled_)
+    {
+      RCLCPP_WARN(
+        rclcpp::get_logger("CubeMarsSystemHardware"),
+        "feedback_timeout_us has no effect together with rx_thread.");
+      feedback_timeout_ = 0;
+    }
+  }
+  if (info_.hardware_parameters.count("can_fd") != 0 &&
+    std::stoi(info_.hardware_parameters.at("can_fd")) == 1)
+  {
+    can_fd_ = true;
+    if (info_.hardware_parameters.count("data_bitrate") != 0)
+    {
+      data_bitrate_ = std::stod(info_.hardware_parameters.at("data_bitrate"));
+    }
+  }
+  if (info_.hardware_parameters.count("tx_scheduler") != 0 &&
+    std::stoi(info_.hardware_parameters.at("tx_scheduler")) == 1)
+  {
+    tx_scheduler_enabled_ = true;
+    if (info_.hardware_parameters.count("tx_keep_alive") != 0)
+    {
+      tx_keep_alive_ = std::stod(info_.hardware_parameters.at("tx_keep_alive"));
+    }
+    if (info_.hardware_parameters.count("tx_load_budget") != 0)
+    {
+      tx_load_budget_ = std::stod(info_.hardware_parameters.at("tx_load_budget"));
+    }
+    scheduler_.configure(
+      tx_keep_alive_, tx_load_budget_, bitrate_, can_fd_, bitrate_ / data_bitrate_);
+  }
+  if (info_.hardware_parameters.count("record_file") != 0)
+  {
+    record_file_ = info_.hardware_parameters.at("record_file");
+    if (info_.hardware_parameters.count("record_frames") != 0)
+    {
+      record_frames_ = std::stoul(info_.hardware_parameters.at("record_frames"));
+    }
+  }
+  if (info_.hardware_parameters.count("replay_file") != 0)
+  {
+    // the recording replaces the CAN interfaces
+    replay_file_ = info_.hardware_parameters.at("replay_file");
+    rx_thread_enabled_ = false;
+    feedback_timeout_ = 0;
+    record_file_.clear();
+  }
+  if (info_.hardware_parameters.count("log_period") != 0)
+  {
+    log_period_ = std::stod(info_.hardware_parameters.at("log_period"));
   }
 
   hw_states_positions_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
   hw_states_velocities_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
   hw_states_efforts_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
   hw_states_temperatures_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
+  hw_states_round_trips_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
+  hw_states_feedback_ages_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
+  hw_states_missed_feedback_.resize(info_.joints.size(), 0);
+  hw_states_missed_deadlines_.resize(info_.joints.size(), 0);
+  hw_states_bus_loads_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
   hw_commands_positions_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
   hw_commands_velocities_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
   hw_commands_accelerations_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
+  hw_commands_stiffnesses_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
+  hw_commands_dampings_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
   hw_commands_efforts_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
   control_mode_.resize(info_.joints.size(), control_mode_t::UNDEFINED);
+  feedback_.resize(info_.joints.size(), ServoFeedback());
+  feedback_stamps_.resize(info_.joints.size(), 0);
+  feedback_received_.resize(info_.joints.size(), false);
+  feedback_missing_.resize(info_.joints.size(), false);
+  motor_faults_.resize(info_.joints.size(), 0);
+  feedback_fresh_.resize(info_.joints.size(), false);
+  rx_feedback_ = std::vector<SeqLock<StampedFeedback>>(info_.joints.size());
+  rx_feedback_seq_.resize(info_.joints.size(), 0);
+  joint_stats_ = std::vector<JointStatistics>(info_.joints.size());
+
+  if (info_.joints.size() > JointCodec::MAX_JOINTS)
+  {
+    RCLCPP_FATAL(
+      rclcpp::get_logger("CubeMarsSystemHardware"),
+      "At most %lu joints are supported", JointCodec::MAX_JOINTS);
+    return hardware_interface::CallbackReturn::ERROR;
+  }
 
-  for (const hardware_interface::ComponentInfo & joint : info_.joints)
+  for (std::size_t i = 0; i < info_.joints.size(); i++)
   {
+    const hardware_interface::ComponentInfo & joint = info_.joints[i];
     if (joint.parameters.count("can_id") != 0 &&
       joint.parameters.count("kt") != 0 &&
       joint.parameters.count("pole_pairs") != 0 &&
       joint.parameters.count("gear_ratio") != 0)
     {
+      double enc_off = 0;
+      if (joint.parameters.count("enc_off") != 0)
+      {
+        enc_off = std::stod(joint.parameters.at("enc_off"));
+      }
+      double trq_limit = 0;
+      if (joint.parameters.count("trq_limit") != 0)
+      {
+        trq_limit = std::stod(joint.parameters.at("trq_limit"));
+      }
+
+      std::string itf = default_itf;
+      if (joint.parameters.count("can_interface") != 0)
+      {
+        itf = joint.parameters.at("can_interface");
+      }
+      if (itf.empty())
+      {
+        RCLCPP_FATAL(
+          rclcpp::get_logger("CubeMarsSystemHardware"),
+          "No can_interface specified in URDF for %s", joint.name.c_str());
+        return hardware_interface::CallbackReturn::ERROR;
+      }
+      std::size_t bus = 0;
+      while (bus < buses_.size() && buses_[bus]->itf != itf)
+      {
+        bus++;
+      }
+      if (bus == buses_.size())
+      {
+        if (buses_.size() >= JointCodec::MAX_BUSES)
+        {
+          RCLCPP_FATAL(
+            rclcpp::get_logger("CubeMarsSystemHardware"),
+            "At most %lu CAN interfaces are supported", JointCodec::MAX_BUSES);
+          return hardware_interface::CallbackReturn::ERROR;
+        }
+        buses_.emplace_back(std::make_unique<CanBus>());
+        buses_.back()->itf = itf;
+      }
+
       can_ids_.emplace_back(std::stoul(joint.parameters.at("can_id")));
-      torque_constants_.emplace_back(std::stod(joint.parameters.at("kt")));
-      double erpm_conversion = std::stoi(joint.parameters.at("pole_pairs")) * 
-        std::stoi(joint.parameters.at("gear_ratio")) * 60 / (2 * M_PI);
-      erpm_conversions_.emplace_back(erpm_conversion);
+      joint_bus_.emplace_back(bus);
+      buses_[bus]->can_ids.emplace_back(can_ids_.back());
+      if (!codec_.add_joint(
+          bus, can_ids_.back(),
+          std::stoi(joint.parameters.at("pole_pairs")),
+          std::stoi(joint.parameters.at("gear_ratio")),
+          std::stod(joint.parameters.at("kt")),
+          enc_off, trq_limit) || !scheduler_.add_joint(bus))
+      {
+        RCLCPP_FATAL(
+          rclcpp::get_logger("CubeMarsSystemHardware"),
+          "CAN ID %u of %s is not in range 0-255 or used twice on %s",
+          can_ids_.back(), joint.name.c_str(), itf.c_str());
+        return hardware_interface::CallbackReturn::ERROR;
+      }
 
       if (joint.parameters.count("acc_limit") != 0 &&
         joint.parameters.count("vel_limit") != 0)
       {
         std::pair<std::int32_t, std::int32_t> limits;
-        limits.first = std::stoi(joint.parameters.at("vel_limit")) / 10 * erpm_conversion;
-        limits.second = std::stoi(joint.parameters.at("acc_limit")) / 10 * erpm_conversion;
+        limits.first = std::stoi(joint.parameters.at("vel_limit")) / 10 * codec_.erpm_conversion(i);
+        limits.second = std::stoi(joint.parameters.at("acc_limit")) / 10 * codec_.erpm_conversion(i);
         if (limits.first >= 32767 || limits.first <= 0)
         {
           RCLCPP_ERROR(
@@ -76,11 +233,34 @@ hardware_interface::CallbackReturn CubeMarsSystemHardware::on_init(
             "acceleration limit is not in range 0-32767: %d", limits.second);
           return hardware_interface::CallbackReturn::ERROR;
         }
-        limits_.emplace_back(limits);
+        codec_.set_limits(i, limits.first, limits.second);
       }
-      else
+
+      // the scaling of the impedance command differs between the models, there is no default
+      const std::size_t mit_ranges = joint.parameters.count("mit_p_max") +
+        joint.parameters.count("mit_v_max") + joint.parameters.count("mit_t_max");
+      if (mit_ranges == 3)
+      {
+        codec_.set_impedance_ranges(
+          i,
+          std::stod(joint.parameters.at("mit_p_max")),
+          std::stod(joint.parameters.at("mit_v_max")),
+          std::stod(joint.parameters.at("mit_t_max")));
+        if (!codec_.has_impedance_ranges(i))
+        {
+          RCLCPP_FATAL(
+            rclcpp::get_logger("CubeMarsSystemHardware"),
+            "mit_p_max, mit_v_max and mit_t_max of %s must be positive", joint.name.c_str());
+          return hardware_interface::CallbackReturn::ERROR;
+        }
+      }
+      else if (mit_ranges != 0)
       {
-        limits_.emplace_back(std::make_pair(0, 0));
+        RCLCPP_FATAL(
+          rclcpp::get_logger("CubeMarsSystemHardware"),
+          "Either all or none of mit_p_max, mit_v_max and mit_t_max must be set for %s",
+          joint.name.c_str());
+        return hardware_interface::CallbackReturn::ERROR;
       }
     }
     else
@@ -91,61 +271,138 @@ hardware_interface::CallbackReturn CubeMarsSystemHardware::on_init(
       return hardware_interface::CallbackReturn::ERROR;
     }
 
-    if (joint.parameters.count("enc_off") != 0)
+    if (joint.parameters.count("read_only") != 0 && std::stoi(joint.parameters.at("read_only")) == 1)
     {
-      enc_offs_.emplace_back(std::stod(joint.parameters.at("enc_off")));
+      read_only_.emplace_back(true);
     }
     else
     {
-      enc_offs_.emplace_back(0);
+      read_only_.emplace_back(false);
     }
+  }
 
-    if (joint.parameters.count("trq_limit") != 0 && std::stod(joint.parameters.at("trq_limit")) > 0)
+  // pin the receive thread of the n-th CAN interface to the n-th CPU in the list
+  if (info_.hardware_parameters.count("rx_thread_cpu") != 0)
+  {
+    std::stringstream cpus(info_.hardware_parameters.at("rx_thread_cpu"));
+    std::string cpu;
+    for (std::size_t bus = 0; bus < buses_.size() && std::getline(cpus, cpu, ','); bus++)
     {
-      trq_limits_.emplace_back(std::stod(joint.parameters.at("trq_limit")));
+      buses_[bus]->rx_thread_cpu = std::stoi(cpu);
     }
-    else
+  }
+
+  return hardware_interface::CallbackReturn::SUCCESS;
+}
+
+hardware_interface::CallbackReturn CubeMarsSystemHardware::on_configure(
+  const rclcpp_lifecycle::State & /*previous_state*/)
+{
+  if (!replay_file_.empty())
+  {
+    if (!replay_.open(replay_file_))
     {
-      trq_limits_.emplace_back(0);
+      return hardware_interface::CallbackReturn::FAILURE;
     }
+    replay_index_ = 0;
+    replay_time_ = replay_.size() > 0 ? replay_[0].stamp : 0;
+    RCLCPP_INFO(
+      rclcpp::get_logger("CubeMarsSystemHardware"),
+      "Replaying %lu frames from %s", replay_.size(), replay_file_.c_str());
+    return hardware_interface::CallbackReturn::SUCCESS;
+  }
 
-    if (joint.parameters.count("read_only") != 0 && std::stoi(joint.parameters.at("read_only")) == 1)
+  for (std::size_t bus = 0; bus < buses_.size(); bus++)
+  {
+    CanBus & can_bus = *buses_[bus];
+    if (!can_bus.can.connect(
+        can_bus.itf, can_bus.can_ids, 0xFFU, can_fd_, bitrate_ / data_bitrate_))
     {
-      read_only_.emplace_back(true);
+      // do not leave the buses connected so far open
+      disconnect_buses(bus);
+      return hardware_interface::CallbackReturn::FAILURE;
     }
-    else
+  }
+
+  if (!record_file_.empty())
+  {
+    if (!recorder_.open(record_file_, record_frames_))
     {
-      read_only_.emplace_back(false);
+      disconnect_buses(buses_.size());
+      return hardware_interface::CallbackReturn::FAILURE;
+    }
+    for (std::size_t bus = 0; bus < buses_.size(); bus++)
+    {
+      buses_[bus]->can.set_recorder(&recorder_, bus);
     }
   }
 
-  return hardware_interface::CallbackReturn::SUCCESS;
-}
+  poll_fds_.clear();
+  for (const std::unique_ptr<CanBus> & bus : buses_)
+  {
+    struct pollfd pfd;
+    pfd.fd = bus->can.fd();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    poll_fds_.push_back(pfd);
+  }
 
-hardware_interface::CallbackReturn CubeMarsSystemHardware::on_configure(
-  const rclcpp_lifecycle::State & /*previous_state*/)
-{
-  const hardware_interface::CallbackReturn result = can_.connect(can_itf_, can_ids_, 0xFFU)
-                                                      ? hardware_interface::CallbackReturn::SUCCESS
-                                                      : hardware_interface::CallbackReturn::FAILURE;
+  if (statistics_rate_ > 0 && !statistics_node_)
+  {
+    // one node per hardware component, node names only allow alphanumerics and underscores
+    std::string node_name = "cubemars_hardware_statistics_" + info_.name;
+    std::replace_if(
+      node_name.begin(), node_name.end(),
+      [](char c) {return !std::isalnum(static_cast<unsigned char>(c)) && c != '_';}, '_');
+    statistics_node_ = std::make_shared<rclcpp::Node>(node_name);
+    statistics_pub_ = statistics_node_->create_publisher<diagnostic_msgs::msg::DiagnosticArray>(
+      "/diagnostics", rclcpp::QoS(10));
+  }
 
   RCLCPP_INFO(rclcpp::get_logger("CubeMarsSystemHardware"), "Communication active");
 
-  return result;
+  return hardware_interface::CallbackReturn::SUCCESS;
 }
 
 hardware_interface::CallbackReturn CubeMarsSystemHardware::on_cleanup(
   const rclcpp_lifecycle::State & /*previous_state*/)
 {
-  const hardware_interface::CallbackReturn result = can_.disconnect()
-                                                      ? hardware_interface::CallbackReturn::SUCCESS
-                                                      : hardware_interface::CallbackReturn::FAILURE;
+  stop_statistics_thread();
+  stop_rx_threads();
+  stop_event_thread();
+
+  if (!replay_file_.empty())
+  {
+    replay_.close();
+    return hardware_interface::CallbackReturn::SUCCESS;
+  }
+
+  for (const std::unique_ptr<CanBus> & bus : buses_)
+  {
+    bus->can.set_recorder(nullptr, 0);
+  }
+  recorder_.close();
+  hardware_interface::CallbackReturn result = disconnect_buses(buses_.size()) ?
+    hardware_interface::CallbackReturn::SUCCESS : hardware_interface::CallbackReturn::FAILURE;
 
   RCLCPP_INFO(rclcpp::get_logger("CubeMarsSystemHardware"), "Communication closed");
 
   return result;
 }
 
+bool CubeMarsSystemHardware::disconnect_buses(std::size_t count)
+{
+  bool result = true;
+  for (std::size_t bus = 0; bus < count && bus < buses_.size(); bus++)
+  {
+    if (!buses_[bus]->can.disconnect())
+    {
+      result = false;
+    }
+  }
+  return result;
+}
+
 std::vector<hardware_interface::StateInterface>
 CubeMarsSystemHardware::export_state_interfaces()
 {
@@ -160,6 +417,16 @@ CubeMarsSystemHardware::export_state_interfaces()
       info_.joints[i].name, hardware_interface::HW_IF_EFFORT, &hw_states_efforts_[i]));
     state_interfaces.emplace_back(hardware_interface::StateInterface(
       info_.joints[i].name, "temperature", &hw_states_temperatures_[i]));
+    state_interfaces.emplace_back(hardware_interface::StateInterface(
+      info_.joints[i].name, "round_trip_latency", &hw_states_round_trips_[i]));
+    state_interfaces.emplace_back(hardware_interface::StateInterface(
+      info_.joints[i].name, "feedback_age", &hw_states_feedback_ages_[i]));
+    state_interfaces.emplace_back(hardware_interface::StateInterface(
+      info_.joints[i].name, "missed_feedback", &hw_states_missed_feedback_[i]));
+    state_interfaces.emplace_back(hardware_interface::StateInterface(
+      info_.joints[i].name, "missed_deadlines", &hw_states_missed_deadlines_[i]));
+    state_interfaces.emplace_back(hardware_interface::StateInterface(
+      info_.joints[i].name, "bus_load", &hw_states_bus_loads_[i]));
   }
 
   return state_interfaces;
@@ -179,6 +446,10 @@ CubeMarsSystemHardware::export_command_interfaces()
       info_.joints[i].name, hardware_interface::HW_IF_ACCELERATION, &hw_commands_accelerations_[i]));
     command_interfaces.emplace_back(hardware_interface::CommandInterface(
       info_.joints[i].name, hardware_interface::HW_IF_EFFORT, &hw_commands_efforts_[i]));
+    command_interfaces.emplace_back(hardware_interface::CommandInterface(
+      info_.joints[i].name, "stiffness", &hw_commands_stiffnesses_[i]));
+    command_interfaces.emplace_back(hardware_interface::CommandInterface(
+      info_.joints[i].name, "damping", &hw_commands_dampings_[i]));
   }
 
   return command_interfaces;
@@ -197,7 +468,24 @@ hardware_interface::return_type CubeMarsSystemHardware::prepare_command_mode_swi
   std::unordered_set<std::string> eff {"effort"};
   std::unordered_set<std::string> vel {"velocity"};
   std::unordered_set<std::string> pos {"position"};
-  
+  // impedance mode needs stiffness or damping, position, velocity and effort are optional
+  std::unordered_set<std::string> imp {"position", "velocity", "effort", "stiffness", "damping"};
+  auto is_impedance = [&imp](const std::unordered_set<std::string> & interfaces) {
+      if (interfaces.count("stiffness") == 0 && interfaces.count("damping") == 0)
+      {
+        return false;
+      }
+      for (const std::string & interface : interfaces)
+      {
+        if (imp.count(interface) == 0)
+        {
+          return false;
+        }
+      }
+      return true;
+    };
+
+
   std::unordered_set<std::string> joint_interfaces;
   for (std::size_t i = 0; i < info_.joints.size(); i++)
   {
@@ -232,7 +520,7 @@ hardware_interface::return_type CubeMarsSystemHardware::prepare_command_mode_swi
     }
     else if (joint_interfaces == pos)
     {
-      if (limits_[i].first == 0 || limits_[i].second == 0)
+      if (!codec_.has_limits(i))
       {
         start_modes_.push_back(POSITION_LOOP);
       }
@@ -241,6 +529,18 @@ hardware_interface::return_type CubeMarsSystemHardware::prepare_command_mode_swi
         start_modes_.push_back(POSITION_SPEED_LOOP);
       }
     }
+    else if (is_impedance(joint_interfaces))
+    {
+      if (!codec_.has_impedance_ranges(i))
+      {
+        RCLCPP_ERROR(
+          rclcpp::get_logger("CubeMarsSystemHardware"),
+          "Impedance mode of %s requires mit_p_max, mit_v_max and mit_t_max",
+          info_.joints[i].name.c_str());
+        return hardware_interface::return_type::ERROR;
+      }
+      start_modes_.push_back(IMPEDANCE);
+    }
     else if (joint_interfaces.empty())
     {
       if (stop_modes_[i])
@@ -273,6 +573,8 @@ hardware_interface::return_type CubeMarsSystemHardware::perform_command_mode_swi
       hw_commands_efforts_[i] = std::numeric_limits<double>::quiet_NaN();
       hw_commands_velocities_[i] = std::numeric_limits<double>::quiet_NaN();
       hw_commands_positions_[i] = std::numeric_limits<double>::quiet_NaN();
+      hw_commands_stiffnesses_[i] = std::numeric_limits<double>::quiet_NaN();
+      hw_commands_dampings_[i] = std::numeric_limits<double>::quiet_NaN();
     }
     // switch control mode
     control_mode_[i] = start_modes_[i];
@@ -284,101 +586,130 @@ hardware_interface::return_type CubeMarsSystemHardware::perform_command_mode_swi
 hardware_interface::CallbackReturn CubeMarsSystemHardware::on_activate(
   const rclcpp_lifecycle::State & /*previous_state*/)
 {
+  start_event_thread();
+  start_rx_threads();
+  start_statistics_thread();
   return hardware_interface::CallbackReturn::SUCCESS;
 }
 
 hardware_interface::CallbackReturn CubeMarsSystemHardware::on_deactivate(
   const rclcpp_lifecycle::State & /*previous_state*/)
 {
+  stop_statistics_thread();
+  stop_rx_threads();
+  stop_event_thread();
   return hardware_interface::CallbackReturn::SUCCESS;
 }
 
 hardware_interface::return_type CubeMarsSystemHardware::read(
-  const rclcpp::Time & /*time*/, const rclcpp::Duration & /*period*/)
+  const rclcpp::Time & /*time*/, const rclcpp::Duration & period)
 {
-  bool all_ids[can_ids_.size()] = { false };
-  std::uint32_t read_id;
-  std::uint8_t read_data[8];
-  std::uint8_t read_len;
-
-  std::int16_t pos_int;
-
-  // read all buffered CAN messages
-  while (can_.read_nonblocking(read_id, read_data, read_len))
+  if (!replay_file_.empty())
+  {
+    replay_feedback(period);
+  }
+  else if (rx_thread_enabled_)
+  {
+    // frames were already received and decoded by the receive thread
+    StampedFeedback stamped;
+    for (std::size_t i = 0; i < info_.joints.size(); i++)
+    {
+      std::uint32_t seq = rx_feedback_[i].load(stamped);
+      feedback_[i] = stamped.feedback;
+      feedback_stamps_[i] = stamped.stamp;
+      feedback_received_[i] = seq != rx_feedback_seq_[i];
+      rx_feedback_seq_[i] = seq;
+    }
+  }
+  else
   {
-    if (read_data[7] != 0)
+    std::fill(feedback_received_.begin(), feedback_received_.end(), false);
+    std::fill(feedback_fresh_.begin(), feedback_fresh_.end(), false);
+    feedback_pending_ = info_.joints.size();
+    receive_feedback();
+
+    if (feedback_timeout_ > 0)
     {
-      switch(read_data[7])
+      // wait for the replies still in flight until the deadline, measured on the monotonic
+      // clock because the realtime clock of the kernel timestamps may be stepped
+      const std::int64_t deadline = monotonic_ns() + feedback_timeout_;
+      std::int64_t remaining = feedback_timeout_;
+      while (feedback_pending_ > 0 && remaining > 0)
       {
-        case 1:
-          RCLCPP_ERROR(rclcpp::get_logger("CubeMarsSystemHardware"), "Motor over-temperature fault.");
-          break;
-        case 2:
-          RCLCPP_ERROR(rclcpp::get_logger("CubeMarsSystemHardware"), "Over-current fault.");
-          break;
-        case 3:
-          RCLCPP_ERROR(rclcpp::get_logger("CubeMarsSystemHardware"), "Over-voltage fault.");
-          break;
-        case 4:
-          RCLCPP_ERROR(rclcpp::get_logger("CubeMarsSystemHardware"), "Under-voltage fault.");
-          break;
-        case 5:
-          RCLCPP_ERROR(rclcpp::get_logger("CubeMarsSystemHardware"), "Encoder fault.");
-          break;
-        case 6:
-          RCLCPP_ERROR(rclcpp::get_logger("CubeMarsSystemHardware"), "MOSFET over-temperature fault.");
-          break;
-        case 7:
-          RCLCPP_ERROR(rclcpp::get_logger("CubeMarsSystemHardware"), "Motor stall.");
+        struct timespec ts;
+        ts.tv_sec = remaining / 1000000000;
+        ts.tv_nsec = remaining % 1000000000;
+        if (ppoll(poll_fds_.data(), poll_fds_.size(), &ts, NULL) <= 0)
+        {
           break;
-        return hardware_interface::return_type::ERROR;
+        }
+        receive_feedback();
+        remaining = deadline - monotonic_ns();
+      }
+
+      for (std::size_t i = 0; i < info_.joints.size(); i++)
+      {
+        if (!feedback_fresh_[i])
+        {
+          hw_states_missed_deadlines_[i] =
+            joint_stats_[i].missed_deadline.fetch_add(1, std::memory_order_relaxed) + 1;
+          log_event(DEADLINE_MISSED, i, 0, feedback_timeout_ * 1e-3);
+        }
       }
-    }
-    auto it = std::find(can_ids_.begin(), can_ids_.end(), read_id);
-    if (it != can_ids_.end())
-    {
-      int i = std::distance(can_ids_.begin(), it);
-      all_ids[i] = true;
-      pos_int = read_data[0] << 8 | read_data[1];
-      // if (std::abs(pos_int) >= 32000)
-      // {
-      //   RCLCPP_INFO(
-      //     rclcpp::get_logger("CubeMarsSystemHardware"),
-      //     "Position has reached maximum possible value.");
-      // }
-      hw_states_positions_[i] = pos_int;
-      hw_states_velocities_[i] = std::int16_t (read_data[2] << 8 | read_data[3]);
-      hw_states_efforts_[i] = std::int16_t (read_data[4] << 8 | read_data[5]);
     }
   }
 
   // check if all CAN IDs have received a message
+  const std::int64_t now = now_ns();
   for (std::size_t i = 0; i < info_.joints.size(); i++)
   {
-    if (!all_ids[i])
+    JointStatistics & stats = joint_stats_[i];
+    if (feedback_stamps_[i] != 0)
     {
-      RCLCPP_WARN(
-        rclcpp::get_logger("CubeMarsSystemHardware"),
-        "No CAN message received from CAN ID: %u. ",
-        can_ids_[i]);
+      std::int64_t age = now - feedback_stamps_[i];
+      stats.feedback_age.record(age);
+      hw_states_feedback_ages_[i] = age * 1e-9;
+    }
+    hw_states_round_trips_[i] = stats.last_round_trip.load(std::memory_order_relaxed) * 1e-9;
+    hw_states_bus_loads_[i] = buses_[joint_bus_[i]]->load.load(std::memory_order_relaxed);
+
+    if (!feedback_received_[i])
+    {
+      hw_states_missed_feedback_[i] = stats.missed_feedback.fetch_add(1, std::memory_order_relaxed) + 1;
+      if (!feedback_missing_[i])
+      {
+        log_event(NO_FEEDBACK, i, 0, 0);
+        feedback_missing_[i] = true;
+      }
     }
     else
     {
+      feedback_missing_[i] = false;
+      if (feedback_[i].error != motor_faults_[i])
+      {
+        if (feedback_[i].error != 0)
+        {
+          log_event(MOTOR_FAULT, i, feedback_[i].error, 0);
+        }
+        motor_faults_[i] = feedback_[i].error;
+      }
+
       // Unit conversions
-      hw_states_positions_[i] = hw_states_positions_[i] * 0.1 * M_PI / 180 - enc_offs_[i];
-      hw_states_velocities_[i] = hw_states_velocities_[i] * 10 / erpm_conversions_[i];
-      hw_states_efforts_[i] = hw_states_efforts_[i] * 0.01 * torque_constants_[i] *
-        std::stoi(info_.joints[i].parameters.at("gear_ratio"));
-      hw_states_temperatures_[i] = read_data[6];
-      if (trq_limits_[i] != 0 && hw_states_efforts_[i] > trq_limits_[i])
-      {
-        RCLCPP_ERROR(rclcpp::get_logger("CubeMarsSystemHardware"),
-          "Joint %lu went over torque limit.", i);
-        
+      hw_states_positions_[i] = codec_.position(i, feedback_[i]);
+      hw_states_velocities_[i] = codec_.velocity(i, feedback_[i]);
+      hw_states_efforts_[i] = codec_.effort(i, feedback_[i]);
+      hw_states_temperatures_[i] = feedback_[i].temperature;
+      if (codec_.over_torque_limit(i, hw_states_efforts_[i]))
+      {
+        log_event(TORQUE_LIMIT, i, 0, hw_states_efforts_[i]);
+
         // disable motor
-        std::uint8_t data[4] = {0, 0, 0, 0};
-        can_.write_message(can_ids_[i] | CURRENT_LOOP << 8, data, 4);
-        
+        if (replay_file_.empty())
+        {
+          std::uint8_t data[4] = {0, 0, 0, 0};
+          buses_[joint_bus_[i]]->can.write_message(can_ids_[i] | CURRENT_LOOP << 8, data, 4);
+        }
+
         return hardware_interface::return_type::ERROR;
       }
       if (read_only_[i])
@@ -387,11 +718,7 @@ hardware_interface::return_type CubeMarsSystemHardware::read(
         //   rclcpp::get_logger("CubeMarsSystemHardware"),
         //   "read states joint %lu: pos %f, spd %f, eff %f, temp %f",
         //   i, hw_states_positions_[i], hw_states_velocities_[i], hw_states_efforts_[i], hw_states_temperatures_[i]);
-        RCLCPP_INFO(
-          rclcpp::get_logger("CubeMarsSystemHardware"),
-          "Joint %lu: pos: %f",
-          i, hw_states_positions_[i]);
-
+        log_event(READ_ONLY_POSITION, i, 0, hw_states_positions_[i]);
       }
     }
   }
@@ -400,7 +727,7 @@ hardware_interface::return_type CubeMarsSystemHardware::read(
 }
 
 hardware_interface::return_type CubeMarsSystemHardware::write(
-  const rclcpp::Time & /*time*/, const rclcpp::Duration & /*period*/)
+  const rclcpp::Time & /*time*/, const rclcpp::Duration & period)
 {
   for (std::size_t i = 0; i < info_.joints.size(); i++)
   {
@@ -419,12 +746,11 @@ hardware_interface::return_type CubeMarsSystemHardware::write(
         {
           if (!std::isnan(hw_commands_efforts_[i]))
           {
-            std::int32_t current = hw_commands_efforts_[i] * 1000 / torque_constants_[i];
+            std::int32_t current = codec_.current_command(i, hw_commands_efforts_[i]);
             if (std::abs(current) >= 60000)
             {
-              RCLCPP_ERROR(
-                rclcpp::get_logger("CubeMarsSystemHardware"),
-                "current command is over maximal allowed value of 60000: %d", current);
+              log_event(CURRENT_LIMIT, i, 0, current);
+              flush_buses(period.seconds());
               return hardware_interface::return_type::ERROR;
             }
             // RCLCPP_INFO(
@@ -432,12 +758,9 @@ hardware_interface::return_type CubeMarsSystemHardware::write(
             //   "current command for joint %lu: %d", i, current);
 
             std::uint8_t data[4];
-            data[0] = current >> 24;
-            data[1] = current >> 16;
-            data[2] = current >> 8;
-            data[3] = current;
+            JointCodec::encode(current, data);
 
-            can_.write_message(can_ids_[i] | CURRENT_LOOP << 8, data, 4);
+            queue_command(i, CURRENT_LOOP, data, 4);
           }
           break;
         }
@@ -445,12 +768,11 @@ hardware_interface::return_type CubeMarsSystemHardware::write(
         {
           if (!std::isnan(hw_commands_velocities_[i]))
           {
-            std::int32_t speed = hw_commands_velocities_[i] * erpm_conversions_[i];
+            std::int32_t speed = codec_.speed_command(i, hw_commands_velocities_[i]);
             if (std::abs(speed) >= 100000)
             {
-              RCLCPP_ERROR(
-                rclcpp::get_logger("CubeMarsSystemHardware"),
-                "speed command is over maximal allowed value of 100000: %d", speed);
+              log_event(SPEED_LIMIT, i, 0, speed);
+              flush_buses(period.seconds());
               return hardware_interface::return_type::ERROR;
             }
             // RCLCPP_INFO(
@@ -458,12 +780,9 @@ hardware_interface::return_type CubeMarsSystemHardware::write(
             //   "speed command for joint %lu: %d", i, speed);
 
             std::uint8_t data[4];
-            data[0] = speed >> 24;
-            data[1] = speed >> 16;
-            data[2] = speed >> 8;
-            data[3] = speed;
+            JointCodec::encode(speed, data);
 
-            can_.write_message(can_ids_[i] | SPEED_LOOP << 8, data, 4);
+            queue_command(i, SPEED_LOOP, data, 4);
           }
           break;
         }
@@ -471,12 +790,11 @@ hardware_interface::return_type CubeMarsSystemHardware::write(
         {
           if (!std::isnan(hw_commands_positions_[i]))
           {
-            std::int32_t position = (hw_commands_positions_[i] + enc_offs_[i]) * 10000 * 180 / M_PI;
+            std::int32_t position = codec_.position_command(i, hw_commands_positions_[i]);
             if (std::abs(position) >= 360000000)
             {
-              RCLCPP_ERROR(
-                rclcpp::get_logger("CubeMarsSystemHardware"),
-                "speed command is over maximal allowed value of 360000000: %d", position);
+              log_event(POSITION_LIMIT, i, 0, position);
+              flush_buses(period.seconds());
               return hardware_interface::return_type::ERROR;
             }
             // RCLCPP_INFO(
@@ -484,26 +802,22 @@ hardware_interface::return_type CubeMarsSystemHardware::write(
             //   "position command for joint %lu: %d", i, position);
 
             std::uint8_t data[4];
-            data[0] = position >> 24;
-            data[1] = position >> 16;
-            data[2] = position >> 8;
-            data[3] = position;
+            JointCodec::encode(position, data);
 
-            can_.write_message(can_ids_[i] | POSITION_LOOP << 8, data, 4);
+            queue_command(i, POSITION_LOOP, data, 4);
           }
           break;
         case POSITION_SPEED_LOOP:
         {
           if (!std::isnan(hw_commands_positions_[i]))
           {
-            std::int32_t position = (hw_commands_positions_[i] + enc_offs_[i]) * 10000 * 180 / M_PI;
-            std::int16_t vel = limits_[i].first;
-            std::int16_t acc = limits_[i].second;
+            std::int32_t position = codec_.position_command(i, hw_commands_positions_[i]);
+            std::int16_t vel = codec_.vel_limit(i);
+            std::int16_t acc = codec_.acc_limit(i);
             if (std::abs(position) >= 360000000)
             {
-              RCLCPP_ERROR(
-                rclcpp::get_logger("CubeMarsSystemHardware"),
-                "position command is over maximal allowed value of 360000000: %d", position);
+              log_event(POSITION_LIMIT, i, 0, position);
+              flush_buses(period.seconds());
               return hardware_interface::return_type::ERROR;
             }
             // RCLCPP_INFO(
@@ -512,16 +826,41 @@ hardware_interface::return_type CubeMarsSystemHardware::write(
             //   i, position, vel, acc);
 
             std::uint8_t data[8];
-            data[0] = position >> 24;
-            data[1] = position >> 16;
-            data[2] = position >> 8;
-            data[3] = position;
+            JointCodec::encode(position, data);
             data[4] = vel >> 8;
             data[5] = vel;
             data[6] = acc >> 8;
             data[7] = acc;
 
-            can_.write_message(can_ids_[i] | POSITION_SPEED_LOOP << 8, data, 8);
+            queue_command(i, POSITION_SPEED_LOOP, data, 8);
+          }
+          break;
+        }
+        case IMPEDANCE:
+        {
+          // unclaimed interfaces stay NaN and don't contribute
+          const bool has_position = !std::isnan(hw_commands_positions_[i]);
+          const bool has_velocity = !std::isnan(hw_commands_velocities_[i]);
+          const bool has_effort = !std::isnan(hw_commands_efforts_[i]);
+          if (has_position || has_velocity || has_effort)
+          {
+            const double values[5] = {
+              has_position ? hw_commands_positions_[i] : 0,
+              has_velocity ? hw_commands_velocities_[i] : 0,
+              has_position && !std::isnan(hw_commands_stiffnesses_[i]) ?
+              hw_commands_stiffnesses_[i] : 0,
+              !std::isnan(hw_commands_dampings_[i]) ? hw_commands_dampings_[i] : 0,
+              has_effort ? hw_commands_efforts_[i] : 0};
+            std::uint8_t data[8];
+            int out_of_range = codec_.impedance_command(i, values, data);
+            if (out_of_range >= 0)
+            {
+              log_event(IMPEDANCE_LIMIT, i, out_of_range, values[out_of_range]);
+              flush_buses(period.seconds());
+              return hardware_interface::return_type::ERROR;
+            }
+
+            queue_command(i, IMPEDANCE, data, 8);
           }
           break;
         }
@@ -530,9 +869,522 @@ hardware_interface::return_type CubeMarsSystemHardware::write(
     }
   }
 
+  // transmit the commands of all joints at once
+  flush_buses(period.seconds());
+
   return hardware_interface::return_type::OK;
 }
 
+void CubeMarsSystemHardware::queue_command(
+  std::size_t i, std::uint8_t mode, const std::uint8_t data[], std::uint8_t len)
+{
+  if (!replay_file_.empty())
+  {
+    // commands have no effect on a recording
+    return;
+  }
+  const std::uint32_t id = can_ids_[i] | mode << 8;
+  if (tx_scheduler_enabled_)
+  {
+    // sent by flush_buses() if selected by the scheduler
+    scheduler_.submit(i, id, data, len, mode == CURRENT_LOOP || mode == IMPEDANCE);
+    return;
+  }
+  buses_[joint_bus_[i]]->can.queue_message(id, data, len);
+  joint_stats_[i].tx_stamp.store(now_ns(), std::memory_order_relaxed);
+}
+
+void CubeMarsSystemHardware::flush_buses(double period)
+{
+  if (tx_scheduler_enabled_)
+  {
+    std::uint64_t bits[JointCodec::MAX_BUSES] = {};
+    for (std::size_t bus = 0; bus < buses_.size(); bus++)
+    {
+      bits[bus] = buses_[bus]->can.bits();
+    }
+    std::uint8_t joints[JointCodec::MAX_JOINTS];
+    const std::int64_t now = now_ns();
+    const std::size_t n = scheduler_.schedule(now, period, bits, joints);
+
+    // joints in the order their commands were queued on every bus
+    std::uint8_t queued[JointCodec::MAX_BUSES][JointCodec::MAX_JOINTS];
+    std::size_t queued_count[JointCodec::MAX_BUSES] = {};
+    for (std::size_t k = 0; k < n; k++)
+    {
+      const std::size_t i = joints[k];
+      const std::size_t bus = joint_bus_[i];
+      if (buses_[bus]->can.queue_message(scheduler_.id(i), scheduler_.data(i), scheduler_.len(i)))
+      {
+        queued[bus][queued_count[bus]++] = i;
+        joint_stats_[i].tx_stamp.store(now, std::memory_order_relaxed);
+      }
+    }
+
+    // only the commands actually written count as sent, the others stay due
+    for (std::size_t bus = 0; bus < buses_.size(); bus++)
+    {
+      const std::size_t sent = buses_[bus]->can.flush();
+      for (std::size_t k = 0; k < sent && k < queued_count[bus]; k++)
+      {
+        scheduler_.sent(queued[bus][k], now);
+      }
+    }
+    return;
+  }
+
+  for (const std::unique_ptr<CanBus> & bus : buses_)
+  {
+    bus->can.flush();
+  }
+}
+
+void CubeMarsSystemHardware::start_rx_threads()
+{
+  if (!rx_thread_enabled_ || rx_thread_running_)
+  {
+    return;
+  }
+
+  rx_thread_running_ = true;
+  for (std::size_t i = 0; i < buses_.size(); i++)
+  {
+    CanBus & bus = *buses_[i];
+    bus.rx_thread = std::thread(&CubeMarsSystemHardware::rx_thread_loop, this, i);
+
+    if (bus.rx_thread_cpu >= 0)
+    {
+      cpu_set_t cpuset;
+      CPU_ZERO(&cpuset);
+      CPU_SET(bus.rx_thread_cpu, &cpuset);
+      if (pthread_setaffinity_np(bus.rx_thread.native_handle(), sizeof(cpu_set_t), &cpuset) != 0)
+      {
+        RCLCPP_WARN(
+          rclcpp::get_logger("CubeMarsSystemHardware"),
+          "Could not pin receive thread of %s to CPU %d", bus.itf.c_str(), bus.rx_thread_cpu);
+      }
+    }
+    if (rx_thread_priority_ > 0)
+    {
+      struct sched_param param;
+      param.sched_priority = rx_thread_priority_;
+      if (pthread_setschedparam(bus.rx_thread.native_handle(), SCHED_FIFO, &param) != 0)
+      {
+        RCLCPP_WARN(
+          rclcpp::get_logger("CubeMarsSystemHardware"),
+          "Could not set SCHED_FIFO priority %d for receive thread of %s",
+          rx_thread_priority_, bus.itf.c_str());
+      }
+    }
+
+    RCLCPP_INFO(
+      rclcpp::get_logger("CubeMarsSystemHardware"), "Receive thread of %s started", bus.itf.c_str());
+  }
+}
+
+void CubeMarsSystemHardware::stop_rx_threads()
+{
+  rx_thread_running_ = false;
+  for (const std::unique_ptr<CanBus> & bus : buses_)
+  {
+    if (bus->rx_thread.joinable())
+    {
+      bus->rx_thread.join();
+      RCLCPP_INFO(
+        rclcpp::get_logger("CubeMarsSystemHardware"), "Receive thread of %s stopped", bus->itf.c_str());
+    }
+  }
+}
+
+void CubeMarsSystemHardware::rx_thread_loop(std::size_t bus)
+{
+  CanSocket & can = buses_[bus]->can;
+  struct canfd_frame frames[CanSocket::MAX_BATCH];
+  std::int64_t stamps[CanSocket::MAX_BATCH];
+  StampedFeedback stamped;
+
+  while (rx_thread_running_.load(std::memory_order_relaxed))
+  {
+    // wake up regularly to check if the thread should stop
+    std::size_t n = can.read_batch(frames, CanSocket::MAX_BATCH, 100, stamps);
+    for (std::size_t k = 0; k < n; k++)
+    {
+      std::uint8_t i = codec_.index(bus, frames[k].can_id);
+      if (i != JointCodec::NO_JOINT)
+      {
+        JointCodec::decode(frames[k].data, stamped.feedback);
+        stamped.stamp = stamps[k];
+        rx_feedback_[i].store(stamped);
+        record_feedback(i, stamps[k]);
+      }
+    }
+  }
+}
+
+void CubeMarsSystemHardware::record_feedback(std::size_t i, std::int64_t stamp)
+{
+  JointStatistics & stats = joint_stats_[i];
+  stats.feedback_count.fetch_add(1, std::memory_order_relaxed);
+
+  // round trip from the last command to the first status message after it
+  std::int64_t tx_stamp = stats.tx_stamp.load(std::memory_order_relaxed);
+  if (tx_stamp != 0 && tx_stamp != stats.matched_tx_stamp && stamp > tx_stamp)
+  {
+    stats.round_trip.record(stamp - tx_stamp);
+    stats.last_round_trip.store(stamp - tx_stamp, std::memory_order_relaxed);
+    stats.matched_tx_stamp = tx_stamp;
+  }
+}
+
+void CubeMarsSystemHardware::start_statistics_thread()
+{
+  if (!statistics_pub_ || statistics_running_)
+  {
+    return;
+  }
+  statistics_running_ = true;
+  statistics_thread_ = std::thread(&CubeMarsSystemHardware::statistics_loop, this);
+}
+
+void CubeMarsSystemHardware::stop_statistics_thread()
+{
+  statistics_running_ = false;
+  if (statistics_thread_.joinable())
+  {
+    statistics_thread_.join();
+  }
+}
+
+void CubeMarsSystemHardware::statistics_loop()
+{
+  using clock = std::chrono::steady_clock;
+  const auto period = std::chrono::duration_cast<clock::duration>(
+    std::chrono::duration<double>(1 / statistics_rate_));
+
+  // histograms and counters at the end of the last period
+  std::vector<std::array<std::uint64_t, LatencyHistogram::BUCKETS>> last_round_trips(
+    info_.joints.size());
+  std::vector<std::array<std::uint64_t, LatencyHistogram::BUCKETS>> last_ages(info_.joints.size());
+  std::vector<std::uint64_t> last_counts(info_.joints.size(), 0);
+  std::vector<std::uint64_t> last_missed(info_.joints.size(), 0);
+  std::vector<std::uint64_t> last_missed_deadlines(info_.joints.size(), 0);
+  std::vector<std::uint64_t> last_deferred(info_.joints.size(), 0);
+  for (const std::unique_ptr<CanBus> & bus : buses_)
+  {
+    bus->last_bits = bus->can.bits();
+  }
+  clock::time_point last = clock::now();
+
+  while (statistics_running_)
+  {
+    // sleep in short steps to stop quickly
+    clock::time_point next = last + period;
+    while (statistics_running_ && clock::now() < next)
+    {
+      std::this_thread::sleep_for(
+        std::min<clock::duration>(next - clock::now(), std::chrono::milliseconds(100)));
+    }
+    if (!statistics_running_)
+    {
+      break;
+    }
+    clock::time_point now = clock::now();
+    const double dt = std::chrono::duration<double>(now - last).count();
+    last = now;
+
+    for (const std::unique_ptr<CanBus> & bus : buses_)
+    {
+      std::uint64_t bits = bus->can.bits();
+      bus->load.store((bits - bus->last_bits) / dt / bitrate_, std::memory_order_relaxed);
+      bus->last_bits = bits;
+    }
+
+    diagnostic_msgs::msg::DiagnosticArray msg;
+    msg.header.stamp = statistics_node_->now();
+    for (std::size_t i = 0; i < info_.joints.size(); i++)
+    {
+      JointStatistics & stats = joint_stats_[i];
+      std::uint64_t round_trips[LatencyHistogram::BUCKETS];
+      std::uint64_t ages[LatencyHistogram::BUCKETS];
+      stats.round_trip.snapshot(round_trips);
+      stats.feedback_age.snapshot(ages);
+      for (std::size_t k = 0; k < LatencyHistogram::BUCKETS; k++)
+      {
+        // only count what happened during this period
+        std::uint64_t total = round_trips[k];
+        round_trips[k] -= last_round_trips[i][k];
+        last_round_trips[i][k] = total;
+        total = ages[k];
+        ages[k] -= last_ages[i][k];
+        last_ages[i][k] = total;
+      }
+      std::uint64_t count = stats.feedback_count.load(std::memory_order_relaxed);
+      std::uint64_t missed = stats.missed_feedback.load(std::memory_order_relaxed);
+      std::uint64_t missed_deadlines = stats.missed_deadline.load(std::memory_order_relaxed);
+      std::uint64_t deferred = tx_scheduler_enabled_ ? scheduler_.deferred(i) : 0;
+
+      diagnostic_msgs::msg::DiagnosticStatus status;
+      status.name = info_.name + ": " + info_.joints[i].name;
+      status.hardware_id = buses_[joint_bus_[i]]->itf + " " + std::to_string(can_ids_[i]);
+      status.level = missed > last_missed[i]
+        ? diagnostic_msgs::msg::DiagnosticStatus::WARN
+        : diagnostic_msgs::msg::DiagnosticStatus::OK;
+      status.message = missed > last_missed[i] ? "Missed feedback" : "OK";
+      auto add_value = [&status](const std::string & key, double value) {
+          diagnostic_msgs::msg::KeyValue kv;
+          kv.key = key;
+          kv.value = std::to_string(value);
+          status.values.push_back(kv);
+        };
+      add_value("feedback rate [Hz]", (count - last_counts[i]) / dt);
+      add_value("missed feedback", missed - last_missed[i]);
+      add_value("missed deadline", missed_deadlines - last_missed_deadlines[i]);
+      add_value("round trip p50 [s]", LatencyHistogram::quantile(round_trips, 0.5));
+      add_value("round trip p99 [s]", LatencyHistogram::quantile(round_trips, 0.99));
+      add_value("feedback age p50 [s]", LatencyHistogram::quantile(ages, 0.5));
+      add_value("feedback age p99 [s]", LatencyHistogram::quantile(ages, 0.99));
+      add_value("bus load", buses_[joint_bus_[i]]->load.load(std::memory_order_relaxed));
+      if (tx_scheduler_enabled_)
+      {
+        add_value("bus load estimate", scheduler_.utilization(joint_bus_[i]));
+        add_value("deferred commands", deferred - last_deferred[i]);
+      }
+      msg.status.push_back(status);
+
+      last_counts[i] = count;
+      last_missed[i] = missed;
+      last_missed_deadlines[i] = missed_deadlines;
+      last_deferred[i] = deferred;
+    }
+    statistics_pub_->publish(msg);
+  }
+}
+
+void CubeMarsSystemHardware::receive_feedback()
+{
+  struct canfd_frame frames[CanSocket::MAX_BATCH];
+  std::int64_t stamps[CanSocket::MAX_BATCH];
+  std::size_t n;
+
+  // read all buffered CAN messages, up to MAX_BATCH per system call
+  for (std::size_t bus = 0; bus < buses_.size(); bus++)
+  {
+    do
+    {
+      n = buses_[bus]->can.read_batch(frames, CanSocket::MAX_BATCH, 0, stamps);
+      for (std::size_t k = 0; k < n; k++)
+      {
+        std::uint8_t i = codec_.index(bus, frames[k].can_id);
+        if (i != JointCodec::NO_JOINT)
+        {
+          JointCodec::decode(frames[k].data, feedback_[i]);
+          feedback_stamps_[i] = stamps[k];
+          feedback_received_[i] = true;
+          record_feedback(i, stamps[k]);
+          // only a status message sent after the last command counts as reply
+          if (!feedback_fresh_[i] &&
+            stamps[k] >= joint_stats_[i].tx_stamp.load(std::memory_order_relaxed))
+          {
+            feedback_fresh_[i] = true;
+            feedback_pending_--;
+          }
+        }
+      }
+    } while (n == CanSocket::MAX_BATCH);
+  }
+}
+
+void CubeMarsSystemHardware::replay_feedback(const rclcpp::Duration & period)
+{
+  std::fill(feedback_received_.begin(), feedback_received_.end(), false);
+
+  // advance the time of the recording by one update period, independent of the wall clock
+  replay_time_ += period.nanoseconds();
+  const std::int64_t now = now_ns();
+  for (; replay_index_ < replay_.size() && replay_[replay_index_].stamp <= replay_time_;
+    replay_index_++)
+  {
+    const RecordedFrame & frame = replay_[replay_index_];
+    if (frame.flags & RecordedFrame::TX || frame.bus >= JointCodec::MAX_BUSES)
+    {
+      continue;
+    }
+    std::uint8_t i = codec_.index(frame.bus, frame.can_id & 0xFF);
+    if (i != JointCodec::NO_JOINT)
+    {
+      JointCodec::decode(frame.data, feedback_[i]);
+      feedback_stamps_[i] = now;
+      feedback_received_[i] = true;
+    }
+  }
+}
+
+void CubeMarsSystemHardware::log_event(
+  event_t type, std::size_t joint, std::uint8_t code, double value)
+{
+  Event event;
+  event.stamp = now_ns();
+  event.value = value;
+  event.joint = joint;
+  event.type = type;
+  event.code = code;
+  events_.push(event);
+}
+
+void CubeMarsSystemHardware::print_event(const Event & event, std::uint64_t suppressed)
+{
+  static const char * faults[] = {
+    "No fault.",
+    "Motor over-temperature fault.",
+    "Over-current fault.",
+    "Over-voltage fault.",
+    "Under-voltage fault.",
+    "Encoder fault.",
+    "MOSFET over-temperature fault.",
+    "Motor stall."
+  };
+
+  static const char * impedance_values[] = {
+    "position", "velocity", "stiffness", "damping", "torque"
+  };
+
+  const std::string note = suppressed > 0
+    ? " (" + std::to_string(suppressed) + " similar messages suppressed)"
+    : "";
+  const rclcpp::Logger logger = rclcpp::get_logger("CubeMarsSystemHardware");
+  switch (event.type)
+  {
+    case NO_FEEDBACK:
+      RCLCPP_WARN(
+        logger, "No CAN message received from CAN ID: %u.%s", can_ids_[event.joint], note.c_str());
+      break;
+    case MOTOR_FAULT:
+      RCLCPP_ERROR(
+        logger, "Joint %u: %s%s", event.joint,
+        event.code < sizeof(faults) / sizeof(faults[0]) ? faults[event.code] : "Unknown fault.",
+        note.c_str());
+      break;
+    case TORQUE_LIMIT:
+      RCLCPP_ERROR(logger, "Joint %u went over torque limit.%s", event.joint, note.c_str());
+      break;
+    case CURRENT_LIMIT:
+      RCLCPP_ERROR(
+        logger, "current command is over maximal allowed value of 60000: %d%s",
+        static_cast<std::int32_t>(event.value), note.c_str());
+      break;
+    case SPEED_LIMIT:
+      RCLCPP_ERROR(
+        logger, "speed command is over maximal allowed value of 100000: %d%s",
+        static_cast<std::int32_t>(event.value), note.c_str());
+      break;
+    case POSITION_LIMIT:
+      RCLCPP_ERROR(
+        logger, "position command is over maximal allowed value of 360000000: %d%s",
+        static_cast<std::int32_t>(event.value), note.c_str());
+      break;
+    case READ_ONLY_POSITION:
+      RCLCPP_INFO(logger, "Joint %u: pos: %f", event.joint, event.value);
+      break;
+    case IMPEDANCE_LIMIT:
+      RCLCPP_ERROR(
+        logger, "Joint %u: impedance %s command is out of range: %f%s", event.joint,
+        impedance_values[event.code < 5 ? event.code : 0], event.value, note.c_str());
+      break;
+    case DEADLINE_MISSED:
+      RCLCPP_WARN(
+        logger, "No reply from CAN ID %u within %.0f us.%s", can_ids_[event.joint], event.value,
+        note.c_str());
+      break;
+    default:
+      break;
+  }
+}
+
+void CubeMarsSystemHardware::start_event_thread()
+{
+  if (event_running_)
+  {
+    return;
+  }
+  event_running_ = true;
+  event_thread_ = std::thread(&CubeMarsSystemHardware::event_loop, this);
+}
+
+void CubeMarsSystemHardware::stop_event_thread()
+{
+  event_running_ = false;
+  if (event_thread_.joinable())
+  {
+    event_thread_.join();
+  }
+}
+
+void CubeMarsSystemHardware::event_loop()
+{
+  // events of the same type and joint which were not printed yet
+  struct Summary
+  {
+    Event last;
+    std::uint64_t pending = 0;
+    std::int64_t last_print = 0;
+  };
+  std::vector<std::array<Summary, EVENT_TYPES>> summaries(info_.joints.size());
+  const std::int64_t period = log_period_ * 1e9;
+  std::uint64_t dropped = 0;
+  std::int64_t last_dropped_print = 0;
+  bool running = true;
+
+  while (running)
+  {
+    // drain the remaining events once more after the thread was stopped
+    running = event_running_;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    Event event;
+    while (events_.pop(event))
+    {
+      Summary & summary = summaries[event.joint][event.type];
+      const bool new_fault = event.type == MOTOR_FAULT && event.code != summary.last.code;
+      if (new_fault || event.stamp - summary.last_print >= period)
+      {
+        print_event(event, summary.pending);
+        summary.pending = 0;
+        summary.last_print = event.stamp;
+      }
+      else
+      {
+        summary.pending++;
+      }
+      summary.last = event;
+    }
+
+    // print the latest of the suppressed events once the period is over
+    const std::int64_t now = now_ns();
+    for (auto & joint_summaries : summaries)
+    {
+      for (Summary & summary : joint_summaries)
+      {
+        if (summary.pending > 0 && now - summary.last_print >= period)
+        {
+          print_event(summary.last, summary.pending - 1);
+          summary.pending = 0;
+          summary.last_print = now;
+        }
+      }
+    }
+
+    // the dropped events are reported with the same rate limit, and once more when stopping
+    if (events_.dropped() != dropped && (now - last_dropped_print >= period || !running))
+    {
+      RCLCPP_WARN(
+        rclcpp::get_logger("CubeMarsSystemHardware"),
+        "%lu events could not be logged", events_.dropped() - dropped);
+      dropped = events_.dropped();
+      last_dropped_print = now;
+    }
+  }
+}
+
 }  // namespace cubemars_hardware
 
 #include "pluginlib/class_list_macros.hpp"
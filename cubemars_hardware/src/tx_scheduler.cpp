@@ -0,0 +1,164 @@
+#include "cubemars_hardware/tx_scheduler.hpp"
+
+#include <cstring>
+
+#include "cubemars_hardware/statistics.hpp"
+
+namespace cubemars_hardware
+{
+TxScheduler::TxScheduler()
+: keep_alive_(0),
+  load_budget_(1),
+  bitrate_(1e6),
+  fd_(false),
+  data_ratio_(1),
+  size_(0)
+{
+  std::memset(ids_, 0, sizeof(ids_));
+  std::memset(data_, 0, sizeof(data_));
+  std::memset(lens_, 0, sizeof(lens_));
+  std::memset(submitted_, 0, sizeof(submitted_));
+  std::memset(priorities_, 0, sizeof(priorities_));
+  std::memset(sent_ids_, 0, sizeof(sent_ids_));
+  std::memset(sent_data_, 0, sizeof(sent_data_));
+  std::memset(sent_lens_, 0, sizeof(sent_lens_));
+  std::memset(sent_stamps_, 0, sizeof(sent_stamps_));
+  std::memset(bus_joints_, 0, sizeof(bus_joints_));
+  std::memset(bus_sizes_, 0, sizeof(bus_sizes_));
+  std::memset(cursors_, 0, sizeof(cursors_));
+  std::memset(last_bits_, 0, sizeof(last_bits_));
+  for (std::size_t bus = 0; bus < JointCodec::MAX_BUSES; bus++)
+  {
+    tx_bits_[bus] = 0;
+    rx_bits_[bus] = 0;
+    utilization_[bus] = 0;
+  }
+  for (std::size_t i = 0; i < JointCodec::MAX_JOINTS; i++)
+  {
+    deferred_[i] = 0;
+  }
+}
+
+void TxScheduler::configure(
+  double keep_alive, double load_budget, double bitrate, bool fd, double data_ratio)
+{
+  keep_alive_ = keep_alive * 1e9;
+  load_budget_ = load_budget;
+  bitrate_ = bitrate;
+  fd_ = fd;
+  data_ratio_ = data_ratio;
+}
+
+bool TxScheduler::add_joint(std::size_t bus)
+{
+  if (size_ >= JointCodec::MAX_JOINTS || bus >= JointCodec::MAX_BUSES)
+  {
+    return false;
+  }
+  bus_joints_[bus][bus_sizes_[bus]++] = size_++;
+  return true;
+}
+
+void TxScheduler::submit(
+  std::size_t i, std::uint32_t id, const std::uint8_t data[], std::uint8_t len, bool priority)
+{
+  ids_[i] = id;
+  std::memset(data_[i], 0, sizeof(data_[i]));
+  std::memcpy(data_[i], data, len);
+  lens_[i] = len;
+  priorities_[i] = priority;
+  submitted_[i] = true;
+}
+
+double TxScheduler::frame_bits(std::uint8_t len) const
+{
+  return fd_ ? canfd_frame_bits(len, data_ratio_) : can_frame_bits(len);
+}
+
+bool TxScheduler::due(std::size_t i, std::int64_t now) const
+{
+  return ids_[i] != sent_ids_[i] || lens_[i] != sent_lens_[i] ||
+         std::memcmp(data_[i], sent_data_[i], sizeof(data_[i])) != 0 ||
+         now - sent_stamps_[i] >= keep_alive_;
+}
+
+std::size_t TxScheduler::schedule(
+  std::int64_t now, double period, const std::uint64_t bus_bits[],
+  std::uint8_t joints[JointCodec::MAX_JOINTS])
+{
+  std::size_t count = 0;
+  for (std::size_t bus = 0; bus < JointCodec::MAX_BUSES; bus++)
+  {
+    if (bus_sizes_[bus] == 0)
+    {
+      continue;
+    }
+
+    // everything on the bus since the last cycle which was not sent by us was received
+    const bool first = last_bits_[bus] == 0;
+    const double bits = bus_bits[bus] - last_bits_[bus];
+    last_bits_[bus] = bus_bits[bus];
+    if (period > 0 && !first)
+    {
+      const double rx_bits = bits > tx_bits_[bus] ? bits - tx_bits_[bus] : 0;
+      rx_bits_[bus] += 0.1 * (rx_bits - rx_bits_[bus]);
+      const double utilization = utilization_[bus].load(std::memory_order_relaxed);
+      utilization_[bus].store(
+        utilization + 0.1 * (bits / (bitrate_ * period) - utilization), std::memory_order_relaxed);
+    }
+
+    // bits left for commands in this cycle, at least one command is always sent
+    double budget = load_budget_ * bitrate_ * period - rx_bits_[bus];
+    const std::size_t start = count;
+    count = take(bus, true, now, budget, joints, count, start);
+    count = take(bus, false, now, budget, joints, count, start);
+
+    tx_bits_[bus] = 0;
+    for (std::size_t k = start; k < count; k++)
+    {
+      tx_bits_[bus] += frame_bits(lens_[joints[k]]);
+    }
+  }
+
+  std::memset(submitted_, 0, sizeof(submitted_));
+  return count;
+}
+
+void TxScheduler::sent(std::size_t i, std::int64_t now)
+{
+  sent_ids_[i] = ids_[i];
+  std::memcpy(sent_data_[i], data_[i], sizeof(data_[i]));
+  sent_lens_[i] = lens_[i];
+  sent_stamps_[i] = now;
+}
+
+std::size_t TxScheduler::take(
+  std::size_t bus, bool priority, std::int64_t now, double & budget, std::uint8_t joints[],
+  std::size_t count, std::size_t start)
+{
+  const std::size_t n = bus_sizes_[bus];
+  std::size_t & cursor = cursors_[bus][priority];
+  std::size_t next = cursor;
+  for (std::size_t k = 0; k < n; k++)
+  {
+    const std::size_t slot = (cursor + k) % n;
+    const std::size_t i = bus_joints_[bus][slot];
+    if (!submitted_[i] || priorities_[i] != priority || !due(i, now))
+    {
+      continue;
+    }
+    const double bits = frame_bits(lens_[i]);
+    if (budget < bits && count > start)
+    {
+      deferred_[i].fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    budget -= bits;
+    joints[count++] = i;
+    // continue after the last joint sent in the next cycle
+    next = (slot + 1) % n;
+  }
+  cursor = next;
+  return count;
+}
+}
@@ -0,0 +1,153 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file urg_clock_synchronizer.hpp
+ * @brief LiDAR時刻とシステム時刻の同期
+ */
+
+#ifndef URG_NODE2_URG_CLOCK_SYNCHRONIZER_HPP_
+#define URG_NODE2_URG_CLOCK_SYNCHRONIZER_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace urg_node2
+{
+
+/**
+ * @brief LiDAR時刻からシステム時刻を推定する
+ * @details (LiDAR時刻, 受信時のシステム時刻)の組から、時刻のオフセットとLiDAR時計のずれ（ドリフト）を推定する
+ * 受信時刻には通信や処理待ちの遅延が加わるため、一定期間ごとに遅延が最小の組のみを残し（最小遅延フィルタ）、
+ * 直近の期間の組に対する線形回帰で推定する
+ * 24bitのLiDAR時刻の周回は差分で扱うため、周回によるリセットは発生しない
+ */
+class UrgClockSynchronizer
+{
+public:
+  /**
+   * @brief コンストラクタ
+   * @param[in] bucket_period 最小遅延の組を選ぶ期間[sec]
+   * @param[in] window_size 回帰に使う期間の数
+   * @param[in] reset_threshold 推定をリセットする時刻のずれ[sec]
+   */
+  explicit UrgClockSynchronizer(
+    double bucket_period = 1.0, size_t window_size = 30,
+    double reset_threshold = 0.1);
+
+  /**
+   * @brief 推定のリセット
+   */
+  void reset();
+
+  /**
+   * @brief 時刻の組の追加と同期時刻の取得
+   * @details LiDAR時刻が飛んだ場合（LiDARの再起動など）や受信が長く途切れた場合は、受信時刻から推定をやり直す
+   * @param[in] time_stamp LiDAR時刻[msec]（下位24bitのみ使用）
+   * @param[in] system_time_ns 受信時のシステム時刻[nsec]
+   * @return LiDAR時刻に対応するシステム時刻[nsec]（最小遅延の受信時刻）
+   */
+  int64_t update(long time_stamp, int64_t system_time_ns);
+
+  /**
+   * @brief LiDAR時計のずれ
+   * @return システム時刻に対するLiDAR時計の遅れ[ppm]
+   */
+  double drift_ppm() const;
+
+  /**
+   * @brief 受信時刻のジッタ
+   * @return 直近の受信時刻の推定値に対する残差の標準偏差[sec]
+   */
+  double jitter() const;
+
+  /**
+   * @brief 推定のリセット回数
+   * @return LiDAR時刻の飛びを検出してリセットした回数
+   */
+  int reset_count() const;
+
+private:
+  /** LiDAR時刻と（システム時刻 - LiDAR時刻）の組（起点からの経過時間[sec]） */
+  struct Sample
+  {
+    double sensor_time;
+    double offset;
+  };
+
+  /** ジッタ計算に使う残差の数 */
+  static constexpr size_t kResidualSize = 100;
+  /** 推定のリセットを判断する連続した外れ値の数 */
+  static constexpr int kResetOutliers = 10;
+
+  /**
+   * @brief 推定するオフセット
+   * @param[in] sensor_time LiDAR時刻[sec]
+   * @return システム時刻 - LiDAR時刻[sec]
+   */
+  double predict(double sensor_time) const;
+
+  /**
+   * @brief 回帰による推定の更新
+   */
+  void fit();
+
+  /**
+   * @brief 残差の追加とジッタの更新
+   * @param[in] residual 残差[sec]
+   */
+  void add_residual(double residual);
+
+  const double bucket_period_;
+  const size_t window_size_;
+  const double reset_threshold_;
+
+  bool is_initialized_;
+  /** 起点のシステム時刻[nsec] */
+  int64_t origin_ns_;
+  /** 前回のシステム時刻[nsec] */
+  int64_t last_system_time_ns_;
+  /** 前回のLiDAR時刻（24bit） */
+  uint32_t last_time_stamp_;
+  /** 周回を補正した起点からのLiDAR時刻[msec] */
+  int64_t ticks_;
+
+  /** 完了した期間の最小遅延の組（スキャンごとのメモリ確保を避けるためvectorで保持する） */
+  std::vector<Sample> samples_;
+  /** 現在の期間の最小遅延の組 */
+  Sample bucket_min_;
+  /** 現在の期間の開始時刻[sec] */
+  double bucket_start_;
+
+  /** 回帰直線（center時点のoffsetと傾き） */
+  double fit_center_;
+  double fit_offset_;
+  double fit_drift_;
+  /** 連続した外れ値の数 */
+  int outliers_;
+
+  std::vector<double> residuals_;
+  size_t residual_index_;
+
+  /** Diagnostics用（スキャンスレッド以外から参照される） */
+  std::atomic<double> drift_ppm_;
+  std::atomic<double> jitter_;
+  std::atomic<int> reset_count_;
+};
+
+}  // namespace urg_node2
+
+#endif  // URG_NODE2_URG_CLOCK_SYNCHRONIZER_HPP_
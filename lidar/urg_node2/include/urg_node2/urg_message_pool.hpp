@@ -0,0 +1,145 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file urg_message_pool.hpp
+ * @brief 配信メッセージの再利用
+ */
+
+#ifndef URG_NODE2_URG_MESSAGE_POOL_HPP_
+#define URG_NODE2_URG_MESSAGE_POOL_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace urg_node2
+{
+
+/**
+ * @brief 配信メッセージのプール
+ * @details 領域を確保済みのメッセージを再利用し、スキャンごとのメモリ確保を避ける
+ * unique_ptrで配信したメッセージ（所有権が購読側に移る）は戻さず、次のacquire()で新たに確保する
+ * スレッドセーフではないため、1つのスレッドから使うこと
+ */
+template<typename MessageT>
+class UrgMessagePool
+{
+public:
+  /** 新しく確保したメッセージの初期化（配列の領域確保など） */
+  using Initializer = std::function<void (MessageT & msg)>;
+
+  /**
+   * @brief コンストラクタ
+   * @param[in] max_size 保持するメッセージの最大数
+   */
+  explicit UrgMessagePool(size_t max_size = 4)
+  : max_size_(max_size)
+  {
+    pool_.reserve(max_size_);
+  }
+
+  /**
+   * @brief 初期化方法の設定
+   * @details 保持しているメッセージは破棄される
+   * @param[in] initializer 新しく確保したメッセージの初期化
+   * @param[in] prefill 事前に確保するメッセージ数
+   */
+  void set_initializer(Initializer initializer, size_t prefill = 1)
+  {
+    initializer_ = std::move(initializer);
+    pool_.clear();
+    while (pool_.size() < prefill && pool_.size() < max_size_) {
+      pool_.push_back(create());
+    }
+  }
+
+  /**
+   * @brief メッセージの取得
+   * @details 保持しているメッセージがなければ新しく確保する
+   * @return メッセージ（内容は前回使用時のまま）
+   */
+  std::unique_ptr<MessageT> acquire()
+  {
+    if (pool_.empty()) {
+      return create();
+    }
+    std::unique_ptr<MessageT> msg = std::move(pool_.back());
+    pool_.pop_back();
+    return msg;
+  }
+
+  /**
+   * @brief メッセージの返却
+   * @param[in] msg acquire()で取得したメッセージ
+   */
+  void release(std::unique_ptr<MessageT> msg)
+  {
+    if (msg && pool_.size() < max_size_) {
+      pool_.push_back(std::move(msg));
+    }
+  }
+
+  /**
+   * @brief 保持しているメッセージ数
+   */
+  size_t size() const
+  {
+    return pool_.size();
+  }
+
+private:
+  std::unique_ptr<MessageT> create()
+  {
+    auto msg = std::make_unique<MessageT>();
+    if (initializer_) {
+      initializer_(*msg);
+    }
+    return msg;
+  }
+
+  size_t max_size_;
+  Initializer initializer_;
+  std::vector<std::unique_ptr<MessageT>> pool_;
+};
+
+/**
+ * @brief プールのメッセージの配信
+ * @details プロセス内通信が有効な場合は所有権を購読側に渡し（コピーなし）、
+ * 無効な場合はシリアライズ後のメッセージをプールに戻して再利用する
+ * @param[in] publisher 配信するpublisher
+ * @param[in,out] pool メッセージを取得したプール
+ * @param[in] msg 配信するメッセージ
+ * @param[in] use_intra_process プロセス内通信が有効かどうか
+ */
+template<typename PublisherT, typename MessageT>
+void publish_pooled_message(
+  PublisherT & publisher, UrgMessagePool<MessageT> & pool,
+  std::unique_ptr<MessageT> msg, bool use_intra_process)
+{
+  if (use_intra_process) {
+    // 同一プロセスの購読側には所有権を渡す（const参照の配信ではコピーされる）
+    publisher.publish(std::move(msg));
+  } else {
+    // プロセス間通信ではシリアライズされるため、配信後のメッセージは再利用できる
+    publisher.publish(*msg);
+    pool.release(std::move(msg));
+  }
+}
+
+}  // namespace urg_node2
+
+#endif  // URG_NODE2_URG_MESSAGE_POOL_HPP_
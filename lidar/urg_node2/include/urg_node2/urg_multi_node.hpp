@@ -0,0 +1,206 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file urg_multi_node.hpp
+ * @brief 複数LiDARを1プロセスで扱うROS2対応LiDARドライバ
+ */
+
+#ifndef URG_NODE2_URG_MULTI_NODE_HPP_
+#define URG_NODE2_URG_MULTI_NODE_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/laser_scan.hpp"
+#include "urg_sensor.h"
+#include "urg_utils.h"
+#include "urg_node2/urg_multiplexer.hpp"
+#include "urg_node2/urg_sensor_setup.hpp"
+
+/** @def
+ * 受信がない場合に切断とみなすまでのスキャン周期数（電源断やケーブル抜けの検出用）
+ */
+#define URG_NODE2_RECEIVE_TIMEOUT_SCANS 4
+
+namespace urg_node2
+{
+
+class UrgMultiNode : public rclcpp::Node
+{
+public:
+  /**
+   * @brief コンストラクタ
+   * @details パラメータの取得、全LiDARとの接続、計測の開始およびイベントループの開始を行う
+   * 接続できなかったLiDARは再接続スレッドで接続を繰り返す
+   */
+  explicit UrgMultiNode(const rclcpp::NodeOptions & node_options = rclcpp::NodeOptions());
+
+  /**
+   * @brief デストラクタ
+   * @details 再接続スレッドとイベントループを停止し、全LiDARの計測停止と切断を行う
+   */
+  ~UrgMultiNode();
+
+private:
+  /** スキャントピック用のパラメータ（接続ごとに更新する） */
+  struct ScanParameter
+  {
+    /** スキャンデータの最大ステップ数 */
+    int max_size = 0;
+    /** スキャン範囲とトピック用の角度・時間・距離 */
+    UrgScanRange range;
+    /** スキャン周期 [sec] */
+    double scan_time = 0.0;
+    /** 応答の受信時刻からスキャン開始角度の時刻までの補正時間 [sec] */
+    double time_correction = 0.0;
+  };
+
+  /** LiDAR1台分の設定と状態 */
+  struct Sensor
+  {
+    std::string name;
+    std::string ip_address;
+    int ip_port;
+    std::string serial_port;
+    int serial_baud;
+    std::string frame_id;
+    bool publish_intensity;
+    double angle_min;
+    double angle_max;
+    int skip;
+    int cluster;
+    double time_offset;
+
+    /** 以下の接続状態は再接続スレッド（開始前はコンストラクタ）からのみ参照する */
+    urg_t urg;
+    bool is_connected;
+    /** 接続したLiDARのシリアルID（再接続時に同じLiDARかを確認する） */
+    std::string serial_id;
+    /** イベントループに登録済みかどうか */
+    bool is_added;
+
+    /** 以下の再接続待ちの状態はreconnect_mutex_で保護する */
+    bool needs_reconnect;
+    /** 次の再接続の時刻 */
+    std::chrono::steady_clock::time_point reconnect_time;
+    /** 再接続に失敗した場合の待ち時間 */
+    std::chrono::milliseconds reconnect_interval;
+
+    /** スキャントピック用のパラメータ（再接続スレッドとワーカースレッドで共有するためmutexで保護する） */
+    mutable std::mutex mutex;
+    ScanParameter scan;
+
+    rclcpp::Publisher<sensor_msgs::msg::LaserScan>::SharedPtr scan_pub;
+  };
+
+  /**
+   * @brief パラメータの宣言と取得
+   * @param[in] name LiDAR名
+   * @return LiDARの設定
+   */
+  std::unique_ptr<Sensor> declare_sensor(const std::string & name);
+
+  /**
+   * @brief LiDAR接続
+   * @param[in,out] sensor LiDARの設定と状態
+   * @retval true 成功
+   * @retval false 失敗
+   */
+  bool connect(Sensor & sensor);
+
+  /**
+   * @brief LiDAR再接続（パラメータ再利用）
+   * @details PPコマンドを省略して接続する。前回と異なるLiDARの場合はconnect()で接続し直す
+   * @param[in,out] sensor 切断済みのLiDARの設定と状態
+   * @retval true 成功
+   * @retval false 失敗
+   */
+  bool resume(Sensor & sensor);
+
+  /**
+   * @brief 計測開始
+   * @details スキャン範囲の設定、スキャントピック用のパラメータの更新および連続計測の開始を行う
+   * @param[in,out] sensor 接続済みのLiDARの設定と状態
+   * @retval true 成功
+   * @retval false 失敗（LiDARは切断される）
+   */
+  bool start_measurement(Sensor & sensor);
+
+  /**
+   * @brief イベントループへの登録
+   * @details 初回はコールバックとともに登録し、再接続後は新しい接続の監視を再開する
+   * 受信がURG_NODE2_RECEIVE_TIMEOUT_SCANS回分のスキャン周期途絶えた場合も切断とみなす
+   * @param[in,out] sensor 計測開始済みのLiDARの設定と状態
+   * @retval true 成功
+   * @retval false 失敗
+   */
+  bool watch(Sensor & sensor);
+
+  /**
+   * @brief LiDAR再接続と計測開始
+   * @param[in,out] sensor LiDARの設定と状態
+   * @retval true 成功
+   * @retval false 失敗
+   */
+  bool reconnect(Sensor & sensor);
+
+  /**
+   * @brief 再接続の要求
+   * @details 切断時のコールバック（イベントループのスレッド）から呼ばれる
+   * @param[in,out] sensor 切断されたLiDAR
+   */
+  void request_reconnect(Sensor & sensor);
+
+  /**
+   * @brief 再接続スレッド
+   * @details 再接続待ちのLiDARを1台ずつ再接続する。失敗した場合の待ち時間はLiDARごとに倍にする
+   */
+  void reconnect_thread();
+
+  /**
+   * @brief スキャンデータのpublish
+   * @details 応答を解析してスキャントピックを配信する。ワーカースレッドから呼ばれる
+   * @param[in] sensor LiDARの設定と状態
+   * @param[in] response 計測コマンドの応答
+   * @param[in] receive_time 応答の先頭を受信した時刻
+   */
+  void publish_scan(
+    const Sensor & sensor, const std::vector<char> & response,
+    UrgMultiplexer::Clock::time_point receive_time);
+
+  /** LiDAR */
+  std::vector<std::unique_ptr<Sensor>> sensors_;
+  /** 全LiDARの受信を行うイベントループ */
+  std::unique_ptr<UrgMultiplexer> multiplexer_;
+
+  /** 再接続スレッド */
+  std::thread reconnect_thread_;
+  /** 再接続待ちの状態の排他 */
+  std::mutex reconnect_mutex_;
+  /** 再接続要求と停止要求の通知 */
+  std::condition_variable reconnect_condition_;
+  /** 再接続スレッドの停止要求 */
+  bool is_closing_;
+};
+
+}  // namespace urg_node2
+
+#endif  // URG_NODE2_URG_MULTI_NODE_HPP_
@@ -0,0 +1,70 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file urg_multiecho.hpp
+ * @brief マルチエコーの受信データのメッセージへの変換
+ */
+
+#ifndef URG_NODE2_URG_MULTIECHO_HPP_
+#define URG_NODE2_URG_MULTIECHO_HPP_
+
+#include "sensor_msgs/msg/laser_scan.hpp"
+#include "sensor_msgs/msg/multi_echo_laser_scan.hpp"
+
+namespace urg_node2
+{
+
+/**
+ * @brief マルチエコーメッセージの領域確保
+ * @details 各ステップのエコー配列をURG_MAX_ECHO個分確保する
+ * @param[in] max_beams 最大ステップ数
+ * @param[in] use_intensity 強度の領域も確保するかどうか
+ * @param[out] msg マルチエコーメッセージ
+ */
+void reserve_multiecho(
+  int max_beams, bool use_intensity,
+  sensor_msgs::msg::MultiEchoLaserScan & msg);
+
+/**
+ * @brief マルチエコーメッセージへの格納
+ * @details 前回のメッセージのエコー配列を再利用するため、ステップ数が変わらなければメモリ確保は発生しない
+ * @param[in] distance 距離データ[mm]（1ステップあたりURG_MAX_ECHO個、0以降はエコーなし）
+ * @param[in] intensity 強度データ（nullptrのときは格納しない）
+ * @param[in] num_beams ステップ数
+ * @param[out] msg マルチエコーメッセージ
+ */
+void set_multiecho_ranges(
+  const long distance[], const unsigned short intensity[], int num_beams,
+  sensor_msgs::msg::MultiEchoLaserScan & msg);
+
+/**
+ * @brief 代表エコーのスキャンへの格納
+ * @details 最初のエコー、最後のエコー、強度が最大のエコーをそれぞれのスキャンに格納する（laser_procと同じ選択）
+ * エコーのないステップの距離はNaN、強度は0とする
+ * @param[in] distance 距離データ[mm]（1ステップあたりURG_MAX_ECHO個、0以降はエコーなし）
+ * @param[in] intensity 強度データ（nullptrのときは格納しない）
+ * @param[in] num_beams ステップ数
+ * @param[out] first 最初のエコーのスキャン
+ * @param[out] last 最後のエコーのスキャン
+ * @param[out] most_intense 強度が最大のエコーのスキャン（nullptrまたは強度がない場合は格納しない）
+ */
+void set_echo_ranges(
+  const long distance[], const unsigned short intensity[], int num_beams,
+  sensor_msgs::msg::LaserScan & first, sensor_msgs::msg::LaserScan & last,
+  sensor_msgs::msg::LaserScan * most_intense);
+
+}  // namespace urg_node2
+
+#endif  // URG_NODE2_URG_MULTIECHO_HPP_
@@ -0,0 +1,232 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file urg_multiplexer.hpp
+ * @brief 複数LiDARの受信を1スレッドで行うイベントループ
+ */
+
+#ifndef URG_NODE2_URG_MULTIPLEXER_HPP_
+#define URG_NODE2_URG_MULTIPLEXER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "urg_connection.h"
+
+namespace urg_node2
+{
+
+class UrgMultiplexer
+{
+public:
+  using Clock = std::chrono::system_clock;
+
+  /**
+   * @brief 応答受信時のコールバック
+   * @details ワーカースレッド（ワーカー数0のときはイベントループのスレッド）から呼ばれる
+   * 同じ接続のコールバックは受信順に1つずつ呼ばれる
+   * @param[in] response エコーバックから終端の空行までの応答
+   * @param[in] receive_time 応答の先頭を受信した時刻
+   */
+  using ResponseCallback =
+    std::function<void (const std::vector<char> & response, Clock::time_point receive_time)>;
+
+  /**
+   * @brief 切断時のコールバック
+   * @details イベントループのスレッドから呼ばれる。以降その接続はresume()まで監視されない
+   * 電源断やケーブル抜けのように切断が通知されない場合は、受信タイムアウトで切断とみなす
+   */
+  using ErrorCallback = std::function<void ()>;
+
+  /**
+   * @brief コンストラクタ
+   * @param[in] worker_threads 応答を処理するワーカースレッド数（0のときはイベントループで処理する）
+   */
+  explicit UrgMultiplexer(size_t worker_threads = 1);
+
+  /**
+   * @brief デストラクタ
+   * @details イベントループとワーカースレッドを停止する
+   */
+  ~UrgMultiplexer();
+
+  UrgMultiplexer(const UrgMultiplexer &) = delete;
+  UrgMultiplexer & operator=(const UrgMultiplexer &) = delete;
+
+  /**
+   * @brief 接続の登録
+   * @details start()の前後どちらでも呼べる。計測の開始（urg_start_measurement）は呼び出し側で行う
+   * 接続の受信は登録後、stop()または切断までイベントループのスレッドでのみ行われる
+   * @param[in] connection 接続済みの通信リソース
+   * @param[in] on_response 応答受信時のコールバック
+   * @param[in] on_error 切断時のコールバック
+   * @param[in] timeout 受信がない場合に切断とみなすまでの時間（0のときは切断の通知のみ）
+   * @retval true 成功
+   * @retval false 失敗（ファイルディスクリプタがない、登録済み）
+   */
+  bool add(
+    urg_connection_t * connection, ResponseCallback on_response,
+    ErrorCallback on_error = ErrorCallback(),
+    std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
+
+  /**
+   * @brief 再接続した接続の監視の再開
+   * @details 切断時のコールバックの後、同じ通信リソースを再接続（urg_reopenなど）してから呼ぶ
+   * 新しいファイルディスクリプタを監視し、コールバックは登録時のものを使う
+   * @param[in] connection add()で登録し、再接続した通信リソース
+   * @param[in] timeout 受信がない場合に切断とみなすまでの時間（0のときは切断の通知のみ）
+   * @retval true 成功
+   * @retval false 失敗（ファイルディスクリプタがない、未登録、切断されていない）
+   */
+  bool resume(
+    urg_connection_t * connection,
+    std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
+
+  /**
+   * @brief イベントループとワーカースレッドの開始
+   * @retval true 成功
+   * @retval false 失敗
+   */
+  bool start();
+
+  /**
+   * @brief イベントループとワーカースレッドの停止
+   * @details 処理待ちの応答は破棄される
+   */
+  void stop();
+
+private:
+  /** 応答の最大サイズ（超えた場合は受信データを破棄する） */
+  static constexpr size_t kMaxResponseSize = 1 << 16;
+
+  /** 接続ごとの受信状態 */
+  struct Connection
+  {
+    urg_connection_t * connection;
+    int fd;
+    ResponseCallback on_response;
+    ErrorCallback on_error;
+    size_t worker;
+    /** 切断されてresume()を待っているかどうか */
+    std::atomic<bool> is_disconnected;
+    /** 受信タイムアウト（0のときは無効） */
+    std::chrono::milliseconds timeout;
+    /** 最後に受信した時刻（監視開始時は開始時刻） */
+    std::chrono::steady_clock::time_point last_receive_time;
+
+    std::vector<char> buffer;
+    size_t searched;
+    Clock::time_point receive_time;
+
+    /** 処理済みの応答領域（再利用してメモリ確保を避ける） */
+    std::mutex spare_mutex;
+    std::vector<std::vector<char>> spares;
+  };
+
+  /** ワーカースレッドへの処理依頼 */
+  struct Job
+  {
+    Connection * connection;
+    std::vector<char> response;
+    Clock::time_point receive_time;
+  };
+
+  /** ワーカースレッド */
+  struct Worker
+  {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Job> jobs;
+  };
+
+  /**
+   * @brief 接続の監視の開始
+   * @param[in] connection 受信状態
+   * @retval true 成功
+   * @retval false 失敗
+   */
+  bool watch(Connection & connection);
+
+  /**
+   * @brief 接続の監視の停止
+   * @details 受信途中のデータを破棄してresume()を待つ状態にする（コールバックは呼ばない）
+   * @param[in,out] connection 受信状態
+   */
+  void unwatch(Connection & connection);
+
+  /**
+   * @brief イベントループ
+   */
+  void event_loop();
+
+  /**
+   * @brief 受信タイムアウトの確認
+   * @details タイムアウトした接続の監視を停止し、切断時のコールバックを呼ぶ
+   * @return 次にタイムアウトするまでの時間[msec]（タイムアウトを設定した接続がなければ-1）
+   */
+  int check_timeout();
+
+  /**
+   * @brief 受信データの読み出しと応答の切り出し
+   * @param[in,out] connection 受信状態
+   */
+  void receive(Connection & connection);
+
+  /**
+   * @brief 応答の処理依頼
+   * @param[in,out] connection 受信状態
+   * @param[in] size 応答のサイズ
+   */
+  void dispatch(Connection & connection, size_t size);
+
+  /**
+   * @brief ワーカースレッドの処理
+   * @param[in,out] worker ワーカースレッド
+   */
+  void worker_loop(Worker & worker);
+
+  /**
+   * @brief 応答の処理
+   * @param[in,out] job 処理依頼
+   */
+  void process(Job & job);
+
+  /** epollのファイルディスクリプタ */
+  int epoll_fd_;
+  /** イベントループへの停止・タイムアウト変更通知用のeventfd */
+  int event_fd_;
+
+  /** 登録された接続（add()とresume()は他のスレッドから呼ばれるため排他する） */
+  std::mutex connections_mutex_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  size_t worker_threads_;
+
+  std::thread event_thread_;
+  std::atomic<bool> is_running_;
+};
+
+}  // namespace urg_node2
+
+#endif  // URG_NODE2_URG_MULTIPLEXER_HPP_
@@ -35,14 +35,21 @@
 
 #include "rclcpp/rclcpp.hpp"
 #include "rclcpp_lifecycle/lifecycle_node.hpp"
+#include "lifecycle_msgs/msg/state.hpp"
 #include "sensor_msgs/msg/laser_scan.hpp"
 #include "sensor_msgs/msg/multi_echo_laser_scan.hpp"
+#include "sensor_msgs/msg/point_cloud2.hpp"
 #include "laser_proc/laser_publisher.hpp"
 #include "diagnostic_updater/diagnostic_updater.hpp"
 #include "diagnostic_updater/publisher.hpp"
 #include "diagnostic_msgs/msg/diagnostic_status.hpp"
 #include "urg_sensor.h"
 #include "urg_utils.h"
+#include "urg_node2/urg_message_pool.hpp"
+#include "urg_node2/urg_multiecho.hpp"
+#include "urg_node2/urg_point_cloud.hpp"
+#include "urg_node2/urg_scan_builder.hpp"
+#include "urg_node2/urg_sensor_setup.hpp"
 
 using namespace std::chrono_literals;
 
@@ -142,6 +149,15 @@ private:
    */
   bool connect(void);
 
+  /**
+   * @brief LiDAR再接続（パラメータ再利用）
+   * @details 前回の接続で取得したパラメータとLiDAR情報を使って接続する
+   * シリアルIDが前回と異なる場合はconnect()による接続を行う
+   * @retval true 接続成功
+   * @retval false 接続失敗
+   */
+  bool resume(void);
+
   /**
    * @brief スキャン設定
    * @details 受信用のデータ領域確保やLiDARに対してスキャンの設定を行う
@@ -157,6 +173,7 @@ private:
   /**
    * @brief LiDAR再接続
    * @details LiDARからの切断処理および接続処理を行う
+   * 前回の接続情報がある場合はresume()で接続する
    */
   void reconnect(void);
 
@@ -167,13 +184,19 @@ private:
   void scan_thread(void);
 
   /**
-   * @brief スキャントピック作成
-   * @details LiDARから取得したスキャン情報のトピックへの変換を行う
-   * @param[out] msg スキャンデータメッセージ
+   * @brief スキャントピックの作成と配信
+   * @details RMWが対応していればloaned messageに、対応していなければプールのメッセージに格納して配信する
    * @retval true 正常終了
    * @retval false 取得失敗
    */
-  bool create_scan_message(sensor_msgs::msg::LaserScan & msg);
+  bool publish_scan(void);
+
+  /**
+   * @brief 点群トピックの作成と配信
+   * @details スキャンデータから座標を計算し、LaserScanを経由せずに点群を作成する
+   * @param[in] scan スキャンデータメッセージ
+   */
+  void publish_cloud(const sensor_msgs::msg::LaserScan & scan);
 
   /**
    * @brief スキャントピック作成（マルチエコー）
@@ -184,6 +207,21 @@ private:
    */
   bool create_scan_message(sensor_msgs::msg::MultiEchoLaserScan & msg);
 
+  /**
+   * @brief マルチエコースキャンの受信
+   * @param[out] stamp スキャンのタイムスタンプ
+   * @return 受信したステップ数（0以下は取得失敗）
+   */
+  int receive_multiecho(builtin_interfaces::msg::Time & stamp);
+
+  /**
+   * @brief マルチエコートピックの作成と配信
+   * @details パラメータcompact_multiechoがtrueの場合は代表エコーのスキャンのみを配信する
+   * @retval true 正常終了
+   * @retval false 取得失敗
+   */
+  bool publish_echoes(void);
+
   /**
    * @brief システムレイテンシの計算
    * @details 調整モード（calibrate_time_==true）時に実行、内部変数system_latency_を設定する
@@ -207,15 +245,6 @@ private:
    */
   rclcpp::Duration get_time_stamp_offset(size_t num_measurements);
 
-  /**
-   * @brief タイムスタンプの動的補正
-   * @details システム時刻とLiDAR時刻の指数移動平均で補正する
-   * @param[in] time_stamp LiDAR時刻
-   * @param[in] system_time_stamp システム時刻
-   * @return 補正後タイムスタンプ
-   */
-  rclcpp::Time get_synchronized_time(long time_stamp, rclcpp::Time system_time_stamp);
-
   /**
    * @brief 強度モード対応確認
    * @details 接続先のLiDARが強度モードに対応しているかを確認する
@@ -273,6 +302,33 @@ private:
   std::shared_ptr<rclcpp_lifecycle::LifecyclePublisher<sensor_msgs::msg::LaserScan>> scan_pub_;
   /** マルチエコースキャンデータのpublisher */
   std::unique_ptr<laser_proc::LaserPublisher> echo_pub_;
+  /** 最初のエコーのスキャンデータのpublisher（compact_multiecho時） */
+  std::shared_ptr<rclcpp_lifecycle::LifecyclePublisher<sensor_msgs::msg::LaserScan>> first_pub_;
+  /** 最後のエコーのスキャンデータのpublisher（compact_multiecho時） */
+  std::shared_ptr<rclcpp_lifecycle::LifecyclePublisher<sensor_msgs::msg::LaserScan>> last_pub_;
+  /** 強度が最大のエコーのスキャンデータのpublisher（compact_multiecho時） */
+  std::shared_ptr<rclcpp_lifecycle::LifecyclePublisher<sensor_msgs::msg::LaserScan>>
+  most_intense_pub_;
+  /** 部分スキャンデータのpublisher */
+  std::shared_ptr<rclcpp_lifecycle::LifecyclePublisher<sensor_msgs::msg::LaserScan>> sector_pub_;
+  /** 点群データのpublisher */
+  std::shared_ptr<rclcpp_lifecycle::LifecyclePublisher<sensor_msgs::msg::PointCloud2>> cloud_pub_;
+  /** スキャンデータメッセージのプール */
+  UrgMessagePool<sensor_msgs::msg::LaserScan> scan_pool_;
+  /** 代表エコーのスキャンデータメッセージのプール */
+  UrgMessagePool<sensor_msgs::msg::LaserScan> first_pool_;
+  UrgMessagePool<sensor_msgs::msg::LaserScan> last_pool_;
+  UrgMessagePool<sensor_msgs::msg::LaserScan> most_intense_pool_;
+  /** 点群データメッセージのプール */
+  UrgMessagePool<sensor_msgs::msg::PointCloud2> cloud_pool_;
+  /** 点群への変換（角度テーブル） */
+  UrgPointCloudConverter cloud_converter_;
+  /** スキャンデータメッセージの作成（シングルエコー） */
+  UrgScanBuilder scan_builder_;
+  /** マルチエコースキャンデータメッセージ（各ステップのエコー配列をスキャン間で再利用する） */
+  sensor_msgs::msg::MultiEchoLaserScan echo_msg_;
+  /** プロセス内通信が有効かどうか */
+  bool use_intra_process_;
 
   /** Diagnositcs Updater */
   std::unique_ptr<diagnostic_updater::Updater> diagnostic_updater_;
@@ -307,6 +363,12 @@ private:
   bool publish_intensity_;
   /** パラメータ"publish_multiecho" : マルチエコーモード */
   bool publish_multiecho_;
+  /** パラメータ"compact_multiecho" : マルチエコーを代表エコーのスキャンのみで出力 */
+  bool compact_multiecho_;
+  /** パラメータ"publish_pointcloud" : 点群出力モード */
+  bool publish_pointcloud_;
+  /** パラメータ"pointcloud_time" : 点群に各点の計測時刻を含めるかどうか */
+  bool pointcloud_time_;
   /** パラメータ"error_limit" : 再接続を行うエラー回数 */
   int error_limit_;
   /** パラメータ"error_reset_period" : エラーをリセットする期間 */
@@ -325,6 +387,20 @@ private:
   int skip_;
   /** パラメータ"cluster" : グルーピング設定 */
   int cluster_;
+  /** パラメータ"sector_size" : 部分スキャンのデータ数（0:部分スキャン出力なし） */
+  int sector_size_;
+  /** パラメータ"filter_range_min" : フィルタの最小距離[m]（0:使わない） */
+  double filter_range_min_;
+  /** パラメータ"filter_range_max" : フィルタの最大距離[m]（0:使わない） */
+  double filter_range_max_;
+  /** パラメータ"filter_intensity_min" : フィルタの強度の閾値（0:使わない） */
+  double filter_intensity_min_;
+  /** パラメータ"filter_shadow_angle" : 影除去の角度[rad]（0:使わない） */
+  double filter_shadow_angle_;
+  /** パラメータ"filter_decimation" : 間引き数（1:間引きなし） */
+  int filter_decimation_;
+  /** パラメータ"filter_median" : 間引きで中央値を使うかどうか（false:最小値） */
+  bool filter_median_;
 
   /** デバイス状態 : urg_sensor_status()の値を格納 */
   std::string device_status_;
@@ -334,7 +410,7 @@ private:
   std::string product_name_;
   /** ファームウェアバージョン : urg_sensor_firmware_version()の値を格納 */
   std::string firmware_version_;
-  /** デバイスID : urg_sensor_serial_id()の値を格納 */
+  /** デバイスID : urg_sensor_serial_id()の値を格納（空でない場合はresume()で再接続する） */
   std::string device_id_;
   /** スキャン時間(sec) : urg_scan_usec()の値(usec)をsecに変換したものを格納 */
   double scan_period_;
@@ -370,17 +446,6 @@ private:
   /** ユーザレイテンシ[ns] */
   rclcpp::Duration user_latency_;
 
-  /** 同期モード用変数 */
-  double hardware_clock_;
-  /** 同期モード用変数 */
-  long int last_hardware_time_stamp_;
-  /** 同期モード用変数 */
-  double hardware_clock_adj_;
-  /** 同期モード用変数 */
-  const double adj_alpha_ = 0.01;
-  /** 同期モード用変数 */
-  int adj_count_;
-
   /** LiDARに設定された最小ステップ範囲（範囲クリップ&丸め実施）[exp:-540] */
   int first_step_;
   /** LiDARに設定された最大ステップ範囲（範囲クリップ&丸め実施）[exp:540] */
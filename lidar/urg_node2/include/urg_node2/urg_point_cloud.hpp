@@ -0,0 +1,91 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file urg_point_cloud.hpp
+ * @brief 距離データの点群への変換
+ */
+
+#ifndef URG_NODE2_URG_POINT_CLOUD_HPP_
+#define URG_NODE2_URG_POINT_CLOUD_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "sensor_msgs/msg/point_cloud2.hpp"
+
+namespace urg_node2
+{
+
+/**
+ * @brief 距離データをPointCloud2に変換する
+ * @details 設定ごとに作成したcos, sinのテーブルを使い、三角関数を呼び出さずに座標を計算する
+ * 点のフィールドはx, y, z（float32）、強度を使う場合はintensity（float32）、
+ * 時刻を使う場合はtime（float32、スキャンのタイムスタンプからの経過時間[sec]）の順に並ぶ
+ * 点群は1行（height=1）でステップ順に並び、距離がNaNのステップの座標はNaNとなる（is_dense=false）
+ */
+class UrgPointCloudConverter
+{
+public:
+  UrgPointCloudConverter();
+
+  /**
+   * @brief 角度テーブルの作成
+   * @param[in] angle_min 最初のステップの角度[rad]
+   * @param[in] angle_increment ステップ間の角度[rad]
+   * @param[in] max_points 最大ステップ数
+   */
+  void set_angles(double angle_min, double angle_increment, int max_points);
+
+  /**
+   * @brief 点のフィールドの設定
+   * @param[in] use_intensity 強度を含めるかどうか
+   * @param[in] use_time 時刻を含めるかどうか
+   * @param[in] time_increment ステップ間の時間[sec]
+   */
+  void set_fields(bool use_intensity, bool use_time, double time_increment);
+
+  /**
+   * @brief メッセージの初期化
+   * @details フィールドを設定し、最大ステップ数分の領域を確保する
+   * @param[out] msg 点群メッセージ
+   */
+  void initialize(sensor_msgs::msg::PointCloud2 & msg) const;
+
+  /**
+   * @brief 距離データの変換
+   * @details initialize()したメッセージであれば、メモリ確保は発生しない
+   * @param[in] ranges 距離データ[m]
+   * @param[in] intensities 強度データ（強度を含めない場合は使わない）
+   * @param[in] num_points ステップ数（最大ステップ数を超える分は変換しない）
+   * @param[out] msg 点群メッセージ（header以外を設定する）
+   * @return 変換した点の数
+   */
+  int convert(
+    const float ranges[], const float intensities[], int num_points,
+    sensor_msgs::msg::PointCloud2 & msg) const;
+
+private:
+  std::vector<float> cos_table_;
+  std::vector<float> sin_table_;
+  bool use_intensity_;
+  bool use_time_;
+  float time_increment_;
+  /** 1点のfloatの数 */
+  int stride_;
+};
+
+}  // namespace urg_node2
+
+#endif  // URG_NODE2_URG_POINT_CLOUD_HPP_
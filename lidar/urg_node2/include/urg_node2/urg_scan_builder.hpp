@@ -0,0 +1,189 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file urg_scan_builder.hpp
+ * @brief スキャントピックの作成
+ */
+
+#ifndef URG_NODE2_URG_SCAN_BUILDER_HPP_
+#define URG_NODE2_URG_SCAN_BUILDER_HPP_
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/laser_scan.hpp"
+#include "urg_sensor.h"
+#include "urg_node2/urg_clock_synchronizer.hpp"
+#include "urg_node2/urg_message_pool.hpp"
+#include "urg_node2/urg_scan_filter.hpp"
+
+namespace urg_node2
+{
+
+/** スキャントピックの設定 */
+struct UrgScanConfig
+{
+  /** メッセージヘッダのframe_id */
+  std::string frame_id;
+  /** 強度を出力するかどうか */
+  bool use_intensity = false;
+  /** 受信するデータ数の最大値 */
+  int max_beams = 0;
+
+  /** トピック設定用の角度範囲[rad]、時間[sec]、距離範囲[m] */
+  double angle_min = 0.0;
+  double angle_max = 0.0;
+  double angle_increment = 0.0;
+  double time_increment = 0.0;
+  double scan_time = 0.0;
+  double range_min = 0.0;
+  double range_max = 0.0;
+
+  /** 真後ろから開始角度位置までの回転時間[sec] */
+  double angular_time_offset = 0.0;
+  /** 部分スキャンのデータ数（0:部分スキャン出力なし） */
+  int sector_size = 0;
+  /** フィルタの設定 */
+  UrgScanFilterConfig filter;
+};
+
+/**
+ * @brief シングルエコーのスキャントピックの作成
+ * @details LiDARからの受信、タイムスタンプの設定、部分スキャンの配信およびフィルタの適用を行う
+ * スキャンごとのメモリ確保は行わない（メッセージは呼び出し側で確保済みのものを渡す）
+ * スレッドセーフではないため、スキャンスレッドからのみ使うこと（clock_synchronizer()の参照を除く）
+ */
+class UrgScanBuilder
+{
+public:
+  using LaserScan = sensor_msgs::msg::LaserScan;
+
+  /**
+   * @brief 部分スキャンの配信
+   * @details 部分スキャンのメッセージと取得元のプールが渡される（publish_pooled_message()で配信する）
+   */
+  using SectorCallback =
+    std::function<void (UrgMessagePool<LaserScan> & pool, std::unique_ptr<LaserScan> sector)>;
+
+  /**
+   * @brief コンストラクタ
+   * @param[in] logger LiDAR時計の推定をリセットした際の警告の出力先
+   */
+  explicit UrgScanBuilder(const rclcpp::Logger & logger);
+
+  /**
+   * @brief スキャントピックの設定
+   * @details 接続のたびに呼ぶこと（部分スキャン出力のハンドラをurgに登録する）
+   * @param[in,out] urg 接続済みのLiDAR
+   * @param[in] config スキャントピックの設定
+   * @param[in] on_sector 部分スキャンの配信（config.sector_sizeが0の場合は使わない）
+   */
+  void configure(
+    urg_t & urg, const UrgScanConfig & config,
+    SectorCallback on_sector = SectorCallback());
+
+  /**
+   * @brief タイムスタンプの補正の設定
+   * @param[in] synchronize_time LiDAR時計の推定で補正するかどうか（同期モード）
+   * @param[in] latency 加算するレイテンシ（システムレイテンシとユーザレイテンシの和）
+   */
+  void set_time_correction(bool synchronize_time, const rclcpp::Duration & latency);
+
+  /**
+   * @brief LiDAR時計の推定のリセット
+   */
+  void reset_clock();
+
+  /**
+   * @brief スキャントピック作成
+   * @details 受信データを[m]単位（0はNaN）でメッセージへ直接格納し、タイムスタンプとフィルタを適用する
+   * 受信中に部分スキャンを配信する場合は、最初の部分スキャンの配信時にタイムスタンプを確定する
+   * @param[in,out] urg 計測開始済みのLiDAR
+   * @param[out] msg スキャンデータメッセージ
+   * @retval true 正常終了
+   * @retval false 取得失敗
+   */
+  bool create_scan_message(urg_t & urg, LaserScan & msg);
+
+  /**
+   * @brief スキャンのタイムスタンプ
+   * @details LiDAR時刻と受信開始時のシステム時刻からスキャン先頭のタイムスタンプを計算する
+   * @param[in] time_stamp LiDAR時刻
+   * @param[in] system_time_stamp 受信開始時のシステム時刻
+   * @return タイムスタンプ
+   */
+  rclcpp::Time get_stamp(long time_stamp, const rclcpp::Time & system_time_stamp);
+
+  /**
+   * @brief フィルタの間引き数
+   */
+  int decimation() const;
+
+  /**
+   * @brief LiDAR時計の推定（Diagnostics用）
+   */
+  const UrgClockSynchronizer & clock_synchronizer() const;
+
+private:
+  /**
+   * @brief 部分スキャン受信時のコールバック
+   * @details urg_set_sector_handler()に登録し、publish_sector()を呼び出す
+   * @param[in] first_index 受信済み部分スキャンの先頭インデックス
+   * @param[in] steps 受信済み部分スキャンのデータ数
+   * @param[in] context UrgScanBuilderのポインタ
+   */
+  static void sector_received(int first_index, int steps, void * context);
+
+  /**
+   * @brief 部分スキャントピック配信
+   * @details 受信中のスキャンのうち受信済みの範囲を部分スキャンとして配信する
+   * @param[in] first_index 部分スキャンの先頭インデックス
+   * @param[in] steps 部分スキャンのデータ数
+   */
+  void publish_sector(int first_index, int steps);
+
+  rclcpp::Logger logger_;
+  UrgScanConfig config_;
+  SectorCallback on_sector_;
+
+  /** 部分スキャンデータメッセージのプール */
+  UrgMessagePool<LaserScan> sector_pool_;
+  /** スキャンデータのフィルタ */
+  UrgScanFilter filter_;
+
+  /** 同期モードかどうか */
+  bool synchronize_time_;
+  /** 同期モード用のLiDAR時計の推定 */
+  UrgClockSynchronizer clock_synchronizer_;
+  /** 加算するレイテンシと開始角度位置までの回転時間の和 */
+  rclcpp::Duration time_correction_;
+  /** 加算するレイテンシ */
+  rclcpp::Duration latency_;
+
+  /** 受信中のスキャンデータメッセージ（部分スキャン出力用） */
+  LaserScan * receiving_scan_;
+  /** 受信中のスキャンのLiDAR時刻 */
+  long receiving_time_stamp_;
+  /** 受信中のスキャンの受信開始時のシステム時刻 */
+  rclcpp::Time receiving_system_time_stamp_;
+  /** 受信中のスキャンのタイムスタンプが設定済みかどうか */
+  bool is_receiving_scan_stamped_;
+};
+
+}  // namespace urg_node2
+
+#endif  // URG_NODE2_URG_SCAN_BUILDER_HPP_
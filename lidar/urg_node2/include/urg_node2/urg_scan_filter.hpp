@@ -0,0 +1,114 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file urg_scan_filter.hpp
+ * @brief スキャンデータのフィルタ
+ */
+
+#ifndef URG_NODE2_URG_SCAN_FILTER_HPP_
+#define URG_NODE2_URG_SCAN_FILTER_HPP_
+
+namespace urg_node2
+{
+
+/**
+ * @brief フィルタの設定
+ * @details 0（decimationは1）の項目は使わない
+ */
+struct UrgScanFilterConfig
+{
+  /** 範囲外の距離を無効にする最小距離[m] */
+  double range_min = 0.0;
+  /** 範囲外の距離を無効にする最大距離[m] */
+  double range_max = 0.0;
+  /** これより強度が低いステップを無効にする */
+  double intensity_min = 0.0;
+  /** 隣接ステップとの段差から見込む角度がこれより小さい（影・ベール）場合に遠い方を無効にする[rad] */
+  double shadow_angle = 0.0;
+  /** 間引き数（連続するdecimation個のステップを1つにまとめる） */
+  int decimation = 1;
+  /** 間引きで中央値を使うかどうか（falseの場合は最小値） */
+  bool median = false;
+};
+
+/**
+ * @brief スキャンデータのフィルタ
+ * @details 距離の範囲、強度の閾値、影の除去、間引きを1回の走査でまとめて行う
+ * 使う処理と強度の有無の組み合わせごとに特殊化した処理をconfigure()で選択する
+ * 無効なステップの距離はNaN、強度は0とする（urg_get_ranges_intensity_f32()と同じ）
+ */
+class UrgScanFilter
+{
+public:
+  /** 間引き数の最大値 */
+  static constexpr int kMaxDecimation = 16;
+
+  UrgScanFilter();
+
+  /**
+   * @brief フィルタの設定
+   * @param[in] config フィルタの設定（decimationは1～kMaxDecimationに制限される）
+   * @param[in] angle_increment ステップ間の角度[rad]（影の除去に使う）
+   * @param[in] use_intensity 強度データを使うかどうか（falseの場合は強度の閾値を使わない）
+   */
+  void configure(
+    const UrgScanFilterConfig & config, double angle_increment,
+    bool use_intensity);
+
+  /**
+   * @brief フィルタを使うかどうか
+   */
+  bool is_enabled() const;
+
+  /**
+   * @brief 間引き数
+   */
+  int decimation() const;
+
+  /**
+   * @brief フィルタの適用
+   * @details rangesとintensitiesを置き換える（メモリ確保は行わない）
+   * @param[in,out] ranges 距離データ[m]（無効なステップはNaN）
+   * @param[in,out] intensities 強度データ（configure()でuse_intensityがfalseの場合はnullptrでよい）
+   * @param[in] num_beams ステップ数
+   * @return フィルタ後のステップ数（間引きしない場合はnum_beams）
+   */
+  int apply(float ranges[], float intensities[], int num_beams) const;
+
+  /** 特殊化した処理に渡すパラメータ */
+  struct Parameters
+  {
+    float range_min;
+    float range_max;
+    float intensity_min;
+    /** 影の判定に使う tan(shadow_angle) */
+    float shadow_tan;
+    float sin_increment;
+    float cos_increment;
+    int decimation;
+  };
+
+private:
+  /** 特殊化した処理 */
+  using Kernel = int (*)(const Parameters &, float[], float[], int);
+
+  Parameters parameters_;
+  /** configure()で選択した処理（フィルタを使わない場合はnullptr） */
+  Kernel kernel_;
+};
+
+}  // namespace urg_node2
+
+#endif  // URG_NODE2_URG_SCAN_FILTER_HPP_
@@ -0,0 +1,84 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file urg_sensor_setup.hpp
+ * @brief LiDAR接続時の設定（UrgNode2とUrgMultiNodeで共通）
+ */
+
+#ifndef URG_NODE2_URG_SENSOR_SETUP_HPP_
+#define URG_NODE2_URG_SENSOR_SETUP_HPP_
+
+#include "urg_sensor.h"
+
+/** @def
+ * 再接続の初回待ち時間[msec]（失敗するごとに倍にする）
+ */
+#define URG_NODE2_RECONNECT_MIN_INTERVAL 5
+
+/** @def
+ * 再接続の最大待ち時間[msec]
+ */
+#define URG_NODE2_RECONNECT_MAX_INTERVAL 500
+
+namespace urg_node2
+{
+
+/** LiDARに設定したスキャン範囲とスキャントピック用のパラメータ */
+struct UrgScanRange
+{
+  /** LiDARに設定した最小ステップ（範囲クリップ&丸め実施） */
+  int first_step = 0;
+  /** LiDARに設定した最大ステップ（範囲クリップ&丸め実施） */
+  int last_step = 0;
+
+  /** トピック設定用の角度範囲[rad]、時間[sec]、距離範囲[m] */
+  double angle_min = 0.0;
+  double angle_max = 0.0;
+  double angle_increment = 0.0;
+  double time_increment = 0.0;
+  double range_min = 0.0;
+  double range_max = 0.0;
+
+  /** 真後ろから開始角度位置までの回転時間[sec] */
+  double angular_time_offset = 0.0;
+};
+
+/**
+ * @brief スキャン範囲の設定
+ * @details 指定範囲をステップに変換してLiDARに設定し（範囲クリップ&丸め）、スキャントピック用のパラメータを計算する
+ * @param[in,out] urg 接続済みのLiDAR
+ * @param[in] angle_min 開始角度[rad]
+ * @param[in] angle_max 終了角度[rad]
+ * @param[in] cluster グルーピング数
+ * @param[in] scan_period スキャン周期[sec]
+ * @return 設定したスキャン範囲
+ */
+UrgScanRange set_scan_range(
+  urg_t & urg, double angle_min, double angle_max, int cluster,
+  double scan_period);
+
+/**
+ * @brief 開始角度位置までの回転時間の計算
+ * @details スキャンデータのタイムスタンプは真後ろのものなので、開始角度位置までの時間をオフセットとして加算する必要がある
+ * @param[in] urg 接続済みのLiDAR
+ * @param[in] first_step 開始ステップ
+ * @param[in] scan_period スキャン周期[sec]
+ * @return 真後ろから開始角度位置までの回転時間[sec]
+ */
+double get_angular_time_offset(const urg_t & urg, int first_step, double scan_period);
+
+}  // namespace urg_node2
+
+#endif  // URG_NODE2_URG_SENSOR_SETUP_HPP_
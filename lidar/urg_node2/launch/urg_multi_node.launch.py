@@ -0,0 +1,55 @@
+# Copyright 2022 eSOL Co.,Ltd.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+import yaml
+from ament_index_python.packages import get_package_share_directory
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument
+from launch.substitutions import LaunchConfiguration
+from launch_ros.actions import Node
+
+# 複数LiDARを1プロセス（1つのイベントループ）で扱うurg_multi_nodeの起動
+
+def generate_launch_description():
+
+    # パラメータファイルのパス設定
+    config_file_path = os.path.join(
+        get_package_share_directory('urg_node2'),
+        'config',
+        'params_multi.yaml'
+    )
+
+    # パラメータファイルのロード
+    with open(config_file_path, 'r') as file:
+        config_params = yaml.safe_load(file)['urg_multi_node']['ros__parameters']
+
+    # urg_multi_nodeを通常のノードとして起動
+    multi_node = Node(
+        package='urg_node2',
+        executable='urg_multi_node_node',
+        name=LaunchConfiguration('node_name'),
+        parameters=[config_params],
+        namespace='',
+        output='screen',
+    )
+
+    # パラメータについて
+    # node_name : ノード名 (default)"urg_multi_node"
+    # *スキャンは"<sensorsの名前>/scan"に出力されます*
+    # *ロードするパラメータファイルは上部のファイル名を直接編集してください*
+    return LaunchDescription([
+        DeclareLaunchArgument('node_name', default_value='urg_multi_node'),
+        multi_node,
+    ])
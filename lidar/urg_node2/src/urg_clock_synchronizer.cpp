@@ -0,0 +1,204 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "urg_node2/urg_clock_synchronizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace urg_node2
+{
+
+namespace
+{
+/** LiDAR時刻の周期[msec]（24bit） */
+const int64_t kTimeStampPeriod = 1 << 24;
+}  // namespace
+
+UrgClockSynchronizer::UrgClockSynchronizer(
+  double bucket_period, size_t window_size,
+  double reset_threshold)
+: bucket_period_(bucket_period),
+  window_size_(window_size),
+  reset_threshold_(reset_threshold),
+  residuals_(kResidualSize, 0.0),
+  drift_ppm_(0.0),
+  jitter_(0.0),
+  reset_count_(0)
+{
+  samples_.reserve(window_size_ + 1);
+  reset();
+}
+
+void UrgClockSynchronizer::reset()
+{
+  is_initialized_ = false;
+  origin_ns_ = 0;
+  last_system_time_ns_ = 0;
+  last_time_stamp_ = 0;
+  ticks_ = 0;
+  samples_.clear();
+  bucket_min_ = Sample{0.0, 0.0};
+  bucket_start_ = 0.0;
+  fit_center_ = 0.0;
+  fit_offset_ = 0.0;
+  fit_drift_ = 0.0;
+  outliers_ = 0;
+  residual_index_ = 0;
+  drift_ppm_ = 0.0;
+  jitter_ = 0.0;
+}
+
+int64_t UrgClockSynchronizer::update(long time_stamp, int64_t system_time_ns)
+{
+  const uint32_t time_stamp_24 = static_cast<uint32_t>(time_stamp) & (kTimeStampPeriod - 1);
+
+  // 回帰に使う期間より長く受信が途切れた場合（再接続など）は、前回の推定を使わない
+  const int64_t window_ns = static_cast<int64_t>(bucket_period_ * window_size_ * 1e9);
+  if (is_initialized_ && system_time_ns - last_system_time_ns_ > window_ns) {
+    reset();
+  }
+
+  if (!is_initialized_) {
+    // 最初の組を起点とし、受信時刻をそのまま使う
+    is_initialized_ = true;
+    origin_ns_ = system_time_ns;
+    last_time_stamp_ = time_stamp_24;
+    last_system_time_ns_ = system_time_ns;
+    ticks_ = 0;
+    bucket_min_ = Sample{0.0, 0.0};
+    bucket_start_ = 0.0;
+    fit();
+    add_residual(0.0);
+    return system_time_ns;
+  }
+
+  // 24bitの周回は差分で扱う（受信間隔は周期の約4.6時間より十分短い）
+  ticks_ += (time_stamp_24 - last_time_stamp_) & (kTimeStampPeriod - 1);
+  last_time_stamp_ = time_stamp_24;
+  last_system_time_ns_ = system_time_ns;
+
+  Sample sample;
+  sample.sensor_time = static_cast<double>(ticks_) / 1e3;
+  sample.offset = static_cast<double>(system_time_ns - origin_ns_) / 1e9 - sample.sensor_time;
+
+  // 受信時刻は送信時刻より前にならないため、大きく負の残差は時計の飛び（LiDARの再起動など）
+  // 正の残差は処理待ちの可能性があるため、連続した場合のみリセットする
+  double residual = sample.offset - predict(sample.sensor_time);
+  if (residual < -reset_threshold_ ||
+    (residual > reset_threshold_ && ++outliers_ >= kResetOutliers))
+  {
+    reset();
+    ++reset_count_;
+    return update(time_stamp, system_time_ns);
+  } else if (residual > reset_threshold_) {
+    // 外れ値は推定に使わない
+    return origin_ns_ + std::llround((sample.sensor_time + predict(sample.sensor_time)) * 1e9);
+  }
+  outliers_ = 0;
+
+  // 期間ごとに最小遅延（オフセットが最小）の組を残す
+  if (sample.sensor_time >= bucket_start_ + bucket_period_) {
+    samples_.push_back(bucket_min_);
+    if (samples_.size() > window_size_) {
+      samples_.erase(samples_.begin());
+    }
+    bucket_min_ = sample;
+    bucket_start_ = sample.sensor_time;
+  } else if (sample.offset < bucket_min_.offset) {
+    bucket_min_ = sample;
+  }
+  fit();
+
+  double estimated_offset = predict(sample.sensor_time);
+  add_residual(sample.offset - estimated_offset);
+  return origin_ns_ + std::llround((sample.sensor_time + estimated_offset) * 1e9);
+}
+
+double UrgClockSynchronizer::drift_ppm() const
+{
+  return drift_ppm_;
+}
+
+double UrgClockSynchronizer::jitter() const
+{
+  return jitter_;
+}
+
+int UrgClockSynchronizer::reset_count() const
+{
+  return reset_count_;
+}
+
+double UrgClockSynchronizer::predict(double sensor_time) const
+{
+  return fit_offset_ + fit_drift_ * (sensor_time - fit_center_);
+}
+
+void UrgClockSynchronizer::fit()
+{
+  if (samples_.size() < 2) {
+    // 回帰できるまではLiDAR時計のずれを0とし、最小のオフセットを使う
+    fit_center_ = bucket_min_.sensor_time;
+    fit_offset_ = bucket_min_.offset;
+    for (const Sample & s : samples_) {
+      fit_offset_ = std::min(fit_offset_, s.offset);
+    }
+    fit_drift_ = 0.0;
+    drift_ppm_ = 0.0;
+    return;
+  }
+
+  // 完了した期間の最小遅延の組に対する最小二乗法
+  // （現在の期間の組は遅延の大きい受信のみの場合があるため使わない）
+  double sum_time = 0.0;
+  double sum_offset = 0.0;
+  for (const Sample & s : samples_) {
+    sum_time += s.sensor_time;
+    sum_offset += s.offset;
+  }
+  double mean_time = sum_time / samples_.size();
+  double mean_offset = sum_offset / samples_.size();
+
+  double sxx = 0.0;
+  double sxy = 0.0;
+  for (const Sample & s : samples_) {
+    sxx += (s.sensor_time - mean_time) * (s.sensor_time - mean_time);
+    sxy += (s.sensor_time - mean_time) * (s.offset - mean_offset);
+  }
+
+  fit_center_ = mean_time;
+  fit_offset_ = mean_offset;
+  fit_drift_ = (sxx > 0.0) ? sxy / sxx : 0.0;
+  drift_ppm_ = fit_drift_ * 1e6;
+}
+
+void UrgClockSynchronizer::add_residual(double residual)
+{
+  residuals_[residual_index_ % kResidualSize] = residual;
+  ++residual_index_;
+
+  size_t n = (residual_index_ < kResidualSize) ? residual_index_ : kResidualSize;
+  double sum = 0.0;
+  double sum_square = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    sum += residuals_[i];
+    sum_square += residuals_[i] * residuals_[i];
+  }
+  double mean = sum / n;
+  double variance = sum_square / n - mean * mean;
+  jitter_ = (variance > 0.0) ? std::sqrt(variance) : 0.0;
+}
+
+}  // namespace urg_node2
@@ -0,0 +1,379 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "urg_node2/urg_multi_node.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace urg_node2
+{
+
+UrgMultiNode::UrgMultiNode(const rclcpp::NodeOptions & node_options)
+: Node("urg_multi_node", node_options),
+  is_closing_(false)
+{
+  // LiDARとの通信でのSIGPIPEを無効化する（UrgNode2と同様）
+  std::signal(SIGPIPE, SIG_IGN);
+
+  // パラメータの登録
+  std::vector<std::string> names =
+    declare_parameter<std::vector<std::string>>("sensors", std::vector<std::string>());
+  int worker_threads = declare_parameter<int>("worker_threads", 1);
+  worker_threads = std::max(worker_threads, 0);
+
+  multiplexer_ = std::make_unique<UrgMultiplexer>(static_cast<size_t>(worker_threads));
+
+  for (const auto & name : names) {
+    std::unique_ptr<Sensor> sensor = declare_sensor(name);
+    sensor->scan_pub = create_publisher<sensor_msgs::msg::LaserScan>(
+      name + "/scan",
+      rclcpp::QoS(20));
+
+    // 接続できなかったLiDARは再接続スレッドで接続する
+    if (!connect(*sensor) || !start_measurement(*sensor) || !watch(*sensor)) {
+      sensor->needs_reconnect = true;
+      sensor->reconnect_time = std::chrono::steady_clock::now() + sensor->reconnect_interval;
+    }
+    sensors_.push_back(std::move(sensor));
+  }
+
+  if (sensors_.empty()) {
+    RCLCPP_WARN(get_logger(), "No LiDAR is specified.");
+    return;
+  }
+
+  if (!multiplexer_->start()) {
+    RCLCPP_ERROR(get_logger(), "Could not start the event loop.");
+    return;
+  }
+  reconnect_thread_ = std::thread([this]() {reconnect_thread();});
+}
+
+UrgMultiNode::~UrgMultiNode()
+{
+  // 再接続の停止
+  {
+    std::lock_guard<std::mutex> lock(reconnect_mutex_);
+    is_closing_ = true;
+  }
+  reconnect_condition_.notify_all();
+  if (reconnect_thread_.joinable()) {
+    reconnect_thread_.join();
+  }
+
+  // 受信の停止後に計測停止と切断を行う
+  multiplexer_->stop();
+  for (auto & sensor : sensors_) {
+    if (sensor->is_connected) {
+      urg_stop_measurement(&sensor->urg);
+      urg_close(&sensor->urg);
+      sensor->is_connected = false;
+    }
+  }
+}
+
+std::unique_ptr<UrgMultiNode::Sensor> UrgMultiNode::declare_sensor(const std::string & name)
+{
+  auto sensor = std::make_unique<Sensor>();
+  sensor->name = name;
+  sensor->ip_address = declare_parameter<std::string>(name + ".ip_address", "");
+  sensor->ip_port = declare_parameter<int>(name + ".ip_port", 10940);
+  sensor->serial_port = declare_parameter<std::string>(name + ".serial_port", "/dev/ttyACM0");
+  sensor->serial_baud = declare_parameter<int>(name + ".serial_baud", 115200);
+  sensor->frame_id = declare_parameter<std::string>(name + ".frame_id", name);
+  sensor->publish_intensity = declare_parameter<bool>(name + ".publish_intensity", false);
+  sensor->angle_min = declare_parameter<double>(name + ".angle_min", -M_PI);
+  sensor->angle_max = declare_parameter<double>(name + ".angle_max", M_PI);
+  sensor->skip = declare_parameter<int>(name + ".skip", 0);
+  sensor->cluster = declare_parameter<int>(name + ".cluster", 1);
+  sensor->time_offset = declare_parameter<double>(name + ".time_offset", 0.0);
+
+  // 範囲チェック（UrgNode2と同じ）
+  sensor->skip = (sensor->skip < 0) ? 0 : ((sensor->skip > 9) ? 9 : sensor->skip);
+  sensor->cluster = (sensor->cluster < 1) ? 1 : ((sensor->cluster > 99) ? 99 : sensor->cluster);
+
+  sensor->is_connected = false;
+  sensor->is_added = false;
+  sensor->needs_reconnect = false;
+  sensor->reconnect_interval = std::chrono::milliseconds(URG_NODE2_RECONNECT_MIN_INTERVAL);
+  return sensor;
+}
+
+bool UrgMultiNode::connect(Sensor & sensor)
+{
+  urg_t_initialize(&sensor.urg);
+  if (!sensor.ip_address.empty()) {
+    // イーサネット接続
+    if (urg_open(&sensor.urg, URG_ETHERNET, sensor.ip_address.c_str(), sensor.ip_port) < 0) {
+      RCLCPP_ERROR(
+        get_logger(), "Could not open network Hokuyo 2D LiDAR %s\n%s:%d\n%s",
+        sensor.name.c_str(), sensor.ip_address.c_str(), sensor.ip_port, urg_error(&sensor.urg));
+      return false;
+    }
+  } else {
+    // シリアル接続
+    if (urg_open(&sensor.urg, URG_SERIAL, sensor.serial_port.c_str(), sensor.serial_baud) < 0) {
+      RCLCPP_ERROR(
+        get_logger(), "Could not open serial Hokuyo 2D LiDAR %s\n%s:%d\n%s",
+        sensor.name.c_str(), sensor.serial_port.c_str(), sensor.serial_baud,
+        urg_error(&sensor.urg));
+      return false;
+    }
+  }
+  sensor.is_connected = true;
+  sensor.serial_id = urg_sensor_serial_id(&sensor.urg);
+
+  RCLCPP_INFO(
+    get_logger(), "Connected %s. Hardware ID: %s",
+    sensor.name.c_str(), sensor.serial_id.c_str());
+  return true;
+}
+
+bool UrgMultiNode::resume(Sensor & sensor)
+{
+  // PPコマンドを省略して接続
+  int result;
+  if (!sensor.ip_address.empty()) {
+    result = urg_reopen(&sensor.urg, URG_ETHERNET, sensor.ip_address.c_str(), sensor.ip_port);
+  } else {
+    result = urg_reopen(&sensor.urg, URG_SERIAL, sensor.serial_port.c_str(), sensor.serial_baud);
+  }
+  if (result < 0) {
+    RCLCPP_ERROR(
+      get_logger(), "Could not reconnect Hokuyo 2D LiDAR %s\n%s",
+      sensor.name.c_str(), urg_error(&sensor.urg));
+    return false;
+  }
+  sensor.is_connected = true;
+
+  // 前回と異なるLiDARの場合はLiDAR情報を取得し直す
+  std::string serial_id = urg_sensor_serial_id(&sensor.urg);
+  if (serial_id != sensor.serial_id) {
+    RCLCPP_WARN(
+      get_logger(), "Hardware ID of %s changed from %s to %s, reconnecting.",
+      sensor.name.c_str(), sensor.serial_id.c_str(), serial_id.c_str());
+    urg_close(&sensor.urg);
+    sensor.is_connected = false;
+    return connect(sensor);
+  }
+
+  RCLCPP_INFO(
+    get_logger(), "Reconnected %s. Hardware ID: %s",
+    sensor.name.c_str(), sensor.serial_id.c_str());
+  return true;
+}
+
+bool UrgMultiNode::start_measurement(Sensor & sensor)
+{
+  // スキャン範囲の設定とスキャントピック用のパラメータ設定（UrgNode2と共通）
+  double scan_period = 1.e-6 * static_cast<double>(urg_scan_usec(&sensor.urg));
+  {
+    std::lock_guard<std::mutex> lock(sensor.mutex);
+    sensor.scan.range = set_scan_range(
+      sensor.urg, sensor.angle_min, sensor.angle_max, sensor.cluster, scan_period);
+    sensor.scan.max_size = urg_max_data_size(&sensor.urg);
+    sensor.scan.scan_time = scan_period;
+
+    // 応答はスキャン終了後に送信されるため、受信時刻から1周期戻した真後ろの時刻に
+    // 開始角度位置までの時間を加算する
+    sensor.scan.time_correction =
+      sensor.time_offset - scan_period + sensor.scan.range.angular_time_offset;
+  }
+
+  // 連続計測の開始（応答はイベントループで受信する）
+  urg_measurement_type_t type =
+    sensor.publish_intensity ? URG_DISTANCE_INTENSITY : URG_DISTANCE;
+  if (urg_start_measurement(&sensor.urg, type, URG_SCAN_INFINITY, sensor.skip, 0) < 0) {
+    RCLCPP_ERROR(
+      get_logger(), "Could not start Hokuyo measurement %s\n%s",
+      sensor.name.c_str(), urg_error(&sensor.urg));
+    urg_close(&sensor.urg);
+    sensor.is_connected = false;
+    return false;
+  }
+  return true;
+}
+
+bool UrgMultiNode::watch(Sensor & sensor)
+{
+  // 間引いたスキャンも含めて数周期分受信がなければ切断とみなす
+  std::chrono::milliseconds timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::microseconds(
+      URG_NODE2_RECEIVE_TIMEOUT_SCANS * (sensor.skip + 1) * urg_scan_usec(&sensor.urg)));
+
+  // 再接続後は新しい接続の監視を再開する
+  if (sensor.is_added) {
+    if (!multiplexer_->resume(&sensor.urg.connection, timeout)) {
+      RCLCPP_ERROR(get_logger(), "Could not wait for the data of %s", sensor.name.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  Sensor * s = &sensor;
+  bool is_added = multiplexer_->add(
+    &sensor.urg.connection,
+    [this, s](const std::vector<char> & response, UrgMultiplexer::Clock::time_point time) {
+      publish_scan(*s, response, time);
+    },
+    [this, s]() {
+      RCLCPP_ERROR(get_logger(), "Disconnected from %s", s->name.c_str());
+      request_reconnect(*s);
+    },
+    timeout);
+  if (!is_added) {
+    RCLCPP_ERROR(get_logger(), "Could not wait for the data of %s", sensor.name.c_str());
+    return false;
+  }
+  sensor.is_added = true;
+  return true;
+}
+
+bool UrgMultiNode::reconnect(Sensor & sensor)
+{
+  // 切断
+  if (sensor.is_connected) {
+    urg_close(&sensor.urg);
+    sensor.is_connected = false;
+  }
+
+  // 接続（一度も接続できていない場合はLiDAR情報を取得する）
+  bool is_connected = sensor.serial_id.empty() ? connect(sensor) : resume(sensor);
+  return is_connected && start_measurement(sensor) && watch(sensor);
+}
+
+void UrgMultiNode::request_reconnect(Sensor & sensor)
+{
+  {
+    std::lock_guard<std::mutex> lock(reconnect_mutex_);
+    sensor.needs_reconnect = true;
+    sensor.reconnect_time = std::chrono::steady_clock::now();
+  }
+  reconnect_condition_.notify_all();
+}
+
+void UrgMultiNode::reconnect_thread()
+{
+  std::unique_lock<std::mutex> lock(reconnect_mutex_);
+  while (!is_closing_) {
+    // 再接続の時刻になったLiDARを探す
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    Sensor * target = nullptr;
+    bool is_waiting = false;
+    std::chrono::steady_clock::time_point wake_time;
+    for (auto & sensor : sensors_) {
+      if (!sensor->needs_reconnect) {
+        continue;
+      }
+      if (sensor->reconnect_time <= now) {
+        target = sensor.get();
+        break;
+      }
+      if (!is_waiting || sensor->reconnect_time < wake_time) {
+        wake_time = sensor->reconnect_time;
+      }
+      is_waiting = true;
+    }
+
+    // なければ最も早い再接続時刻か再接続要求まで待つ
+    if (!target) {
+      if (is_waiting) {
+        reconnect_condition_.wait_until(lock, wake_time);
+      } else {
+        reconnect_condition_.wait(lock);
+      }
+      continue;
+    }
+
+    // 再接続中の切断通知は再接続後にもう一度再接続する
+    target->needs_reconnect = false;
+    lock.unlock();
+    bool is_reconnected = reconnect(*target);
+    lock.lock();
+
+    if (is_reconnected) {
+      target->reconnect_interval = std::chrono::milliseconds(URG_NODE2_RECONNECT_MIN_INTERVAL);
+    } else {
+      // 再接続の待ち時間は失敗するごとに倍にする
+      target->needs_reconnect = true;
+      target->reconnect_time = std::chrono::steady_clock::now() + target->reconnect_interval;
+      target->reconnect_interval = std::min(
+        target->reconnect_interval * 2,
+        std::chrono::milliseconds(URG_NODE2_RECONNECT_MAX_INTERVAL));
+    }
+  }
+}
+
+void UrgMultiNode::publish_scan(
+  const Sensor & sensor, const std::vector<char> & response,
+  UrgMultiplexer::Clock::time_point receive_time)
+{
+  // 再接続時に更新されるため、パラメータを取り出してから使う
+  ScanParameter scan;
+  {
+    std::lock_guard<std::mutex> lock(sensor.mutex);
+    scan = sensor.scan;
+  }
+
+  auto msg = std::make_unique<sensor_msgs::msg::LaserScan>();
+  msg->ranges.resize(scan.max_size);
+  if (sensor.publish_intensity) {
+    msg->intensities.resize(scan.max_size);
+  }
+
+  long time_stamp;
+  int num_beams = urg_parse_ranges_f32(
+    response.data(), static_cast<int>(response.size()), msg->ranges.data(),
+    sensor.publish_intensity ? msg->intensities.data() : nullptr,
+    scan.max_size, 1, &time_stamp);
+  if (num_beams < 0) {
+    RCLCPP_WARN_THROTTLE(
+      get_logger(), *get_clock(), 1000, "Could not get scan of %s: %d",
+      sensor.name.c_str(), num_beams);
+    return;
+  } else if (num_beams == 0) {
+    // 計測開始の応答
+    return;
+  }
+  msg->ranges.resize(num_beams);
+  if (sensor.publish_intensity) {
+    msg->intensities.resize(num_beams);
+  }
+
+  int64_t receive_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    receive_time.time_since_epoch()).count();
+  msg->header.frame_id = sensor.frame_id;
+  msg->header.stamp = rclcpp::Time(receive_nsec, RCL_SYSTEM_TIME) +
+    rclcpp::Duration::from_seconds(scan.time_correction);
+  msg->angle_min = scan.range.angle_min;
+  msg->angle_max = scan.range.angle_max;
+  msg->angle_increment = scan.range.angle_increment;
+  msg->time_increment = scan.range.time_increment;
+  msg->scan_time = scan.scan_time;
+  msg->range_min = scan.range.range_min;
+  msg->range_max = scan.range.range_max;
+
+  sensor.scan_pub->publish(std::move(msg));
+}
+
+}  // namespace urg_node2
+
+#include "rclcpp_components/register_node_macro.hpp"
+RCLCPP_COMPONENTS_REGISTER_NODE(urg_node2::UrgMultiNode)
@@ -0,0 +1,140 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "urg_node2/urg_multiecho.hpp"
+
+#include <limits>
+#include <vector>
+
+#include "urg_sensor.h"
+
+namespace urg_node2
+{
+
+void reserve_multiecho(
+  int max_beams, bool use_intensity,
+  sensor_msgs::msg::MultiEchoLaserScan & msg)
+{
+  msg.ranges.resize(max_beams);
+  for (sensor_msgs::msg::LaserEcho & echo : msg.ranges) {
+    echo.echoes.reserve(URG_MAX_ECHO);
+  }
+  if (use_intensity) {
+    msg.intensities.resize(max_beams);
+    for (sensor_msgs::msg::LaserEcho & echo : msg.intensities) {
+      echo.echoes.reserve(URG_MAX_ECHO);
+    }
+  } else {
+    msg.intensities.clear();
+  }
+}
+
+void set_multiecho_ranges(
+  const long distance[], const unsigned short intensity[], int num_beams,
+  sensor_msgs::msg::MultiEchoLaserScan & msg)
+{
+  // 要素を破棄せずに数を合わせ、各ステップのエコー配列の領域を再利用する
+  msg.ranges.resize(num_beams);
+  if (intensity) {
+    msg.intensities.resize(num_beams);
+  }
+
+  for (int i = 0; i < num_beams; i++) {
+    std::vector<float> & range_echoes = msg.ranges[i].echoes;
+    range_echoes.clear();
+    for (int j = 0; j < URG_MAX_ECHO; j++) {
+      long value = distance[(URG_MAX_ECHO * i) + j];
+      if (value == 0) {
+        break;
+      }
+      range_echoes.push_back(static_cast<float>(value) / 1000.0f);
+    }
+
+    if (intensity) {
+      std::vector<float> & intensity_echoes = msg.intensities[i].echoes;
+      intensity_echoes.clear();
+      for (size_t j = 0; j < range_echoes.size(); j++) {
+        intensity_echoes.push_back(intensity[(URG_MAX_ECHO * i) + j]);
+      }
+    }
+  }
+}
+
+void set_echo_ranges(
+  const long distance[], const unsigned short intensity[], int num_beams,
+  sensor_msgs::msg::LaserScan & first, sensor_msgs::msg::LaserScan & last,
+  sensor_msgs::msg::LaserScan * most_intense)
+{
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  if (!intensity) {
+    most_intense = nullptr;
+  }
+
+  first.ranges.resize(num_beams);
+  last.ranges.resize(num_beams);
+  if (intensity) {
+    first.intensities.resize(num_beams);
+    last.intensities.resize(num_beams);
+  }
+  if (most_intense) {
+    most_intense->ranges.resize(num_beams);
+    most_intense->intensities.resize(num_beams);
+  }
+
+  for (int i = 0; i < num_beams; i++) {
+    const long * step_distance = &distance[URG_MAX_ECHO * i];
+
+    // エコー数（0以降はエコーなし）
+    int num_echoes = 0;
+    while (num_echoes < URG_MAX_ECHO && step_distance[num_echoes] != 0) {
+      num_echoes++;
+    }
+    if (num_echoes == 0) {
+      first.ranges[i] = nan;
+      last.ranges[i] = nan;
+      if (intensity) {
+        first.intensities[i] = 0.0f;
+        last.intensities[i] = 0.0f;
+      }
+      if (most_intense) {
+        most_intense->ranges[i] = nan;
+        most_intense->intensities[i] = 0.0f;
+      }
+      continue;
+    }
+
+    first.ranges[i] = static_cast<float>(step_distance[0]) / 1000.0f;
+    last.ranges[i] = static_cast<float>(step_distance[num_echoes - 1]) / 1000.0f;
+    if (!intensity) {
+      continue;
+    }
+
+    const unsigned short * step_intensity = &intensity[URG_MAX_ECHO * i];
+    first.intensities[i] = step_intensity[0];
+    last.intensities[i] = step_intensity[num_echoes - 1];
+    if (most_intense) {
+      // 同じ強度の場合は先のエコーとする
+      int most_index = 0;
+      for (int j = 1; j < num_echoes; j++) {
+        if (step_intensity[j] > step_intensity[most_index]) {
+          most_index = j;
+        }
+      }
+      most_intense->ranges[i] = static_cast<float>(step_distance[most_index]) / 1000.0f;
+      most_intense->intensities[i] = step_intensity[most_index];
+    }
+  }
+}
+
+}  // namespace urg_node2
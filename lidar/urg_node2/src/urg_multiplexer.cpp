@@ -0,0 +1,400 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "urg_node2/urg_multiplexer.hpp"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace urg_node2
+{
+
+UrgMultiplexer::UrgMultiplexer(size_t worker_threads)
+: epoll_fd_(-1),
+  event_fd_(-1),
+  worker_threads_(worker_threads),
+  is_running_(false)
+{
+}
+
+UrgMultiplexer::~UrgMultiplexer()
+{
+  stop();
+}
+
+bool UrgMultiplexer::add(
+  urg_connection_t * connection, ResponseCallback on_response,
+  ErrorCallback on_error, std::chrono::milliseconds timeout)
+{
+  int fd = connection_descriptor(connection);
+  if (fd < 0) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(connections_mutex_);
+  for (const auto & entry : connections_) {
+    if (entry->connection == connection) {
+      return false;
+    }
+  }
+
+  auto entry = std::make_unique<Connection>();
+  entry->connection = connection;
+  entry->fd = fd;
+  entry->on_response = std::move(on_response);
+  entry->on_error = std::move(on_error);
+  entry->worker = (worker_threads_ > 0) ? connections_.size() % worker_threads_ : 0;
+  entry->is_disconnected = false;
+  entry->timeout = timeout;
+  entry->buffer.reserve(kMaxResponseSize);
+  entry->searched = 0;
+
+  // 開始済みの場合はすぐに監視する
+  if (is_running_ && !watch(*entry)) {
+    return false;
+  }
+  connections_.push_back(std::move(entry));
+  return true;
+}
+
+bool UrgMultiplexer::resume(urg_connection_t * connection, std::chrono::milliseconds timeout)
+{
+  int fd = connection_descriptor(connection);
+  if (fd < 0) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(connections_mutex_);
+  for (auto & entry : connections_) {
+    if (entry->connection != connection) {
+      continue;
+    }
+    if (!entry->is_disconnected) {
+      return false;
+    }
+    // 受信途中のデータは切断時に破棄済み
+    entry->fd = fd;
+    entry->timeout = timeout;
+    if (is_running_ && !watch(*entry)) {
+      return false;
+    }
+    entry->is_disconnected = false;
+    return true;
+  }
+  return false;
+}
+
+bool UrgMultiplexer::start()
+{
+  if (is_running_) {
+    return false;
+  }
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  event_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (epoll_fd_ < 0 || event_fd_ < 0) {
+    stop();
+    return false;
+  }
+
+  // 停止通知の登録（data.ptrがnullptrのイベントは停止通知）
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &event) < 0) {
+    stop();
+    return false;
+  }
+
+  // 接続の登録（切断されたままの接続はresume()で登録する）
+  {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    bool is_watched = true;
+    for (auto & connection : connections_) {
+      if (!connection->is_disconnected && !watch(*connection)) {
+        is_watched = false;
+        break;
+      }
+    }
+    is_running_ = is_watched;
+  }
+  if (!is_running_) {
+    stop();
+    return false;
+  }
+
+  for (size_t i = 0; i < worker_threads_; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (auto & worker : workers_) {
+    Worker * w = worker.get();
+    worker->thread = std::thread([this, w]() {worker_loop(*w);});
+  }
+  event_thread_ = std::thread([this]() {event_loop();});
+  return true;
+}
+
+void UrgMultiplexer::stop()
+{
+  is_running_ = false;
+
+  // イベントループの停止
+  if (event_thread_.joinable()) {
+    uint64_t value = 1;
+    if (write(event_fd_, &value, sizeof(value)) < 0) {
+      // eventfdへの書き込みは失敗しない想定
+    }
+    event_thread_.join();
+  }
+
+  // ワーカースレッドの停止
+  for (auto & worker : workers_) {
+    {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      worker->jobs.clear();
+    }
+    worker->condition.notify_all();
+  }
+  for (auto & worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+  workers_.clear();
+
+  // 他のスレッドのadd()とresume()が監視の登録を終えてから閉じる
+  std::lock_guard<std::mutex> lock(connections_mutex_);
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+    epoll_fd_ = -1;
+  }
+  if (event_fd_ >= 0) {
+    close(event_fd_);
+    event_fd_ = -1;
+  }
+}
+
+bool UrgMultiplexer::watch(Connection & connection)
+{
+  connection.last_receive_time = std::chrono::steady_clock::now();
+
+  struct epoll_event event;
+  event.events = EPOLLIN | EPOLLRDHUP;
+  event.data.ptr = &connection;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, connection.fd, &event) < 0) {
+    return false;
+  }
+
+  // 待機中のイベントループにタイムアウトを計算し直させる
+  if (connection.timeout.count() > 0 && is_running_) {
+    uint64_t value = 1;
+    if (write(event_fd_, &value, sizeof(value)) < 0) {
+      // eventfdへの書き込みは失敗しない想定
+    }
+  }
+  return true;
+}
+
+void UrgMultiplexer::unwatch(Connection & connection)
+{
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection.fd, nullptr);
+
+  // 受信途中のデータを破棄してresume()を待つ
+  connection.buffer.clear();
+  connection.searched = 0;
+  connection.is_disconnected = true;
+}
+
+void UrgMultiplexer::event_loop()
+{
+  struct epoll_event events[16];
+
+  int timeout = check_timeout();
+  while (is_running_) {
+    int n = epoll_wait(epoll_fd_, events, sizeof(events) / sizeof(events[0]), timeout);
+    for (int i = 0; i < n; ++i) {
+      if (events[i].data.ptr == nullptr) {
+        // 停止通知またはタイムアウトの変更通知
+        uint64_t value;
+        if (read(event_fd_, &value, sizeof(value)) < 0) {
+          // 通知済みの値は読み出し済み
+        }
+        if (!is_running_) {
+          return;
+        }
+        continue;
+      }
+
+      Connection & connection = *static_cast<Connection *>(events[i].data.ptr);
+      receive(connection);
+
+      // 受信済みのデータを処理した後で切断を扱う
+      if (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        unwatch(connection);
+        if (connection.on_error) {
+          connection.on_error();
+        }
+      }
+    }
+    timeout = check_timeout();
+  }
+}
+
+int UrgMultiplexer::check_timeout()
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::vector<Connection *> timed_out;
+  std::chrono::milliseconds wait(-1);
+  {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    for (auto & connection : connections_) {
+      if (connection->is_disconnected || connection->timeout.count() <= 0) {
+        continue;
+      }
+      std::chrono::steady_clock::duration left =
+        connection->last_receive_time + connection->timeout - now;
+      if (left.count() <= 0) {
+        // 切断が通知されないまま受信が途絶えた
+        unwatch(*connection);
+        timed_out.push_back(connection.get());
+        continue;
+      }
+      // 早く起きすぎないように切り上げる
+      std::chrono::milliseconds remaining =
+        std::chrono::duration_cast<std::chrono::milliseconds>(left) + std::chrono::milliseconds(1);
+      if (wait.count() < 0 || remaining < wait) {
+        wait = remaining;
+      }
+    }
+  }
+
+  // コールバックからのresume()で排他しないようにロックの外で呼ぶ
+  for (Connection * connection : timed_out) {
+    if (connection->on_error) {
+      connection->on_error();
+    }
+  }
+  return static_cast<int>(wait.count());
+}
+
+void UrgMultiplexer::receive(Connection & connection)
+{
+  // 受信バッファを空になるまで読み出す（タイムアウト0のため待たない）
+  const char * data;
+  int n;
+  while ((n = connection_peek(connection.connection, &data, 0)) > 0) {
+    connection.last_receive_time = std::chrono::steady_clock::now();
+    if (connection.buffer.empty()) {
+      connection.receive_time = Clock::now();
+    }
+    connection.buffer.insert(connection.buffer.end(), data, data + n);
+    connection_consume(connection.connection, n);
+  }
+
+  // 応答の終端（空行）ごとに切り出して処理を依頼する
+  std::vector<char> & buffer = connection.buffer;
+  static const char terminator[] = {'\n', '\n'};
+  while (connection.searched + 1 < buffer.size()) {
+    auto begin = buffer.begin() + connection.searched;
+    auto end = std::search(begin, buffer.end(), terminator, terminator + 2);
+    if (end == buffer.end()) {
+      connection.searched = buffer.size() - 1;
+      break;
+    }
+    dispatch(connection, (end - buffer.begin()) + 2);
+  }
+
+  if (buffer.size() > kMaxResponseSize) {
+    // 終端が見つからない場合は不正なデータとして破棄する
+    buffer.clear();
+    connection.searched = 0;
+  }
+}
+
+void UrgMultiplexer::dispatch(Connection & connection, size_t size)
+{
+  // 応答以降のデータを再利用する領域に移し、応答を処理に渡す
+  std::vector<char> rest;
+  {
+    std::lock_guard<std::mutex> lock(connection.spare_mutex);
+    if (!connection.spares.empty()) {
+      rest = std::move(connection.spares.back());
+      connection.spares.pop_back();
+    }
+  }
+  rest.assign(connection.buffer.begin() + size, connection.buffer.end());
+  if (rest.capacity() < kMaxResponseSize) {
+    rest.reserve(kMaxResponseSize);
+  }
+
+  Job job;
+  job.connection = &connection;
+  job.response = std::move(connection.buffer);
+  job.response.resize(size);
+  job.receive_time = connection.receive_time;
+
+  connection.buffer = std::move(rest);
+  connection.searched = 0;
+  if (!connection.buffer.empty()) {
+    // 次の応答の先頭も受信済み
+    connection.receive_time = Clock::now();
+  }
+
+  if (workers_.empty()) {
+    process(job);
+    return;
+  }
+  Worker & worker = *workers_[connection.worker];
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.jobs.push_back(std::move(job));
+  }
+  worker.condition.notify_one();
+}
+
+void UrgMultiplexer::worker_loop(Worker & worker)
+{
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(worker.mutex);
+      worker.condition.wait(lock, [this, &worker]() {return !is_running_ || !worker.jobs.empty();});
+      if (!is_running_) {
+        return;
+      }
+      job = std::move(worker.jobs.front());
+      worker.jobs.pop_front();
+    }
+    process(job);
+  }
+}
+
+void UrgMultiplexer::process(Job & job)
+{
+  Connection & connection = *job.connection;
+  connection.on_response(job.response, job.receive_time);
+
+  // 応答領域を受信に戻す
+  job.response.clear();
+  std::lock_guard<std::mutex> lock(connection.spare_mutex);
+  connection.spares.push_back(std::move(job.response));
+}
+
+}  // namespace urg_node2
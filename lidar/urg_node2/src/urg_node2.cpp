@@ -19,6 +19,7 @@ namespace urg_node2
 
 UrgNode2::UrgNode2(const rclcpp::NodeOptions & node_options)
 : rclcpp_lifecycle::LifecycleNode("urg_node2", node_options),
+  scan_builder_(get_logger()),
   error_count_(0),
   is_connected_(false),
   is_measurement_started_(false),
@@ -44,6 +45,9 @@ UrgNode2::UrgNode2(const rclcpp::NodeOptions & node_options)
   synchronize_time_ = declare_parameter<bool>("synchronize_time", false);
   publish_intensity_ = declare_parameter<bool>("publish_intensity", false);
   publish_multiecho_ = declare_parameter<bool>("publish_multiecho", false);
+  compact_multiecho_ = declare_parameter<bool>("compact_multiecho", false);
+  publish_pointcloud_ = declare_parameter<bool>("publish_pointcloud", false);
+  pointcloud_time_ = declare_parameter<bool>("pointcloud_time", false);
   error_limit_ = declare_parameter<int>("error_limit", 4);
   error_reset_period_ = declare_parameter<double>("error_reset_period", 5.0),
   diagnostics_tolerance_ = declare_parameter<double>("diagnostics_tolerance", 0.05);
@@ -53,6 +57,15 @@ UrgNode2::UrgNode2(const rclcpp::NodeOptions & node_options)
   angle_max_ = declare_parameter<double>("angle_max", M_PI);
   skip_ = declare_parameter<int>("skip", 0);
   cluster_ = declare_parameter<int>("cluster", 1);
+  sector_size_ = declare_parameter<int>("sector_size", 0);
+  filter_range_min_ = declare_parameter<double>("filter_range_min", 0.0);
+  filter_range_max_ = declare_parameter<double>("filter_range_max", 0.0);
+  filter_intensity_min_ = declare_parameter<double>("filter_intensity_min", 0.0);
+  filter_shadow_angle_ = declare_parameter<double>("filter_shadow_angle", 0.0);
+  filter_decimation_ = declare_parameter<int>("filter_decimation", 1);
+  filter_median_ = declare_parameter<bool>("filter_median", false);
+
+  use_intra_process_ = get_node_options().use_intra_process_comms();
 }
 
 // デストラクタ
@@ -74,10 +87,27 @@ UrgNode2::CallbackReturn UrgNode2::on_configure(const rclcpp_lifecycle::State &
   }
 
   // Publisher設定
-  if (use_multiecho_) {
+  if (use_multiecho_ && compact_multiecho_) {
+    // laser_procと同じトピック名で代表エコーのスキャンのみを出力する
+    first_pub_ = create_publisher<sensor_msgs::msg::LaserScan>("first", rclcpp::QoS(20));
+    last_pub_ = create_publisher<sensor_msgs::msg::LaserScan>("last", rclcpp::QoS(20));
+    if (use_intensity_) {
+      most_intense_pub_ = create_publisher<sensor_msgs::msg::LaserScan>(
+        "most_intense",
+        rclcpp::QoS(20));
+    }
+  } else if (use_multiecho_) {
     echo_pub_ = std::make_unique<laser_proc::LaserPublisher>(get_node_topics_interface(), 20);
   } else {
     scan_pub_ = create_publisher<sensor_msgs::msg::LaserScan>("scan", rclcpp::QoS(20));
+    if (sector_size_ > 0) {
+      sector_pub_ = create_publisher<sensor_msgs::msg::LaserScan>(
+        "scan_sector",
+        rclcpp::QoS(20));
+    }
+    if (publish_pointcloud_) {
+      cloud_pub_ = create_publisher<sensor_msgs::msg::PointCloud2>("cloud", rclcpp::QoS(20));
+    }
   }
 
   // スレッド起動
@@ -98,6 +128,19 @@ UrgNode2::CallbackReturn UrgNode2::on_activate(const rclcpp_lifecycle::State & s
     if (scan_pub_) {
       scan_pub_->on_activate();
     }
+    if (sector_pub_) {
+      sector_pub_->on_activate();
+    }
+    if (cloud_pub_) {
+      cloud_pub_->on_activate();
+    }
+    if (first_pub_) {
+      first_pub_->on_activate();
+      last_pub_->on_activate();
+    }
+    if (most_intense_pub_) {
+      most_intense_pub_->on_activate();
+    }
 
     // Diagnostics開始
     start_diagnostics();
@@ -135,8 +178,13 @@ UrgNode2::CallbackReturn UrgNode2::on_cleanup(const rclcpp_lifecycle::State & st
   // publisherの解放
   if (use_multiecho_) {
     echo_pub_.reset();
+    first_pub_.reset();
+    last_pub_.reset();
+    most_intense_pub_.reset();
   } else {
     scan_pub_.reset();
+    sector_pub_.reset();
+    cloud_pub_.reset();
   }
 
   // 切断
@@ -159,8 +207,13 @@ UrgNode2::CallbackReturn UrgNode2::on_shutdown(const rclcpp_lifecycle::State & s
   // publisherの解放
   if (use_multiecho_) {
     echo_pub_.reset();
+    first_pub_.reset();
+    last_pub_.reset();
+    most_intense_pub_.reset();
   } else {
     scan_pub_.reset();
+    sector_pub_.reset();
+    cloud_pub_.reset();
   }
 
   // 切断
@@ -183,8 +236,13 @@ UrgNode2::CallbackReturn UrgNode2::on_error(const rclcpp_lifecycle::State & stat
   // publisherの解放
   if (use_multiecho_) {
     echo_pub_.reset();
+    first_pub_.reset();
+    last_pub_.reset();
+    most_intense_pub_.reset();
   } else {
     scan_pub_.reset();
+    sector_pub_.reset();
+    cloud_pub_.reset();
   }
 
   // 切断
@@ -215,12 +273,26 @@ void UrgNode2::initialize()
   angle_max_ = get_parameter("angle_max").as_double();
   skip_ = get_parameter("skip").as_int();
   cluster_ = get_parameter("cluster").as_int();
+  sector_size_ = get_parameter("sector_size").as_int();
+  filter_range_min_ = get_parameter("filter_range_min").as_double();
+  filter_range_max_ = get_parameter("filter_range_max").as_double();
+  filter_intensity_min_ = get_parameter("filter_intensity_min").as_double();
+  filter_shadow_angle_ = get_parameter("filter_shadow_angle").as_double();
+  filter_decimation_ = get_parameter("filter_decimation").as_int();
+  filter_median_ = get_parameter("filter_median").as_bool();
 
   // 範囲チェック
   angle_min_ = (angle_min_ < -M_PI) ? -M_PI : ((angle_min_ > M_PI) ? M_PI : angle_min_);
   angle_max_ = (angle_max_ < -M_PI) ? -M_PI : ((angle_max_ > M_PI) ? M_PI : angle_max_);
   skip_ = (skip_ < 0) ? 0 : ((skip_ > 9) ? 9 : skip_);
   cluster_ = (cluster_ < 1) ? 1 : ((cluster_ > 99) ? 99 : cluster_);
+  sector_size_ = (sector_size_ < 0) ? 0 : sector_size_;
+  filter_shadow_angle_ =
+    (filter_shadow_angle_ < 0.0) ? 0.0 : ((filter_shadow_angle_ > M_PI / 2.0) ? M_PI / 2.0 :
+    filter_shadow_angle_);
+  filter_decimation_ = (filter_decimation_ < 1) ? 1 :
+    ((filter_decimation_ > UrgScanFilter::kMaxDecimation) ? UrgScanFilter::kMaxDecimation :
+    filter_decimation_);
 
   // 内部変数初期化
   is_connected_ = false;
@@ -234,15 +306,15 @@ void UrgNode2::initialize()
     frame_id_.find_first_not_of(
       '/'));
 
-  hardware_clock_ = 0.0;
-  last_hardware_time_stamp_ = 0;
-  hardware_clock_adj_ = 0;
-  adj_count_ = 0;
+  scan_builder_.reset_clock();
 }
 
 // Lidarとの接続処理
 bool UrgNode2::connect()
 {
+  // 接続に失敗した場合はパラメータを再利用しない
+  device_id_.clear();
+
   if (!ip_address_.empty()) {
     // イーサネット接続
     int result = urg_open(&urg_, URG_ETHERNET, ip_address_.c_str(), ip_port_);
@@ -322,6 +394,30 @@ bool UrgNode2::connect()
     measurement_type_ = URG_DISTANCE;
   }
 
+  // 点群出力の設定（シングルエコーのみ）
+  if (publish_pointcloud_ && use_multiecho_) {
+    RCLCPP_WARN(
+      get_logger(),
+      "parameter 'publish_pointcloud' is true, but point cloud output is not supported in multiecho scan mode.");
+  }
+
+  // フィルタの設定（シングルエコーのみ）
+  if (use_multiecho_ &&
+    (filter_range_min_ > 0.0 || filter_range_max_ > 0.0 || filter_intensity_min_ > 0.0 ||
+    filter_shadow_angle_ > 0.0 || filter_decimation_ > 1))
+  {
+    RCLCPP_WARN(
+      get_logger(),
+      "filter parameters are set, but scan filtering is not supported in multiecho scan mode.");
+  }
+
+  // 部分スキャン出力の設定（シングルエコーのみ）
+  if (sector_size_ > 0 && use_multiecho_) {
+    RCLCPP_WARN(
+      get_logger(),
+      "parameter 'sector_size' is set, but sector output is not supported in multiecho scan mode.");
+  }
+
   return true;
 }
 
@@ -339,54 +435,117 @@ void UrgNode2::set_scan_parameter()
   distance_.resize(urg_data_size * URG_MAX_ECHO);
   intensity_.resize(urg_data_size * URG_MAX_ECHO);
 
-  // 指定範囲のステップ変換（範囲クリップ&丸め）
-  first_step_ = urg_rad2step(&urg_, angle_min_);
-  last_step_ = urg_rad2step(&urg_, angle_max_);
+  // スキャン範囲の設定とスキャントピック用のパラメータ設定
+  UrgScanRange range = set_scan_range(urg_, angle_min_, angle_max_, cluster_, scan_period_);
+  first_step_ = range.first_step;
+  last_step_ = range.last_step;
 
-  // 逆転してた場合入れ替え
-  if (last_step_ < first_step_) {
-    std::swap(first_step_, last_step_);
+  // スキャンデータ範囲の反映
+  angle_min_ = range.angle_min;
+  angle_max_ = range.angle_max;
+
+  topic_angle_min_ = range.angle_min;
+  topic_angle_max_ = range.angle_max;
+  topic_angle_increment_ = range.angle_increment;
+  topic_time_increment_ = range.time_increment;
+  topic_range_min_ = range.range_min;
+  topic_range_max_ = range.range_max;
+
+  // 配信メッセージの領域を事前に確保する
+  bool use_intensity = use_intensity_;
+  std::string frame_id = header_frame_id_;
+  auto scan_initializer =
+    [urg_data_size, use_intensity, frame_id](sensor_msgs::msg::LaserScan & msg) {
+      msg.header.frame_id = frame_id;
+      msg.ranges.reserve(urg_data_size);
+      if (use_intensity) {
+        msg.intensities.reserve(urg_data_size);
+      }
+    };
+  if (use_multiecho_ && compact_multiecho_) {
+    first_pool_.set_initializer(scan_initializer);
+    last_pool_.set_initializer(scan_initializer);
+    most_intense_pool_.set_initializer(scan_initializer, use_intensity ? 1 : 0);
+  } else if (use_multiecho_) {
+    reserve_multiecho(urg_data_size, use_intensity_, echo_msg_);
+  } else {
+    scan_pool_.set_initializer(scan_initializer);
   }
 
-  // 変換後ステップが同値の場合は1ずらす
-  if (last_step_ == first_step_) {
-    int min_step, max_step;
-    urg_step_min_max(&urg_, &min_step, &max_step);
-    if (first_step_ == min_step) {
-      last_step_ = first_step_ + 1;
-    } else {
-      first_step_ = last_step_ - 1;
-    }
+  // シングルエコーのスキャントピックの設定（マルチエコーではタイムスタンプの計算のみ使う）
+  UrgScanConfig scan_config;
+  scan_config.frame_id = frame_id;
+  scan_config.use_intensity = use_intensity_;
+  scan_config.max_beams = urg_data_size;
+  scan_config.angle_min = topic_angle_min_;
+  scan_config.angle_max = topic_angle_max_;
+  scan_config.angle_increment = topic_angle_increment_;
+  scan_config.time_increment = topic_time_increment_;
+  scan_config.scan_time = scan_period_;
+  scan_config.range_min = topic_range_min_;
+  scan_config.range_max = topic_range_max_;
+  scan_config.angular_time_offset = range.angular_time_offset;
+  scan_config.sector_size = use_multiecho_ ? 0 : sector_size_;
+  scan_config.filter.range_min = filter_range_min_;
+  scan_config.filter.range_max = filter_range_max_;
+  scan_config.filter.intensity_min = filter_intensity_min_;
+  scan_config.filter.shadow_angle = filter_shadow_angle_;
+  scan_config.filter.decimation = filter_decimation_;
+  scan_config.filter.median = filter_median_;
+  scan_builder_.configure(
+    urg_, scan_config,
+    [this](UrgMessagePool<sensor_msgs::msg::LaserScan> & pool,
+    std::unique_ptr<sensor_msgs::msg::LaserScan> sector) {
+      if (sector_pub_) {
+        publish_pooled_message(*sector_pub_, pool, std::move(sector), use_intra_process_);
+      }
+    });
+  // 間引き後のステップ間の角度はdecimation倍になる
+  int decimation = scan_builder_.decimation();
+
+  if (publish_pointcloud_ && !use_multiecho_) {
+    cloud_converter_.set_angles(
+      topic_angle_min_, decimation * topic_angle_increment_,
+      (urg_data_size + decimation - 1) / decimation);
+    cloud_converter_.set_fields(
+      use_intensity_, pointcloud_time_, decimation * topic_time_increment_);
+    UrgPointCloudConverter converter = cloud_converter_;
+    cloud_pool_.set_initializer(
+      [converter, frame_id](sensor_msgs::msg::PointCloud2 & msg) {
+        msg.header.frame_id = frame_id;
+        converter.initialize(msg);
+      });
   }
+}
 
-  // スキャンデータ範囲の反映
-  angle_min_ = urg_step2rad(&urg_, first_step_);
-  angle_max_ = urg_step2rad(&urg_, last_step_);
-
-  // スキャンデータ範囲の設定
-  urg_set_scanning_parameter(&urg_, first_step_, last_step_, cluster_);
-
-  // スキャントピック用のパラメータ設定
-  topic_angle_min_ = urg_step2rad(&urg_, first_step_);
-  topic_angle_max_ = urg_step2rad(&urg_, last_step_);
-  topic_angle_increment_ = cluster_ * urg_step2rad(&urg_, 1);
-
-  int min_step;
-  int max_step;
-  urg_step_min_max(&urg_, &min_step, &max_step);
-  topic_time_increment_ = cluster_ *
-    ((urg_step2rad(
-      &urg_,
-      max_step) -
-    urg_step2rad(
-      &urg_,
-      min_step)) / (2.0 * M_PI)) * scan_period_ / static_cast<double>(max_step - min_step);
-
-  long min_dis;
-  long max_dis;
-  urg_distance_min_max(&urg_, &min_dis, &max_dis);
-  topic_range_min_ = static_cast<double>(min_dis) / 1000.0;
-  topic_range_max_ = static_cast<double>(max_dis) / 1000.0;
+// Lidarとの再接続処理（パラメータ再利用）
+bool UrgNode2::resume()
+{
+  // PPコマンドを省略して接続
+  int result;
+  if (!ip_address_.empty()) {
+    result = urg_reopen(&urg_, URG_ETHERNET, ip_address_.c_str(), ip_port_);
+  } else {
+    result = urg_reopen(&urg_, URG_SERIAL, serial_port_.c_str(), serial_baud_);
+  }
+  if (result < 0) {
+    RCLCPP_ERROR(get_logger(), "Could not reconnect Hokuyo 2D LiDAR\n%s", urg_error(&urg_));
+    return false;
+  }
+
+  // 前回と同じLiDARであれば、LiDAR情報と強度・マルチエコー対応の判定を再利用する
+  std::string device_id = urg_sensor_serial_id(&urg_);
+  if (device_id != device_id_) {
+    RCLCPP_WARN(
+      get_logger(), "Hardware ID changed from %s to %s, reconnecting.",
+      device_id_.c_str(), device_id.c_str());
+    urg_close(&urg_);
+    return connect();
+  }
+
+  is_connected_ = true;
+  RCLCPP_INFO(get_logger(), "Reconnected. Hardware ID: %s", device_id_.c_str());
+  return true;
 }
 
 // Lidarとの切断処理
@@ -404,20 +563,31 @@ void UrgNode2::reconnect()
   // 切断
   disconnect();
   // 接続
-  connect();
+  if (device_id_.empty()) {
+    connect();
+  } else {
+    resume();
+  }
 }
 
 // scanスレッド
 void UrgNode2::scan_thread()
 {
   reconnect_count_ = 0;
+  std::chrono::milliseconds reconnect_interval(URG_NODE2_RECONNECT_MIN_INTERVAL);
 
   while (!close_thread_) {
     if (!is_connected_) {
-      if (!connect()) {
-        rclcpp::sleep_for(500ms);
+      bool is_connected = device_id_.empty() ? connect() : resume();
+      if (!is_connected) {
+        // 再接続の待ち時間は失敗するごとに倍にする
+        rclcpp::sleep_for(reconnect_interval);
+        reconnect_interval = std::min(
+          reconnect_interval * 2,
+          std::chrono::milliseconds(URG_NODE2_RECONNECT_MAX_INTERVAL));
         continue;
       }
+      reconnect_interval = std::chrono::milliseconds(URG_NODE2_RECONNECT_MIN_INTERVAL);
     }
 
     // Inactive状態判定
@@ -440,6 +610,7 @@ void UrgNode2::scan_thread()
     if (calibrate_time_) {
       calibrate_system_latency(URG_NODE2_CALIBRATION_MEASUREMENT_TIME);
     }
+    scan_builder_.set_time_correction(synchronize_time_, system_latency_ + user_latency_);
 
     // LiDAR状態更新
     device_status_ = urg_sensor_status(&urg_);
@@ -465,18 +636,15 @@ void UrgNode2::scan_thread()
     rclcpp::Time prev_time = system_clock.now();
 
     while (!close_thread_) {
-      // Inactive状態判定
-      rclcpp_lifecycle::State state = get_current_state();
-      if (state.label() == "inactive") {
+      // Inactive状態判定（スキャンごとのStateのコピーを避けるためIDで判定する）
+      if (get_current_state().id() == lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE) {
         urg_stop_measurement(&urg_);
         is_measurement_started_ = false;
         break;
       }
 
       if (use_multiecho_) {
-        sensor_msgs::msg::MultiEchoLaserScan msg;
-        if (create_scan_message(msg)) {
-          echo_pub_->publish(msg);
+        if (publish_echoes()) {
           if (echo_freq_) {
             echo_freq_->tick();
           }
@@ -489,9 +657,7 @@ void UrgNode2::scan_thread()
           is_stable_ = urg_is_stable(&urg_);
         }
       } else {
-        sensor_msgs::msg::LaserScan msg;
-        if (create_scan_message(msg)) {
-          scan_pub_->publish(msg);
+        if (publish_scan()) {
           if (scan_freq_) {
             scan_freq_->tick();
           }
@@ -529,60 +695,48 @@ void UrgNode2::scan_thread()
   disconnect();
 }
 
-// スキャンデータ取得
-bool UrgNode2::create_scan_message(sensor_msgs::msg::LaserScan & msg)
+// スキャンデータの取得と配信
+bool UrgNode2::publish_scan()
 {
-  msg.header.frame_id = header_frame_id_;
-  msg.angle_min = topic_angle_min_;
-  msg.angle_max = topic_angle_max_;
-  msg.angle_increment = topic_angle_increment_;
-  msg.scan_time = scan_period_;
-  msg.time_increment = topic_time_increment_;
-  msg.range_min = topic_range_min_;
-  msg.range_max = topic_range_max_;
-
-  int num_beams = 0;
-  long time_stamp = 0;
-  rclcpp::Clock system_clock(RCL_SYSTEM_TIME);
-  rclcpp::Time system_time_stamp = system_clock.now();
-
-  if (use_intensity_) {
-    num_beams = urg_get_distance_intensity(&urg_, &distance_[0], &intensity_[0], &time_stamp);
-  } else {
-    num_beams = urg_get_distance(&urg_, &distance_[0], &time_stamp);
-  }
-  if (num_beams <= 0) {
-    return false;
-  }
-
-  // タイムスタンプ設定
-  if (synchronize_time_) {
-    system_time_stamp = get_synchronized_time(time_stamp, system_time_stamp);
+  if (scan_pub_->can_loan_messages()) {
+    // ミドルウェアの領域に直接格納する
+    auto loaned_msg = scan_pub_->borrow_loaned_message();
+    if (!scan_builder_.create_scan_message(urg_, loaned_msg.get())) {
+      return false;
+    }
+    if (cloud_pub_) {
+      publish_cloud(loaned_msg.get());
+    }
+    // foxyのLifecyclePublisherはloaned messageの配信に対応していないため、有効状態を確認して直接配信する
+    if (scan_pub_->is_activated()) {
+      scan_pub_->rclcpp::Publisher<sensor_msgs::msg::LaserScan>::publish(std::move(loaned_msg));
+    }
+    return true;
   }
-  msg.header.stamp = system_time_stamp + system_latency_ + user_latency_ +
-    get_angular_time_offset();
 
-  // データ領域確保
-  msg.ranges.resize(num_beams);
-  if (use_intensity_) {
-    msg.intensities.resize(num_beams);
+  std::unique_ptr<sensor_msgs::msg::LaserScan> msg = scan_pool_.acquire();
+  if (!scan_builder_.create_scan_message(urg_, *msg)) {
+    scan_pool_.release(std::move(msg));
+    return false;
   }
-
-  for (int i = 0; i < num_beams; i++) {
-    if (distance_[i] != 0) {
-      msg.ranges[i] = static_cast<float>(distance_[i]) / 1000.0;
-      if (use_intensity_) {
-        msg.intensities[i] = intensity_[i];
-      }
-    } else {
-      msg.ranges[i] = std::numeric_limits<float>::quiet_NaN();
-      continue;
-    }
+  if (cloud_pub_) {
+    publish_cloud(*msg);
   }
-
+  publish_pooled_message(*scan_pub_, scan_pool_, std::move(msg), use_intra_process_);
   return true;
 }
 
+// 点群データの作成と配信
+void UrgNode2::publish_cloud(const sensor_msgs::msg::LaserScan & scan)
+{
+  std::unique_ptr<sensor_msgs::msg::PointCloud2> cloud = cloud_pool_.acquire();
+  cloud->header = scan.header;
+  cloud_converter_.convert(
+    scan.ranges.data(), use_intensity_ ? scan.intensities.data() : nullptr,
+    static_cast<int>(scan.ranges.size()), *cloud);
+  publish_pooled_message(*cloud_pub_, cloud_pool_, std::move(cloud), use_intra_process_);
+}
+
 // マルチエコースキャンデータ取得
 bool UrgNode2::create_scan_message(sensor_msgs::msg::MultiEchoLaserScan & msg)
 {
@@ -595,56 +749,89 @@ bool UrgNode2::create_scan_message(sensor_msgs::msg::MultiEchoLaserScan & msg)
   msg.range_min = topic_range_min_;
   msg.range_max = topic_range_max_;
 
+  int num_beams = receive_multiecho(msg.header.stamp);
+  if (num_beams <= 0) {
+    return false;
+  }
+
+  set_multiecho_ranges(
+    &distance_[0], use_intensity_ ? &intensity_[0] : nullptr, num_beams, msg);
+
+  return true;
+}
+
+// マルチエコースキャンデータ受信
+int UrgNode2::receive_multiecho(builtin_interfaces::msg::Time & stamp)
+{
   int num_beams = 0;
   long time_stamp = 0;
-  rclcpp::Clock system_clock(RCL_SYSTEM_TIME);
-  rclcpp::Time system_time_stamp = system_clock.now();
+  rclcpp::Time system_time_stamp(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count(), RCL_SYSTEM_TIME);
   if (use_intensity_) {
     num_beams = urg_get_multiecho_intensity(&urg_, &distance_[0], &intensity_[0], &time_stamp);
   } else {
     num_beams = urg_get_multiecho(&urg_, &distance_[0], &time_stamp);
   }
   if (num_beams <= 0) {
-    return false;
+    return num_beams;
   }
 
   // タイムスタンプ設定
-  if (synchronize_time_) {
-    system_time_stamp = get_synchronized_time(time_stamp, system_time_stamp);
+  stamp = scan_builder_.get_stamp(time_stamp, system_time_stamp);
+
+  return num_beams;
+}
+
+// マルチエコースキャンデータの取得と配信
+bool UrgNode2::publish_echoes()
+{
+  if (!compact_multiecho_) {
+    // 前回のメッセージを再利用する（laser_procはconst参照で配信する）
+    if (!create_scan_message(echo_msg_)) {
+      return false;
+    }
+    echo_pub_->publish(echo_msg_);
+    return true;
   }
-  msg.header.stamp = system_time_stamp + system_latency_ + user_latency_ +
-    get_angular_time_offset();
 
-  // データ領域確保
-  msg.ranges.reserve(num_beams);
-  if (use_intensity_) {
-    msg.intensities.reserve(num_beams);
+  builtin_interfaces::msg::Time stamp;
+  int num_beams = receive_multiecho(stamp);
+  if (num_beams <= 0) {
+    return false;
   }
 
-  for (int i = 0; i < num_beams; i++) {
-    sensor_msgs::msg::LaserEcho distance_echo;
-    distance_echo.echoes.reserve(URG_MAX_ECHO);
-    sensor_msgs::msg::LaserEcho intensity_echo;
-    if (use_intensity_) {
-      intensity_echo.echoes.reserve(URG_MAX_ECHO);
-    }
-    for (int j = 0; j < URG_MAX_ECHO; j++) {
-      if (distance_[(URG_MAX_ECHO * i) + j] != 0) {
-        distance_echo.echoes.push_back(
-          static_cast<float>(distance_[(URG_MAX_ECHO * i) + j]) / 1000.0f);
-        if (use_intensity_) {
-          intensity_echo.echoes.push_back(intensity_[(URG_MAX_ECHO * i) + j]);
-        }
-      } else {
-        break;
-      }
-    }
-    msg.ranges.push_back(distance_echo);
-    if (use_intensity_) {
-      msg.intensities.push_back(intensity_echo);
-    }
+  std::unique_ptr<sensor_msgs::msg::LaserScan> first = first_pool_.acquire();
+  std::unique_ptr<sensor_msgs::msg::LaserScan> last = last_pool_.acquire();
+  std::unique_ptr<sensor_msgs::msg::LaserScan> most_intense;
+  if (most_intense_pub_) {
+    most_intense = most_intense_pool_.acquire();
   }
 
+  for (sensor_msgs::msg::LaserScan * msg : {first.get(), last.get(), most_intense.get()}) {
+    if (!msg) {
+      continue;
+    }
+    msg->header.frame_id = header_frame_id_;
+    msg->header.stamp = stamp;
+    msg->angle_min = topic_angle_min_;
+    msg->angle_max = topic_angle_max_;
+    msg->angle_increment = topic_angle_increment_;
+    msg->scan_time = scan_period_;
+    msg->time_increment = topic_time_increment_;
+    msg->range_min = topic_range_min_;
+    msg->range_max = topic_range_max_;
+  }
+  set_echo_ranges(
+    &distance_[0], use_intensity_ ? &intensity_[0] : nullptr, num_beams,
+    *first, *last, most_intense.get());
+
+  publish_pooled_message(*first_pub_, first_pool_, std::move(first), use_intra_process_);
+  publish_pooled_message(*last_pub_, last_pool_, std::move(last), use_intra_process_);
+  if (most_intense) {
+    publish_pooled_message(
+      *most_intense_pub_, most_intense_pool_, std::move(most_intense), use_intra_process_);
+  }
   return true;
 }
 
@@ -694,6 +881,12 @@ void UrgNode2::populate_diagnostics_status(diagnostic_updater::DiagnosticStatusW
   status.add("Scan Retrieve Error Count", error_count_);
   status.add("Scan Retrieve Total Error Count", total_error_count_);
   status.add("Reconnection Count", reconnect_count_);
+  if (synchronize_time_) {
+    const UrgClockSynchronizer & clock_synchronizer = scan_builder_.clock_synchronizer();
+    status.add("Clock Drift [ppm]", clock_synchronizer.drift_ppm());
+    status.add("Clock Jitter", clock_synchronizer.jitter());
+    status.add("Clock Reset Count", clock_synchronizer.reset_count());
+  }
 }
 
 // スキャンスレッドの開始
@@ -971,54 +1164,17 @@ rclcpp::Duration UrgNode2::get_time_stamp_offset(size_t num_measurements)
   return time_offsets[time_offsets.size() / 2];
 }
 
-// 指数移動平均による動的補正
-rclcpp::Time UrgNode2::get_synchronized_time(long time_stamp, rclcpp::Time system_time_stamp)
-{
-  rclcpp::Time stamp = system_time_stamp;
-
-  const uint32_t t1 = static_cast<uint32_t>(time_stamp);
-  const uint32_t t0 = static_cast<uint32_t>(last_hardware_time_stamp_);
-  const uint32_t mask = 0x00ffffff;
-  double delta = static_cast<double>(mask & (t1 - t0)) / 1000.0;
-  hardware_clock_ += delta;
-  double cur_adj = stamp.seconds() - hardware_clock_;
-  if (adj_count_ > 0) {
-    hardware_clock_adj_ = adj_alpha_ * cur_adj + (1.0 - adj_alpha_) * hardware_clock_adj_;
-  } else {
-    // 指数移動平均の初期化
-    hardware_clock_adj_ = cur_adj;
-  }
-  adj_count_++;
-  last_hardware_time_stamp_ = time_stamp;
-
-  // ズレのチェック
-  if (adj_count_ > 100) {
-    stamp = rclcpp::Time((hardware_clock_ + hardware_clock_adj_) * 1e9);
-    // ズレが大きすぎると指数移動平均の初期化
-    if (fabs((stamp - system_time_stamp).seconds()) > 0.1) {
-      adj_count_ = 0;
-      hardware_clock_ = 0.0;
-      last_hardware_time_stamp_ = 0;
-      stamp = system_time_stamp;
-      RCLCPP_WARN(get_logger(), "%s: detected clock warp, reset EMA", __func__);
-    }
-  }
-  return stamp;
-}
-
 // 開始角度位置移動までのオフセット計算
 rclcpp::Duration UrgNode2::get_angular_time_offset(void)
 {
-  // スキャンデータのタイムスタンプは真後ろのものなので開始角度位置までの時間をオフセットとして加算する必要がある
-  double circle_fraction = 0.0;
+  // スキャン範囲の設定前はスキャン可能範囲の先頭を開始角度位置とする
+  int first_step = first_step_;
   if (first_step_ == 0 && last_step_ == 0) {
-    int min_step, max_step;
-    urg_step_min_max(&urg_, &min_step, &max_step);
-    circle_fraction = (urg_step2rad(&urg_, min_step) + M_PI) / (2.0 * M_PI);
-  } else {
-    circle_fraction = (urg_step2rad(&urg_, first_step_) + M_PI) / (2.0 * M_PI);
+    int max_step;
+    urg_step_min_max(&urg_, &first_step, &max_step);
   }
-  return rclcpp::Duration::from_seconds(circle_fraction * scan_period_);
+  return rclcpp::Duration::from_seconds(
+    urg_node2::get_angular_time_offset(urg_, first_step, scan_period_));
 }
 
 }
@@ -0,0 +1,174 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "urg_node2/urg_point_cloud.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#if defined(__SSE2__)
+#define URG_NODE2_CLOUD_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define URG_NODE2_CLOUD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace urg_node2
+{
+
+UrgPointCloudConverter::UrgPointCloudConverter()
+: use_intensity_(false),
+  use_time_(false),
+  time_increment_(0.0f),
+  stride_(3)
+{
+}
+
+void UrgPointCloudConverter::set_angles(double angle_min, double angle_increment, int max_points)
+{
+  cos_table_.resize(max_points);
+  sin_table_.resize(max_points);
+  for (int i = 0; i < max_points; ++i) {
+    double angle = angle_min + i * angle_increment;
+    cos_table_[i] = static_cast<float>(std::cos(angle));
+    sin_table_[i] = static_cast<float>(std::sin(angle));
+  }
+}
+
+void UrgPointCloudConverter::set_fields(bool use_intensity, bool use_time, double time_increment)
+{
+  use_intensity_ = use_intensity;
+  use_time_ = use_time;
+  time_increment_ = static_cast<float>(time_increment);
+  stride_ = 3 + (use_intensity_ ? 1 : 0) + (use_time_ ? 1 : 0);
+}
+
+void UrgPointCloudConverter::initialize(sensor_msgs::msg::PointCloud2 & msg) const
+{
+  std::vector<std::string> names = {"x", "y", "z"};
+  if (use_intensity_) {
+    names.push_back("intensity");
+  }
+  if (use_time_) {
+    names.push_back("time");
+  }
+
+  msg.fields.clear();
+  for (size_t i = 0; i < names.size(); ++i) {
+    sensor_msgs::msg::PointField field;
+    field.name = names[i];
+    field.offset = static_cast<uint32_t>(i * sizeof(float));
+    field.datatype = sensor_msgs::msg::PointField::FLOAT32;
+    field.count = 1;
+    msg.fields.push_back(field);
+  }
+
+  msg.height = 1;
+  msg.width = 0;
+  msg.is_bigendian = false;
+  msg.point_step = static_cast<uint32_t>(stride_ * sizeof(float));
+  msg.row_step = 0;
+  msg.is_dense = false;
+  msg.data.reserve(cos_table_.size() * msg.point_step);
+}
+
+int UrgPointCloudConverter::convert(
+  const float ranges[], const float intensities[], int num_points,
+  sensor_msgs::msg::PointCloud2 & msg) const
+{
+  const int n = std::min(num_points, static_cast<int>(cos_table_.size()));
+  msg.height = 1;
+  msg.width = static_cast<uint32_t>(n);
+  msg.row_step = msg.width * msg.point_step;
+  msg.data.resize(msg.row_step);
+
+  const float * cos_table = cos_table_.data();
+  const float * sin_table = sin_table_.data();
+  float * points = reinterpret_cast<float *>(msg.data.data());
+  int i = 0;
+
+#if defined(URG_NODE2_CLOUD_SSE2)
+  // 4点ずつ(x, y, z, 4番目)を転置して格納する
+  // 3要素の点は次の点の先頭に上書きしながら格納するため、最後の4点はSIMDで扱わない
+  const bool use_fourth = use_intensity_ || use_time_;
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 time_increment = _mm_set1_ps(time_increment_);
+  __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+  const __m128 four = _mm_set1_ps(4.0f);
+  const int simd_end = (stride_ == 3) ? n - 4 : n - 3;
+  for (; i < simd_end; i += 4) {
+    __m128 r = _mm_loadu_ps(&ranges[i]);
+    __m128 x = _mm_mul_ps(r, _mm_loadu_ps(&cos_table[i]));
+    __m128 y = _mm_mul_ps(r, _mm_loadu_ps(&sin_table[i]));
+    __m128 z = zero;
+    __m128 t = _mm_mul_ps(index, time_increment);
+    __m128 w = !use_fourth ? zero : (use_intensity_ ? _mm_loadu_ps(&intensities[i]) : t);
+    index = _mm_add_ps(index, four);
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    float * p = &points[stride_ * i];
+    _mm_storeu_ps(p, x);
+    _mm_storeu_ps(p + stride_, y);
+    _mm_storeu_ps(p + 2 * stride_, z);
+    _mm_storeu_ps(p + 3 * stride_, w);
+    if (stride_ == 5) {
+      alignas(16) float times[4];
+      _mm_store_ps(times, t);
+      p[4] = times[0];
+      p[9] = times[1];
+      p[14] = times[2];
+      p[19] = times[3];
+    }
+  }
+#elif defined(URG_NODE2_CLOUD_NEON)
+  // 3要素, 4要素の点はインターリーブして格納する
+  if (stride_ <= 4) {
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    float32x4_t index = {0.0f, 1.0f, 2.0f, 3.0f};
+    for (; i + 4 <= n; i += 4) {
+      float32x4_t r = vld1q_f32(&ranges[i]);
+      float32x4_t x = vmulq_f32(r, vld1q_f32(&cos_table[i]));
+      float32x4_t y = vmulq_f32(r, vld1q_f32(&sin_table[i]));
+      if (stride_ == 3) {
+        float32x4x3_t xyz = {{x, y, zero}};
+        vst3q_f32(&points[3 * i], xyz);
+      } else {
+        float32x4_t w = use_intensity_ ?
+          vld1q_f32(&intensities[i]) : vmulq_n_f32(index, time_increment_);
+        float32x4x4_t xyzw = {{x, y, zero, w}};
+        vst4q_f32(&points[4 * i], xyzw);
+      }
+      index = vaddq_f32(index, vdupq_n_f32(4.0f));
+    }
+  }
+#endif
+
+  for (; i < n; ++i) {
+    float * p = &points[stride_ * i];
+    p[0] = ranges[i] * cos_table[i];
+    p[1] = ranges[i] * sin_table[i];
+    p[2] = 0.0f;
+    int field = 3;
+    if (use_intensity_) {
+      p[field++] = intensities[i];
+    }
+    if (use_time_) {
+      p[field] = static_cast<float>(i) * time_increment_;
+    }
+  }
+  return n;
+}
+
+}  // namespace urg_node2
@@ -0,0 +1,215 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "urg_node2/urg_scan_builder.hpp"
+
+#include <chrono>
+#include <utility>
+
+namespace urg_node2
+{
+
+UrgScanBuilder::UrgScanBuilder(const rclcpp::Logger & logger)
+: logger_(logger),
+  synchronize_time_(false),
+  time_correction_(std::chrono::nanoseconds(0)),
+  latency_(std::chrono::nanoseconds(0)),
+  receiving_scan_(nullptr),
+  receiving_time_stamp_(0),
+  is_receiving_scan_stamped_(false)
+{
+}
+
+void UrgScanBuilder::configure(
+  urg_t & urg, const UrgScanConfig & config,
+  SectorCallback on_sector)
+{
+  config_ = config;
+  on_sector_ = std::move(on_sector);
+  time_correction_ = latency_ + rclcpp::Duration::from_seconds(config_.angular_time_offset);
+
+  // フィルタの設定（間引き後のステップ間の角度はdecimation倍になる）
+  filter_.configure(config_.filter, config_.angle_increment, config_.use_intensity);
+
+  // 部分スキャン出力の設定
+  if (config_.sector_size > 0 && on_sector_) {
+    int sector_size = config_.sector_size;
+    bool use_intensity = config_.use_intensity;
+    std::string frame_id = config_.frame_id;
+    sector_pool_.set_initializer(
+      [sector_size, use_intensity, frame_id](LaserScan & msg) {
+        msg.header.frame_id = frame_id;
+        msg.ranges.reserve(sector_size);
+        if (use_intensity) {
+          msg.intensities.reserve(sector_size);
+        }
+      });
+    urg_set_sector_handler(&urg, &UrgScanBuilder::sector_received, config_.sector_size, this);
+  } else {
+    urg_set_sector_handler(&urg, nullptr, 0, nullptr);
+  }
+}
+
+void UrgScanBuilder::set_time_correction(
+  bool synchronize_time,
+  const rclcpp::Duration & latency)
+{
+  synchronize_time_ = synchronize_time;
+  latency_ = latency;
+  time_correction_ = latency_ + rclcpp::Duration::from_seconds(config_.angular_time_offset);
+}
+
+void UrgScanBuilder::reset_clock()
+{
+  clock_synchronizer_.reset();
+}
+
+// スキャンデータ取得
+bool UrgScanBuilder::create_scan_message(urg_t & urg, LaserScan & msg)
+{
+  msg.header.frame_id = config_.frame_id;
+  msg.angle_min = config_.angle_min;
+  msg.angle_max = config_.angle_max;
+  msg.angle_increment = config_.angle_increment;
+  msg.scan_time = config_.scan_time;
+  msg.time_increment = config_.time_increment;
+  msg.range_min = config_.range_min;
+  msg.range_max = config_.range_max;
+
+  // rclcpp::Clockの生成はメモリ確保を伴うため、std::chronoからシステム時刻を取得する
+  int num_beams = 0;
+  rclcpp::Time system_time_stamp(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count(), RCL_SYSTEM_TIME);
+
+  // 部分スキャン出力のため受信中のスキャンとして登録
+  receiving_scan_ = &msg;
+  receiving_time_stamp_ = 0;
+  receiving_system_time_stamp_ = system_time_stamp;
+  is_receiving_scan_stamped_ = false;
+
+  // 受信データを[m]単位（0はNaN）でメッセージへ直接格納する
+  msg.ranges.resize(config_.max_beams);
+  if (config_.use_intensity) {
+    msg.intensities.resize(config_.max_beams);
+    num_beams = urg_get_ranges_intensity_f32(
+      &urg, &msg.ranges[0], &msg.intensities[0], &receiving_time_stamp_);
+  } else {
+    num_beams = urg_get_ranges_f32(&urg, &msg.ranges[0], &receiving_time_stamp_);
+  }
+  receiving_scan_ = nullptr;
+  if (num_beams <= 0) {
+    return false;
+  }
+
+  // タイムスタンプ設定（部分スキャン出力時は設定済み）
+  if (!is_receiving_scan_stamped_) {
+    msg.header.stamp = get_stamp(receiving_time_stamp_, system_time_stamp);
+  }
+
+  // フィルタの適用（部分スキャン出力は受信中に配信済みのため対象外）
+  if (filter_.is_enabled()) {
+    num_beams = filter_.apply(
+      &msg.ranges[0], config_.use_intensity ? &msg.intensities[0] : nullptr, num_beams);
+    int decimation = filter_.decimation();
+    if (decimation > 1) {
+      msg.angle_increment = decimation * config_.angle_increment;
+      msg.time_increment = decimation * config_.time_increment;
+      msg.angle_max = msg.angle_min + (num_beams - 1) * msg.angle_increment;
+    }
+  }
+
+  // 受信したデータ数に合わせる
+  msg.ranges.resize(num_beams);
+  if (config_.use_intensity) {
+    msg.intensities.resize(num_beams);
+  }
+
+  return true;
+}
+
+// スキャンデータのタイムスタンプ計算
+rclcpp::Time UrgScanBuilder::get_stamp(long time_stamp, const rclcpp::Time & system_time_stamp)
+{
+  rclcpp::Time stamp = system_time_stamp;
+  if (synchronize_time_) {
+    int reset_count = clock_synchronizer_.reset_count();
+    int64_t synchronized = clock_synchronizer_.update(
+      time_stamp, system_time_stamp.nanoseconds());
+    if (clock_synchronizer_.reset_count() != reset_count) {
+      RCLCPP_WARN(logger_, "%s: detected clock warp, reset clock estimation", __func__);
+    }
+    stamp = rclcpp::Time(synchronized, system_time_stamp.get_clock_type());
+  }
+  return stamp + time_correction_;
+}
+
+int UrgScanBuilder::decimation() const
+{
+  return filter_.decimation();
+}
+
+const UrgClockSynchronizer & UrgScanBuilder::clock_synchronizer() const
+{
+  return clock_synchronizer_;
+}
+
+// 部分スキャン受信時のコールバック
+void UrgScanBuilder::sector_received(int first_index, int steps, void * context)
+{
+  UrgScanBuilder * builder = static_cast<UrgScanBuilder *>(context);
+
+  // create_scan_message()以外（強度モード対応確認など）の受信では配信しない
+  if (builder->receiving_scan_ && builder->on_sector_) {
+    builder->publish_sector(first_index, steps);
+  }
+}
+
+// 部分スキャン配信
+void UrgScanBuilder::publish_sector(int first_index, int steps)
+{
+  LaserScan & scan = *receiving_scan_;
+
+  // 最初の部分スキャンでスキャン全体のタイムスタンプを確定する
+  if (!is_receiving_scan_stamped_) {
+    scan.header.stamp = get_stamp(receiving_time_stamp_, receiving_system_time_stamp_);
+    is_receiving_scan_stamped_ = true;
+  }
+
+  // 部分スキャンの先頭ステップの計測時刻と角度を設定
+  std::unique_ptr<LaserScan> sector = sector_pool_.acquire();
+  sector->header.frame_id = scan.header.frame_id;
+  sector->header.stamp = rclcpp::Time(scan.header.stamp) +
+    rclcpp::Duration::from_seconds(first_index * scan.time_increment);
+  sector->angle_min = scan.angle_min + first_index * scan.angle_increment;
+  sector->angle_max = sector->angle_min + (steps - 1) * scan.angle_increment;
+  sector->angle_increment = scan.angle_increment;
+  sector->time_increment = scan.time_increment;
+  sector->scan_time = scan.scan_time;
+  sector->range_min = scan.range_min;
+  sector->range_max = scan.range_max;
+
+  sector->ranges.assign(
+    scan.ranges.begin() + first_index,
+    scan.ranges.begin() + first_index + steps);
+  if (config_.use_intensity) {
+    sector->intensities.assign(
+      scan.intensities.begin() + first_index,
+      scan.intensities.begin() + first_index + steps);
+  }
+
+  on_sector_(sector_pool_, std::move(sector));
+}
+
+}  // namespace urg_node2
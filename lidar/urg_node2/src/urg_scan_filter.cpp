@@ -0,0 +1,295 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "urg_node2/urg_scan_filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__)
+#define URG_NODE2_FILTER_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define URG_NODE2_FILTER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace urg_node2
+{
+
+namespace
+{
+/** 間引きの方法 */
+enum Decimation
+{
+  kNoDecimation = 0,
+  kMinDecimation,
+  kMedianDecimation,
+};
+
+using Parameters = UrgScanFilter::Parameters;
+using Kernel = int (*)(const Parameters &, float[], float[], int);
+
+/**
+ * @brief 影（ベール）の判定
+ * @details 隣接ステップの点から見た段差が、rangeの点の視線となす角がshadow_angleより小さい場合は影とする
+ * 遠い方の点のみを影とするため、range > neighborの場合のみ判定する（NaNは影としない）
+ */
+inline bool is_shadow(const Parameters & p, float range, float neighbor)
+{
+  return range > neighbor &&
+         neighbor * p.sin_increment < p.shadow_tan * (range - neighbor * p.cos_increment);
+}
+
+/**
+ * @brief ステップごとの判定のみの場合のSIMD処理
+ * @return 処理したステップ数
+ */
+template<bool kClip, bool kThreshold, bool kIntensities>
+int filter_elementwise(const Parameters & p, float ranges[], float intensities[], int num_beams)
+{
+  int i = 0;
+#if defined(URG_NODE2_FILTER_SSE2)
+  const __m128 nan = _mm_set1_ps(std::numeric_limits<float>::quiet_NaN());
+  const __m128 range_min = _mm_set1_ps(p.range_min);
+  const __m128 range_max = _mm_set1_ps(p.range_max);
+  const __m128 intensity_min = _mm_set1_ps(p.intensity_min);
+  for (; i + 4 <= num_beams; i += 4) {
+    __m128 r = _mm_loadu_ps(&ranges[i]);
+    // NaNとの比較は偽になる
+    __m128 valid = kClip ?
+      _mm_and_ps(_mm_cmpge_ps(r, range_min), _mm_cmple_ps(r, range_max)) :
+      _mm_cmpord_ps(r, r);
+    if (kThreshold) {
+      valid = _mm_and_ps(valid, _mm_cmpge_ps(_mm_loadu_ps(&intensities[i]), intensity_min));
+    }
+    _mm_storeu_ps(&ranges[i], _mm_or_ps(_mm_and_ps(valid, r), _mm_andnot_ps(valid, nan)));
+    if (kIntensities) {
+      _mm_storeu_ps(&intensities[i], _mm_and_ps(valid, _mm_loadu_ps(&intensities[i])));
+    }
+  }
+#elif defined(URG_NODE2_FILTER_NEON)
+  const float32x4_t nan = vdupq_n_f32(std::numeric_limits<float>::quiet_NaN());
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  for (; i + 4 <= num_beams; i += 4) {
+    float32x4_t r = vld1q_f32(&ranges[i]);
+    uint32x4_t valid = kClip ?
+      vandq_u32(vcgeq_f32(r, vdupq_n_f32(p.range_min)), vcleq_f32(r, vdupq_n_f32(p.range_max))) :
+      vceqq_f32(r, r);
+    if (kThreshold) {
+      valid = vandq_u32(valid, vcgeq_f32(vld1q_f32(&intensities[i]), vdupq_n_f32(p.intensity_min)));
+    }
+    vst1q_f32(&ranges[i], vbslq_f32(valid, r, nan));
+    if (kIntensities) {
+      vst1q_f32(&intensities[i], vbslq_f32(valid, vld1q_f32(&intensities[i]), zero));
+    }
+  }
+#else
+  (void)p;
+  (void)ranges;
+  (void)intensities;
+  (void)num_beams;
+#endif
+  return i;
+}
+
+/**
+ * @brief 処理の組み合わせごとに特殊化したフィルタ
+ * @details 各ステップを1回だけ読み、判定と間引きをまとめて行い、同じ配列の先頭から書き込む
+ * 書き込み位置は読み込み位置を超えないため、影の判定に使う次のステップは変更前の値を読める
+ */
+template<bool kClip, bool kThreshold, bool kShadow, int kDecimation, bool kIntensities>
+int filter_kernel(const Parameters & p, float ranges[], float intensities[], int num_beams)
+{
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  int i = 0;
+  if (!kShadow && kDecimation == kNoDecimation) {
+    i = filter_elementwise<kClip, kThreshold, kIntensities>(p, ranges, intensities, num_beams);
+  }
+
+  // 間引き中のブロック（有効なステップのみ）
+  float block_ranges[UrgScanFilter::kMaxDecimation] = {};
+  float block_intensities[UrgScanFilter::kMaxDecimation] = {};
+  int block_size = 0;
+  int valid_count = 0;
+  int output = 0;
+  float previous = nan;
+
+  for (; i < num_beams; ++i) {
+    float range = ranges[i];
+    float intensity = kIntensities ? intensities[i] : 0.0f;
+    bool valid = (range == range);
+
+    if (kShadow) {
+      float next = (i + 1 < num_beams) ? ranges[i + 1] : nan;
+      if (is_shadow(p, range, previous) || is_shadow(p, range, next)) {
+        valid = false;
+      }
+      previous = range;
+    }
+    if (kClip) {
+      valid = valid && range >= p.range_min && range <= p.range_max;
+    }
+    if (kThreshold) {
+      valid = valid && intensity >= p.intensity_min;
+    }
+
+    if (kDecimation == kNoDecimation) {
+      ranges[i] = valid ? range : nan;
+      if (kIntensities) {
+        intensities[i] = valid ? intensity : 0.0f;
+      }
+      continue;
+    }
+
+    if (valid) {
+      if (kDecimation == kMinDecimation) {
+        if (valid_count == 0 || range < block_ranges[0]) {
+          block_ranges[0] = range;
+          block_intensities[0] = intensity;
+        }
+      } else {
+        // 挿入ソート（ブロックは小さい）
+        int j = valid_count;
+        while (j > 0 && block_ranges[j - 1] > range) {
+          block_ranges[j] = block_ranges[j - 1];
+          block_intensities[j] = block_intensities[j - 1];
+          --j;
+        }
+        block_ranges[j] = range;
+        block_intensities[j] = intensity;
+      }
+      ++valid_count;
+    }
+
+    if (++block_size == p.decimation || i == num_beams - 1) {
+      int selected = (kDecimation == kMinDecimation) ? 0 : (valid_count - 1) / 2;
+      ranges[output] = (valid_count > 0) ? block_ranges[selected] : nan;
+      if (kIntensities) {
+        intensities[output] = (valid_count > 0) ? block_intensities[selected] : 0.0f;
+      }
+      ++output;
+      block_size = 0;
+      valid_count = 0;
+    }
+  }
+
+  return (kDecimation == kNoDecimation) ? num_beams : output;
+}
+
+/** 強度の有無ごとの特殊化 */
+template<bool kClip, bool kThreshold, bool kShadow, int kDecimation>
+Kernel select_kernel(bool use_intensities)
+{
+  if (use_intensities) {
+    return &filter_kernel<kClip, kThreshold, kShadow, kDecimation, true>;
+  }
+  // 強度がない場合は閾値を使わない
+  return &filter_kernel<kClip, false, kShadow, kDecimation, false>;
+}
+
+template<bool kClip, bool kThreshold, bool kShadow>
+Kernel select_kernel(int decimation_mode, bool use_intensities)
+{
+  switch (decimation_mode) {
+    case kMinDecimation:
+      return select_kernel<kClip, kThreshold, kShadow, kMinDecimation>(use_intensities);
+    case kMedianDecimation:
+      return select_kernel<kClip, kThreshold, kShadow, kMedianDecimation>(use_intensities);
+    default:
+      return select_kernel<kClip, kThreshold, kShadow, kNoDecimation>(use_intensities);
+  }
+}
+
+template<bool kClip, bool kThreshold>
+Kernel select_kernel(bool use_shadow, int decimation_mode, bool use_intensities)
+{
+  return use_shadow ?
+         select_kernel<kClip, kThreshold, true>(decimation_mode, use_intensities) :
+         select_kernel<kClip, kThreshold, false>(decimation_mode, use_intensities);
+}
+
+template<bool kClip>
+Kernel select_kernel(
+  bool use_threshold, bool use_shadow, int decimation_mode,
+  bool use_intensities)
+{
+  return use_threshold ?
+         select_kernel<kClip, true>(use_shadow, decimation_mode, use_intensities) :
+         select_kernel<kClip, false>(use_shadow, decimation_mode, use_intensities);
+}
+}  // namespace
+
+constexpr int UrgScanFilter::kMaxDecimation;
+
+UrgScanFilter::UrgScanFilter()
+: kernel_(nullptr)
+{
+  configure(UrgScanFilterConfig(), 0.0, false);
+}
+
+void UrgScanFilter::configure(
+  const UrgScanFilterConfig & config, double angle_increment,
+  bool use_intensity)
+{
+  bool use_clip = (config.range_min > 0.0) || (config.range_max > 0.0);
+  bool use_threshold = (config.intensity_min > 0.0);
+  bool use_shadow = (config.shadow_angle > 0.0);
+
+  parameters_.range_min = static_cast<float>(config.range_min);
+  parameters_.range_max = (config.range_max > 0.0) ?
+    static_cast<float>(config.range_max) : std::numeric_limits<float>::infinity();
+  parameters_.intensity_min = static_cast<float>(config.intensity_min);
+  parameters_.shadow_tan = static_cast<float>(std::tan(config.shadow_angle));
+  parameters_.sin_increment = static_cast<float>(std::sin(std::fabs(angle_increment)));
+  parameters_.cos_increment = static_cast<float>(std::cos(angle_increment));
+  parameters_.decimation = std::min(std::max(config.decimation, 1), kMaxDecimation);
+
+  int decimation_mode = kNoDecimation;
+  if (parameters_.decimation > 1) {
+    decimation_mode = config.median ? kMedianDecimation : kMinDecimation;
+  }
+
+  // スキャンごとに選択しないよう、ここで特殊化した処理を決める
+  if (!use_clip && !(use_threshold && use_intensity) && !use_shadow &&
+    decimation_mode == kNoDecimation)
+  {
+    kernel_ = nullptr;
+  } else if (use_clip) {
+    kernel_ = select_kernel<true>(use_threshold, use_shadow, decimation_mode, use_intensity);
+  } else {
+    kernel_ = select_kernel<false>(use_threshold, use_shadow, decimation_mode, use_intensity);
+  }
+}
+
+bool UrgScanFilter::is_enabled() const
+{
+  return kernel_ != nullptr;
+}
+
+int UrgScanFilter::decimation() const
+{
+  return parameters_.decimation;
+}
+
+int UrgScanFilter::apply(float ranges[], float intensities[], int num_beams) const
+{
+  if (kernel_ == nullptr || num_beams <= 0) {
+    return num_beams;
+  }
+  return kernel_(parameters_, ranges, intensities, num_beams);
+}
+
+}  // namespace urg_node2
@@ -0,0 +1,83 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "urg_node2/urg_sensor_setup.hpp"
+
+#include <cmath>
+#include <utility>
+
+#include "urg_utils.h"
+
+namespace urg_node2
+{
+
+UrgScanRange set_scan_range(
+  urg_t & urg, double angle_min, double angle_max, int cluster,
+  double scan_period)
+{
+  UrgScanRange range;
+
+  // 範囲チェック
+  angle_min = (angle_min < -M_PI) ? -M_PI : ((angle_min > M_PI) ? M_PI : angle_min);
+  angle_max = (angle_max < -M_PI) ? -M_PI : ((angle_max > M_PI) ? M_PI : angle_max);
+
+  // 指定範囲のステップ変換（範囲クリップ&丸め）
+  range.first_step = urg_rad2step(&urg, angle_min);
+  range.last_step = urg_rad2step(&urg, angle_max);
+
+  // 逆転してた場合入れ替え
+  if (range.last_step < range.first_step) {
+    std::swap(range.first_step, range.last_step);
+  }
+
+  // 変換後ステップが同値の場合は1ずらす
+  int min_step;
+  int max_step;
+  urg_step_min_max(&urg, &min_step, &max_step);
+  if (range.last_step == range.first_step) {
+    if (range.first_step == min_step) {
+      range.last_step = range.first_step + 1;
+    } else {
+      range.first_step = range.last_step - 1;
+    }
+  }
+
+  // スキャンデータ範囲の設定
+  urg_set_scanning_parameter(&urg, range.first_step, range.last_step, cluster);
+
+  // スキャントピック用のパラメータ設定
+  range.angle_min = urg_step2rad(&urg, range.first_step);
+  range.angle_max = urg_step2rad(&urg, range.last_step);
+  range.angle_increment = cluster * urg_step2rad(&urg, 1);
+  range.time_increment = cluster *
+    ((urg_step2rad(&urg, max_step) - urg_step2rad(&urg, min_step)) / (2.0 * M_PI)) *
+    scan_period / static_cast<double>(max_step - min_step);
+
+  long min_dis;
+  long max_dis;
+  urg_distance_min_max(&urg, &min_dis, &max_dis);
+  range.range_min = static_cast<double>(min_dis) / 1000.0;
+  range.range_max = static_cast<double>(max_dis) / 1000.0;
+
+  range.angular_time_offset = get_angular_time_offset(urg, range.first_step, scan_period);
+  return range;
+}
+
+double get_angular_time_offset(const urg_t & urg, int first_step, double scan_period)
+{
+  double circle_fraction = (urg_step2rad(&urg, first_step) + M_PI) / (2.0 * M_PI);
+  return circle_fraction * scan_period;
+}
+
+}  // namespace urg_node2
@@ -0,0 +1,51 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ALLOCATION_COUNTER_HPP_
+#define ALLOCATION_COUNTER_HPP_
+
+// replaces the global operator new/delete, include only from the file with main()
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// number of allocations while counting (only in the counting thread, e.g. not in a fake sensor)
+static thread_local bool is_counting = false;
+static std::atomic<int> allocation_count(0);
+
+void * operator new(std::size_t size)
+{
+  if (is_counting) {
+    ++allocation_count;
+  }
+  void * p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+// not inlined to avoid a false positive of -Wmismatched-new-delete
+__attribute__((noinline)) void operator delete(void * p) noexcept
+{
+  std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void * p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+#endif  // ALLOCATION_COUNTER_HPP_
@@ -0,0 +1,264 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FAKE_SCIP_SERVER_HPP_
+#define FAKE_SCIP_SERVER_HPP_
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+const char test_serial_id[] = "H0000001";
+const int test_front_index = 540;
+
+// SCIP checksum
+inline char checksum(const std::string & data)
+{
+  int sum = 0;
+  for (char ch : data) {
+    sum += ch;
+  }
+  return static_cast<char>((sum & 0x3f) + 0x30);
+}
+
+// SCIP encoding
+inline std::string encode(long value, int size)
+{
+  std::string data(size, '0');
+  for (int i = size - 1; i >= 0; --i) {
+    data[i] = static_cast<char>((value & 0x3f) + 0x30);
+    value >>= 6;
+  }
+  return data;
+}
+
+// a line with the checksum
+inline std::string line(const std::string & data)
+{
+  return data + checksum(data) + "\n";
+}
+
+// a parameter line of PP and VV ("NAME:value;" and the checksum of "NAME:value")
+inline std::string parameter(const std::string & data)
+{
+  return data + ";" + checksum(data) + "\n";
+}
+
+// distance [mm] of a step
+inline long test_distance(int step)
+{
+  return 100 + (step * 13) % 20000;
+}
+
+// TCP server of a fake sensor answering QT, PP, VV and MD
+class FakeScipServer
+{
+public:
+  FakeScipServer()
+  : client_(-1),
+    is_running_(true),
+    is_streaming_(false),
+    start_time_(std::chrono::steady_clock::now())
+  {
+    server_ = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(server_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    bind(server_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+    listen(server_, 1);
+    socklen_t size = sizeof(addr);
+    getsockname(server_, reinterpret_cast<struct sockaddr *>(&addr), &size);
+    port_ = ntohs(addr.sin_port);
+
+    thread_ = std::thread([this]() {run();});
+  }
+
+  ~FakeScipServer()
+  {
+    is_running_ = false;
+    thread_.join();
+    drop();
+    close(server_);
+  }
+
+  int port() const
+  {
+    return port_;
+  }
+
+  // number of the received commands (e.g. "PP")
+  int count(const std::string & command)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return counts_[command];
+  }
+
+  // keeps sending scans after MD with the infinite number of scans (until QT)
+  // otherwise only the first scan is sent
+  void set_streaming(bool is_streaming)
+  {
+    is_streaming_ = is_streaming;
+  }
+
+  // closes the connection as a rebooted sensor does
+  void drop()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (client_ >= 0) {
+      close(client_);
+      client_ = -1;
+    }
+  }
+
+private:
+  void run()
+  {
+    std::string received;
+    while (is_running_) {
+      int client;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        client = client_;
+      }
+      struct pollfd fd;
+      fd.fd = (client >= 0) ? client : server_;
+      fd.events = POLLIN;
+      if (client >= 0 && !scan_command_.empty()) {
+        fd.events |= POLLOUT;
+      }
+      if (poll(&fd, 1, 10) <= 0) {
+        continue;
+      }
+      if (client < 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        client_ = accept(server_, nullptr, nullptr);
+        received.clear();
+        scan_command_.clear();
+        continue;
+      }
+
+      if (fd.revents & POLLNVAL) {
+        // closed by drop()
+        continue;
+      }
+      if (!(fd.revents & (POLLIN | POLLHUP | POLLERR))) {
+        // the next scan while the client is not sending a command
+        if ((fd.revents & POLLOUT) && !scan_command_.empty()) {
+          std::string data = scan(scan_command_);
+          send(client, data.data(), data.size(), MSG_NOSIGNAL);
+        }
+        continue;
+      }
+
+      char buffer[256];
+      ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+      if (n <= 0) {
+        drop();
+        continue;
+      }
+      received.append(buffer, n);
+
+      size_t end;
+      while ((end = received.find('\n')) != std::string::npos) {
+        std::string command = received.substr(0, end);
+        received.erase(0, end + 1);
+        std::string response = respond(command);
+        if (!response.empty()) {
+          send(client, response.data(), response.size(), MSG_NOSIGNAL);
+        }
+      }
+    }
+  }
+
+  // a scan of the MD command with the time stamp of the elapsed time [msec]
+  std::string scan(const std::string & command)
+  {
+    int first = std::atoi(command.substr(2, 4).c_str());
+    int last = std::atoi(command.substr(6, 4).c_str());
+    std::string encoded;
+    for (int i = first; i <= last; ++i) {
+      encoded += encode(test_distance(i), 3);
+    }
+    long time_stamp = static_cast<long>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time_).count());
+    std::string data = command + "\n" + line("99") + line(encode(time_stamp & 0xffffff, 4));
+    for (size_t i = 0; i < encoded.size(); i += 64) {
+      data += line(encoded.substr(i, 64));
+    }
+    return data + "\n";
+  }
+
+  std::string respond(const std::string & command)
+  {
+    if (command.size() < 2) {
+      // empty lines are ignored
+      return std::string();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++counts_[command.substr(0, 2)];
+    }
+
+    std::string echoback = command + "\n";
+    if (command == "QT") {
+      scan_command_.clear();
+      return echoback + line("00") + "\n";
+    } else if (command == "PP") {
+      return echoback + line("00") +
+             parameter("MODL:UST-10LX") + parameter("DMIN:20") + parameter("DMAX:30000") +
+             parameter("ARES:1440") + parameter("AMIN:0") + parameter("AMAX:1080") +
+             parameter("AFRT:" + std::to_string(test_front_index)) + parameter("SCAN:2400") + "\n";
+    } else if (command == "VV") {
+      return echoback + line("00") +
+             parameter("VEND:Hokuyo Automatic Co., Ltd.") + parameter("PROD:UST-10LX") +
+             parameter("FIRM:1.0.0") + parameter("PROT:SCIP 2.0") +
+             parameter(std::string("SERI:") + test_serial_id) + "\n";
+    } else if (command.compare(0, 2, "MD") == 0 && command.size() == 15) {
+      // acknowledgement and the first scan
+      if (is_streaming_ && command.compare(13, 2, "00") == 0) {
+        scan_command_ = command;
+      }
+      return echoback + line("00") + "\n" + scan(command);
+    }
+    return echoback + line("0E") + "\n";
+  }
+
+  int server_;
+  int client_;
+  int port_;
+  std::atomic<bool> is_running_;
+  std::atomic<bool> is_streaming_;
+  std::chrono::steady_clock::time_point start_time_;
+  // MD command of the streamed scans (accessed only by the server thread)
+  std::string scan_command_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::map<std::string, int> counts_;
+};
+
+#endif  // FAKE_SCIP_SERVER_HPP_
@@ -0,0 +1,181 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "urg_node2/urg_clock_synchronizer.hpp"
+
+const int64_t scan_period_ns = 25000000;
+const int64_t min_delay_ns = 1000000;
+
+// sensor with a drifting clock and a network with queuing delays
+class FakeClock
+{
+public:
+  FakeClock(double drift_ppm, int64_t first_tick_msec)
+  : drift_ppm_(drift_ppm),
+    first_tick_msec_(first_tick_msec),
+    system_time_ns_(1700000000000000000LL),
+    random_(1),
+    delay_(1.0 / 2e6)
+  {
+  }
+
+  // the sensor restarts its clock from the time stamp
+  void reboot(int64_t tick_msec)
+  {
+    double sensor_msec = elapsed_ns_ * (1.0 - drift_ppm_ * 1e-6) / 1e6;
+    first_tick_msec_ = tick_msec - static_cast<int64_t>(std::floor(sensor_msec));
+  }
+
+  // time of the next scan
+  void advance(int64_t period_ns = scan_period_ns)
+  {
+    elapsed_ns_ += period_ns;
+  }
+
+  // time stamp of the sensor (24 bit, msec)
+  long time_stamp() const
+  {
+    double sensor_msec = elapsed_ns_ * (1.0 - drift_ppm_ * 1e-6) / 1e6;
+    return static_cast<long>(
+      (first_tick_msec_ + static_cast<int64_t>(std::floor(sensor_msec))) & 0xffffff);
+  }
+
+  // time when the scan is sent
+  int64_t send_time() const
+  {
+    return system_time_ns_ + elapsed_ns_;
+  }
+
+  // time when the scan is received (exponential queuing delay, 2 % of 30 ms outliers)
+  int64_t receive_time()
+  {
+    int64_t delay = min_delay_ns + static_cast<int64_t>(delay_(random_));
+    if (std::uniform_real_distribution<double>(0.0, 1.0)(random_) < 0.02) {
+      delay += 30000000;
+    }
+    return send_time() + delay;
+  }
+
+private:
+  double drift_ppm_;
+  int64_t first_tick_msec_;
+  int64_t system_time_ns_;
+  int64_t elapsed_ns_ = 0;
+  std::mt19937 random_;
+  std::exponential_distribution<double> delay_;
+};
+
+// the synchronized time is the send time with the minimum delay
+TEST(ClockSynchronizerTest, DriftAndQueuingDelay)
+{
+  FakeClock clock(50.0, 1000);
+  urg_node2::UrgClockSynchronizer synchronizer;
+
+  double max_error = 0.0;
+  for (int i = 0; i < 40 * 60; ++i) {
+    int64_t stamp = synchronizer.update(clock.time_stamp(), clock.receive_time());
+    if (i >= 40 * 10) {
+      // the time stamp of the sensor is truncated to msec
+      double error = std::fabs(static_cast<double>(stamp - clock.send_time() - min_delay_ns));
+      max_error = std::max(max_error, error);
+    }
+    clock.advance();
+  }
+  EXPECT_LT(max_error, 1.5e6);
+  EXPECT_NEAR(synchronizer.drift_ppm(), 50.0, 10.0);
+  EXPECT_GT(synchronizer.jitter(), 0.0);
+  EXPECT_LT(synchronizer.jitter(), 0.01);
+  EXPECT_EQ(synchronizer.reset_count(), 0);
+}
+
+// the first stamp is the receive time
+TEST(ClockSynchronizerTest, FirstStamp)
+{
+  FakeClock clock(0.0, 0);
+  urg_node2::UrgClockSynchronizer synchronizer;
+
+  int64_t receive_time = clock.receive_time();
+  EXPECT_EQ(synchronizer.update(clock.time_stamp(), receive_time), receive_time);
+}
+
+// the 24 bit time stamp wraps around without resetting the estimation
+TEST(ClockSynchronizerTest, WrapAround)
+{
+  FakeClock clock(0.0, 0xffffff - 5000);
+  urg_node2::UrgClockSynchronizer synchronizer;
+
+  int64_t last_stamp = 0;
+  for (int i = 0; i < 40 * 20; ++i) {
+    int64_t stamp = synchronizer.update(clock.time_stamp(), clock.receive_time());
+    if (i > 40) {
+      EXPECT_NEAR(stamp - last_stamp, scan_period_ns, 1.5e6) << i;
+    }
+    last_stamp = stamp;
+    clock.advance();
+  }
+  EXPECT_EQ(synchronizer.reset_count(), 0);
+}
+
+// a gap longer than the period of the time stamp (e.g. reconnection) restarts the estimation
+TEST(ClockSynchronizerTest, LongGap)
+{
+  FakeClock clock(0.0, 0);
+  urg_node2::UrgClockSynchronizer synchronizer;
+
+  for (int i = 0; i < 40 * 10; ++i) {
+    synchronizer.update(clock.time_stamp(), clock.receive_time());
+    clock.advance();
+  }
+  // 5 hours (the time stamp wraps every 4.66 hours)
+  clock.advance(5LL * 3600 * 1000000000);
+  for (int i = 0; i < 40 * 2; ++i) {
+    int64_t stamp = synchronizer.update(clock.time_stamp(), clock.receive_time());
+    double error = static_cast<double>(stamp - clock.send_time() - min_delay_ns);
+    EXPECT_NEAR(error, 0.0, (i < 40) ? 0.1e9 : 1.5e6) << i;
+    clock.advance();
+  }
+  EXPECT_EQ(synchronizer.reset_count(), 0);
+}
+
+// the sensor clock jumps back (e.g. the sensor reboots)
+TEST(ClockSynchronizerTest, ClockJump)
+{
+  FakeClock clock(0.0, 0);
+  urg_node2::UrgClockSynchronizer synchronizer;
+
+  for (int i = 0; i < 40 * 10; ++i) {
+    synchronizer.update(clock.time_stamp(), clock.receive_time());
+    clock.advance();
+  }
+  clock.reboot(100);
+  for (int i = 0; i < 40 * 10; ++i) {
+    int64_t stamp = synchronizer.update(clock.time_stamp(), clock.receive_time());
+    double error = static_cast<double>(stamp - clock.send_time() - min_delay_ns);
+    EXPECT_NEAR(error, 0.0, (i < 40) ? 0.1e9 : 1.5e6);
+    clock.advance();
+  }
+  EXPECT_EQ(synchronizer.reset_count(), 1);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
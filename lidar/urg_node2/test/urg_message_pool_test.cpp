@@ -0,0 +1,256 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "allocation_counter.hpp"
+#include "fake_scip_server.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/laser_scan.hpp"
+#include "urg_node2/urg_message_pool.hpp"
+#include "urg_node2/urg_scan_builder.hpp"
+#include "urg_sensor.h"
+#include "urg_utils.h"
+
+using LaserScan = sensor_msgs::msg::LaserScan;
+
+const int test_first_step = -540;
+const int test_last_step = 540;
+const int test_steps = test_last_step - test_first_step + 1;
+const char test_frame_id[] = "laser_with_a_long_frame_name";
+const double test_time_increment = 0.025 / 1440;
+const double test_angular_time_offset = 0.003125;
+const double test_latency = 0.01;
+
+// publisher of UrgNode2 (publish_pooled_message() uses both overloads)
+struct FakePublisher
+{
+  // inter-process publishing (the message is serialized)
+  void publish(const LaserScan & msg)
+  {
+    ++count;
+    ranges = msg.ranges.size();
+  }
+
+  // intra-process publishing (the ownership is passed to the subscriber)
+  void publish(std::unique_ptr<LaserScan> msg)
+  {
+    ++count;
+    ranges = msg->ranges.size();
+    owned.push_back(std::move(msg));
+  }
+
+  int count = 0;
+  size_t ranges = 0;
+  std::vector<std::unique_ptr<LaserScan>> owned;
+};
+
+class MessagePoolTest : public ::testing::Test
+{
+protected:
+  MessagePoolTest()
+  : builder_(rclcpp::get_logger("urg_message_pool_test"))
+  {
+  }
+
+  void SetUp() override
+  {
+    server_.set_streaming(true);
+    ASSERT_EQ(urg_open(&urg_, URG_ETHERNET, "127.0.0.1", server_.port()), 0);
+    ASSERT_EQ(urg_set_scanning_parameter(&urg_, test_first_step, test_last_step, 1), 0);
+    max_beams_ = urg_max_data_size(&urg_);
+    pool_.set_initializer(
+      [this](LaserScan & msg) {
+        msg.header.frame_id = test_frame_id;
+        msg.ranges.reserve(max_beams_);
+      });
+  }
+
+  void TearDown() override
+  {
+    urg_stop_measurement(&urg_);
+    urg_close(&urg_);
+  }
+
+  // configures the builder and starts the measurement as UrgNode2::scan_thread() does
+  void start(int sector_size, bool use_intra_process)
+  {
+    // the scanning range of the fake sensor (UST-10LX)
+    urg_node2::UrgScanConfig config;
+    config.frame_id = test_frame_id;
+    config.max_beams = max_beams_;
+    config.angle_min = -0.75 * M_PI;
+    config.angle_max = 0.75 * M_PI;
+    config.angle_increment = M_PI / 720;
+    config.time_increment = test_time_increment;
+    config.scan_time = 0.025;
+    config.range_min = 0.02;
+    config.range_max = 30.0;
+    config.angular_time_offset = test_angular_time_offset;
+    config.sector_size = sector_size;
+    config.filter.range_min = 0.05;
+    builder_.configure(
+      urg_, config,
+      [this, use_intra_process](
+        urg_node2::UrgMessagePool<LaserScan> & pool, std::unique_ptr<LaserScan> sector) {
+        urg_node2::publish_pooled_message(
+          sector_publisher_, pool, std::move(sector), use_intra_process);
+      });
+    builder_.set_time_correction(true, rclcpp::Duration::from_seconds(test_latency));
+    ASSERT_EQ(urg_start_measurement(&urg_, URG_DISTANCE, URG_SCAN_INFINITY, 0, 0), 0);
+  }
+
+  // the pooled path of UrgNode2::publish_scan()
+  bool publish_scan(bool use_intra_process)
+  {
+    std::unique_ptr<LaserScan> msg = pool_.acquire();
+    if (!builder_.create_scan_message(urg_, *msg)) {
+      pool_.release(std::move(msg));
+      return false;
+    }
+    urg_node2::publish_pooled_message(scan_publisher_, pool_, std::move(msg), use_intra_process);
+    return true;
+  }
+
+  FakeScipServer server_;
+  urg_t urg_;
+  int max_beams_ = 0;
+  urg_node2::UrgScanBuilder builder_;
+  urg_node2::UrgMessagePool<LaserScan> pool_;
+  FakePublisher scan_publisher_;
+  FakePublisher sector_publisher_;
+};
+
+// no allocation per scan when the published messages are returned (inter-process publishing)
+TEST_F(MessagePoolTest, NoAllocationPerScan)
+{
+  start(256, false);
+
+  // warm up the pools and the clock synchronizer
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(publish_scan(false));
+  }
+
+  allocation_count = 0;
+  is_counting = true;
+  int published = 0;
+  for (int i = 0; i < 1000; ++i) {
+    if (!publish_scan(false)) {
+      break;
+    }
+    ++published;
+  }
+  is_counting = false;
+
+  EXPECT_EQ(published, 1000);
+  EXPECT_EQ(allocation_count, 0);
+  EXPECT_EQ(pool_.size(), 1u);
+  EXPECT_EQ(scan_publisher_.count, 1100);
+  EXPECT_EQ(scan_publisher_.ranges, static_cast<size_t>(test_steps));
+  // 1081 steps are sent in 5 sectors
+  EXPECT_EQ(sector_publisher_.count, 1100 * 5);
+
+  std::unique_ptr<LaserScan> msg = pool_.acquire();
+  ASSERT_EQ(msg->ranges.size(), static_cast<size_t>(test_steps));
+  EXPECT_FLOAT_EQ(msg->ranges[1], test_distance(1) / 1000.0f);
+  EXPECT_EQ(msg->header.frame_id, test_frame_id);
+}
+
+// the time stamp is the system time at the start of receiving with the corrections
+TEST_F(MessagePoolTest, Stamp)
+{
+  start(0, true);
+  builder_.set_time_correction(false, rclcpp::Duration::from_seconds(test_latency));
+
+  for (int i = 0; i < 10; ++i) {
+    int64_t before = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+    ASSERT_TRUE(publish_scan(true));
+    int64_t after = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+
+    int64_t correction = static_cast<int64_t>((test_latency + test_angular_time_offset) * 1e9);
+    int64_t stamp = rclcpp::Time(scan_publisher_.owned.back()->header.stamp).nanoseconds();
+    EXPECT_GE(stamp, before + correction);
+    EXPECT_LE(stamp, after + correction);
+  }
+}
+
+// the sectors are published while receiving and cover the scan
+TEST_F(MessagePoolTest, Sectors)
+{
+  const int sector_size = 100;
+  start(sector_size, true);
+  ASSERT_TRUE(publish_scan(true));
+
+  ASSERT_EQ(scan_publisher_.owned.size(), 1u);
+  const LaserScan & scan = *scan_publisher_.owned[0];
+  const std::vector<std::unique_ptr<LaserScan>> & sectors = sector_publisher_.owned;
+  ASSERT_EQ(sectors.size(), static_cast<size_t>((test_steps + sector_size - 1) / sector_size));
+
+  int64_t scan_stamp = rclcpp::Time(scan.header.stamp).nanoseconds();
+  int first_index = 0;
+  for (const auto & sector : sectors) {
+    int steps = static_cast<int>(sector->ranges.size());
+    EXPECT_EQ(steps, std::min(sector_size, test_steps - first_index));
+    EXPECT_EQ(sector->header.frame_id, test_frame_id);
+    EXPECT_FLOAT_EQ(sector->angle_min, scan.angle_min + first_index * scan.angle_increment);
+    int64_t expected_stamp = scan_stamp + static_cast<int64_t>(first_index * test_time_increment * 1e9);
+    EXPECT_NEAR(rclcpp::Time(sector->header.stamp).nanoseconds(), expected_stamp, 1);
+    for (int i = 0; i < steps; ++i) {
+      EXPECT_EQ(sector->ranges[i], scan.ranges[first_index + i]);
+    }
+    first_index += steps;
+  }
+  EXPECT_EQ(first_index, test_steps);
+}
+
+// a message whose ownership is passed to the subscriber (intra-process publishing) is replaced
+TEST_F(MessagePoolTest, OwnershipTransfer)
+{
+  start(0, true);
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(publish_scan(true));
+  }
+  EXPECT_EQ(pool_.size(), 0u);
+  EXPECT_EQ(scan_publisher_.owned.size(), 10u);
+
+  // the new message is reserved by the initializer
+  std::unique_ptr<LaserScan> msg = pool_.acquire();
+  EXPECT_EQ(msg->header.frame_id, test_frame_id);
+  EXPECT_GE(msg->ranges.capacity(), static_cast<size_t>(test_steps));
+
+  // the pool holds up to its maximum size
+  for (int i = 0; i < 10; ++i) {
+    pool_.release(std::make_unique<LaserScan>());
+  }
+  EXPECT_EQ(pool_.size(), 4u);
+}
+
+int main(int argc, char ** argv)
+{
+  // writing to the closed connection must not terminate the test
+  std::signal(SIGPIPE, SIG_IGN);
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,141 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "allocation_counter.hpp"
+#include "urg_node2/urg_multiecho.hpp"
+#include "urg_sensor.h"
+
+const int test_steps = 1081;
+
+// received data of a multiecho scan (0 to 3 echoes per step)
+class MultiechoTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    distance_.assign(test_steps * URG_MAX_ECHO, 0);
+    intensity_.assign(test_steps * URG_MAX_ECHO, 0);
+    for (int i = 0; i < test_steps; ++i) {
+      int num_echoes = i % (URG_MAX_ECHO + 1);
+      for (int j = 0; j < num_echoes; ++j) {
+        distance_[URG_MAX_ECHO * i + j] = 1000 + i + 1000 * j;
+        // the second echo is the most intense one
+        intensity_[URG_MAX_ECHO * i + j] = static_cast<unsigned short>((j == 1) ? 3000 : 1000 + j);
+      }
+    }
+  }
+
+  std::vector<long> distance_;
+  std::vector<unsigned short> intensity_;
+};
+
+TEST_F(MultiechoTest, Echoes)
+{
+  sensor_msgs::msg::MultiEchoLaserScan msg;
+  urg_node2::reserve_multiecho(test_steps, true, msg);
+  urg_node2::set_multiecho_ranges(&distance_[0], &intensity_[0], test_steps, msg);
+
+  ASSERT_EQ(msg.ranges.size(), static_cast<size_t>(test_steps));
+  ASSERT_EQ(msg.intensities.size(), static_cast<size_t>(test_steps));
+  for (int i = 0; i < test_steps; ++i) {
+    size_t num_echoes = i % (URG_MAX_ECHO + 1);
+    ASSERT_EQ(msg.ranges[i].echoes.size(), num_echoes) << i;
+    ASSERT_EQ(msg.intensities[i].echoes.size(), num_echoes) << i;
+    for (size_t j = 0; j < num_echoes; ++j) {
+      EXPECT_FLOAT_EQ(msg.ranges[i].echoes[j], (1000 + i + 1000 * j) / 1000.0f);
+      EXPECT_FLOAT_EQ(msg.intensities[i].echoes[j], (j == 1) ? 3000.0f : 1000.0f + j);
+    }
+  }
+
+  // without intensity
+  sensor_msgs::msg::MultiEchoLaserScan range_msg;
+  urg_node2::set_multiecho_ranges(&distance_[0], nullptr, test_steps, range_msg);
+  EXPECT_EQ(range_msg.ranges.size(), static_cast<size_t>(test_steps));
+  EXPECT_TRUE(range_msg.intensities.empty());
+}
+
+TEST_F(MultiechoTest, FirstLastMostIntense)
+{
+  sensor_msgs::msg::LaserScan first;
+  sensor_msgs::msg::LaserScan last;
+  sensor_msgs::msg::LaserScan most_intense;
+  urg_node2::set_echo_ranges(
+    &distance_[0], &intensity_[0], test_steps, first, last, &most_intense);
+
+  ASSERT_EQ(first.ranges.size(), static_cast<size_t>(test_steps));
+  ASSERT_EQ(last.intensities.size(), static_cast<size_t>(test_steps));
+  ASSERT_EQ(most_intense.ranges.size(), static_cast<size_t>(test_steps));
+  for (int i = 0; i < test_steps; ++i) {
+    int num_echoes = i % (URG_MAX_ECHO + 1);
+    if (num_echoes == 0) {
+      EXPECT_TRUE(std::isnan(first.ranges[i]));
+      EXPECT_TRUE(std::isnan(last.ranges[i]));
+      EXPECT_TRUE(std::isnan(most_intense.ranges[i]));
+      EXPECT_EQ(first.intensities[i], 0.0f);
+      continue;
+    }
+    EXPECT_FLOAT_EQ(first.ranges[i], (1000 + i) / 1000.0f);
+    EXPECT_FLOAT_EQ(last.ranges[i], (1000 + i + 1000 * (num_echoes - 1)) / 1000.0f);
+    int most_index = (num_echoes > 1) ? 1 : 0;
+    EXPECT_FLOAT_EQ(most_intense.ranges[i], (1000 + i + 1000 * most_index) / 1000.0f);
+    EXPECT_FLOAT_EQ(most_intense.intensities[i], (most_index == 1) ? 3000.0f : 1000.0f);
+  }
+
+  // without intensity, the most intense scan is not stored
+  sensor_msgs::msg::LaserScan range_first;
+  sensor_msgs::msg::LaserScan range_last;
+  sensor_msgs::msg::LaserScan range_most_intense;
+  urg_node2::set_echo_ranges(
+    &distance_[0], nullptr, test_steps, range_first, range_last, &range_most_intense);
+  EXPECT_EQ(range_first.ranges.size(), static_cast<size_t>(test_steps));
+  EXPECT_TRUE(range_first.intensities.empty());
+  EXPECT_TRUE(range_most_intense.ranges.empty());
+}
+
+// no allocation per scan once the messages are reused
+TEST_F(MultiechoTest, NoAllocationPerScan)
+{
+  sensor_msgs::msg::MultiEchoLaserScan msg;
+  urg_node2::reserve_multiecho(test_steps, true, msg);
+  sensor_msgs::msg::LaserScan first;
+  sensor_msgs::msg::LaserScan last;
+  sensor_msgs::msg::LaserScan most_intense;
+  urg_node2::set_echo_ranges(
+    &distance_[0], &intensity_[0], test_steps, first, last, &most_intense);
+
+  allocation_count = 0;
+  is_counting = true;
+  for (int scan = 0; scan < 100; ++scan) {
+    // the number of echoes of each step changes between scans
+    distance_[URG_MAX_ECHO * (scan % test_steps)] += 1;
+    std::swap(distance_[0], distance_[URG_MAX_ECHO * 3 + 2]);
+    urg_node2::set_multiecho_ranges(&distance_[0], &intensity_[0], test_steps, msg);
+    urg_node2::set_echo_ranges(
+      &distance_[0], &intensity_[0], test_steps, first, last, &most_intense);
+  }
+  is_counting = false;
+
+  EXPECT_EQ(allocation_count, 0);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,367 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "urg_node2/urg_multiplexer.hpp"
+#include "urg_sensor.h"
+
+using namespace std::chrono_literals;
+
+const int test_steps = 1081;
+
+// SCIP checksum
+char checksum(const std::string & data)
+{
+  int sum = 0;
+  for (char ch : data) {
+    sum += ch;
+  }
+  return static_cast<char>((sum & 0x3f) + 0x30);
+}
+
+// SCIP encoding
+std::string encode(long value, int size)
+{
+  std::string data(size, '0');
+  for (int i = size - 1; i >= 0; --i) {
+    data[i] = static_cast<char>((value & 0x3f) + 0x30);
+    value >>= 6;
+  }
+  return data;
+}
+
+// distance [mm] of a step of a scan
+long test_distance(int scan, int step)
+{
+  return 100 + (scan * 7 + step * 13) % 20000;
+}
+
+// response to a MD command
+std::string create_response(int scan)
+{
+  std::string encoded;
+  for (int i = 0; i < test_steps; ++i) {
+    encoded += encode(test_distance(scan, i), 3);
+  }
+
+  std::string response = "MD0000108000000\n99b\n";
+  std::string time_stamp = encode(scan, 4);
+  response += time_stamp + checksum(time_stamp) + "\n";
+  for (size_t i = 0; i < encoded.size(); i += 64) {
+    std::string line = encoded.substr(i, 64);
+    response += line + checksum(line) + "\n";
+  }
+  return response + "\n";
+}
+
+// TCP server of a fake sensor
+class FakeSensor
+{
+public:
+  FakeSensor()
+  : client_(-1)
+  {
+    server_ = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    bind(server_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+    listen(server_, 1);
+    socklen_t size = sizeof(addr);
+    getsockname(server_, reinterpret_cast<struct sockaddr *>(&addr), &size);
+    port_ = ntohs(addr.sin_port);
+  }
+
+  ~FakeSensor()
+  {
+    disconnect();
+    close(server_);
+  }
+
+  // connects the client and accepts the connection
+  bool connect(urg_connection_t * connection)
+  {
+    if (connection_open(connection, URG_ETHERNET, "127.0.0.1", port_) < 0) {
+      return false;
+    }
+    client_ = accept(server_, nullptr, nullptr);
+    return client_ >= 0;
+  }
+
+  // sends the data split into chunks
+  void send_data(const std::string & data, size_t chunk_size)
+  {
+    for (size_t i = 0; i < data.size(); i += chunk_size) {
+      std::string chunk = data.substr(i, chunk_size);
+      ASSERT_EQ(send(client_, chunk.data(), chunk.size(), 0), static_cast<ssize_t>(chunk.size()));
+      if (chunk_size < data.size()) {
+        std::this_thread::sleep_for(100us);
+      }
+    }
+  }
+
+  void disconnect()
+  {
+    if (client_ >= 0) {
+      close(client_);
+      client_ = -1;
+    }
+  }
+
+private:
+  int server_;
+  int client_;
+  int port_;
+};
+
+// receives the scans of a sensor
+struct ScanReceiver
+{
+  std::atomic<int> count{0};
+  std::atomic<int> errors{0};
+  std::atomic<int> disconnected{0};
+  int next_scan = 0;
+  std::vector<float> ranges = std::vector<float>(test_steps);
+
+  urg_node2::UrgMultiplexer::ResponseCallback callback()
+  {
+    return [this](const std::vector<char> & response, urg_node2::UrgMultiplexer::Clock::time_point) {
+             long time_stamp = 0;
+             int n = urg_parse_ranges_f32(
+               response.data(), static_cast<int>(response.size()),
+               ranges.data(), nullptr, test_steps, 1, &time_stamp);
+             if (n == 0) {
+               return;
+             }
+             // the scans arrive in order and decode to the sent distances
+             bool is_valid = (n == test_steps) && (time_stamp == next_scan);
+             for (int i = 0; is_valid && i < n; ++i) {
+               is_valid = std::fabs(ranges[i] - test_distance(next_scan, i) / 1000.0) < 1e-6;
+             }
+             if (!is_valid) {
+               ++errors;
+             }
+             ++next_scan;
+             ++count;
+           };
+  }
+};
+
+// waits until the condition is satisfied
+template<typename Predicate>
+bool wait_for(Predicate predicate)
+{
+  for (int i = 0; i < 200; ++i) {
+    if (predicate()) {
+      return true;
+    }
+    std::this_thread::sleep_for(10ms);
+  }
+  return predicate();
+}
+
+class MultiplexerTest : public ::testing::TestWithParam<size_t>
+{
+};
+
+// several sensors with responses split at arbitrary positions
+TEST_P(MultiplexerTest, MultipleSensors)
+{
+  const int sensors = 4;
+  const int scans = 20;
+  FakeSensor fake[sensors];
+  urg_connection_t connection[sensors];
+  ScanReceiver receiver[sensors];
+
+  urg_node2::UrgMultiplexer multiplexer(GetParam());
+  for (int i = 0; i < sensors; ++i) {
+    ASSERT_TRUE(fake[i].connect(&connection[i]));
+    ASSERT_TRUE(multiplexer.add(&connection[i], receiver[i].callback()));
+  }
+  ASSERT_TRUE(multiplexer.start());
+
+  for (int i = 0; i < sensors; ++i) {
+    fake[i].send_data("MD0000108000000\n00P\n\n", 5);
+  }
+  for (int scan = 0; scan < scans; ++scan) {
+    for (int i = 0; i < sensors; ++i) {
+      const size_t chunk_sizes[] = {1448, 100, 37, 4096};
+      fake[i].send_data(create_response(scan), chunk_sizes[(scan + i) % 4]);
+    }
+  }
+
+  for (int i = 0; i < sensors; ++i) {
+    EXPECT_TRUE(wait_for([&]() {return receiver[i].count == scans;}));
+    EXPECT_EQ(receiver[i].errors, 0);
+  }
+  multiplexer.stop();
+
+  for (int i = 0; i < sensors; ++i) {
+    connection_close(&connection[i]);
+  }
+}
+
+// disconnection is notified after the received responses are processed
+TEST_P(MultiplexerTest, Disconnect)
+{
+  FakeSensor fake;
+  urg_connection_t connection;
+  ScanReceiver receiver;
+
+  urg_node2::UrgMultiplexer multiplexer(GetParam());
+  ASSERT_TRUE(fake.connect(&connection));
+  ASSERT_TRUE(
+    multiplexer.add(
+      &connection, receiver.callback(), [&receiver]() {++receiver.disconnected;}));
+  ASSERT_TRUE(multiplexer.start());
+  EXPECT_FALSE(multiplexer.add(&connection, receiver.callback()));
+
+  fake.send_data(create_response(0), 4096);
+  fake.disconnect();
+
+  EXPECT_TRUE(wait_for([&]() {return receiver.disconnected == 1;}));
+  EXPECT_TRUE(wait_for([&]() {return receiver.count == 1;}));
+  EXPECT_EQ(receiver.errors, 0);
+  multiplexer.stop();
+  connection_close(&connection);
+}
+
+// a disconnected sensor is watched again after reconnecting
+TEST_P(MultiplexerTest, Reconnect)
+{
+  FakeSensor fake;
+  urg_connection_t connection;
+  ScanReceiver receiver;
+
+  urg_node2::UrgMultiplexer multiplexer(GetParam());
+  ASSERT_TRUE(fake.connect(&connection));
+  ASSERT_TRUE(
+    multiplexer.add(
+      &connection, receiver.callback(), [&receiver]() {++receiver.disconnected;}));
+  ASSERT_TRUE(multiplexer.start());
+  EXPECT_FALSE(multiplexer.resume(&connection));
+
+  // the sensor is rebooted while sending a response
+  fake.send_data(create_response(0), 4096);
+  fake.send_data(create_response(1).substr(0, 100), 4096);
+  fake.disconnect();
+  ASSERT_TRUE(wait_for([&]() {return receiver.disconnected == 1;}));
+  EXPECT_TRUE(wait_for([&]() {return receiver.count == 1;}));
+
+  // the partial response before the disconnection is discarded
+  connection_close(&connection);
+  ASSERT_TRUE(fake.connect(&connection));
+  ASSERT_TRUE(multiplexer.resume(&connection));
+  EXPECT_FALSE(multiplexer.resume(&connection));
+  for (int scan = 1; scan < 5; ++scan) {
+    fake.send_data(create_response(scan), 37);
+  }
+  EXPECT_TRUE(wait_for([&]() {return receiver.count == 5;}));
+  EXPECT_EQ(receiver.errors, 0);
+
+  // disconnected again
+  fake.disconnect();
+  EXPECT_TRUE(wait_for([&]() {return receiver.disconnected == 2;}));
+  multiplexer.stop();
+  connection_close(&connection);
+}
+
+// a sensor connected after starting (e.g. not found at startup) is added while running
+TEST_P(MultiplexerTest, AddWhileRunning)
+{
+  FakeSensor fake[2];
+  urg_connection_t connection[2];
+  ScanReceiver receiver[2];
+
+  urg_node2::UrgMultiplexer multiplexer(GetParam());
+  ASSERT_TRUE(fake[0].connect(&connection[0]));
+  ASSERT_TRUE(multiplexer.add(&connection[0], receiver[0].callback()));
+  ASSERT_TRUE(multiplexer.start());
+
+  ASSERT_TRUE(fake[1].connect(&connection[1]));
+  ASSERT_TRUE(multiplexer.add(&connection[1], receiver[1].callback()));
+  EXPECT_FALSE(multiplexer.add(&connection[1], receiver[1].callback()));
+  for (int scan = 0; scan < 5; ++scan) {
+    for (int i = 0; i < 2; ++i) {
+      fake[i].send_data(create_response(scan), 1448);
+    }
+  }
+
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_TRUE(wait_for([&]() {return receiver[i].count == 5;}));
+    EXPECT_EQ(receiver[i].errors, 0);
+  }
+  multiplexer.stop();
+  for (int i = 0; i < 2; ++i) {
+    connection_close(&connection[i]);
+  }
+}
+
+// a sensor which stops sending without closing (power loss, pulled cable) is disconnected
+TEST_P(MultiplexerTest, ReceiveTimeout)
+{
+  FakeSensor fake;
+  urg_connection_t connection;
+  ScanReceiver receiver;
+
+  urg_node2::UrgMultiplexer multiplexer(GetParam());
+  ASSERT_TRUE(fake.connect(&connection));
+  ASSERT_TRUE(
+    multiplexer.add(
+      &connection, receiver.callback(), [&receiver]() {++receiver.disconnected;}, 200ms));
+  ASSERT_TRUE(multiplexer.start());
+
+  // no timeout while the scans arrive
+  for (int scan = 0; scan < 5; ++scan) {
+    fake.send_data(create_response(scan), 1448);
+    std::this_thread::sleep_for(50ms);
+  }
+  EXPECT_EQ(receiver.disconnected, 0);
+
+  // the sensor stops sending but the connection stays open
+  EXPECT_TRUE(wait_for([&]() {return receiver.disconnected == 1;}));
+  EXPECT_EQ(receiver.count, 5);
+
+  // watched again with the timeout after reconnecting
+  connection_close(&connection);
+  ASSERT_TRUE(fake.connect(&connection));
+  ASSERT_TRUE(multiplexer.resume(&connection, 200ms));
+  fake.send_data(create_response(5), 1448);
+  EXPECT_TRUE(wait_for([&]() {return receiver.count == 6;}));
+  EXPECT_TRUE(wait_for([&]() {return receiver.disconnected == 2;}));
+  EXPECT_EQ(receiver.errors, 0);
+  multiplexer.stop();
+  connection_close(&connection);
+}
+
+INSTANTIATE_TEST_CASE_P(WorkerThreads, MultiplexerTest, ::testing::Values(0, 1, 3));
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
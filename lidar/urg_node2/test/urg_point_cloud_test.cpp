@@ -0,0 +1,145 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "allocation_counter.hpp"
+#include "urg_node2/urg_point_cloud.hpp"
+
+const int test_steps = 1081;
+const double angle_min = -2.35619449;
+const double angle_increment = 0.00436332313;
+const double time_increment = 1.736e-5;
+
+class PointCloudTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    ranges_.resize(test_steps);
+    intensities_.resize(test_steps);
+    for (int i = 0; i < test_steps; ++i) {
+      ranges_[i] = (i % 50 == 0) ?
+        std::numeric_limits<float>::quiet_NaN() : 0.5f + 0.01f * (i % 300);
+      intensities_[i] = 100.0f + i;
+    }
+    converter_.set_angles(angle_min, angle_increment, test_steps);
+  }
+
+  // float of a field of a point
+  float field(const sensor_msgs::msg::PointCloud2 & msg, int point, const char * name)
+  {
+    for (const sensor_msgs::msg::PointField & f : msg.fields) {
+      if (f.name == name) {
+        float value;
+        std::memcpy(&value, &msg.data[point * msg.point_step + f.offset], sizeof(value));
+        return value;
+      }
+    }
+    ADD_FAILURE() << "no field " << name;
+    return 0.0f;
+  }
+
+  // compares the cloud with the projection computed point by point
+  void check(
+    const sensor_msgs::msg::PointCloud2 & msg, int num_points, bool use_intensity,
+    bool use_time)
+  {
+    ASSERT_EQ(msg.height, 1u);
+    ASSERT_EQ(msg.width, static_cast<uint32_t>(num_points));
+    ASSERT_EQ(msg.point_step, (3u + use_intensity + use_time) * sizeof(float));
+    ASSERT_EQ(msg.row_step, msg.width * msg.point_step);
+    ASSERT_EQ(msg.data.size(), msg.row_step);
+    EXPECT_FALSE(msg.is_dense);
+
+    for (int i = 0; i < num_points; ++i) {
+      double angle = angle_min + i * angle_increment;
+      float x = field(msg, i, "x");
+      float y = field(msg, i, "y");
+      if (std::isnan(ranges_[i])) {
+        EXPECT_TRUE(std::isnan(x)) << i;
+        EXPECT_TRUE(std::isnan(y)) << i;
+      } else {
+        EXPECT_NEAR(x, ranges_[i] * std::cos(angle), 1e-5) << i;
+        EXPECT_NEAR(y, ranges_[i] * std::sin(angle), 1e-5) << i;
+      }
+      EXPECT_EQ(field(msg, i, "z"), 0.0f) << i;
+      if (use_intensity) {
+        EXPECT_EQ(field(msg, i, "intensity"), intensities_[i]) << i;
+      }
+      if (use_time) {
+        EXPECT_FLOAT_EQ(field(msg, i, "time"), static_cast<float>(i * time_increment)) << i;
+      }
+    }
+  }
+
+  urg_node2::UrgPointCloudConverter converter_;
+  std::vector<float> ranges_;
+  std::vector<float> intensities_;
+};
+
+TEST_F(PointCloudTest, Fields)
+{
+  for (int use_intensity = 0; use_intensity < 2; ++use_intensity) {
+    for (int use_time = 0; use_time < 2; ++use_time) {
+      converter_.set_fields(use_intensity, use_time, time_increment);
+      sensor_msgs::msg::PointCloud2 msg;
+      converter_.initialize(msg);
+      // the number of points is not always a multiple of the SIMD width
+      for (int num_points : {test_steps, 8, 7, 5, 4, 3, 1, 0}) {
+        EXPECT_EQ(
+          converter_.convert(&ranges_[0], &intensities_[0], num_points, msg),
+          num_points);
+        check(msg, num_points, use_intensity, use_time);
+      }
+    }
+  }
+}
+
+TEST_F(PointCloudTest, MaxPoints)
+{
+  converter_.set_fields(false, false, time_increment);
+  converter_.set_angles(angle_min, angle_increment, 100);
+  sensor_msgs::msg::PointCloud2 msg;
+  converter_.initialize(msg);
+  EXPECT_EQ(converter_.convert(&ranges_[0], nullptr, test_steps, msg), 100);
+  check(msg, 100, false, false);
+}
+
+// no allocation per scan once the message is initialized
+TEST_F(PointCloudTest, NoAllocationPerScan)
+{
+  converter_.set_fields(true, true, time_increment);
+  sensor_msgs::msg::PointCloud2 msg;
+  converter_.initialize(msg);
+
+  allocation_count = 0;
+  is_counting = true;
+  for (int scan = 0; scan < 100; ++scan) {
+    converter_.convert(&ranges_[0], &intensities_[0], test_steps - scan % 2, msg);
+  }
+  is_counting = false;
+
+  EXPECT_EQ(allocation_count, 0);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
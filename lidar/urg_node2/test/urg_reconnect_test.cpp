@@ -0,0 +1,123 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "fake_scip_server.hpp"
+#include "urg_sensor.h"
+#include "urg_utils.h"
+
+using namespace std::chrono_literals;
+
+// identifies the sensor and receives the first scan as UrgNode2 does after connecting
+bool receive_first_scan(urg_t * urg, std::vector<long> & data)
+{
+  if (std::string(urg_sensor_serial_id(urg)) != test_serial_id) {
+    return false;
+  }
+  if (urg_start_measurement(urg, URG_DISTANCE, URG_SCAN_INFINITY, 0, 0) < 0) {
+    return false;
+  }
+  data.assign(urg_max_data_size(urg), 0);
+  return urg_get_distance(urg, data.data(), nullptr) > 0;
+}
+
+// checks the distances of the scanning range set before the disconnection
+bool is_valid_scan(const std::vector<long> & data, int first_step, int last_step)
+{
+  for (int step = first_step; step <= last_step; ++step) {
+    if (data[step - first_step] != test_distance(test_front_index + step)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+double elapsed_msec(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// the sensor reboots and the connection is recovered with and without the cached parameters
+TEST(ReconnectTest, RecoveryTime)
+{
+  const int first_step = -100;
+  const int last_step = 100;
+  FakeScipServer server;
+  urg_t urg;
+  std::vector<long> data;
+
+  ASSERT_EQ(urg_open(&urg, URG_ETHERNET, "127.0.0.1", server.port()), 0);
+  EXPECT_EQ(server.count("PP"), 1);
+  ASSERT_EQ(urg_set_scanning_parameter(&urg, first_step, last_step, 1), 0);
+  ASSERT_TRUE(receive_first_scan(&urg, data));
+
+  // full handshake
+  server.drop();
+  urg_close(&urg);
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(urg_open(&urg, URG_ETHERNET, "127.0.0.1", server.port()), 0);
+  ASSERT_EQ(urg_set_scanning_parameter(&urg, first_step, last_step, 1), 0);
+  ASSERT_TRUE(receive_first_scan(&urg, data));
+  double open_msec = elapsed_msec(start);
+  EXPECT_EQ(server.count("PP"), 2);
+  EXPECT_TRUE(is_valid_scan(data, first_step, last_step));
+
+  // cached parameters
+  server.drop();
+  urg_close(&urg);
+  start = std::chrono::steady_clock::now();
+  ASSERT_EQ(urg_reopen(&urg, URG_ETHERNET, "127.0.0.1", server.port()), 0);
+  ASSERT_TRUE(receive_first_scan(&urg, data));
+  double reopen_msec = elapsed_msec(start);
+  EXPECT_EQ(server.count("PP"), 2);
+  EXPECT_TRUE(is_valid_scan(data, first_step, last_step));
+
+  std::printf("recovery time: urg_open %.2f [msec], urg_reopen %.2f [msec]\n", open_msec, reopen_msec);
+  RecordProperty("urg_open_msec", std::to_string(open_msec));
+  RecordProperty("urg_reopen_msec", std::to_string(reopen_msec));
+  EXPECT_LT(reopen_msec, open_msec);
+
+  urg_close(&urg);
+}
+
+// reconnection fails while the sensor is not available
+TEST(ReconnectTest, SensorUnavailable)
+{
+  urg_t urg;
+  int port;
+  {
+    FakeScipServer server;
+    port = server.port();
+    ASSERT_EQ(urg_open(&urg, URG_ETHERNET, "127.0.0.1", port), 0);
+    urg_close(&urg);
+  }
+
+  EXPECT_LT(urg_reopen(&urg, URG_ETHERNET, "127.0.0.1", port), 0);
+  EXPECT_STRNE(urg_sensor_serial_id(&urg), test_serial_id);
+  urg_close(&urg);
+}
+
+int main(int argc, char ** argv)
+{
+  // writing to the dropped connection must not terminate the test
+  std::signal(SIGPIPE, SIG_IGN);
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,280 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "allocation_counter.hpp"
+#include "urg_node2/urg_scan_filter.hpp"
+
+const int test_steps = 1081;
+const double angle_increment = 0.00436332313;
+const float invalid_range = std::numeric_limits<float>::quiet_NaN();
+
+class ScanFilterTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    ranges_.resize(test_steps);
+    intensities_.resize(test_steps);
+    for (int i = 0; i < test_steps; ++i) {
+      ranges_[i] = (i % 37 == 0) ? invalid_range : 0.1f + 0.013f * ((i * 7) % 400);
+      intensities_[i] = (i % 37 == 0) ? 0.0f : 100.0f + (i * 13) % 900;
+    }
+  }
+
+  // applies the filter to a copy of the test scan
+  int apply(
+    const urg_node2::UrgScanFilterConfig & config, int num_beams, bool use_intensity,
+    std::vector<float> & ranges, std::vector<float> & intensities)
+  {
+    urg_node2::UrgScanFilter filter;
+    filter.configure(config, angle_increment, use_intensity);
+    ranges = ranges_;
+    intensities = intensities_;
+    return filter.apply(&ranges[0], use_intensity ? &intensities[0] : nullptr, num_beams);
+  }
+
+  void expect_range(float actual, float expected, int i)
+  {
+    if (std::isnan(expected)) {
+      EXPECT_TRUE(std::isnan(actual)) << i;
+    } else {
+      EXPECT_EQ(actual, expected) << i;
+    }
+  }
+
+  std::vector<float> ranges_;
+  std::vector<float> intensities_;
+};
+
+TEST_F(ScanFilterTest, Disabled)
+{
+  urg_node2::UrgScanFilter filter;
+  EXPECT_FALSE(filter.is_enabled());
+  EXPECT_EQ(filter.decimation(), 1);
+
+  std::vector<float> ranges;
+  std::vector<float> intensities;
+  EXPECT_EQ(apply(urg_node2::UrgScanFilterConfig(), test_steps, true, ranges, intensities),
+    test_steps);
+  for (int i = 0; i < test_steps; ++i) {
+    expect_range(ranges[i], ranges_[i], i);
+    EXPECT_EQ(intensities[i], intensities_[i]) << i;
+  }
+}
+
+TEST_F(ScanFilterTest, RangeAndIntensity)
+{
+  urg_node2::UrgScanFilterConfig config;
+  config.range_min = 0.5;
+  config.range_max = 4.0;
+  config.intensity_min = 300.0;
+
+  // the number of steps is not always a multiple of the SIMD width
+  for (int num_beams : {test_steps, 8, 7, 5, 4, 3, 1}) {
+    for (int use_intensity = 0; use_intensity < 2; ++use_intensity) {
+      std::vector<float> ranges;
+      std::vector<float> intensities;
+      EXPECT_EQ(apply(config, num_beams, use_intensity, ranges, intensities), num_beams);
+      for (int i = 0; i < num_beams; ++i) {
+        // the intensity threshold is not used without intensities
+        bool valid = ranges_[i] >= 0.5f && ranges_[i] <= 4.0f &&
+          (!use_intensity || intensities_[i] >= 300.0f);
+        expect_range(ranges[i], valid ? ranges_[i] : invalid_range, i);
+        if (use_intensity) {
+          EXPECT_EQ(intensities[i], valid ? intensities_[i] : 0.0f) << i;
+        }
+      }
+      for (int i = num_beams; i < test_steps; ++i) {
+        expect_range(ranges[i], ranges_[i], i);
+      }
+    }
+  }
+}
+
+TEST_F(ScanFilterTest, IntensityWithoutIntensities)
+{
+  urg_node2::UrgScanFilterConfig config;
+  config.intensity_min = 300.0;
+
+  urg_node2::UrgScanFilter filter;
+  filter.configure(config, angle_increment, true);
+  EXPECT_TRUE(filter.is_enabled());
+  // nothing to do without intensities
+  filter.configure(config, angle_increment, false);
+  EXPECT_FALSE(filter.is_enabled());
+}
+
+TEST_F(ScanFilterTest, RangeMaxOnly)
+{
+  urg_node2::UrgScanFilterConfig config;
+  config.range_max = 2.0;
+
+  std::vector<float> ranges;
+  std::vector<float> intensities;
+  apply(config, test_steps, false, ranges, intensities);
+  for (int i = 0; i < test_steps; ++i) {
+    expect_range(ranges[i], ranges_[i] <= 2.0f ? ranges_[i] : invalid_range, i);
+  }
+}
+
+TEST_F(ScanFilterTest, Shadow)
+{
+  // a wall at 2m with an object at 1m between steps 10 and 19
+  // the steps next to the edges are veiling points between both surfaces
+  for (int i = 0; i < 30; ++i) {
+    ranges_[i] = (i >= 10 && i < 20) ? 1.0f : 2.0f;
+  }
+  ranges_[9] = 1.5f;
+  ranges_[20] = 1.5f;
+  ranges_[25] = invalid_range;
+  intensities_[25] = 0.0f;
+
+  urg_node2::UrgScanFilterConfig config;
+  config.shadow_angle = 0.1745;  // 10deg
+
+  std::vector<float> ranges;
+  std::vector<float> intensities;
+  EXPECT_EQ(apply(config, 30, true, ranges, intensities), 30);
+  for (int i = 0; i < 30; ++i) {
+    // the farther points of the edges are removed, the nearer ones are kept
+    bool shadow = (i == 8 || i == 9 || i == 20 || i == 21);
+    expect_range(ranges[i], shadow ? invalid_range : ranges_[i], i);
+    EXPECT_EQ(intensities[i], shadow ? 0.0f : intensities_[i]) << i;
+  }
+}
+
+TEST_F(ScanFilterTest, Decimation)
+{
+  for (int median = 0; median < 2; ++median) {
+    for (int decimation : {2, 3, 4, 16}) {
+      urg_node2::UrgScanFilterConfig config;
+      config.decimation = decimation;
+      config.median = median;
+
+      std::vector<float> ranges;
+      std::vector<float> intensities;
+      int num_beams = apply(config, test_steps, true, ranges, intensities);
+      // the last block may be shorter
+      ASSERT_EQ(num_beams, (test_steps + decimation - 1) / decimation);
+
+      for (int b = 0; b < num_beams; ++b) {
+        // valid steps of the block sorted by the range (the first step of equal ranges first)
+        std::vector<std::pair<float, int>> block;
+        for (int i = b * decimation; i < std::min((b + 1) * decimation, test_steps); ++i) {
+          if (!std::isnan(ranges_[i])) {
+            block.emplace_back(ranges_[i], i);
+          }
+        }
+        std::sort(block.begin(), block.end());
+        if (block.empty()) {
+          expect_range(ranges[b], invalid_range, b);
+          EXPECT_EQ(intensities[b], 0.0f) << b;
+          continue;
+        }
+        size_t selected = median ? (block.size() - 1) / 2 : 0;
+        EXPECT_EQ(ranges[b], block[selected].first) << b;
+        EXPECT_EQ(intensities[b], intensities_[block[selected].second]) << b;
+      }
+    }
+  }
+}
+
+TEST_F(ScanFilterTest, DecimationLimit)
+{
+  urg_node2::UrgScanFilter filter;
+  urg_node2::UrgScanFilterConfig config;
+  config.decimation = 100;
+  filter.configure(config, angle_increment, true);
+  EXPECT_EQ(filter.decimation(), urg_node2::UrgScanFilter::kMaxDecimation);
+  config.decimation = 0;
+  filter.configure(config, angle_increment, true);
+  EXPECT_EQ(filter.decimation(), 1);
+  EXPECT_FALSE(filter.is_enabled());
+}
+
+// all filters in one pass give the same result as applied one after another
+TEST_F(ScanFilterTest, Combined)
+{
+  urg_node2::UrgScanFilterConfig config;
+  config.range_min = 0.3;
+  config.range_max = 4.5;
+  config.intensity_min = 200.0;
+  config.shadow_angle = 0.1745;
+  config.decimation = 3;
+  config.median = true;
+
+  std::vector<float> ranges;
+  std::vector<float> intensities;
+  int num_beams = apply(config, test_steps, true, ranges, intensities);
+
+  std::vector<float> expected_ranges = ranges_;
+  std::vector<float> expected_intensities = intensities_;
+  urg_node2::UrgScanFilter filter;
+  urg_node2::UrgScanFilterConfig step;
+  step.shadow_angle = config.shadow_angle;
+  filter.configure(step, angle_increment, true);
+  filter.apply(&expected_ranges[0], &expected_intensities[0], test_steps);
+  step = urg_node2::UrgScanFilterConfig();
+  step.range_min = config.range_min;
+  step.range_max = config.range_max;
+  step.intensity_min = config.intensity_min;
+  filter.configure(step, angle_increment, true);
+  filter.apply(&expected_ranges[0], &expected_intensities[0], test_steps);
+  step = urg_node2::UrgScanFilterConfig();
+  step.decimation = config.decimation;
+  step.median = config.median;
+  filter.configure(step, angle_increment, true);
+  ASSERT_EQ(filter.apply(&expected_ranges[0], &expected_intensities[0], test_steps), num_beams);
+
+  for (int i = 0; i < num_beams; ++i) {
+    expect_range(ranges[i], expected_ranges[i], i);
+    EXPECT_EQ(intensities[i], expected_intensities[i]) << i;
+  }
+}
+
+// no allocation per scan
+TEST_F(ScanFilterTest, NoAllocationPerScan)
+{
+  urg_node2::UrgScanFilter filter;
+  urg_node2::UrgScanFilterConfig config;
+  config.range_min = 0.3;
+  config.intensity_min = 200.0;
+  config.shadow_angle = 0.1745;
+  config.decimation = 4;
+  config.median = true;
+  filter.configure(config, angle_increment, true);
+
+  std::vector<float> ranges = ranges_;
+  std::vector<float> intensities = intensities_;
+  allocation_count = 0;
+  is_counting = true;
+  for (int scan = 0; scan < 100; ++scan) {
+    filter.apply(&ranges[0], &intensities[0], test_steps);
+  }
+  is_counting = false;
+
+  EXPECT_EQ(allocation_count, 0);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,118 @@
+// Copyright 2022 eSOL Co.,Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <csignal>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "fake_scip_server.hpp"
+#include "urg_node2/urg_sensor_setup.hpp"
+#include "urg_sensor.h"
+#include "urg_utils.h"
+
+// angle of a step of the fake sensor (UST-10LX, ARES:1440)
+const double test_step_angle = 2.0 * M_PI / 1440;
+const double test_scan_period = 0.025;
+
+class SensorSetupTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    ASSERT_EQ(urg_open(&urg_, URG_ETHERNET, "127.0.0.1", server_.port()), 0);
+  }
+
+  void TearDown() override
+  {
+    urg_close(&urg_);
+  }
+
+  FakeScipServer server_;
+  urg_t urg_;
+};
+
+// the whole scanning range of the sensor
+TEST_F(SensorSetupTest, FullRange)
+{
+  urg_node2::UrgScanRange range =
+    urg_node2::set_scan_range(urg_, -M_PI, M_PI, 1, test_scan_period);
+
+  EXPECT_EQ(range.first_step, -540);
+  EXPECT_EQ(range.last_step, 540);
+  EXPECT_DOUBLE_EQ(range.angle_min, -540 * test_step_angle);
+  EXPECT_DOUBLE_EQ(range.angle_max, 540 * test_step_angle);
+  EXPECT_DOUBLE_EQ(range.angle_increment, test_step_angle);
+  EXPECT_DOUBLE_EQ(range.time_increment, test_scan_period / 1440);
+  EXPECT_DOUBLE_EQ(range.range_min, 0.02);
+  EXPECT_DOUBLE_EQ(range.range_max, 30.0);
+
+  // from the back (-pi) to the first step (-3/4 pi)
+  EXPECT_DOUBLE_EQ(range.angular_time_offset, test_scan_period / 8);
+  EXPECT_DOUBLE_EQ(
+    urg_node2::get_angular_time_offset(urg_, 0, test_scan_period), test_scan_period / 2);
+}
+
+// the scanning range is set to the sensor
+TEST_F(SensorSetupTest, ScanningParameter)
+{
+  urg_node2::UrgScanRange range =
+    urg_node2::set_scan_range(urg_, -1.0, 1.0, 1, test_scan_period);
+  EXPECT_EQ(range.first_step, urg_rad2step(&urg_, -1.0));
+  EXPECT_EQ(range.last_step, urg_rad2step(&urg_, 1.0));
+
+  ASSERT_EQ(urg_start_measurement(&urg_, URG_DISTANCE, URG_SCAN_INFINITY, 0, 0), 0);
+  std::vector<long> data(urg_max_data_size(&urg_));
+  int n = urg_get_distance(&urg_, data.data(), nullptr);
+  ASSERT_EQ(n, range.last_step - range.first_step + 1);
+  EXPECT_EQ(data[0], test_distance(test_front_index + range.first_step));
+}
+
+// the grouped steps
+TEST_F(SensorSetupTest, Cluster)
+{
+  urg_node2::UrgScanRange range =
+    urg_node2::set_scan_range(urg_, -1.0, 1.0, 3, test_scan_period);
+  EXPECT_DOUBLE_EQ(range.angle_increment, 3 * test_step_angle);
+  EXPECT_DOUBLE_EQ(range.time_increment, 3 * test_scan_period / 1440);
+}
+
+// the range is clipped, swapped and widened to 2 steps
+TEST_F(SensorSetupTest, RoundRange)
+{
+  urg_node2::UrgScanRange range =
+    urg_node2::set_scan_range(urg_, -10.0, 10.0, 1, test_scan_period);
+  EXPECT_EQ(range.first_step, -540);
+  EXPECT_EQ(range.last_step, 540);
+
+  range = urg_node2::set_scan_range(urg_, 1.0, -1.0, 1, test_scan_period);
+  EXPECT_EQ(range.first_step, urg_rad2step(&urg_, -1.0));
+  EXPECT_EQ(range.last_step, urg_rad2step(&urg_, 1.0));
+
+  range = urg_node2::set_scan_range(urg_, 0.0, 0.0, 1, test_scan_period);
+  EXPECT_EQ(range.first_step, -1);
+  EXPECT_EQ(range.last_step, 0);
+
+  range = urg_node2::set_scan_range(urg_, -M_PI, -M_PI, 1, test_scan_period);
+  EXPECT_EQ(range.first_step, -540);
+  EXPECT_EQ(range.last_step, -539);
+}
+
+int main(int argc, char ** argv)
+{
+  // writing to the closed connection must not terminate the test
+  std::signal(SIGPIPE, SIG_IGN);
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
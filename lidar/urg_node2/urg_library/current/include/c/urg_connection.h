@@ -294,6 +294,92 @@ extern int connection_read(urg_connection_t *connection,
 extern int connection_readline(urg_connection_t *connection,
                                char *data, int max_size, int timeout);
 
+
+/*!
+  \~japanese
+  \brief Mf[^̎Q
+
+  Mf[^Rs[ɁAMobt@̃f[^QƂB
+  obt@̂Ƃ timeout ܂ŎM҂Btimeout  0 ̂Ƃ͑҂ȂB
+
+  QƂf[^ connection_consume() ĂԂ܂Ńobt@ɎcB
+  connection_consume() ȊO̎M֐ĂԂƁAdata ͖ɂȂB
+
+  \param[in,out] connection ʐM\[X
+  \param[out] data Mf[^ւ̃|C^
+  \param[in] timeout ^CAEg [msec]
+
+  \retval >0 QƂłf[^
+  \retval <0 G[
+
+  \~english
+  \brief Refers to the received data
+
+  Refers to the data in the receive buffer without copying it.
+  Waits up to timeout for data if the buffer is empty, does not wait if
+  timeout is 0.
+
+  The data stays in the buffer until connection_consume() is called.
+  Calling any other receive function invalidates data.
+
+  \param[in,out] connection Connection resource
+  \param[out] data Pointer to the received data
+  \param[in] timeout Timeout [msec]
+
+  \retval >0 Number of bytes that can be referred
+  \retval <0 Error
+  \~
+  \see connection_consume()
+*/
+extern int connection_peek(urg_connection_t *connection,
+                           const char **data, int timeout);
+
+
+/*!
+  \~japanese
+  \brief QƂf[^̔j
+
+  \param[in,out] connection ʐM\[X
+  \param[in] size joCg
+
+  \~english
+  \brief Removes the referred data
+
+  \param[in,out] connection Connection resource
+  \param[in] size Number of bytes to remove
+  \~
+  \see connection_peek()
+*/
+extern void connection_consume(urg_connection_t *connection, int size);
+
+
+/*!
+  \~japanese
+  \brief t@CfBXNv^̎擾
+
+  select(), epoll ȂǂŎM҂߂̃t@CfBXNv^ԂB
+  M̑ҋ@ connection_peek()  timeout 0 w肵ăf[^ǂݏoB
+
+  \param[in] connection ʐM\[X
+
+  \retval >=0 t@CfBXNv^
+  \retval <0 t@CfBXNv^Ȃ (Windows ̃VAڑ)
+
+  \~english
+  \brief Returns the file descriptor
+
+  Returns the file descriptor to wait for data with select(), epoll etc.
+  The data is then read with connection_peek() and a timeout of 0.
+
+  \param[in] connection Connection resource
+
+  \retval >=0 File descriptor
+  \retval <0 There is no file descriptor (serial connection on Windows)
+  \~
+  \see connection_peek()
+*/
+extern int connection_descriptor(const urg_connection_t *connection);
+
 #ifdef __cplusplus
 }
 #endif
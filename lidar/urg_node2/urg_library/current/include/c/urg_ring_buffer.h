@@ -128,4 +128,102 @@ extern int ring_write(ring_buffer_t *ring, const char *data, int size);
 */
 extern int ring_read(ring_buffer_t *ring, char *buffer, int size);
 
+
+/*!
+  \~japanese
+  \brief š
+
+  \param[in] ring Oobt@̍\
+
+  \return ŏ '\\r' ܂ '\\n' ܂ł̃f[^BsȂ -1
+
+  \~english
+  \brief Searches the stored data for an EOL character
+
+  \param[in] ring Pointer to the ring buffer data structure
+
+  \return The number of elements before the first '\\r' or '\\n', -1 if there is none
+*/
+extern int ring_find_linefeed(const ring_buffer_t *ring);
+
+
+/*!
+  \~japanese
+  \brief 擪AĊi[Ăf[^̎Q
+
+  f[^̓Oobt@菜ȂBring_consume() Ŏ菜B
+
+  \param[in] ring Oobt@̍\
+  \param[out] data f[^̐擪ւ̃|C^
+
+  \return AĎQƂłf[^
+
+  \~english
+  \brief Refers to the data stored contiguously from the first element
+
+  The data is not removed from the ring buffer, use ring_consume() to remove it.
+
+  \param[in] ring Pointer to the ring buffer data structure
+  \param[out] data Pointer to the first element
+
+  \return The number of elements that can be read contiguously
+*/
+extern int ring_peek(const ring_buffer_t *ring, const char **data);
+
+
+/*!
+  \~japanese
+  \brief 擪̃f[^菜
+
+  \param[in] ring Oobt@̍\
+  \param[in] size 菜f[^
+
+  \~english
+  \brief Removes elements from the beginning of the ring buffer
+
+  \param[in] ring Pointer to the ring buffer data structure
+  \param[in] size Number of elements to remove
+*/
+extern void ring_consume(ring_buffer_t *ring, int size);
+
+
+/*!
+  \~japanese
+  \brief Aď߂̈̎擾
+
+  񂾃f[^ ring_commit() Ŋi[B
+
+  \param[in] ring Oobt@̍\
+  \param[out] data ݐւ̃|C^
+
+  \return Aď߂f[^
+
+  \~english
+  \brief Gets the free space that can be written contiguously
+
+  The written data is stored with ring_commit().
+
+  \param[in] ring Pointer to the ring buffer data structure
+  \param[out] data Pointer to write the data to
+
+  \return The number of elements that can be written contiguously
+*/
+extern int ring_reserve(ring_buffer_t *ring, char **data);
+
+
+/*!
+  \~japanese
+  \brief ring_reserve() ̗̈ɏ񂾃f[^̊i[
+
+  \param[in] ring Oobt@̍\
+  \param[in] size 񂾃f[^
+
+  \~english
+  \brief Stores the data written to the space of ring_reserve()
+
+  \param[in] ring Pointer to the ring buffer data structure
+  \param[in] size Number of elements written
+*/
+extern void ring_commit(ring_buffer_t *ring, int size);
+
 #endif /* ! RING_BUFFER_H */
@@ -0,0 +1,153 @@
+#ifndef URG_SCIP_DECODER_H
+#define URG_SCIP_DECODER_H
+
+/*!
+  \file
+  \brief Decoder of the measurement data of SCIP responses
+
+  Decodes the data lines of a scan into distances and intensities. The
+  characters are decoded with SIMD instructions if the CPU supports them,
+  the short runs between the echoes of a multiecho response with scalar
+  code. The checksum of each line is computed in the same pass. The lines can be
+  decoded straight from the receive buffer of the connection.
+
+  $Id$
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// -- NOT INTERFACE, for internal use only --
+
+//! Instruction set used to decode the SCIP characters
+typedef enum {
+    SCIP_DECODE_SCALAR,         //!< Portable C implementation
+    SCIP_DECODE_SSE41,          //!< x86 SSE4.1
+    SCIP_DECODE_AVX2,           //!< x86 AVX2
+    SCIP_DECODE_NEON,           //!< ARMv8 NEON
+    SCIP_DECODE_AUTO,           //!< Fastest instruction set supported by the CPU
+} scip_decode_isa_t;
+
+
+/*!
+  \brief Decoding kernel
+
+  \param[in] data SCIP characters
+  \param[in] count Number of values
+  \param[in] each_size Number of characters per value (2 or 3)
+  \param[out] values Decoded values
+
+  \return The sum of the decoded characters, used for the checksum
+*/
+typedef unsigned int (*scip_decode_function_t)(const char data[], int count,
+                                               int each_size, int values[]);
+
+
+//! Representation of the decoded values
+typedef enum {
+    SCIP_OUTPUT_LONG,           //!< long distances [mm], unsigned short intensities
+    SCIP_OUTPUT_U32,            //!< uint32_t distances [mm], unsigned short intensities
+    SCIP_OUTPUT_F32,            //!< float distances [m] with 0 stored as NaN, float intensities
+} scip_output_format_t;
+
+
+//! Decoding state of one scan
+typedef struct {
+    void *length;               //!< Distances, NULL to skip them
+    void *intensity;            //!< Intensities, NULL to skip them
+    scip_output_format_t format; //!< Representation of length and intensity
+    int each_size;              //!< Number of characters per value
+    int data_size;              //!< Number of characters per step and echo
+    int max_echo;               //!< Number of array elements per step
+    int max_steps;              //!< Number of steps requested
+    int steps;                  //!< Number of steps decoded
+    int echo;                   //!< Echo index of the last decoded value
+
+    // value continued on the next line
+    char carry[8];
+    int carry_size;
+
+    // state of the line being received by scip_decoder_push()
+    unsigned int sum;           //!< Sum of the characters of the line
+    char pending;               //!< Last character, the checksum at the line end
+    int has_pending;            //!< Whether pending holds a character
+    int is_complete;            //!< The terminating empty line was received
+
+    scip_decode_function_t decode;
+} scip_decoder_t;
+// -- end of NON INTERFACE definitions --
+
+
+/*!
+  \brief Returns the decoding kernel of an instruction set
+
+  \param[in] isa Instruction set
+
+  \return The kernel, NULL if the CPU does not support the instruction set
+*/
+extern scip_decode_function_t scip_decode_function(scip_decode_isa_t isa);
+
+
+/*!
+  \brief Prepares the decoding of a scan
+
+  \param[out] decoder Decoding state
+  \param[out] length Distance array, NULL to skip the distances
+  \param[out] intensity Intensity array, NULL to skip the intensities
+  \param[in] format Element type of length and intensity
+  \param[in] each_size Number of characters per value (2 or 3)
+  \param[in] is_intensity Each distance is followed by an intensity
+  \param[in] is_multiecho The arrays hold #URG_MAX_ECHO elements per step
+  \param[in] max_steps Number of steps requested
+*/
+extern void scip_decoder_initialize(scip_decoder_t *decoder,
+                                    void *length, void *intensity,
+                                    scip_output_format_t format,
+                                    int each_size, int is_intensity,
+                                    int is_multiecho, int max_steps);
+
+
+/*!
+  \brief Decodes one data line
+
+  Values split over two lines are completed with the next line.
+
+  \param[in,out] decoder Decoding state
+  \param[in] line Data line including the checksum character, without the line feed
+  \param[in] size Number of characters of the line
+  \param[in] check_sum Validate the checksum
+
+  \retval 0 succeeded
+  \retval URG_CHECKSUM_ERROR checksum error
+  \retval URG_RECEIVE_ERROR invalid or too much data
+*/
+extern int scip_decoder_line(scip_decoder_t *decoder,
+                             const char line[], int size, int check_sum);
+
+
+/*!
+  \brief Decodes the data lines as they are received
+
+  The data may end at any position of a line, the decoding continues with
+  the next call. Stops after the empty line terminating the response and
+  sets is_complete.
+
+  \param[in,out] decoder Decoding state
+  \param[in] data Received characters including the line feeds
+  \param[in] size Number of characters
+  \param[in] check_sum Validate the checksum
+
+  \return The number of characters used, less than size only if the response is complete
+  \retval URG_CHECKSUM_ERROR checksum error
+  \retval URG_RECEIVE_ERROR invalid or too much data
+*/
+extern int scip_decoder_push(scip_decoder_t *decoder,
+                             const char data[], int size, int check_sum);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !URG_SCIP_DECODER_H */
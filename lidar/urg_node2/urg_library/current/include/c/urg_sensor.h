@@ -23,6 +23,7 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
 #include "urg_connection.h"
 
     /*!
@@ -58,6 +59,7 @@ extern "C" {
         URG_SCAN_INFINITY = 0,  //!< \~japanese ̃f[^擾  \~english Continuous data scanning
         URG_MAX_ECHO = 3,       //!< \~japanese }`GR[̍őGR[  \~english Maximum number of echoes
         URG_MAX_IO = 2,         //!< \~japanese IO̍őf[^  \~english Maximum number of IO(input/output)
+        URG_MAX_ANGLE_TABLE = 1441, //!< \~japanese pxe[u̍őf[^ (AMAX 1440)  \~english Maximum number of data points of the angle table (AMAX 1440)
     };
 
 
@@ -71,6 +73,24 @@ extern "C" {
     (*urg_error_handler)(const char *status, void *urg);
 
 
+    /*!
+       \~japanese
+       \brief ZN^nh
+
+       \param[in] first_index fR[hŏ̃f[^̃CfbNX
+       \param[in] steps fR[hf[^
+       \param[in] context urg_set_sector_handler() œo^|C^
+       \~english
+       \brief Sector handler
+
+       \param[in] first_index Index of the first decoded data point
+       \param[in] steps Number of decoded data points
+       \param[in] context Pointer registered by urg_set_sector_handler()
+    */
+    typedef void (*urg_sector_handler)(int first_index, int steps,
+                                       void *context);
+
+
     /*!
       \~japanese
       \brief URG ZTǗ
@@ -110,8 +130,18 @@ extern "C" {
 
         urg_error_handler error_handler;
 
+        urg_sector_handler sector_handler;
+        int sector_steps;
+        void *sector_context;
+
         int ignore_checkSumError;
 
+        // \~japanese urg_set_scanning_parameter() ͈̔͂̊ef[^ cos, sin
+        // \~english cos and sin of each data point of the urg_set_scanning_parameter() range
+        int angle_table_size;
+        float cos_table[URG_MAX_ANGLE_TABLE];
+        float sin_table[URG_MAX_ANGLE_TABLE];
+
         char return_buffer[80];
     } urg_t;
 
@@ -210,6 +240,48 @@ extern "C" {
                         long baudrate_or_port);
 
 
+    /*!
+      \~japanese
+      \brief Đڑ
+
+      O̐ڑŎ擾ZTp[^gčĐڑB
+
+      PP R}hɂp[^擾s킸AZTǗ\̂̏sȂ߁AXĹ͈Apxe[uA^CAEgԁAo^ς݂̃nh͑O̐ڑ̂̂g܂BQT R}h̉Ȃꍇ urg_open() Ɠ{[[gςȂڑ܂B
+
+      \param[in,out] urg URG ZTǗ
+      \param[in] connection_type ʐM^Cv
+      \param[in] device_or_address ڑfoCX
+      \param[in] baudrate_or_port ڑ{[[g [bps] / TCP/IP |[g
+
+      \retval 0 
+      \retval <0 G[
+
+      \attention urg_open() ŐڑɐAurg_close() Őؒf urg nƁBڑ悪ZTǂ͊mFȂ߁AKvȂ urg_sensor_serial_id() ŊmF邱ƁB
+
+      \~english
+      \brief Reconnect
+
+      Reconnects using the sensor parameters received in the previous connection.
+
+      The PP command is not sent and the URG control structure is not initialized, so the scanning range, the angle table, the timeout and the registered handlers of the previous connection are kept. If there is no response to the QT command, the baudrate is searched as in urg_open().
+
+      \param[in,out] urg URG control structure
+      \param[in] connection_type Type of the connection
+      \param[in] device_or_address Name of the device
+      \param[in] baudrate_or_port Connection baudrate [bps] or TCP/IP port number
+
+      \retval 0 Successful
+      \retval <0 Error
+
+      \attention urg must have been connected with urg_open() and closed with urg_close(). This function does not check that the same sensor is connected, use urg_sensor_serial_id() if necessary.
+      \~
+      \see urg_open(), urg_close()
+    */
+    extern int urg_reopen(urg_t *urg, urg_connection_type_t connection_type,
+                          const char *device_or_address,
+                          long baudrate_or_port);
+
+
     /*!
       \~japanese
       \brief ؒf
@@ -769,6 +841,173 @@ extern "C" {
                                            long *time_stamp);
 
 
+    /*!
+      \~japanese
+      \brief f[^̎擾 (uint32_t )
+
+      urg_get_distance() ƓłAf[^ uint32_t ̔zɊi[܂B
+
+      \param[in,out] urg URG ZTǗ
+      \param[out] data f[^ [mm]
+      \param[out] time_stamp ^CX^v [msec]
+
+      \retval >=0 Mf[^
+      \retval <0 G[
+
+      \~english
+      \brief Gets distance data (uint32_t version)
+
+      Same as urg_get_distance(), but stores the distance data in an uint32_t array.
+
+      \param[in,out] urg URG control structure
+      \param[out] data Distance data array [mm]
+      \param[out] time_stamp Timestamp [msec]
+
+      \retval >=0 Number of data points received
+      \retval <0 Error
+
+      \~
+      \see urg_get_distance()
+    */
+    extern int urg_get_distance_u32(urg_t *urg, uint32_t data[],
+                                    long *time_stamp);
+
+
+    /*!
+      \~japanese
+      \brief Ƌxf[^̎擾 (uint32_t )
+
+      urg_get_distance_intensity() ƓłAf[^ uint32_t ̔zɊi[܂B
+
+      \~english
+      \brief Gets distance and intensity data (uint32_t version)
+
+      Same as urg_get_distance_intensity(), but stores the distance data in an uint32_t array.
+
+      \~
+      \see urg_get_distance_intensity()
+    */
+    extern int urg_get_distance_intensity_u32(urg_t *urg, uint32_t data[],
+                                              unsigned short intensity[],
+                                              long *time_stamp);
+
+
+    /*!
+      \~japanese
+      \brief f[^̎擾 (float [m] )
+
+      urg_get_distance() ƓłAf[^ [m] Pʂ float ̔zɊi[܂B
+       0 (vłȂXebv) ̂Ƃ NaN i[܂B
+
+      \param[in,out] urg URG ZTǗ
+      \param[out] ranges f[^ [m]
+      \param[out] time_stamp ^CX^v [msec]
+
+      \retval >=0 Mf[^
+      \retval <0 G[
+
+      \~english
+      \brief Gets distance data (float [m] version)
+
+      Same as urg_get_distance(), but stores the distance data in a float array in [m].
+      NaN is stored for a distance of 0, i.e. steps without a valid measurement.
+
+      \param[in,out] urg URG control structure
+      \param[out] ranges Distance data array [m]
+      \param[out] time_stamp Timestamp [msec]
+
+      \retval >=0 Number of data points received
+      \retval <0 Error
+
+      \~
+      \see urg_get_distance()
+    */
+    extern int urg_get_ranges_f32(urg_t *urg, float ranges[], long *time_stamp);
+
+
+    /*!
+      \~japanese
+      \brief Ƌxf[^̎擾 (float )
+
+      urg_get_ranges_f32() ɉAxf[^ float ̔zɊi[܂B
+       NaN ̃Xebv̋x 0 łB
+
+      \~english
+      \brief Gets distance and intensity data (float version)
+
+      This is an extension to urg_get_ranges_f32() which stores also the intensity data in a float array.
+      The intensity of the steps with a NaN distance is 0.
+
+      \~
+      \see urg_get_ranges_f32(), urg_get_distance_intensity()
+    */
+    extern int urg_get_ranges_intensity_f32(urg_t *urg, float ranges[],
+                                            float intensities[],
+                                            long *time_stamp);
+
+
+    /*!
+      \~japanese
+      \brief Mς݂̉̋f[^̎擾
+
+      urg_start_measurement() ̌ɎMAvR}h̉ 1 ͂A
+      urg_get_ranges_intensity_f32() Ɠ` ranges, intensities Ɋi[܂B
+      response ̓GR[obN牞̏I̋s܂łłB
+
+      urg_t gȂ߁AMƈقȂXbhĂяo܂B
+      M connection_descriptor() Ŏ擾t@CfBXNv^ő҂A
+      connection_peek() œǂݏo܂B
+
+      \param[in] response 
+      \param[in] size ̃oCg
+      \param[out] ranges f[^ [m]
+      \param[out] intensities xf[^ANULL ̂Ƃ͊i[Ȃ
+      \param[in] max_size ranges, intensities ̗vf
+      \param[in] check_sum 0 ȊÔƂ`FbNT]
+      \param[out] time_stamp ^CX^v [msec]
+
+      \retval >0 Mf[^
+      \retval 0 f[^܂܂Ȃ (vJn̉AQT ̉)
+      \retval <0 G[
+
+      }`GR[̂Ƃ́Aranges, intensities  1 Xebv #URG_MAX_ECHO ̗vfg܂B
+
+      \~english
+      \brief Gets distance data from a received response
+
+      Parses one response of a measurement command received after
+      urg_start_measurement() and stores the data in ranges and intensities
+      like urg_get_ranges_intensity_f32(). The response spans from the echoback
+      to the empty line terminating it.
+
+      Does not use urg_t, hence it can be called from another thread than the
+      one receiving the data. The data is received by waiting on the file
+      descriptor returned by connection_descriptor() and reading it with
+      connection_peek().
+
+      \param[in] response Response
+      \param[in] size Number of bytes of the response
+      \param[out] ranges Distance data array [m]
+      \param[out] intensities Intensity data array, not stored if NULL
+      \param[in] max_size Number of elements of ranges and intensities
+      \param[in] check_sum Validates the checksums if not 0
+      \param[out] time_stamp Timestamp [msec]
+
+      \retval >0 Number of data points received
+      \retval 0 Response without data (acknowledgement of the measurement start, QT response)
+      \retval <0 Error
+
+      In multiecho mode, ranges and intensities use #URG_MAX_ECHO elements per step.
+
+      \~
+      \see urg_get_ranges_intensity_f32(), connection_descriptor()
+    */
+    extern int urg_parse_ranges_f32(const char response[], int size,
+                                    float ranges[], float intensities[],
+                                    int max_size, int check_sum,
+                                    long *time_stamp);
+
+
     /*!
       \~japanese
       \brief v𒆒fA[U܂
@@ -842,6 +1081,8 @@ extern "C" {
 
       f[^́A܂Ƃ߂f[^̂AԏȒl̃f[^p܂B
 
+      ݒ肵͈͂̊ef[^ cos, sin e[uɌvZAurg_get_xy() Ŏg܂B
+
       \~english
       \brief Configure measurement parameters
 
@@ -877,6 +1118,8 @@ extern "C" {
       \endverbatim
 
       for each group, the smallest range value is returned.
+
+      The cos and sin of each data point of the range are computed into a table used by urg_get_xy().
       \~
       Example
       \code
@@ -889,7 +1132,7 @@ extern "C" {
       } \endcode
 
       \~
-      \see urg_step_min_max(), urg_rad2step(), urg_deg2step()
+      \see urg_step_min_max(), urg_rad2step(), urg_deg2step(), urg_get_xy()
     */
     extern int urg_set_scanning_parameter(urg_t *urg, int first_step,
                                           int last_step, int skip_step);
@@ -1142,6 +1385,39 @@ extern "C" {
     extern void urg_set_error_handler(urg_t *urg, urg_error_handler handler);
 
 
+    /*!
+      \~japanese
+      \brief Mr̃f[^ʒmnho^
+
+      urg_get_distance() Ȃǂ̌vf[^擾֐AXLŜ̎M҂ɁAsector_steps ̃f[^̃fR[h邲Ƃ handler Ăяo悤ɂȂBŌ̃ZN^ sector_steps 菭ȂꍇB
+
+      handler Ă΂ꂽ_ŁA data  time_stamp ̂ first_index + steps ܂ł͊i[ς݂łB}`GR[̏ꍇAʒmꂽXebvׂ̂ẴGR[i[ς݂łB
+
+      \param[in,out] urg URG ZTǗ
+      \param[in] handler nhBNULL œo^
+      \param[in] sector_steps ʒmf[^̒P
+      \param[in] context handler ɓn|C^
+
+      \attention urg_open() ͓o^܂B
+
+      \~english
+      \brief Registers a handler notified of partially received data
+
+      The measurement functions such as urg_get_distance() call handler each time sector_steps data points have been decoded, without waiting for the whole scan. The last sector may be shorter than sector_steps.
+
+      When handler is called, time_stamp and the data up to first_index + steps have been stored in the arguments of the measurement function. In multiecho mode, all the echoes of the notified steps have been stored.
+
+      \param[in,out] urg URG control structure
+      \param[in] handler Handler, NULL to unregister it
+      \param[in] sector_steps Number of data points per notification
+      \param[in] context Pointer passed to handler
+
+      \attention urg_open() unregisters the handler.
+    */
+    extern void urg_set_sector_handler(urg_t *urg, urg_sector_handler handler,
+                                       int sector_steps, void *context);
+
+
     /*!
       \~japanese
       \brief SCIP ̃fR[hs
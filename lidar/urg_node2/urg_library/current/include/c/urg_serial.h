@@ -79,6 +79,14 @@ extern int serial_readline(urg_serial_t *serial,
                            char *data, int max_size, int timeout);
 
 
+//! \~japanese Mf[^Rs[ɎQƂ  \~english Refers to the received data without copying it
+extern int serial_peek(urg_serial_t *serial, const char **data, int timeout);
+
+
+//! \~japanese serial_peek() ŎQƂf[^菜  \~english Removes the data referred by serial_peek()
+extern void serial_consume(urg_serial_t *serial, int size);
+
+
 //! \~japanese G[i[ĕԂ  \~english Stores the serial error message
 extern int serial_error(urg_serial_t *serial,
                         char *error_message, int max_size);
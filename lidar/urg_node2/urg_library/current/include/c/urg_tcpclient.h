@@ -30,8 +30,9 @@ extern "C" {
 // For urg_ringbuffer.h
 // The size of buffer must be specified by the power of 2
 // i.e. ring buffer size = two to the RB_BITSHIFT-th power.
+// Large enough to receive a whole scan with few recv() calls.
 enum {
-    RB_BITSHIFT = 8,
+    RB_BITSHIFT = 12,
     RB_SIZE = 1 << RB_BITSHIFT,
 
     // caution ! available buffer size is less than the
@@ -53,6 +54,7 @@ typedef struct {
 
     // line reading functions
     int pushed_back; // for pushded back char
+    char peek_ch;    // pushed back char referred by tcpclient_peek()
 
 } urg_tcpclient_t;
 // -- end of NON INTERFACE definitions --
@@ -126,6 +128,30 @@ extern int tcpclient_error(urg_tcpclient_t* cli,
 extern int tcpclient_readline(urg_tcpclient_t* cli,
                               char* userbuf, int buf_size, int timeout);
 
+
+/*!
+  \brief refer to the received data without copying it.
+
+  receives directly into the ring buffer when no data is buffered.
+  the data stays valid until tcpclient_consume() or other read functions are called.
+
+  \param[in,out] cli : tcp client type variable which must be deallocated by a caller after closing.
+  \param[out] data : pointer to the received data.
+  \param[in] timeout : time out specification which unit is millisecond, 0 does not wait.
+
+  \return the number of data which can be referred, -1 when error.
+*/
+extern int tcpclient_peek(urg_tcpclient_t* cli, const char** data, int timeout);
+
+
+/*!
+  \brief remove the data referred by tcpclient_peek().
+
+  \param[in,out] cli : tcp client type variable which must be deallocated by a caller after closing.
+  \param[in] size : data size to remove in byte.
+*/
+extern void tcpclient_consume(urg_tcpclient_t* cli, int size);
+
 #ifdef __cplusplus
 }
 #endif
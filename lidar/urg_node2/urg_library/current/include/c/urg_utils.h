@@ -288,6 +288,73 @@ extern "C" {
     */
     extern int urg_step2index(const urg_t *urg, int step);
 
+    /*!
+      \~japanese
+      \brief f[^ X-Y Wւ̕ϊ
+
+      ZTʂ X ̕Ƃ݂ȂWnŁAf[^̈ʒuvZ܂B
+      urg_set_scanning_parameter() ŌvZς݂ cos, sin ̃e[ug߁AOp֐Ăяo܂B
+
+      points ɂ x, y (intensities w肵Ƃ x, y, intensity) ̏Ƀf[^ƂɊi[܂B
+      W̒Pʂ ranges ƓłBranges  NaN ̃f[^̍W NaN ɂȂ܂B
+
+      \param[in] urg URG ZTǗ
+      \param[in] ranges f[^ (urg_get_ranges_f32() Ŏ擾)
+      \param[in] intensities xf[^ANULL ̂Ƃ͊i[Ȃ
+      \param[in] data_n f[^
+      \param[out] points WBdata_n * 2 (intensities w肵Ƃ data_n * 3) ̗vfKv
+
+      \retval >=0 ϊf[^
+      \retval <0 G[
+
+      }`GR[̃f[^ɂ͎g܂B
+
+      Example
+      \code
+      int n = urg_get_ranges_f32(&urg, ranges, NULL);
+      urg_get_xy(&urg, ranges, NULL, n, points);
+      for (int i = 0; i < n; ++i) {
+          printf("%.3f, %.3f\n", points[2 * i], points[2 * i + 1]);
+      } \endcode
+
+      \~english
+      \brief Converts distance data to X-Y coordinates
+
+      Calculates the coordinates of the distance data, having the X axis
+      aligned to the front step of the sensor. Uses the cos and sin tables
+      computed by urg_set_scanning_parameter(), no trigonometric functions
+      are called.
+
+      points receives x, y (x, y, intensity if intensities is given) per data point.
+      The coordinates are in the unit of ranges. The coordinates of a NaN range are NaN.
+
+      \param[in] urg URG control structure
+      \param[in] ranges Distance data (as given by urg_get_ranges_f32())
+      \param[in] intensities Intensity data, not stored if NULL
+      \param[in] data_n Number of data points
+      \param[out] points Coordinates, requires data_n * 2 (data_n * 3 if intensities is given) elements
+
+      \retval >=0 Number of converted data points
+      \retval <0 Error
+
+      Not applicable to multiecho data.
+
+      Example
+      \code
+      int n = urg_get_ranges_f32(&urg, ranges, NULL);
+      urg_get_xy(&urg, ranges, NULL, n, points);
+      for (int i = 0; i < n; ++i) {
+          printf("%.3f, %.3f\n", points[2 * i], points[2 * i + 1]);
+      } \endcode
+
+      \~
+      \see urg_get_ranges_f32(), urg_set_scanning_parameter(), urg_index2rad()
+    */
+    extern int urg_get_xy(const urg_t *urg, const float ranges[],
+                          const float intensities[], int data_n,
+                          float points[]);
+
+
     /*!
        \~japanese
        \brief w肵ԑ҂
@@ -25,7 +25,8 @@
 int main(int argc, char *argv[])
 {
     urg_t urg;
-    long *data;
+    float *ranges;
+    float *points;
     long max_distance;
     long min_distance;
     long time_stamp;
@@ -36,8 +37,9 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    data = (long *)malloc(urg_max_data_size(&urg) * sizeof(data[0]));
-    if (!data) {
+    ranges = (float *)malloc(urg_max_data_size(&urg) * sizeof(ranges[0]));
+    points = (float *)malloc(urg_max_data_size(&urg) * 2 * sizeof(points[0]));
+    if (!ranges || !points) {
         perror("urg_max_index()");
         return 1;
     }
@@ -45,19 +47,24 @@ int main(int argc, char *argv[])
     // \~japanese f[^擾
     // \~english Gets measurement data
     urg_start_measurement(&urg, URG_DISTANCE, 1, 0, 1);
-    n = urg_get_distance(&urg, data, &time_stamp);
+    n = urg_get_ranges_f32(&urg, ranges, &time_stamp);
     if (n < 0) {
-        printf("urg_get_distance: %s\n", urg_error(&urg));
+        printf("urg_get_ranges_f32: %s\n", urg_error(&urg));
         urg_close(&urg);
         return 1;
     }
 
+    // \~japanese X-Y Wnւ̕ϊBpx̃e[ug cos, sin ͕sv
+    // \~english Converts to X-Y coordinates. Uses the angle table, cos and sin are not needed
+    urg_get_xy(&urg, ranges, NULL, n, points);
+
     // \~japanese X-Y Wn̒lo
     // \~english Outputs X-Y coordinates
     urg_distance_min_max(&urg, &min_distance, &max_distance);
     for (i = 0; i < n; ++i) {
-        long distance = data[i];
-        double radian;
+        // \~japanese vłȂf[^̋ NaN
+        // \~english The distance of the data points without a measurement is NaN
+        long distance = isnan(ranges[i]) ? 0 : (long)(ranges[i] * 1000.0f + 0.5f);
         long x;
         long y;
 
@@ -65,9 +72,8 @@ int main(int argc, char *argv[])
             continue;
         }
 
-        radian = urg_index2rad(&urg, i);
-        x = (long)(distance * cos(radian));
-        y = (long)(distance * sin(radian));
+        x = (long)(points[2 * i] * 1000.0f);
+        y = (long)(points[2 * i + 1] * 1000.0f);
 
         printf("%ld, %ld\n", x, y);
     }
@@ -75,7 +81,8 @@ int main(int argc, char *argv[])
 
     // \~japanese ؒf
     // \~english Disconnects
-    free(data);
+    free(points);
+    free(ranges);
     urg_close(&urg);
 
 #if defined(URG_MSC)
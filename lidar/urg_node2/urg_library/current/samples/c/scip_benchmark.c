@@ -0,0 +1,832 @@
+/*!
+  \example scip_benchmark.c Measures the CPU time spent on receiving SCIP data
+
+  Streams a recorded sensor response (or a synthetic 1081 step MD
+  response) over a loopback TCP connection and reports the CPU time per
+  scan of the line reader and of the zero-copy reader. Then decodes the
+  data lines with every instruction set supported by the CPU, line by line
+  and as a stream of received segments, and compares the results with the
+  previous decoder. Finally compares urg_get_xy() with computing the X-Y
+  coordinates with cos and sin per data point.
+
+  usage: scip_benchmark [recorded_file] [scans]
+
+  A recording is the raw data received from the sensor, e.g.
+  (echo MD0000108000000; sleep 1) | nc 192.168.0.10 10940 > md.scip
+
+  $Id$
+*/
+
+#include "urg_detect_os.h"
+#include "urg_tcpclient.h"
+#include "urg_sensor.h"
+#include "urg_utils.h"
+#include "urg_errno.h"
+#include "urg_scip_decoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(URG_WINDOWS_OS)
+
+int main(void)
+{
+    printf("scip_benchmark is not supported on Windows.\n");
+    return 0;
+}
+
+#else
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+
+enum {
+    STEPS = 1081,
+    LINE_SIZE = 64,
+    READ_TIMEOUT_MSEC = 1000,
+    SEGMENT_SIZE = 1448,        // TCP payload of an Ethernet frame
+    BUFFER_SIZE = 64 + 2 + 6,
+    MAX_LINES = 200,
+};
+
+
+static char checksum(const char *data, int size)
+{
+    int sum = 0;
+    int i;
+
+    for (i = 0; i < size; ++i) {
+        sum += data[i];
+    }
+    return (sum & 0x3f) + 0x30;
+}
+
+
+// Stores the SCIP encoding of a value in size characters
+static int encode(char *data, long value, int size)
+{
+    int i;
+
+    for (i = size - 1; i >= 0; --i) {
+        data[i] = (value & 0x3f) + 0x30;
+        value >>= 6;
+    }
+    return size;
+}
+
+
+// Creates a response to a Mx or Nx command with STEPS steps, the multiecho
+// responses have a second echo every 5th and a third echo every 15th step
+static int create_response(char *data, const char *command)
+{
+    char encoded[STEPS * 3 * 2 * URG_MAX_ECHO * 2];
+    char *p = data;
+    int each_size = (command[1] == 'S') ? 2 : 3;
+    int is_intensity = (command[1] == 'E');
+    int is_multiecho = (command[0] == 'N');
+    int filled = 0;
+    int i;
+
+    p += sprintf(p, "%s0000%04d00000\n99b\n", command, STEPS - 1);
+    encode(p, 123456, 4);
+    p[4] = checksum(p, 4);
+    p[5] = '\n';
+    p += 6;
+
+    for (i = 0; i < STEPS; ++i) {
+        int echoes = !is_multiecho ? 1 : (i % 15 == 0) ? 3 : (i % 5 == 0) ? 2 : 1;
+        int echo;
+        for (echo = 0; echo < echoes; ++echo) {
+            if (echo > 0) {
+                encoded[filled++] = '&';
+            }
+            filled += encode(&encoded[filled],
+                             (500 + (i * 37) % 29500 + echo * 1000) % (1 << (6 * each_size)),
+                             each_size);
+            if (is_intensity) {
+                filled += encode(&encoded[filled], (i * 101) % 4000, each_size);
+            }
+        }
+    }
+    for (i = 0; i < filled; i += LINE_SIZE) {
+        int n = (filled - i > LINE_SIZE) ? LINE_SIZE : filled - i;
+        memcpy(p, &encoded[i], n);
+        p[n] = checksum(&encoded[i], n);
+        p[n + 1] = '\n';
+        p += n + 2;
+    }
+    *p++ = '\n';
+    return p - data;
+}
+
+
+static char *load_file(const char *path, int *size)
+{
+    FILE *fd = fopen(path, "rb");
+    char *data;
+    long n;
+
+    if (!fd) {
+        return NULL;
+    }
+    fseek(fd, 0, SEEK_END);
+    n = ftell(fd);
+    fseek(fd, 0, SEEK_SET);
+    data = malloc(n > 0 ? n : 1);
+    if (data && (long)fread(data, 1, n, fd) != n) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fd);
+    *size = (int)n;
+    return data;
+}
+
+
+// Number of responses in the data, each terminated by an empty line
+static int count_responses(const char *data, int size)
+{
+    int n = 0;
+    int i;
+
+    for (i = 1; i < size; ++i) {
+        if (data[i] == '\n' && data[i - 1] == '\n') {
+            ++n;
+        }
+    }
+    return n;
+}
+
+
+// Sends the data repeatedly to the first client connecting to the port
+static pid_t start_server(const char *data, int size, int repeat, int *port)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_size = sizeof(addr);
+    int one = 1;
+    pid_t pid;
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(sock, 1) < 0 ||
+        getsockname(sock, (struct sockaddr *)&addr, &addr_size) < 0) {
+        close(sock);
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+
+    pid = fork();
+    if (pid == 0) {
+        int client = accept(sock, NULL, NULL);
+        int i;
+        signal(SIGPIPE, SIG_IGN);
+        for (i = 0; i < repeat; ++i) {
+            int sent = 0;
+            while (sent < size) {
+                int n = send(client, &data[sent], size - sent, 0);
+                if (n <= 0) {
+                    _exit(1);
+                }
+                sent += n;
+            }
+        }
+        close(client);
+        _exit(0);
+    }
+    close(sock);
+    return pid;
+}
+
+
+// Previous line reader, reads one character at a time
+static int readline_bytewise(urg_tcpclient_t* cli,
+                             char* userbuf, int buf_size, int timeout)
+{
+    int n = 0;
+    int i = 0;
+
+    if (cli->pushed_back > 0) {
+        userbuf[i] = cli->pushed_back;
+        i++;
+        cli->pushed_back = -1;
+    }
+    for (; i < buf_size; ++i) {
+        char ch;
+        n = tcpclient_read(cli, &ch, 1, timeout);
+        if (n <= 0) {
+            break;
+        }
+        if ((ch == '\r') || (ch == '\n')) {
+            break;
+        }
+        userbuf[i] = ch;
+    }
+
+    if (i >= buf_size) {
+        --i;
+        cli->pushed_back = userbuf[buf_size - 1] & 0xff;
+        userbuf[buf_size - 1] = '\0';
+    }
+    userbuf[i] = '\0';
+
+    if (i == 0 && n <= 0) {
+        return -1;
+    }
+    return i;
+}
+
+
+static double cpu_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+enum {
+    READ_BYTEWISE,              // previous line reader
+    READ_LINE,                  // tcpclient_readline()
+    READ_PEEK,                  // tcpclient_peek(), without copying
+};
+
+
+// Reads all lines sent by the server and returns the CPU time in s
+static double measure_readline(const char *name, int mode,
+                      const char *data, int size, int repeat, int responses)
+{
+    enum { BUFFER_SIZE = 128 };
+    char line[BUFFER_SIZE];
+    urg_tcpclient_t cli;
+    long lines = 0;
+    long bytes = 0;
+    double start;
+    double elapsed;
+    int port;
+    int n;
+    pid_t pid = start_server(data, size, repeat, &port);
+
+    if (pid < 0 || tcpclient_open(&cli, "127.0.0.1", port) < 0) {
+        fprintf(stderr, "could not connect to the server.\n");
+        exit(1);
+    }
+
+    start = cpu_time();
+    do {
+        if (mode == READ_PEEK) {
+            const char *p;
+            const char *last_p;
+            n = tcpclient_peek(&cli, &p, READ_TIMEOUT_MSEC);
+            if (n <= 0) {
+                break;
+            }
+            bytes += n;
+            for (last_p = p + n; (p = memchr(p, '\n', last_p - p)); ++p) {
+                ++lines;
+            }
+            tcpclient_consume(&cli, n);
+            continue;
+        } else if (mode == READ_BYTEWISE) {
+            n = readline_bytewise(&cli, line, BUFFER_SIZE, READ_TIMEOUT_MSEC);
+        } else {
+            n = tcpclient_readline(&cli, line, BUFFER_SIZE, READ_TIMEOUT_MSEC);
+        }
+        if (n >= 0) {
+            ++lines;
+            bytes += n + 1;
+        }
+    } while (n >= 0);
+    elapsed = cpu_time() - start;
+
+    tcpclient_close(&cli);
+    waitpid(pid, NULL, 0);
+
+    printf("%-10s %8ld lines %10ld bytes %8.3f us/scan\n",
+           name, lines, bytes, elapsed * 1e6 / ((double)repeat * responses));
+    return elapsed;
+}
+
+
+// Data lines of a measurement response
+typedef struct {
+    const char *data;           // data lines up to the terminating empty line
+    int data_size;
+    const char *lines[MAX_LINES];
+    int sizes[MAX_LINES];
+    int line_count;
+    int each_size;
+    int is_intensity;
+    int is_multiecho;
+    int max_steps;
+} scan_t;
+
+
+// Splits the next response into lines, returns the size of the response
+static int parse_response(const char *data, int size, scan_t *scan)
+{
+    const char *p = data;
+    const char *last_p = data + size;
+    const char *lines[MAX_LINES + 4];
+    int sizes[MAX_LINES + 4];
+    int n = 0;
+    int header_lines;
+    int i;
+
+    while (p < last_p && n < MAX_LINES + 4) {
+        const char *lf = memchr(p, '\n', last_p - p);
+        if (!lf) {
+            break;
+        }
+        lines[n] = p;
+        sizes[n] = (int)(lf - p);
+        ++n;
+        p = lf + 1;
+        if (sizes[n - 1] == 0) {
+            break;
+        }
+    }
+
+    // echoback, status, timestamp (and I/O) lines
+    scan->line_count = 0;
+    if (n < 4 || (sizes[0] != 12 && sizes[0] != 15) ||
+        (strncmp(lines[1], "99", 2) && strncmp(lines[1], "00", 2))) {
+        return (int)(p - data);
+    }
+    scan->each_size = (lines[0][1] == 'S') ? 2 : 3;
+    scan->is_intensity = (lines[0][1] == 'E') || (lines[0][1] == 'G');
+    scan->is_multiecho = (lines[0][0] == 'H') || (lines[0][0] == 'N');
+    {
+        char first[5] = { 0 };
+        char last[5] = { 0 };
+        memcpy(first, &lines[0][2], 4);
+        memcpy(last, &lines[0][6], 4);
+        scan->max_steps = atoi(last) - atoi(first) + 1;
+    }
+    header_lines = ((lines[0][1] == 'F') || (lines[0][1] == 'G')) ? 4 : 3;
+
+    scan->data = lines[header_lines];
+    scan->data_size = (int)(p - scan->data);
+    for (i = header_lines; i < n - 1; ++i) {
+        scan->lines[scan->line_count] = lines[i];
+        scan->sizes[scan->line_count] = sizes[i];
+        ++scan->line_count;
+    }
+    return (int)(p - data);
+}
+
+
+// Previous decoder of receive_length_data()
+static int decode_bytewise(const scan_t *scan,
+                           long length[], unsigned short intensity[])
+{
+    char buffer[BUFFER_SIZE];
+    int step_filled = 0;
+    int line_filled = 0;
+    int multiecho_index = 0;
+    int each_size = scan->each_size;
+    int data_size = scan->is_intensity ? 2 * each_size : each_size;
+    int multiecho_max_size = scan->is_multiecho ? URG_MAX_ECHO : 1;
+    int line;
+
+    for (line = 0; line < scan->line_count; ++line) {
+        char *p = buffer;
+        char *last_p;
+        int n = scan->sizes[line];
+
+        memcpy(&buffer[line_filled], scan->lines[line], n);
+        if (buffer[line_filled + n - 1] !=
+            checksum(&buffer[line_filled], n - 1)) {
+            return URG_CHECKSUM_ERROR;
+        }
+        line_filled += n - 1;
+        last_p = p + line_filled;
+
+        while ((last_p - p) >= data_size) {
+            int index;
+
+            if (*p == '&') {
+                if ((last_p - (p + 1)) < data_size) {
+                    break;
+                }
+                --step_filled;
+                ++multiecho_index;
+                ++p;
+                --line_filled;
+            } else {
+                multiecho_index = 0;
+            }
+
+            index = (step_filled * multiecho_max_size) + multiecho_index;
+            if (step_filled >= scan->max_steps) {
+                return URG_RECEIVE_ERROR;
+            }
+
+            if (scan->is_multiecho && (multiecho_index == 0)) {
+                int i;
+                for (i = 1; i < multiecho_max_size; ++i) {
+                    length[index + i] = 0;
+                    intensity[index + i] = 0;
+                }
+            }
+            length[index] = urg_scip_decode(p, each_size);
+            p += each_size;
+            if (scan->is_intensity) {
+                intensity[index] = (unsigned short)urg_scip_decode(p, each_size);
+                p += each_size;
+            }
+            ++step_filled;
+            line_filled -= data_size;
+        }
+        memmove(buffer, p, line_filled);
+    }
+    return step_filled;
+}
+
+
+static int decode_lines(const scan_t *scan, scip_decode_function_t function,
+                        long length[], unsigned short intensity[])
+{
+    char buffer[BUFFER_SIZE];
+    scip_decoder_t decoder;
+    int line;
+
+    scip_decoder_initialize(&decoder, length, intensity, SCIP_OUTPUT_LONG,
+                            scan->each_size, scan->is_intensity,
+                            scan->is_multiecho, scan->max_steps);
+    decoder.decode = function;
+    for (line = 0; line < scan->line_count; ++line) {
+        int ret;
+        memcpy(buffer, scan->lines[line], scan->sizes[line]);
+        ret = scip_decoder_line(&decoder, buffer, scan->sizes[line], 1);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return decoder.steps;
+}
+
+
+// Decodes the data lines as received in segments of chunk_size bytes
+static int decode_stream(const scan_t *scan, scip_decode_function_t function,
+                         int chunk_size, scip_output_format_t format,
+                         void *length, void *intensity)
+{
+    scip_decoder_t decoder;
+    int offset = 0;
+
+    scip_decoder_initialize(&decoder, length, intensity, format,
+                            scan->each_size, scan->is_intensity,
+                            scan->is_multiecho, scan->max_steps);
+    decoder.decode = function;
+    while (!decoder.is_complete && offset < scan->data_size) {
+        int size = scan->data_size - offset;
+        int n;
+        if (size > chunk_size) {
+            size = chunk_size;
+        }
+        n = scip_decoder_push(&decoder, &scan->data[offset], size, 1);
+        if (n < 0) {
+            return n;
+        }
+        offset += n;
+    }
+    return decoder.is_complete ? decoder.steps : URG_RECEIVE_ERROR;
+}
+
+
+// Conversion of urg_node2 before urg_get_ranges_intensity_f32()
+static void convert_ranges(int steps, const long length[],
+                           const unsigned short intensity[],
+                           float ranges[], float intensities[])
+{
+    int i;
+
+    for (i = 0; i < steps; ++i) {
+        if (length[i] != 0) {
+            ranges[i] = (float)length[i] / 1000.0;
+            intensities[i] = intensity[i];
+        } else {
+            ranges[i] = NAN;
+            intensities[i] = 0.0f;
+        }
+    }
+}
+
+
+// Compares decoding to meters with decoding to long and converting
+static int measure_ranges(const scan_t *scans, int scan_count, int repeat)
+{
+    static const char *names[] = { "long+convert", "u32", "f32" };
+    static long length[STEPS];
+    static unsigned short intensity[STEPS];
+    static float expected_ranges[STEPS];
+    static float expected_intensities[STEPS];
+    static float ranges[STEPS];
+    static float intensities[STEPS];
+    scip_decode_function_t function = scip_decode_function(SCIP_DECODE_AUTO);
+    int mismatch = 0;
+    int format;
+    int i;
+
+    if (scans[0].is_multiecho) {
+        return 0;
+    }
+
+    for (i = 0; i < scan_count; ++i) {
+        uint32_t *length_u32 = (uint32_t *)ranges;
+        int steps;
+        int n;
+        int j;
+
+        memset(intensity, 0, sizeof(intensity));
+        steps = decode_stream(&scans[i], function, SEGMENT_SIZE,
+                              SCIP_OUTPUT_LONG, length, intensity);
+        convert_ranges(steps, length, intensity,
+                       expected_ranges, expected_intensities);
+        n = decode_stream(&scans[i], function, 7, SCIP_OUTPUT_F32,
+                          ranges, intensities);
+        if (n != steps ||
+            memcmp(ranges, expected_ranges, steps * sizeof(float)) ||
+            (scans[i].is_intensity &&
+             memcmp(intensities, expected_intensities, steps * sizeof(float)))) {
+            printf("f32: scan %d differs from the converted distances\n", i);
+            mismatch = 1;
+        }
+        n = decode_stream(&scans[i], function, 7, SCIP_OUTPUT_U32,
+                          length_u32, NULL);
+        for (j = 0; j < n; ++j) {
+            if (length_u32[j] != (uint32_t)length[j]) {
+                break;
+            }
+        }
+        if (n != steps || j < n) {
+            printf("u32: scan %d differs from the distances\n", i);
+            mismatch = 1;
+        }
+    }
+
+    for (format = SCIP_OUTPUT_LONG; format <= SCIP_OUTPUT_F32; ++format) {
+        double start = cpu_time();
+        double elapsed;
+        int r;
+        for (r = 0; r < repeat; ++r) {
+            for (i = 0; i < scan_count; ++i) {
+                if (format == SCIP_OUTPUT_LONG) {
+                    int steps = decode_stream(&scans[i], function, SEGMENT_SIZE,
+                                              SCIP_OUTPUT_LONG,
+                                              length, intensity);
+                    convert_ranges(steps, length, intensity,
+                                   ranges, intensities);
+                } else {
+                    decode_stream(&scans[i], function, SEGMENT_SIZE,
+                                  (scip_output_format_t)format,
+                                  ranges, (format == SCIP_OUTPUT_F32) ?
+                                  (void *)intensities : (void *)intensity);
+                }
+            }
+        }
+        elapsed = cpu_time() - start;
+        printf("output %-12s %8.3f us/scan\n", names[format],
+               elapsed * 1e6 / ((double)repeat * scan_count));
+    }
+    return mismatch;
+}
+
+
+// Decodes every scan with every instruction set and compares the results
+static int measure_decode(const char *data, int size, int repeat)
+{
+    static const char *names[] = { "scalar", "sse4.1", "avx2", "neon" };
+    enum { ARRAY_SIZE = STEPS * URG_MAX_ECHO };
+    static long expected_length[ARRAY_SIZE];
+    static unsigned short expected_intensity[ARRAY_SIZE];
+    static long length[ARRAY_SIZE];
+    static unsigned short intensity[ARRAY_SIZE];
+    static scan_t scans[64];
+    int scan_count = 0;
+    int offset = 0;
+    int mismatch = 0;
+    int isa;
+    int i;
+
+    while (offset < size && scan_count < 64) {
+        offset += parse_response(&data[offset], size - offset, &scans[scan_count]);
+        if (scans[scan_count].line_count > 0 &&
+            scans[scan_count].max_steps <= STEPS) {
+            ++scan_count;
+        }
+    }
+    if (scan_count == 0) {
+        printf("no measurement data to decode.\n");
+        return 0;
+    }
+
+    for (isa = -1; isa <= SCIP_DECODE_NEON; ++isa) {
+        scip_decode_function_t function =
+            (isa < 0) ? NULL : scip_decode_function((scip_decode_isa_t)isa);
+        double start;
+        double elapsed;
+        int r;
+
+        if (isa >= 0 && !function) {
+            continue;
+        }
+
+        // compares the results with the previous decoder, the stream is
+        // also split at every position
+        for (i = 0; isa >= 0 && i < scan_count; ++i) {
+            static const int chunk_sizes[] = { 0, 1, 7, SEGMENT_SIZE };
+            int steps;
+            int j;
+            memset(expected_length, 0xff, sizeof(expected_length));
+            memset(expected_intensity, 0xff, sizeof(expected_intensity));
+            steps = decode_bytewise(&scans[i], expected_length, expected_intensity);
+            for (j = 0; j < (int)(sizeof(chunk_sizes) / sizeof(chunk_sizes[0])); ++j) {
+                int n;
+                memset(length, 0xff, sizeof(length));
+                memset(intensity, 0xff, sizeof(intensity));
+                if (chunk_sizes[j] == 0) {
+                    n = decode_lines(&scans[i], function, length, intensity);
+                } else {
+                    n = decode_stream(&scans[i], function, chunk_sizes[j],
+                                      SCIP_OUTPUT_LONG, length, intensity);
+                }
+                if (n != steps ||
+                    memcmp(length, expected_length, sizeof(length)) ||
+                    (scans[i].is_intensity &&
+                     memcmp(intensity, expected_intensity, sizeof(intensity)))) {
+                    printf("%s: scan %d differs from the previous decoder"
+                           " (segment size %d)\n", names[isa], i, chunk_sizes[j]);
+                    mismatch = 1;
+                }
+            }
+        }
+
+        start = cpu_time();
+        for (r = 0; r < repeat; ++r) {
+            for (i = 0; i < scan_count; ++i) {
+                if (isa < 0) {
+                    decode_bytewise(&scans[i], length, intensity);
+                } else {
+                    decode_lines(&scans[i], function, length, intensity);
+                }
+            }
+        }
+        elapsed = cpu_time() - start;
+        printf("decode %-10s %8.3f us/scan\n", (isa < 0) ? "bytewise" : names[isa],
+               elapsed * 1e6 / ((double)repeat * scan_count));
+        if (isa < 0) {
+            continue;
+        }
+
+        start = cpu_time();
+        for (r = 0; r < repeat; ++r) {
+            for (i = 0; i < scan_count; ++i) {
+                decode_stream(&scans[i], function, SEGMENT_SIZE,
+                              SCIP_OUTPUT_LONG, length, intensity);
+            }
+        }
+        elapsed = cpu_time() - start;
+        printf("stream %-10s %8.3f us/scan\n", names[isa],
+               elapsed * 1e6 / ((double)repeat * scan_count));
+    }
+
+    mismatch |= measure_ranges(scans, scan_count, repeat);
+    return mismatch;
+}
+
+
+// Converts a scan to X-Y coordinates with urg_get_xy() and with cos and
+// sin per data point as calculate_xy.c did
+static int measure_xy(int repeat)
+{
+    static urg_t urg;
+    static float ranges[STEPS];
+    static float intensities[STEPS];
+    static float expected[STEPS * 3];
+    static float points[STEPS * 3];
+    int mismatch = 0;
+    int with_intensity;
+    int i;
+
+    // UTM-30LX parameters, as received by urg_open()
+    urg_t_initialize(&urg);
+    urg.is_active = 1;
+    urg.area_resolution = 1440;
+    urg.first_data_index = 0;
+    urg.last_data_index = STEPS - 1;
+    urg.front_data_index = 540;
+    urg_set_scanning_parameter(&urg, -540, 540, 0);
+    urg.received_first_index = 0;
+
+    for (i = 0; i < STEPS; ++i) {
+        ranges[i] = (i % 50 == 0) ? NAN : 0.5f + (i * 37 % 29500) / 1000.0f;
+        intensities[i] = (float)(i * 101 % 4000);
+    }
+
+    for (with_intensity = 0; with_intensity <= 1; ++with_intensity) {
+        const float *v = with_intensity ? intensities : NULL;
+        int stride = with_intensity ? 3 : 2;
+        double trig_time;
+        double start;
+        int r;
+
+        start = cpu_time();
+        for (r = 0; r < repeat; ++r) {
+            for (i = 0; i < STEPS; ++i) {
+                double radian = urg_index2rad(&urg, i);
+                expected[stride * i] = (float)(ranges[i] * cos(radian));
+                expected[stride * i + 1] = (float)(ranges[i] * sin(radian));
+                if (v) {
+                    expected[stride * i + 2] = v[i];
+                }
+            }
+        }
+        trig_time = cpu_time() - start;
+
+        start = cpu_time();
+        for (r = 0; r < repeat; ++r) {
+            urg_get_xy(&urg, ranges, v, STEPS, points);
+        }
+        printf("xy%-3s cos/sin %8.3f us/scan, urg_get_xy %8.3f us/scan\n",
+               with_intensity ? "+i" : "",
+               trig_time * 1e6 / repeat, (cpu_time() - start) * 1e6 / repeat);
+
+        for (i = 0; i < STEPS * stride; ++i) {
+            if (isnan(expected[i]) != isnan(points[i]) ||
+                (!isnan(expected[i]) && fabsf(expected[i] - points[i]) > 1e-5f)) {
+                printf("xy: point %d differs\n", i / stride);
+                mismatch = 1;
+                break;
+            }
+        }
+    }
+    return mismatch;
+}
+
+
+int main(int argc, char *argv[])
+{
+    static const char *commands[] = { "MD", "ME", "MS", "ND", "NE" };
+    char *data;
+    int size;
+    int responses;
+    int repeat = (argc > 2) ? atoi(argv[2]) : 10000;
+    int ret = 0;
+    double before;
+    double after;
+    int i;
+
+    if (argc > 1) {
+        data = load_file(argv[1], &size);
+        if (!data) {
+            perror(argv[1]);
+            return 1;
+        }
+    } else {
+        data = malloc(STEPS * 32 + 4096);
+        size = create_response(data, "MD");
+    }
+
+    responses = count_responses(data, size);
+    if (responses <= 0) {
+        fprintf(stderr, "no SCIP response found.\n");
+        return 1;
+    }
+    repeat = (repeat + responses - 1) / responses;
+
+    printf("%d bytes, %d scans\n", size, repeat * responses);
+    before = measure_readline("bytewise", READ_BYTEWISE,
+                              data, size, repeat, responses);
+    after = measure_readline("readline", READ_LINE,
+                             data, size, repeat, responses);
+    printf("speedup %.1f\n", before / after);
+    after = measure_readline("peek", READ_PEEK, data, size, repeat, responses);
+    printf("speedup %.1f\n", before / after);
+
+    ret |= measure_decode(data, size, repeat);
+    if (argc <= 1) {
+        // every data format of the synthetic responses
+        for (i = 1; i < (int)(sizeof(commands) / sizeof(commands[0])); ++i) {
+            printf("%s\n", commands[i]);
+            size = create_response(data, commands[i]);
+            ret |= measure_decode(data, size, repeat / 10);
+        }
+    }
+
+    ret |= measure_xy(repeat);
+
+    free(data);
+    return ret;
+}
+
+#endif
@@ -109,3 +109,49 @@ int connection_readline(urg_connection_t *connection,
     }
     return -1;
 }
+
+
+int connection_peek(urg_connection_t *connection,
+                    const char **data, int timeout)
+{
+    switch (connection->type) {
+    case URG_SERIAL:
+        return serial_peek(&connection->serial, data, timeout);
+        break;
+    case URG_ETHERNET:
+        return tcpclient_peek(&connection->tcpclient, data, timeout);
+        break;
+    }
+    return -1;
+}
+
+
+void connection_consume(urg_connection_t *connection, int size)
+{
+    switch (connection->type) {
+    case URG_SERIAL:
+        serial_consume(&connection->serial, size);
+        break;
+    case URG_ETHERNET:
+        tcpclient_consume(&connection->tcpclient, size);
+        break;
+    }
+}
+
+
+int connection_descriptor(const urg_connection_t *connection)
+{
+    switch (connection->type) {
+    case URG_SERIAL:
+#if defined(URG_WINDOWS_OS)
+        return -1;
+#else
+        return connection->serial.fd;
+#endif
+        break;
+    case URG_ETHERNET:
+        return connection->tcpclient.sock_desc;
+        break;
+    }
+    return -1;
+}
@@ -11,6 +11,7 @@
 */
 
 #include "urg_ring_buffer.h"
+#include <string.h>
 
 
 void ring_initialize(ring_buffer_t *ring, char *buffer, const int shift_length)
@@ -45,10 +46,7 @@ int ring_capacity(const ring_buffer_t *ring)
 
 static void byte_move(char *dest, const char *src, int n)
 {
-    const char *last_p = dest + n;
-    while (dest < last_p) {
-        *dest++ = *src++;
-    }
+    memcpy(dest, src, n);
 }
 
 
@@ -80,7 +78,7 @@ int ring_write(ring_buffer_t *ring, const char *data, int size)
     } else {
         // \~japanese last  first ̑O܂Ŕzu
         // \~english Stores data from last towards first
-        byte_move(&ring->buffer[ring->last], data, size);
+        byte_move(&ring->buffer[ring->last], data, push_size);
         ring->last += push_size;
     }
     return push_size;
@@ -120,3 +118,79 @@ int ring_read(ring_buffer_t *ring, char *buffer, int size)
     }
     return pop_size;
 }
+
+
+int ring_peek(const ring_buffer_t *ring, const char **data)
+{
+    *data = &ring->buffer[ring->first];
+    return (ring->first <= ring->last) ?
+        ring->last - ring->first : ring->buffer_size - ring->first;
+}
+
+
+void ring_consume(ring_buffer_t *ring, int size)
+{
+    int now_size = ring_size(ring);
+    int pop_size = (size > now_size) ? now_size : size;
+
+    ring->first = (ring->first + pop_size) & (ring->buffer_size - 1);
+}
+
+
+int ring_reserve(ring_buffer_t *ring, char **data)
+{
+    if (ring->first == ring->last) {
+        // \~japanese ̂Ƃ͐擪珑
+        // \~english Writes from the beginning when the buffer is empty
+        ring_clear(ring);
+    }
+    *data = &ring->buffer[ring->last];
+
+    // \~japanese last  first ɒǂȂ悤A1 vf󂯂Ă
+    // \~english Leaves one element free so that last does not reach first
+    if (ring->first > ring->last) {
+        return ring->first - ring->last - 1;
+    }
+    return ring->buffer_size - ring->last - ((ring->first == 0) ? 1 : 0);
+}
+
+
+void ring_commit(ring_buffer_t *ring, int size)
+{
+    ring->last = (ring->last + size) & (ring->buffer_size - 1);
+}
+
+
+static int find_linefeed(const char *data, int size)
+{
+    const char *lf = memchr(data, '\n', size);
+    const char *cr = memchr(data, '\r', (lf != NULL) ? lf - data : size);
+
+    if (cr != NULL) {
+        return cr - data;
+    } else if (lf != NULL) {
+        return lf - data;
+    }
+    return -1;
+}
+
+
+int ring_find_linefeed(const ring_buffer_t *ring)
+{
+    int n;
+
+    if (ring->first <= ring->last) {
+        return find_linefeed(&ring->buffer[ring->first],
+                             ring->last - ring->first);
+    }
+
+    // \~japanese first  buffer_size I[܂ŁA 0  last ̑O܂ł
+    // \~english Searches from first to the end of the buffer, then from 0 to last
+    n = find_linefeed(&ring->buffer[ring->first],
+                      ring->buffer_size - ring->first);
+    if (n >= 0) {
+        return n;
+    }
+    n = find_linefeed(ring->buffer, ring->last);
+    return (n >= 0) ? ring->buffer_size - ring->first + n : -1;
+}
@@ -0,0 +1,766 @@
+/*!
+  \file
+  \brief Decoder of the measurement data of SCIP responses
+
+  $Id$
+*/
+
+#include "urg_scip_decoder.h"
+#include "urg_sensor.h"
+#include "urg_errno.h"
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define SCIP_DECODE_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define SCIP_DECODE_ARM
+#include <arm_neon.h>
+#endif
+
+enum {
+    DECODE_VALUES = 64,         // values decoded at once
+};
+
+
+// Each character holds 6 bits of the value, offset by 0x30
+static inline unsigned int decode_scalar(const char data[], int count,
+                                         int each_size, int values[])
+{
+    const unsigned char *p = (const unsigned char *)data;
+    unsigned int sum = 0;
+    int i;
+
+    if (each_size == 3) {
+        for (i = 0; i < count; ++i, p += 3) {
+            sum += p[0] + p[1] + p[2];
+            values[i] = (((p[0] - 0x30) & 0x3f) << 12) |
+                (((p[1] - 0x30) & 0x3f) << 6) | ((p[2] - 0x30) & 0x3f);
+        }
+    } else {
+        for (i = 0; i < count; ++i, p += 2) {
+            sum += p[0] + p[1];
+            values[i] = (((p[0] - 0x30) & 0x3f) << 6) | ((p[1] - 0x30) & 0x3f);
+        }
+    }
+    return sum;
+}
+
+
+#if defined(SCIP_DECODE_X86)
+// 16 characters per iteration: 4 values of 3 or 8 values of 2 characters.
+// Inlined into the AVX2 kernel to avoid mixing SSE and AVX instructions.
+static inline __attribute__((always_inline, target("sse4.1")))
+int decode_128(const char data[], int count, int each_size, int values[],
+               unsigned int *sum)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i offset = _mm_set1_epi8(0x30);
+    const __m128i bits = _mm_set1_epi8(0x3f);
+    const int size = count * each_size;
+    __m128i sums = zero;
+    int i = 0;
+
+    if (each_size == 3) {
+        // characters of each value in the low three bytes of a 32 bit lane,
+        // the last character first
+        const __m128i shuffle =
+            _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+        const __m128i used = _mm_setr_epi32(-1, -1, -1, 0);
+        for (; size - i * 3 >= 16; i += 4) {
+            __m128i raw = _mm_loadu_si128((const __m128i *)&data[i * 3]);
+            __m128i x = _mm_shuffle_epi8(
+                _mm_and_si128(_mm_sub_epi8(raw, offset), bits), shuffle);
+            __m128i value = _mm_or_si128(
+                _mm_and_si128(x, _mm_set1_epi32(0x3f)),
+                _mm_or_si128(
+                    _mm_and_si128(_mm_srli_epi32(x, 2), _mm_set1_epi32(0xfc0)),
+                    _mm_and_si128(_mm_srli_epi32(x, 4), _mm_set1_epi32(0x3f000))));
+            sums = _mm_add_epi64(sums, _mm_sad_epu8(_mm_and_si128(raw, used), zero));
+            _mm_storeu_si128((__m128i *)&values[i], value);
+        }
+    } else {
+        for (; size - i * 2 >= 16; i += 8) {
+            __m128i raw = _mm_loadu_si128((const __m128i *)&data[i * 2]);
+            __m128i x = _mm_and_si128(_mm_sub_epi8(raw, offset), bits);
+            __m128i value = _mm_or_si128(
+                _mm_slli_epi16(_mm_and_si128(x, _mm_set1_epi16(0xff)), 6),
+                _mm_srli_epi16(x, 8));
+            sums = _mm_add_epi64(sums, _mm_sad_epu8(raw, zero));
+            _mm_storeu_si128((__m128i *)&values[i], _mm_cvtepu16_epi32(value));
+            _mm_storeu_si128((__m128i *)&values[i + 4],
+                             _mm_cvtepu16_epi32(_mm_srli_si128(value, 8)));
+        }
+    }
+
+    sums = _mm_add_epi64(sums, _mm_srli_si128(sums, 8));
+    *sum += (unsigned int)_mm_cvtsi128_si32(sums);
+    return i;
+}
+
+
+__attribute__((target("sse4.1")))
+static unsigned int decode_sse41(const char data[], int count,
+                                 int each_size, int values[])
+{
+    unsigned int sum = 0;
+    int i = decode_128(data, count, each_size, values, &sum);
+
+    return sum +
+        decode_scalar(&data[i * each_size], count - i, each_size, &values[i]);
+}
+
+
+// 24 characters (8 values) or 32 characters (16 values) per iteration
+__attribute__((target("avx2")))
+static unsigned int decode_avx2(const char data[], int count,
+                                int each_size, int values[])
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i offset = _mm256_set1_epi8(0x30);
+    const __m256i bits = _mm256_set1_epi8(0x3f);
+    const int size = count * each_size;
+    __m256i sums = zero;
+    __m128i sum;
+    unsigned int total;
+    int i = 0;
+
+    if (size < 32) {
+        // too short for 256 bit registers
+        total = 0;
+        i = decode_128(data, count, each_size, values, &total);
+        return total +
+            decode_scalar(&data[i * each_size], count - i, each_size, &values[i]);
+    }
+
+    if (each_size == 3) {
+        // 12 characters in each 128 bit lane
+        const __m256i shuffle =
+            _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                             2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+        const __m256i used = _mm256_setr_epi32(-1, -1, -1, 0, -1, -1, -1, 0);
+        for (; size - i * 3 >= 28; i += 8) {
+            __m256i raw = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(
+                    _mm_loadu_si128((const __m128i *)&data[i * 3])),
+                _mm_loadu_si128((const __m128i *)&data[i * 3 + 12]), 1);
+            __m256i x = _mm256_shuffle_epi8(
+                _mm256_and_si256(_mm256_sub_epi8(raw, offset), bits), shuffle);
+            __m256i value = _mm256_or_si256(
+                _mm256_and_si256(x, _mm256_set1_epi32(0x3f)),
+                _mm256_or_si256(
+                    _mm256_and_si256(_mm256_srli_epi32(x, 2),
+                                     _mm256_set1_epi32(0xfc0)),
+                    _mm256_and_si256(_mm256_srli_epi32(x, 4),
+                                     _mm256_set1_epi32(0x3f000))));
+            sums = _mm256_add_epi64(
+                sums, _mm256_sad_epu8(_mm256_and_si256(raw, used), zero));
+            _mm256_storeu_si256((__m256i *)&values[i], value);
+        }
+    } else {
+        for (; size - i * 2 >= 32; i += 16) {
+            __m256i raw = _mm256_loadu_si256((const __m256i *)&data[i * 2]);
+            __m256i x = _mm256_and_si256(_mm256_sub_epi8(raw, offset), bits);
+            __m256i value = _mm256_or_si256(
+                _mm256_slli_epi16(_mm256_and_si256(x, _mm256_set1_epi16(0xff)), 6),
+                _mm256_srli_epi16(x, 8));
+            sums = _mm256_add_epi64(sums, _mm256_sad_epu8(raw, zero));
+            _mm256_storeu_si256((__m256i *)&values[i],
+                _mm256_cvtepu16_epi32(_mm256_castsi256_si128(value)));
+            _mm256_storeu_si256((__m256i *)&values[i + 8],
+                _mm256_cvtepu16_epi32(_mm256_extracti128_si256(value, 1)));
+        }
+    }
+
+    sum = _mm_add_epi64(_mm256_castsi256_si128(sums),
+                        _mm256_extracti128_si256(sums, 1));
+    sum = _mm_add_epi64(sum, _mm_srli_si128(sum, 8));
+    total = (unsigned int)_mm_cvtsi128_si32(sum);
+    i += decode_128(&data[i * each_size], count - i, each_size, &values[i], &total);
+    _mm256_zeroupper();
+
+    return total +
+        decode_scalar(&data[i * each_size], count - i, each_size, &values[i]);
+}
+#endif
+
+
+#if defined(SCIP_DECODE_ARM)
+// 16 characters per iteration: 4 values of 3 or 8 values of 2 characters
+static unsigned int decode_neon(const char data[], int count,
+                                int each_size, int values[])
+{
+    static const uint8_t shuffle_table[16] = {
+        2, 1, 0, 0xff, 5, 4, 3, 0xff, 8, 7, 6, 0xff, 11, 10, 9, 0xff,
+    };
+    static const uint8_t used_table[16] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0,
+    };
+    const uint8x16_t offset = vdupq_n_u8(0x30);
+    const uint8x16_t bits = vdupq_n_u8(0x3f);
+    const int size = count * each_size;
+    unsigned int sum = 0;
+    int i = 0;
+
+    if (each_size == 3) {
+        const uint8x16_t shuffle = vld1q_u8(shuffle_table);
+        const uint8x16_t used = vld1q_u8(used_table);
+        for (; size - i * 3 >= 16; i += 4) {
+            uint8x16_t raw = vld1q_u8((const uint8_t *)&data[i * 3]);
+            uint32x4_t x = vreinterpretq_u32_u8(
+                vqtbl1q_u8(vandq_u8(vsubq_u8(raw, offset), bits), shuffle));
+            uint32x4_t value = vorrq_u32(
+                vandq_u32(x, vdupq_n_u32(0x3f)),
+                vorrq_u32(vandq_u32(vshrq_n_u32(x, 2), vdupq_n_u32(0xfc0)),
+                          vandq_u32(vshrq_n_u32(x, 4), vdupq_n_u32(0x3f000))));
+            sum += vaddlvq_u8(vandq_u8(raw, used));
+            vst1q_s32(&values[i], vreinterpretq_s32_u32(value));
+        }
+    } else {
+        for (; size - i * 2 >= 16; i += 8) {
+            uint8x16_t raw = vld1q_u8((const uint8_t *)&data[i * 2]);
+            uint16x8_t x = vreinterpretq_u16_u8(
+                vandq_u8(vsubq_u8(raw, offset), bits));
+            uint16x8_t value = vorrq_u16(
+                vshlq_n_u16(vandq_u16(x, vdupq_n_u16(0xff)), 6),
+                vshrq_n_u16(x, 8));
+            sum += vaddlvq_u8(raw);
+            vst1q_s32(&values[i],
+                      vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(value))));
+            vst1q_s32(&values[i + 4],
+                      vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(value))));
+        }
+    }
+
+    return sum +
+        decode_scalar(&data[i * each_size], count - i, each_size, &values[i]);
+}
+#endif
+
+
+scip_decode_function_t scip_decode_function(scip_decode_isa_t isa)
+{
+    switch (isa) {
+    case SCIP_DECODE_SCALAR:
+        return decode_scalar;
+
+#if defined(SCIP_DECODE_X86)
+    case SCIP_DECODE_SSE41:
+        return __builtin_cpu_supports("sse4.1") ? decode_sse41 : NULL;
+
+    case SCIP_DECODE_AVX2:
+        return __builtin_cpu_supports("avx2") ? decode_avx2 : NULL;
+#endif
+
+#if defined(SCIP_DECODE_ARM)
+    case SCIP_DECODE_NEON:
+        return decode_neon;
+#endif
+
+    case SCIP_DECODE_AUTO:
+        {
+            scip_decode_function_t function = scip_decode_function(SCIP_DECODE_AVX2);
+            if (!function) {
+                function = scip_decode_function(SCIP_DECODE_SSE41);
+            }
+            if (!function) {
+                function = scip_decode_function(SCIP_DECODE_NEON);
+            }
+            return function ? function : decode_scalar;
+        }
+
+    default:
+        return NULL;
+    }
+}
+
+
+void scip_decoder_initialize(scip_decoder_t *decoder,
+                             void *length, void *intensity,
+                             scip_output_format_t format,
+                             int each_size, int is_intensity,
+                             int is_multiecho, int max_steps)
+{
+    decoder->length = length;
+    decoder->intensity = is_intensity ? intensity : NULL;
+    decoder->format = format;
+    decoder->each_size = each_size;
+    decoder->data_size = is_intensity ? 2 * each_size : each_size;
+    decoder->max_echo = is_multiecho ? URG_MAX_ECHO : 1;
+    decoder->max_steps = max_steps;
+    decoder->steps = 0;
+    decoder->echo = 0;
+    decoder->carry_size = 0;
+    decoder->sum = 0;
+    decoder->has_pending = 0;
+    decoder->is_complete = 0;
+    decoder->decode = scip_decode_function(SCIP_DECODE_AUTO);
+}
+
+
+// Number of values per step and echo, a distance and maybe an intensity
+static int values_per_step(const scip_decoder_t *decoder)
+{
+    return (decoder->data_size > decoder->each_size) ? 2 : 1;
+}
+
+
+// Number of steps in size characters, divides by constants as this is done
+// for every line
+static int count_steps(int size, int data_size)
+{
+    switch (data_size) {
+    case 2:
+        return size / 2;
+    case 3:
+        return size / 3;
+    case 4:
+        return size / 4;
+    default:
+        return size / 6;
+    }
+}
+
+
+// Stores count distances taken every value_step elements of values
+// to every step-th element of the output, starting at index.
+static void store_lengths(const scip_decoder_t *decoder, int index, int step,
+                          const int values[], int value_step, int count)
+{
+    int i;
+
+    switch (decoder->format) {
+    case SCIP_OUTPUT_LONG: {
+        long *length = (long *)decoder->length + index;
+        for (i = 0; i < count; ++i) {
+            length[i * step] = values[i * value_step];
+        }
+        break;
+    }
+    case SCIP_OUTPUT_U32: {
+        uint32_t *length = (uint32_t *)decoder->length + index;
+        for (i = 0; i < count; ++i) {
+            length[i * step] = (uint32_t)values[i * value_step];
+        }
+        break;
+    }
+    case SCIP_OUTPUT_F32: {
+        float *length = (float *)decoder->length + index;
+        for (i = 0; i < count; ++i) {
+            int value = values[i * value_step];
+            length[i * step] = (value != 0) ? (float)(value / 1000.0) : NAN;
+        }
+        break;
+    }
+    }
+}
+
+
+// Same as store_lengths() for the intensities, values points to the
+// distance preceding each intensity.
+static void store_intensities(const scip_decoder_t *decoder, int index,
+                              int step, const int values[], int value_step,
+                              int count)
+{
+    int i;
+
+    if (decoder->format == SCIP_OUTPUT_F32) {
+        // the intensity of an invalid distance is 0
+        float *intensity = (float *)decoder->intensity + index;
+        for (i = 0; i < count; ++i) {
+            const int *value = &values[i * value_step];
+            intensity[i * step] = (value[0] != 0) ? (float)value[1] : 0.0f;
+        }
+    } else {
+        unsigned short *intensity = (unsigned short *)decoder->intensity + index;
+        for (i = 0; i < count; ++i) {
+            intensity[i * step] = (unsigned short)values[i * value_step + 1];
+        }
+    }
+}
+
+
+// Fills the elements of count steps starting at the step index with the
+// values of a missing echo
+static void clear_steps(const scip_decoder_t *decoder, int index, int count)
+{
+    const int size = count * decoder->max_echo;
+    int i;
+
+    index *= decoder->max_echo;
+    if (decoder->length) {
+        switch (decoder->format) {
+        case SCIP_OUTPUT_LONG:
+            memset((long *)decoder->length + index, 0, size * sizeof(long));
+            break;
+        case SCIP_OUTPUT_U32:
+            memset((uint32_t *)decoder->length + index, 0,
+                   size * sizeof(uint32_t));
+            break;
+        case SCIP_OUTPUT_F32: {
+            float *length = (float *)decoder->length + index;
+            for (i = 0; i < size; ++i) {
+                length[i] = NAN;
+            }
+            break;
+        }
+        }
+    }
+    if (decoder->intensity) {
+        if (decoder->format == SCIP_OUTPUT_F32) {
+            memset((float *)decoder->intensity + index, 0, size * sizeof(float));
+        } else {
+            memset((unsigned short *)decoder->intensity + index, 0,
+                   size * sizeof(unsigned short));
+        }
+    }
+}
+
+
+// Stores one more echo of the last step
+static inline void store_echo(const scip_decoder_t *decoder, int index,
+                              const int values[])
+{
+    if (decoder->length) {
+        switch (decoder->format) {
+        case SCIP_OUTPUT_LONG:
+            ((long *)decoder->length)[index] = values[0];
+            break;
+        case SCIP_OUTPUT_U32:
+            ((uint32_t *)decoder->length)[index] = (uint32_t)values[0];
+            break;
+        case SCIP_OUTPUT_F32:
+            ((float *)decoder->length)[index] =
+                (values[0] != 0) ? (float)(values[0] / 1000.0) : NAN;
+            break;
+        }
+    }
+    if (decoder->intensity) {
+        if (decoder->format == SCIP_OUTPUT_F32) {
+            ((float *)decoder->intensity)[index] =
+                (values[0] != 0) ? (float)values[1] : 0.0f;
+        } else {
+            ((unsigned short *)decoder->intensity)[index] =
+                (unsigned short)values[1];
+        }
+    }
+}
+
+
+// Stores the decoded values of count steps or echoes.
+// The first one is another echo of the last step if is_echo is set.
+static int store_values(scip_decoder_t *decoder, const int values[],
+                        int count, int is_echo)
+{
+    const int per_step = values_per_step(decoder);
+    int steps = decoder->steps;
+
+    if (is_echo) {
+        if ((steps <= 0) || (decoder->echo + 1 >= decoder->max_echo)) {
+            return URG_RECEIVE_ERROR;
+        }
+        ++decoder->echo;
+        store_echo(decoder, (steps - 1) * decoder->max_echo + decoder->echo,
+                   values);
+        values += per_step;
+        --count;
+    }
+    if (count <= 0) {
+        return 0;
+    }
+
+    if (steps + count > decoder->max_steps) {
+        // too much data
+        return URG_RECEIVE_ERROR;
+    }
+    decoder->steps = steps + count;
+    decoder->echo = 0;
+
+    // fills the elements of the other echoes with dummy values
+    if (decoder->max_echo > 1) {
+        clear_steps(decoder, steps, count);
+    }
+    if (decoder->length) {
+        store_lengths(decoder, steps * decoder->max_echo, decoder->max_echo,
+                      values, per_step, count);
+    }
+    if (decoder->intensity) {
+        store_intensities(decoder, steps * decoder->max_echo,
+                          decoder->max_echo, values, per_step, count);
+    }
+    return 0;
+}
+
+
+// Decodes the values of one step or echo, the constant sizes of each case
+// let the compiler unroll the loops of decode_scalar()
+static inline unsigned int decode_step(const char data[], int data_size,
+                                       int values[])
+{
+    switch (data_size) {
+    case 2:
+        return decode_scalar(data, 1, 2, values);
+    case 3:
+        return decode_scalar(data, 1, 3, values);
+    case 4:
+        return decode_scalar(data, 2, 2, values);
+    default:
+        return decode_scalar(data, 2, 3, values);
+    }
+}
+
+
+// Decodes the complete values of a multiecho response into the output.
+// The runs between the echoes are too short for the SIMD kernels, the
+// values are decoded one at a time and then stored with their echoes.
+// A '&' is only looked for at the start of each value.
+static int decode_echoes(scip_decoder_t *decoder,
+                         const char **data_p, const char *last_p,
+                         unsigned int *sum)
+{
+    int values[DECODE_VALUES];
+    int is_echoes[DECODE_VALUES];
+    const int data_size = decoder->data_size;
+    const int per_step = values_per_step(decoder);
+    const int max_count = DECODE_VALUES / per_step;
+    const char *p = *data_p;
+    unsigned int total = 0;
+    int steps = decoder->steps;
+    int echo = decoder->echo;
+    int ret = 0;
+    int count;
+    int i;
+
+    do {
+        int new_steps = 0;
+        for (count = 0; count < max_count; ++count) {
+            int is_echo = 0;
+            if (last_p - p < data_size) {
+                break;
+            }
+            if (*p == '&') {
+                if (last_p - p <= data_size) {
+                    break;
+                }
+                total += '&';
+                ++p;
+                is_echo = 1;
+            }
+            is_echoes[count] = is_echo;
+            new_steps += !is_echo;
+            total += decode_step(p, data_size, &values[count * per_step]);
+            p += data_size;
+        }
+
+        if (steps + new_steps > decoder->max_steps) {
+            // too much data
+            ret = URG_RECEIVE_ERROR;
+            break;
+        }
+        clear_steps(decoder, steps, new_steps);
+
+        for (i = 0; i < count; ++i) {
+            if (is_echoes[i]) {
+                if ((steps <= 0) || (echo + 1 >= URG_MAX_ECHO)) {
+                    ret = URG_RECEIVE_ERROR;
+                    break;
+                }
+                ++echo;
+            } else {
+                ++steps;
+                echo = 0;
+            }
+            store_echo(decoder, (steps - 1) * URG_MAX_ECHO + echo,
+                       &values[i * per_step]);
+        }
+    } while ((ret == 0) && (count == max_count));
+
+    decoder->steps = steps;
+    decoder->echo = echo;
+    *data_p = p;
+    *sum += total;
+    return ret;
+}
+
+
+// Decodes the data characters between p and last_p, the characters are
+// added to decoder->sum. A value cut at last_p is kept in the carry.
+static int decode_data(scip_decoder_t *decoder,
+                       const char *p, const char *last_p)
+{
+    int values[DECODE_VALUES];
+    const int data_size = decoder->data_size;
+    const int per_step = values_per_step(decoder);
+    unsigned int sum = 0;
+    int ret = 0;
+
+    // completes the value continued from the previous data
+    if (decoder->carry_size > 0) {
+        int is_echo = (decoder->carry[0] == '&') ? 1 : 0;
+        int n = is_echo + data_size - decoder->carry_size;
+        if (n > last_p - p) {
+            n = (int)(last_p - p);
+        }
+        memcpy(&decoder->carry[decoder->carry_size], p, n);
+        decoder->carry_size += n;
+        for (; n > 0; --n) {
+            sum += (unsigned char)*p++;
+        }
+
+        if (decoder->carry_size == is_echo + data_size) {
+            // a single step, too short for the SIMD kernels
+            decode_step(&decoder->carry[is_echo], data_size, values);
+            ret = store_values(decoder, values, 1, is_echo);
+            decoder->carry_size = 0;
+        }
+    }
+
+    if ((decoder->max_echo > 1) && (ret == 0)) {
+        ret = decode_echoes(decoder, &p, last_p, &sum);
+    }
+
+    while ((p < last_p) && (ret == 0)) {
+        const char *run_last_p = last_p;
+        const char *echo_p;
+        int is_echo = 0;
+        int count;
+        int i;
+        int n;
+
+        if (*p == '&') {
+            // a '&' marks another echo of the last step
+            sum += (unsigned char)*p++;
+            is_echo = 1;
+        }
+        echo_p = memchr(p, '&', last_p - p);
+        if (echo_p) {
+            run_last_p = echo_p;
+        }
+
+        count = count_steps((int)(run_last_p - p), data_size);
+        for (i = 0; (i < count) && (ret == 0); i += n) {
+            n = count - i;
+            if (n > DECODE_VALUES / per_step) {
+                n = DECODE_VALUES / per_step;
+            }
+            sum += decoder->decode(p, n * per_step, decoder->each_size, values);
+            ret = store_values(decoder, values, n, is_echo && (i == 0));
+            p += n * data_size;
+        }
+
+        if ((p < run_last_p) || (is_echo && (count == 0))) {
+            if (run_last_p != last_p) {
+                // incomplete value in the middle of the data
+                return URG_RECEIVE_ERROR;
+            }
+
+            // the value continues on the next data
+            decoder->carry_size = 0;
+            if (is_echo && (count == 0)) {
+                decoder->carry[decoder->carry_size++] = '&';
+            }
+            for (; p < last_p; ++p) {
+                sum += (unsigned char)*p;
+                decoder->carry[decoder->carry_size++] = *p;
+            }
+        }
+    }
+
+    decoder->sum += sum;
+    return ret;
+}
+
+
+// The last character of a line is the checksum of the other ones
+static int check_line_sum(scip_decoder_t *decoder, char check_ch)
+{
+    unsigned int sum = decoder->sum;
+
+    decoder->sum = 0;
+    return (check_ch != (char)((sum & 0x3f) + 0x30)) ? URG_CHECKSUM_ERROR : 0;
+}
+
+
+int scip_decoder_line(scip_decoder_t *decoder,
+                      const char line[], int size, int check_sum)
+{
+    int ret;
+
+    if (size <= 0) {
+        return 0;
+    }
+
+    decoder->sum = 0;
+    ret = decode_data(decoder, line, line + size - 1);
+    if ((check_line_sum(decoder, line[size - 1]) < 0) && check_sum) {
+        return URG_CHECKSUM_ERROR;
+    }
+    return ret;
+}
+
+
+// Returns the first '\r' or '\n' of the data, NULL if there is none
+static const char *find_linefeed(const char *data, int size)
+{
+    const char *lf = memchr(data, '\n', size);
+    const char *cr = memchr(data, '\r', (lf != NULL) ? lf - data : size);
+
+    return (cr != NULL) ? cr : lf;
+}
+
+
+int scip_decoder_push(scip_decoder_t *decoder,
+                      const char data[], int size, int check_sum)
+{
+    const char *p = data;
+    const char *end_p = data + size;
+
+    while ((p < end_p) && !decoder->is_complete) {
+        const char *linefeed_p = find_linefeed(p, (int)(end_p - p));
+        const char *line_end_p = (linefeed_p != NULL) ? linefeed_p : end_p;
+        int ret;
+
+        if ((linefeed_p == p) && !decoder->has_pending) {
+            // an empty line terminates the response
+            decoder->is_complete = 1;
+            ++p;
+            break;
+        }
+
+        if (line_end_p > p) {
+            // the held back character was not the checksum
+            if (decoder->has_pending) {
+                decoder->has_pending = 0;
+                ret = decode_data(decoder, &decoder->pending,
+                                  &decoder->pending + 1);
+                if (ret < 0) {
+                    return ret;
+                }
+            }
+
+            // holds back the last character, it may be the checksum
+            ret = decode_data(decoder, p, line_end_p - 1);
+            if (ret < 0) {
+                return ret;
+            }
+            decoder->pending = line_end_p[-1];
+            decoder->has_pending = 1;
+            p = line_end_p;
+        }
+
+        if (linefeed_p != NULL) {
+            decoder->has_pending = 0;
+            if ((check_line_sum(decoder, decoder->pending) < 0) && check_sum) {
+                return URG_CHECKSUM_ERROR;
+            }
+            ++p;
+        }
+    }
+    return (int)(p - data);
+}
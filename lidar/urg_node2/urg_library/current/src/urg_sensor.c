@@ -18,10 +18,13 @@
 #include "urg_sensor.h"
 #include "urg_errno.h"
 #include "urg_utils.h"
+#include "urg_scip_decoder.h"
 #include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
 
 #if defined(URG_MSC)
 #define snprintf _snprintf
@@ -510,137 +513,106 @@ static urg_measurement_type_t parse_distance_echoback(urg_t *urg,
 }
 
 
-static int receive_length_data(urg_t *urg, long length[],
-                               unsigned short intensity[],
-                               urg_measurement_type_t type, char buffer[])
+// \~japanese  1 soAs̒Ԃ
+// \~english Extracts one line of a response, returns the length of the line
+static int response_line(const char **line, const char **position,
+                         const char *last)
 {
+    const char *p = memchr(*position, '\n', last - *position);
+    if (!p) {
+        return -1;
+    }
+    *line = *position;
+    *position = p + 1;
+    return (int)(p - *line);
+}
+
+
+// \~japanese fR[hZN^ʒmAʒmς݂̃f[^Ԃ
+// \~english Notifies the decoded sectors, returns the number of notified data points
+static int notify_sectors(urg_t *urg, const scip_decoder_t *decoder,
+                          int notified_steps)
+{
+    int steps = decoder->steps;
+
+    if (!decoder->is_complete && (decoder->max_echo > 1)) {
+        // \~japanese }`GR[ł́AŌ̃XebṽGR[\
+        // \~english In multiecho mode, more echoes of the last step may follow
+        --steps;
+    }
+
+    while ((steps - notified_steps >= urg->sector_steps) ||
+           (decoder->is_complete && (steps > notified_steps))) {
+        int n = steps - notified_steps;
+        if (n > urg->sector_steps) {
+            n = urg->sector_steps;
+        }
+        urg->sector_handler(notified_steps, n, urg->sector_context);
+        notified_steps += n;
+    }
+    return notified_steps;
+}
+
+
+static int receive_length_data(urg_t *urg, void *length, void *intensity,
+                               scip_output_format_t format,
+                               urg_measurement_type_t type)
+{
+    scip_decoder_t decoder;
+    int notified_steps = 0;
     int n;
-    int step_filled = 0;
-    int line_filled = 0;
-    int multiecho_index = 0;
 
     int each_size =
         (urg->received_range_data_byte == URG_COMMUNICATION_2_BYTE) ? 2 : 3;
-    int data_size = each_size;
     int is_intensity = URG_FALSE;
     int is_multiecho = URG_FALSE;
-    int multiecho_max_size = 1;
 
     if ((type == URG_DISTANCE_INTENSITY)
         || (type == URG_DISTANCE_INTENSITY_IO) 
         || (type == URG_MULTIECHO_INTENSITY)) {
-        data_size *= 2;
         is_intensity = URG_TRUE;
     }
     if ((type == URG_MULTIECHO) || (type == URG_MULTIECHO_INTENSITY)) {
         is_multiecho = URG_TRUE;
-        multiecho_max_size = URG_MAX_ECHO;
     }
 
-    do {
-        char *p = buffer;
-        char *last_p;
+    scip_decoder_initialize(&decoder, length, intensity, format,
+                            each_size, is_intensity, is_multiecho,
+                            urg->received_last_index - urg->received_first_index + 1);
 
-        n = connection_readline(&urg->connection,
-                                &buffer[line_filled], BUFFER_SIZE - line_filled,
-                                urg->timeout);
-
-        if (n > 0) {
-            // \~japanese `FbNT̕]
-            // \~english Validates the checksum
-            if (buffer[line_filled + n - 1] != scip_checksum(&buffer[line_filled], n - 1) &&
-                (urg->ignore_checkSumError == 0)) {
-                ignore_receive_data_with_qt(urg, urg->timeout);
-                return set_errno_and_return(urg, URG_CHECKSUM_ERROR);
-            }
-        }
-        
-        if (n > 0) {
-            line_filled += n - 1;
+    // \~japanese Mobt@̃f[^AsɕɒڃfR[h
+    // \~english Decodes the data in the receive buffer without splitting it into lines
+    while (!decoder.is_complete) {
+        const char *data;
+        n = connection_peek(&urg->connection, &data, urg->timeout);
+        if (n <= 0) {
+            break;
         }
-        last_p = p + line_filled;
-
-        while ((last_p - p) >= data_size) {
-            int index;
-
-            if (*p == '&') {
-                // \~japanese 擪 '&' Ƃ́A}`GR[̃f[^Ƃ݂Ȃ
-                // \~english If the start character is a '&' then assume data is multiecho
-                if ((last_p - (p + 1)) < data_size) {
-                    // \~japanese '&' āAdata_size f[^Δ
-                // \~english Skips the '&' and if the string size is less than data_size ignore it
-                    break;
-                }
-
-                --step_filled;
-                ++multiecho_index;
-                ++p;
-                --line_filled;
-
-            } else {
-                // \~japanese ̃f[^
-                // \~english Next data
-                multiecho_index = 0;
-            }
-
-            index = (step_filled * multiecho_max_size) + multiecho_index;
-
-            if (step_filled >
-                (urg->received_last_index - urg->received_first_index)) {
-                // \~japanese f[^߂ꍇ́Ac̃f[^𖳎Ė߂
-                // \~english If there is extra data, ignore it
-                ignore_receive_data_with_qt(urg, urg->timeout);
-                return set_errno_and_return(urg, URG_RECEIVE_ERROR);
-            }
-
-
-            if (is_multiecho && (multiecho_index == 0)) {
-                // \~japanese }`GR[̃f[^i[_~[f[^Ŗ߂
-                // \~english Stores dummy values in the multiecho data location
-                int i;
-                if (length) {
-                    for (i = 1; i < multiecho_max_size; ++i) {
-                        length[index + i] = 0;
-                    }
-                }
-                if (intensity) {
-                    for (i = 1; i < multiecho_max_size; ++i) {
-                        intensity[index + i] = 0;
-                    }
-                }
-            }
-
-            // \~japanese f[^̊i[
-            // \~english Stores the distance data
-            if (length) {
-                length[index] = urg_scip_decode(p, each_size);
-            }
-            p += each_size;
-
-            // \~japanese xf[^̊i[
-            // \~english Stores the intensity data
-            if (is_intensity) {
-                if (intensity) {
-                    intensity[index] = (unsigned short)urg_scip_decode(p, each_size);
-                }
-                p += each_size;
-            }
 
-            ++step_filled;
-            line_filled -= data_size;
+        // \~japanese f[^̃fR[hƃ`FbNT̕]
+        // \~english Decodes the data and validates the checksum
+        n = scip_decoder_push(&decoder, data, n,
+                              urg->ignore_checkSumError == 0);
+        if (n < 0) {
+            // \~japanese G[̏ꍇ́Ac̃f[^𖳎Ė߂
+            // \~english In case of an error, ignore the remaining data
+            ignore_receive_data_with_qt(urg, urg->timeout);
+            return set_errno_and_return(urg, n);
         }
+        connection_consume(&urg->connection, n);
 
-        // \~japanese ɏ镶ޔ
-        // \~english Prepares the next line to process
-        memmove(buffer, p, line_filled);
-    } while (n > 0);
+        if (urg->sector_handler && length) {
+            notified_steps = notify_sectors(urg, &decoder, notified_steps);
+        }
+    }
 
-    return step_filled;
+    return decoder.steps;
 }
 
 
 //! \~japanese f[^̎擾  \~english Gets measurement data
-static int receive_data(urg_t *urg, long data[], unsigned short intensity[], long io[],
+static int receive_data(urg_t *urg, void *data, void *intensity,
+                        scip_output_format_t format, long io[],
                         long *time_stamp)
 {
     urg_measurement_type_t type;
@@ -703,7 +675,7 @@ static int receive_data(urg_t *urg, long data[], unsigned short intensity[], lon
                 ignore_receive_data_with_qt(urg, urg->timeout);
                 return set_errno_and_return(urg, URG_INVALID_RESPONSE);
             } else {
-                return receive_data(urg, data, intensity, io, time_stamp);
+                return receive_data(urg, data, intensity, format, io, time_stamp);
             }
         }
     }
@@ -759,13 +731,13 @@ static int receive_data(urg_t *urg, long data[], unsigned short intensity[], lon
     case URG_DISTANCE:
     case URG_MULTIECHO:
     case URG_DISTANCE_IO:
-        ret = receive_length_data(urg, data, NULL, type, buffer);
+        ret = receive_length_data(urg, data, NULL, format, type);
         break;
 
     case URG_DISTANCE_INTENSITY:
     case URG_MULTIECHO_INTENSITY:
     case URG_DISTANCE_INTENSITY_IO:
-        ret = receive_length_data(urg, data, intensity, type, buffer);
+        ret = receive_length_data(urg, data, intensity, format, type);
         break;
 
     case URG_STOP:
@@ -788,6 +760,73 @@ static int receive_data(urg_t *urg, long data[], unsigned short intensity[], lon
     return ret;
 }
 
+// \~japanese foCXɐڑ
+// \~english Opens the connection to the device
+static int open_device(urg_t *urg, urg_connection_type_t connection_type,
+                       const char *device_or_address, long baudrate_or_port)
+{
+    int ret = connection_open(&urg->connection, connection_type,
+                              device_or_address, baudrate_or_port);
+
+    if (ret < 0) {
+        switch (connection_type) {
+        case URG_SERIAL:
+            urg->last_errno = URG_SERIAL_OPEN_ERROR;
+            break;
+
+        case URG_ETHERNET:
+            urg->last_errno = URG_ETHERNET_OPEN_ERROR;
+            break;
+
+        default:
+            urg->last_errno = URG_INVALID_RESPONSE;
+            break;
+        }
+        return urg->last_errno;
+    }
+    return URG_NO_ERROR;
+}
+
+
+// \~japanese ڑ̌vԂ
+// \~english Initializes the measurement state after connecting
+static void initialize_measurement_state(urg_t *urg)
+{
+    urg->is_sending = URG_FALSE;
+    urg->last_errno = URG_NO_ERROR;
+    urg->range_data_byte = URG_COMMUNICATION_3_BYTE;
+    urg->specified_scan_times = 0;
+    urg->scanning_remain_times = 0;
+    urg->is_laser_on = URG_FALSE;
+}
+
+
+// \~japanese OƓ{[[gŐڑ
+// \~english Connects to the sensor with the baudrate of the previous connection
+static int resume_urg_device(urg_t *urg, long baudrate)
+{
+    enum { RECEIVE_BUFFER_SIZE = 4 };
+    int qt_expected[] = { 0, EXPECTED_END };
+    char receive_buffer[RECEIVE_BUFFER_SIZE + 1];
+    int ret;
+
+    // \~japanese ZT̓{[[gێĂ邽߁AQT ̉΂̂܂܎g
+    // \~japanese Vڑɂ͑O̎Mf[^cĂȂ̂ŁAMobt@̃NAȗ
+    // \~english The sensor keeps its baudrate, so the connection is used as is if QT is answered.
+    // \~english A new connection has no data left from the previous one, so the buffer is not cleared
+    connection_set_baudrate(&urg->connection, baudrate);
+    ret = scip_response(urg, "QT\n", qt_expected, MAX_TIMEOUT,
+                        receive_buffer, RECEIVE_BUFFER_SIZE);
+    if ((ret > 0) && !strcmp("00P", receive_buffer)) {
+        return set_errno_and_return(urg, URG_NO_ERROR);
+    }
+
+    // \~japanese قȂꍇ̓{[[gςȂڑ
+    // \~english Otherwise, searches the baudrate as urg_open() does
+    return connect_urg_device(urg, baudrate);
+}
+
+
 void urg_t_initialize(urg_t *urg)
 {
     urg->is_active = URG_FALSE;
@@ -796,7 +835,11 @@ void urg_t_initialize(urg_t *urg)
     urg->timeout = MAX_TIMEOUT;
     urg->scanning_skip_scan = 0;
     urg->error_handler = NULL;
+    urg->sector_handler = NULL;
+    urg->sector_steps = 0;
+    urg->sector_context = NULL;
     urg->ignore_checkSumError = 1;
+    urg->angle_table_size = 0;
 }
 
 int urg_open(urg_t *urg, urg_connection_type_t connection_type,
@@ -809,24 +852,10 @@ int urg_open(urg_t *urg, urg_connection_type_t connection_type,
 
     // \~japanese foCXւ̐ڑ
     // \~english Connects to the device
-    ret = connection_open(&urg->connection, connection_type,
-                          device_or_address, baudrate_or_port);
-
+    ret = open_device(urg, connection_type,
+                      device_or_address, baudrate_or_port);
     if (ret < 0) {
-        switch (connection_type) {
-        case URG_SERIAL:
-            urg->last_errno = URG_SERIAL_OPEN_ERROR;
-            break;
-
-        case URG_ETHERNET:
-            urg->last_errno = URG_ETHERNET_OPEN_ERROR;
-            break;
-
-        default:
-            urg->last_errno = URG_INVALID_RESPONSE;
-            break;
-        }
-        return urg->last_errno;
+        return ret;
     }
 
     // \~japanese  w肵{[[g URG ƒʐMł悤ɒ
@@ -841,15 +870,7 @@ int urg_open(urg_t *urg, urg_connection_type_t connection_type,
     if (ret != URG_NO_ERROR) {
         return set_errno_and_return(urg, ret);
     }
-    urg->is_sending = URG_FALSE;
-
-    // \~japanese  ϐ̏
-    // \~english Initializes variables
-    urg->last_errno = URG_NO_ERROR;
-    urg->range_data_byte = URG_COMMUNICATION_3_BYTE;
-    urg->specified_scan_times = 0;
-    urg->scanning_remain_times = 0;
-    urg->is_laser_on = URG_FALSE;
+    initialize_measurement_state(urg);
 
     // \~japanese  p[^擾
     // \~english Gets the sensor parameters
@@ -861,6 +882,42 @@ int urg_open(urg_t *urg, urg_connection_type_t connection_type,
 }
 
 
+
+int urg_reopen(urg_t *urg, urg_connection_type_t connection_type,
+               const char *device_or_address, long baudrate_or_port)
+{
+    int ret;
+    long baudrate = baudrate_or_port;
+
+    // \~japanese ZTp[^ƃXL͈͂͑O̐ڑ̂̂g
+    // \~english Keeps the sensor parameters and the scanning range of the previous connection
+    urg->is_active = URG_FALSE;
+    urg->is_sending = URG_TRUE;
+    urg->last_errno = URG_NOT_CONNECTED;
+
+    ret = open_device(urg, connection_type,
+                      device_or_address, baudrate_or_port);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (connection_type == URG_ETHERNET) {
+        baudrate = 115200;
+    }
+
+    ret = resume_urg_device(urg, baudrate);
+    if (ret != URG_NO_ERROR) {
+        // \~japanese sꍇ͐ڑ
+        // \~english Closes the connection on failure
+        connection_close(&urg->connection);
+        return set_errno_and_return(urg, ret);
+    }
+    initialize_measurement_state(urg);
+    urg->is_active = URG_TRUE;
+
+    return URG_NO_ERROR;
+}
+
 void urg_close(urg_t *urg)
 {
     if (urg->is_active) {
@@ -1077,7 +1134,25 @@ int urg_get_distance(urg_t *urg, long data[], long *time_stamp)
     if (!urg->is_active) {
         return set_errno_and_return(urg, URG_NOT_CONNECTED);
     }
-    return receive_data(urg, data, NULL, NULL, time_stamp);
+    return receive_data(urg, data, NULL, SCIP_OUTPUT_LONG, NULL, time_stamp);
+}
+
+
+int urg_get_distance_u32(urg_t *urg, uint32_t data[], long *time_stamp)
+{
+    if (!urg->is_active) {
+        return set_errno_and_return(urg, URG_NOT_CONNECTED);
+    }
+    return receive_data(urg, data, NULL, SCIP_OUTPUT_U32, NULL, time_stamp);
+}
+
+
+int urg_get_ranges_f32(urg_t *urg, float ranges[], long *time_stamp)
+{
+    if (!urg->is_active) {
+        return set_errno_and_return(urg, URG_NOT_CONNECTED);
+    }
+    return receive_data(urg, ranges, NULL, SCIP_OUTPUT_F32, NULL, time_stamp);
 }
 
 int urg_get_distance_io(urg_t* urg, long data[], long io[], long* time_stamp)
@@ -1085,7 +1160,7 @@ int urg_get_distance_io(urg_t* urg, long data[], long io[], long* time_stamp)
     if (!urg->is_active) {
         return set_errno_and_return(urg, URG_NOT_CONNECTED);
     }
-    return receive_data(urg, data, NULL, io, time_stamp);
+    return receive_data(urg, data, NULL, SCIP_OUTPUT_LONG, io, time_stamp);
 }
 
 int urg_get_distance_intensity(urg_t *urg,
@@ -1096,7 +1171,141 @@ int urg_get_distance_intensity(urg_t *urg,
         return set_errno_and_return(urg, URG_NOT_CONNECTED);
     }
 
-    return receive_data(urg, data, intensity, NULL, time_stamp);
+    return receive_data(urg, data, intensity, SCIP_OUTPUT_LONG, NULL, time_stamp);
+}
+
+
+int urg_get_distance_intensity_u32(urg_t *urg,
+                                   uint32_t data[], unsigned short intensity[],
+                                   long *time_stamp)
+{
+    if (!urg->is_active) {
+        return set_errno_and_return(urg, URG_NOT_CONNECTED);
+    }
+
+    return receive_data(urg, data, intensity, SCIP_OUTPUT_U32, NULL, time_stamp);
+}
+
+
+int urg_get_ranges_intensity_f32(urg_t *urg,
+                                 float ranges[], float intensities[],
+                                 long *time_stamp)
+{
+    if (!urg->is_active) {
+        return set_errno_and_return(urg, URG_NOT_CONNECTED);
+    }
+
+    return receive_data(urg, ranges, intensities, SCIP_OUTPUT_F32, NULL, time_stamp);
+}
+
+int urg_parse_ranges_f32(const char response[], int size,
+                         float ranges[], float intensities[],
+                         int max_size, int check_sum, long *time_stamp)
+{
+    scip_decoder_t decoder;
+    const char *position = response;
+    const char *last = response + size;
+    const char *line;
+    int each_size = 3;
+    int is_intensity = URG_FALSE;
+    int is_multiecho = URG_FALSE;
+    int is_io = URG_FALSE;
+    int cluster;
+    int steps;
+    int n;
+
+    // \~japanese GR[obN̉
+    // \~english Checks the echoback
+    n = response_line(&line, &position, last);
+    if ((n == 2) && !strncmp(line, "QT", 2)) {
+        return 0;
+    }
+    if (!(((n == 12) && ((line[0] == 'G') || (line[0] == 'H'))) ||
+          ((n == 15) && ((line[0] == 'M') || (line[0] == 'N'))))) {
+        return URG_INVALID_RESPONSE;
+    }
+    switch (line[1]) {
+    case 'S':
+        each_size = 2;
+        break;
+    case 'D':
+        break;
+    case 'E':
+        is_intensity = URG_TRUE;
+        break;
+    case 'F':
+        is_io = URG_TRUE;
+        break;
+    case 'G':
+        is_intensity = URG_TRUE;
+        is_io = URG_TRUE;
+        break;
+    default:
+        return URG_INVALID_RESPONSE;
+    }
+    if ((line[0] == 'H') || (line[0] == 'N')) {
+        is_multiecho = URG_TRUE;
+    }
+    cluster = parse_parameter(&line[10], 2);
+    steps = (parse_parameter(&line[6], 4) - parse_parameter(&line[2], 4))
+        / ((cluster > 1) ? cluster : 1) + 1;
+    if ((steps <= 0) ||
+        (steps * (is_multiecho ? URG_MAX_ECHO : 1) > max_size)) {
+        return URG_INVALID_PARAMETER;
+    }
+
+    // \~japanese ̉́Bf[^̂Ȃ "00" ͌vJn̉
+    // \~english Checks the response message. A "00" response without data acknowledges the measurement start
+    n = response_line(&line, &position, last);
+    if (n != 3) {
+        return URG_INVALID_RESPONSE;
+    }
+    if (check_sum && (line[2] != scip_checksum(line, 2))) {
+        return URG_CHECKSUM_ERROR;
+    }
+    if (!strncmp(line, "00", 2) && (position < last) && (*position == '\n')) {
+        return 0;
+    }
+    if (strncmp(line, "00", 2) && strncmp(line, "99", 2)) {
+        return URG_INVALID_RESPONSE;
+    }
+
+    // \~japanese I/O ͓ǂݔ΂
+    // \~english Skips the I/O
+    if (is_io) {
+        if (response_line(&line, &position, last) < 0) {
+            return URG_RECEIVE_ERROR;
+        }
+    }
+
+    // \~japanese ^CX^v̎擾
+    // \~english Gets the timestamp
+    n = response_line(&line, &position, last);
+    if (n != 5) {
+        return URG_RECEIVE_ERROR;
+    }
+    if (check_sum && (line[4] != scip_checksum(line, 4))) {
+        return URG_CHECKSUM_ERROR;
+    }
+    if (time_stamp) {
+        *time_stamp = urg_scip_decode(line, 4);
+    }
+
+    // \~japanese f[^̎擾
+    // \~english Gets the measurement data
+    scip_decoder_initialize(&decoder, ranges,
+                            is_intensity ? intensities : NULL,
+                            SCIP_OUTPUT_F32, each_size, is_intensity,
+                            is_multiecho, steps);
+    n = scip_decoder_push(&decoder, position, (int)(last - position),
+                          check_sum);
+    if (n < 0) {
+        return n;
+    }
+    if (!decoder.is_complete) {
+        return URG_RECEIVE_ERROR;
+    }
+    return decoder.steps;
 }
 
 int urg_get_distance_intensity_io(urg_t* urg,
@@ -1107,7 +1316,7 @@ int urg_get_distance_intensity_io(urg_t* urg,
         return set_errno_and_return(urg, URG_NOT_CONNECTED);
     }
 
-    return receive_data(urg, data, intensity, io, time_stamp);
+    return receive_data(urg, data, intensity, SCIP_OUTPUT_LONG, io, time_stamp);
 }
 
 int urg_get_multiecho(urg_t *urg, long data_multi[], long *time_stamp)
@@ -1116,7 +1325,7 @@ int urg_get_multiecho(urg_t *urg, long data_multi[], long *time_stamp)
         return set_errno_and_return(urg, URG_NOT_CONNECTED);
     }
 
-    return receive_data(urg, data_multi, NULL, NULL, time_stamp);
+    return receive_data(urg, data_multi, NULL, SCIP_OUTPUT_LONG, NULL, time_stamp);
 }
 
 
@@ -1129,7 +1338,7 @@ int urg_get_multiecho_intensity(urg_t *urg,
         return set_errno_and_return(urg, URG_NOT_CONNECTED);
     }
 
-    return receive_data(urg, data_multi, intensity_multi, NULL, time_stamp);
+    return receive_data(urg, data_multi, intensity_multi, SCIP_OUTPUT_LONG, NULL, time_stamp);
 }
 
 
@@ -1154,7 +1363,7 @@ int urg_stop_measurement(urg_t *urg)
     for (i = 0; i < MAX_READ_TIMES; ++i) {
         // \~japanese QT ̉Ԃ܂ŁAf[^ǂݎ̂Ă
         // \~english Skips measuement data until QT response is received
-        ret = receive_data(urg, NULL, NULL, NULL, NULL);
+        ret = receive_data(urg, NULL, NULL, SCIP_OUTPUT_LONG, NULL, NULL);
         if (ret == URG_NO_ERROR) {
             // \~japanese 퉞
             // \~english Correct response
@@ -1167,6 +1376,31 @@ int urg_stop_measurement(urg_t *urg)
 }
 
 
+// \~japanese v͈͂̊ef[^ cos, sin vZ
+// \~english Computes cos and sin of each data point of the scanning range
+static void update_angle_table(urg_t *urg)
+{
+    int skip_step = (urg->scanning_skip_step > 1) ? urg->scanning_skip_step : 1;
+    int n = (urg->scanning_last_step - urg->scanning_first_step) / skip_step + 1;
+    int i;
+
+    if ((urg->area_resolution <= 0) || (n > URG_MAX_ANGLE_TABLE)) {
+        // \~japanese e[ug킸ɌvZ
+        // \~english Falls back to computing the angles
+        urg->angle_table_size = 0;
+        return;
+    }
+
+    for (i = 0; i < n; ++i) {
+        int step = urg->scanning_first_step + i * skip_step;
+        double radian = (2.0 * M_PI) * step / urg->area_resolution;
+        urg->cos_table[i] = (float)cos(radian);
+        urg->sin_table[i] = (float)sin(radian);
+    }
+    urg->angle_table_size = n;
+}
+
+
 int urg_set_scanning_parameter(urg_t *urg, int first_step, int last_step,
                                int skip_step)
 {
@@ -1182,6 +1416,7 @@ int urg_set_scanning_parameter(urg_t *urg, int first_step, int last_step,
     urg->scanning_first_step = first_step;
     urg->scanning_last_step = last_step;
     urg->scanning_skip_step = skip_step;
+    update_angle_table(urg);
 
     return set_errno_and_return(urg, URG_NO_ERROR);
 }
@@ -1492,3 +1727,12 @@ void urg_set_error_handler(urg_t *urg, urg_error_handler handler)
 {
     urg->error_handler = handler;
 }
+
+
+void urg_set_sector_handler(urg_t *urg, urg_sector_handler handler,
+                            int sector_steps, void *context)
+{
+    urg->sector_handler = (sector_steps > 0) ? handler : NULL;
+    urg->sector_steps = sector_steps;
+    urg->sector_context = context;
+}
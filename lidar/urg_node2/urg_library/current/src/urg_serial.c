@@ -43,14 +43,35 @@ static void serial_ungetc(urg_serial_t *serial, char ch)
 
 int serial_readline(urg_serial_t *serial, char *data, int max_size, int timeout)
 {
-    /* \~japanese Pǂݏoĕ] */
-    /* \~english Reads and evaluates 1 character at a time */
+    /* \~japanese obt@̉s܂ł܂Ƃ߂ēǂݏoAȂ΂P҂ */
+    /* \~english Copies the buffered data up to the EOL at once, waits for one more character otherwise */
     int filled = 0;
     int is_timeout = 0;
 
     while (filled < max_size) {
         char recv_ch;
-        int n = serial_read(serial, &recv_ch, 1, timeout);
+        int n;
+
+        if (serial->has_last_ch == False) {
+            int linefeed = ring_find_linefeed(&serial->ring);
+            int copy_size =
+                (linefeed >= 0) ? linefeed : ring_size(&serial->ring);
+            if (copy_size > max_size - filled) {
+                copy_size = max_size - filled;
+            }
+            filled += ring_read(&serial->ring, &data[filled], copy_size);
+            if (filled >= max_size) {
+                break;
+            }
+            if (linefeed >= 0) {
+                ring_read(&serial->ring, &recv_ch, 1);
+                break;
+            }
+        }
+
+        /* \~japanese serial_read() ͎Mς݂̃f[^Oobt@Ɋi[ */
+        /* \~english serial_read() stores the rest of the received data in the ring buffer */
+        n = serial_read(serial, &recv_ch, 1, timeout);
         if (n <= 0) {
             is_timeout = 1;
             break;
@@ -72,3 +93,33 @@ int serial_readline(urg_serial_t *serial, char *data, int max_size, int timeout)
         return filled;
     }
 }
+
+
+int serial_peek(urg_serial_t *serial, const char **data, int timeout)
+{
+    if ((serial->has_last_ch == False) && (ring_size(&serial->ring) <= 0)) {
+        /* \~japanese serial_read() ͎Mς݂̃f[^Oobt@Ɋi[ */
+        /* \~english serial_read() stores the rest of the received data in the ring buffer */
+        char recv_ch;
+        if (serial_read(serial, &recv_ch, 1, timeout) <= 0) {
+            return -1;
+        }
+        serial_ungetc(serial, recv_ch);
+    }
+
+    if (serial->has_last_ch != False) {
+        *data = &serial->last_ch;
+        return 1;
+    }
+    return ring_peek(&serial->ring, data);
+}
+
+
+void serial_consume(urg_serial_t *serial, int size)
+{
+    if ((size > 0) && (serial->has_last_ch != False)) {
+        serial->has_last_ch = False;
+        --size;
+    }
+    ring_consume(&serial->ring, size);
+}
@@ -326,8 +326,27 @@ int tcpclient_readline(urg_tcpclient_t* cli,
         i++;
         cli->pushed_back = -1;
     }
-    for (; i < buf_size; ++i) {
+    while (i < buf_size) {
         char ch;
+
+        // copy the buffered data up to the next CR or LF at once.
+        int linefeed = ring_find_linefeed(&cli->rb);
+        int copy_size =
+            (linefeed >= 0) ? linefeed : tcpclient_buffer_data_num(cli);
+        if (copy_size > buf_size - i) {
+            copy_size = buf_size - i;
+        }
+        i += tcpclient_buffer_read(cli, &userbuf[i], copy_size);
+        if (i >= buf_size) {
+            break;
+        }
+        if (linefeed >= 0) {
+            n = tcpclient_buffer_read(cli, &ch, 1);
+            break; // success
+        }
+
+        // no CR or LF in buffer, wait for the next character.
+        // tcpclient_read() fills the buffer with the rest of the received data.
         n = tcpclient_read(cli, &ch, 1, timeout);
         if (n <= 0) {
             break; // error
@@ -335,7 +354,7 @@ int tcpclient_readline(urg_tcpclient_t* cli,
         if (is_linefeed(ch)) {
             break; // success
         }
-        userbuf[i] = ch;
+        userbuf[i++] = ch;
     }
 
     if (i >= buf_size) { // No CR or LF found.
@@ -351,3 +370,64 @@ int tcpclient_readline(urg_tcpclient_t* cli,
 
     return i; // the number of characters filled into user buffer.
 }
+
+
+int tcpclient_peek(urg_tcpclient_t* cli, const char** data, int timeout)
+{
+    if (cli->pushed_back > 0) {
+        cli->peek_ch = (char)cli->pushed_back;
+        *data = &cli->peek_ch;
+        return 1;
+    }
+
+    if (tcpclient_buffer_data_num(cli) <= 0) {
+        // receive directly into the ring buffer, not via a temporary buffer.
+        int sock = cli->sock_desc;
+        char* space;
+        int space_size = ring_reserve(&cli->rb, &space);
+        int n;
+#if defined(URG_WINDOWS_OS)
+        if (timeout <= 0) {
+            // SO_RCVTIMEO of 0 waits forever, poll the socket instead.
+            fd_set rfds;
+            struct timeval tv = { 0, 0 };
+            FD_ZERO(&rfds);
+            FD_SET(sock, &rfds);
+            if (select(sock + 1, &rfds, NULL, NULL, &tv) <= 0) {
+                return -1;
+            }
+        } else {
+            setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO,
+                       (const char *)&timeout, sizeof(timeout));
+        }
+        n = recv(sock, space, space_size, 0);
+#else
+        // set the time out only when the system's buffer is empty.
+        // a timeout of 0 does not wait, as SO_RCVTIMEO of 0 waits forever.
+        n = recv(sock, space, space_size, MSG_DONTWAIT);
+        if ((n < 0) && (timeout > 0)) {
+            struct timeval tv;
+            tv.tv_sec = timeout / 1000; // millisecond to seccond
+            tv.tv_usec = (timeout % 1000) * 1000; // millisecond to microsecond
+            setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(struct timeval));
+            n = recv(sock, space, space_size, 0);
+        }
+#endif
+        if (n <= 0) {
+            return -1;
+        }
+        ring_commit(&cli->rb, n);
+    }
+
+    return ring_peek(&cli->rb, data);
+}
+
+
+void tcpclient_consume(urg_tcpclient_t* cli, int size)
+{
+    if ((size > 0) && (cli->pushed_back > 0)) {
+        cli->pushed_back = -1;
+        --size;
+    }
+    ring_consume(&cli->rb, size);
+}
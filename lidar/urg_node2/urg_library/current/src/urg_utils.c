@@ -15,6 +15,14 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+#if defined(__SSE2__)
+#define URG_XY_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define URG_XY_NEON
+#include <arm_neon.h>
+#endif
+
 #undef max
 #undef min
 
@@ -216,6 +224,111 @@ int urg_step2index(const urg_t *urg, int step)
                urg->last_data_index);
 }
 
+// \~japanese e[u cos, sin ɂW̌vZB4 f[^ SIMD ߂ŌvZ
+// \~english Computes the coordinates with the cos and sin tables, 4 data points at once with SIMD instructions
+static void polar_to_xy(const float cos_table[], const float sin_table[],
+                        const float ranges[], const float intensities[],
+                        int n, float points[])
+{
+    int i = 0;
+
+#if defined(URG_XY_SSE2)
+    if (!intensities) {
+        for (; i + 4 <= n; i += 4) {
+            __m128 r = _mm_loadu_ps(&ranges[i]);
+            __m128 x = _mm_mul_ps(r, _mm_loadu_ps(&cos_table[i]));
+            __m128 y = _mm_mul_ps(r, _mm_loadu_ps(&sin_table[i]));
+            _mm_storeu_ps(&points[2 * i], _mm_unpacklo_ps(x, y));
+            _mm_storeu_ps(&points[2 * i + 4], _mm_unpackhi_ps(x, y));
+        }
+    } else {
+        for (; i + 4 <= n; i += 4) {
+            __m128 r = _mm_loadu_ps(&ranges[i]);
+            __m128 x = _mm_mul_ps(r, _mm_loadu_ps(&cos_table[i]));
+            __m128 y = _mm_mul_ps(r, _mm_loadu_ps(&sin_table[i]));
+            __m128 v = _mm_loadu_ps(&intensities[i]);
+            // x0 y0 x1 y1, x2 y2 x3 y3
+            __m128 xy_lo = _mm_unpacklo_ps(x, y);
+            __m128 xy_hi = _mm_unpackhi_ps(x, y);
+            // x0 y0 v0 x1 | y1 v1 x2 y2 | v2 x3 y3 v3
+            __m128 v0_x1 = _mm_shuffle_ps(v, xy_lo, _MM_SHUFFLE(2, 2, 0, 0));
+            __m128 y1_v1 = _mm_shuffle_ps(xy_lo, v, _MM_SHUFFLE(1, 1, 3, 3));
+            __m128 v2_x3 = _mm_shuffle_ps(v, xy_hi, _MM_SHUFFLE(2, 2, 2, 2));
+            __m128 y3_v3 = _mm_shuffle_ps(xy_hi, v, _MM_SHUFFLE(3, 3, 3, 3));
+            _mm_storeu_ps(&points[3 * i],
+                          _mm_shuffle_ps(xy_lo, v0_x1, _MM_SHUFFLE(2, 0, 1, 0)));
+            _mm_storeu_ps(&points[3 * i + 4],
+                          _mm_shuffle_ps(y1_v1, xy_hi, _MM_SHUFFLE(1, 0, 2, 0)));
+            _mm_storeu_ps(&points[3 * i + 8],
+                          _mm_shuffle_ps(v2_x3, y3_v3, _MM_SHUFFLE(2, 0, 2, 0)));
+        }
+    }
+#elif defined(URG_XY_NEON)
+    if (!intensities) {
+        for (; i + 4 <= n; i += 4) {
+            float32x4_t r = vld1q_f32(&ranges[i]);
+            float32x4x2_t xy;
+            xy.val[0] = vmulq_f32(r, vld1q_f32(&cos_table[i]));
+            xy.val[1] = vmulq_f32(r, vld1q_f32(&sin_table[i]));
+            vst2q_f32(&points[2 * i], xy);
+        }
+    } else {
+        for (; i + 4 <= n; i += 4) {
+            float32x4_t r = vld1q_f32(&ranges[i]);
+            float32x4x3_t xyv;
+            xyv.val[0] = vmulq_f32(r, vld1q_f32(&cos_table[i]));
+            xyv.val[1] = vmulq_f32(r, vld1q_f32(&sin_table[i]));
+            xyv.val[2] = vld1q_f32(&intensities[i]);
+            vst3q_f32(&points[3 * i], xyv);
+        }
+    }
+#endif
+
+    for (; i < n; ++i) {
+        if (!intensities) {
+            points[2 * i] = ranges[i] * cos_table[i];
+            points[2 * i + 1] = ranges[i] * sin_table[i];
+        } else {
+            points[3 * i] = ranges[i] * cos_table[i];
+            points[3 * i + 1] = ranges[i] * sin_table[i];
+            points[3 * i + 2] = intensities[i];
+        }
+    }
+}
+
+
+int urg_get_xy(const urg_t *urg, const float ranges[],
+               const float intensities[], int data_n, float points[])
+{
+    int stride = intensities ? 3 : 2;
+    int table_n;
+    int i;
+
+    if (!urg->is_active) {
+        return URG_NOT_CONNECTED;
+    }
+    if (data_n < 0) {
+        return URG_INVALID_PARAMETER;
+    }
+
+    table_n = min(data_n, urg->angle_table_size);
+    polar_to_xy(urg->cos_table, urg->sin_table, ranges, intensities,
+                table_n, points);
+
+    // \~japanese e[u͈̔͊Õf[^͊pxvZ
+    // \~english Computes the data points outside of the table from their angle
+    for (i = table_n; i < data_n; ++i) {
+        double radian = urg_index2rad(urg, i);
+        points[stride * i] = (float)(ranges[i] * cos(radian));
+        points[stride * i + 1] = (float)(ranges[i] * sin(radian));
+        if (intensities) {
+            points[stride * i + 2] = intensities[i];
+        }
+    }
+    return data_n;
+}
+
+
 void urg_delay(int delay_msec)
 {
 #if defined(URG_WINDOWS_OS)